@@ -0,0 +1,89 @@
+#include "ahocorasick.h"
+#include <QQueue>
+#include <algorithm>
+#include <cstring>
+
+static quint8 fold(quint8 byte, bool ignoreCase) {
+  return ignoreCase && byte >= 'A' && byte <= 'Z' ? byte + ('a' - 'A') : byte;
+}
+
+AhoCorasick::AhoCorasick() { build(QList<QByteArray>()); }
+
+void AhoCorasick::build(const QList<QByteArray> &patterns, bool ignoreCase) {
+  // class 0 is every byte that no pattern uses
+  memset(classOf, 0, sizeof(classOf));
+  classes = 1;
+  for (auto &pattern : patterns) {
+    for (auto ch : pattern) {
+      quint8 byte = fold(ch, ignoreCase);
+      if (!classOf[byte]) {
+        classOf[byte] = classes++;
+      }
+    }
+  }
+  if (ignoreCase) {
+    for (int byte = 'A'; byte <= 'Z'; byte++) {
+      classOf[byte] = classOf[byte + ('a' - 'A')];
+    }
+  }
+
+  // trie, -1 for missing edges
+  patternCount = patterns.size();
+  lengths.clear();
+  delta.fill(-1, classes);
+  QVector<QVector<int>> output(1);
+  for (int i = 0; i < patterns.size(); i++) {
+    lengths.append(patterns[i].length());
+    if (patterns[i].isEmpty()) {
+      continue;
+    }
+    int state = 0;
+    for (auto ch : patterns[i]) {
+      int edge = state * classes + classOf[(quint8)ch];
+      if (delta[edge] < 0) {
+        int base = delta.size();
+        delta.resize(base + classes);
+        std::fill(delta.begin() + base, delta.end(), -1);
+        delta[edge] = output.size();
+        output.append(QVector<int>());
+      }
+      state = delta[edge];
+    }
+    output[state].append(i);
+  }
+
+  // breadth first: fill missing edges from the failure state, which is
+  // always shallower and so already complete
+  QVector<int> fail(output.size(), 0);
+  QQueue<int> queue;
+  for (int c = 0; c < classes; c++) {
+    int &edge = delta[c];
+    if (edge < 0) {
+      edge = 0;
+    } else {
+      queue.enqueue(edge);
+    }
+  }
+  while (!queue.isEmpty()) {
+    int state = queue.dequeue();
+    output[state] += output[fail[state]];
+    for (int c = 0; c < classes; c++) {
+      int &edge = delta[state * classes + c];
+      int fallback = delta[fail[state] * classes + c];
+      if (edge < 0) {
+        edge = fallback;
+      } else {
+        fail[edge] = fallback;
+        queue.enqueue(edge);
+      }
+    }
+  }
+
+  matchBegin.clear();
+  matchList.clear();
+  for (auto &matches : output) {
+    matchBegin.append(matchList.size());
+    matchList += matches;
+  }
+  matchBegin.append(matchList.size());
+}
@@ -0,0 +1,48 @@
+#ifndef AHOCORASICK_H
+#define AHOCORASICK_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+// Aho-Corasick automaton over bytes, compiled into a full DFA so that
+// advancing costs one table lookup per byte however many patterns there
+// are. Bytes that appear in no pattern share one column, which keeps the
+// table small. State is a plain int, so matching can be resumed across
+// chunk boundaries by keeping it.
+class AhoCorasick {
+public:
+  AhoCorasick();
+
+  // patterns are numbered in the order given, empty ones never match;
+  // ignoreCase folds ASCII letters
+  void build(const QList<QByteArray> &patterns, bool ignoreCase = false);
+  bool isEmpty() const { return patternCount == 0; }
+
+  static int start() { return 0; }
+  int next(int state, quint8 byte) const {
+    return delta[state * classes + classOf[byte]];
+  }
+  // patterns ending at this state
+  bool hasMatches(int state) const {
+    return matchBegin[state] != matchBegin[state + 1];
+  }
+  const int *matchesBegin(int state) const {
+    return matchList.constData() + matchBegin[state];
+  }
+  const int *matchesEnd(int state) const {
+    return matchList.constData() + matchBegin[state + 1];
+  }
+  int patternLength(int pattern) const { return lengths[pattern]; }
+
+private:
+  quint16 classOf[256];
+  int classes;
+  int patternCount;
+  QVector<qint32> delta;
+  QVector<int> matchBegin;
+  QVector<int> matchList;
+  QVector<int> lengths;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "autoresponder.h"
+#include "sendscheduler.h"
+#include <algorithm>
+
+// delayed replies beyond this are dropped rather than queued
+#define MAX_PENDING_REPLIES 4096
+// the last stretch before a deadline is slept precisely instead of on the
+// wait condition, whose timeout only has millisecond resolution
+#define PRECISE_WINDOW_NS 2000000LL
+
+AutoResponder::AutoResponder(const QVector<ResponseRule> &rules,
+                             SerialPort *port, QObject *parent)
+    : QObject(parent) {
+  this->port = port;
+  state = AhoCorasick::start();
+  thread = nullptr;
+  shouldStop = 0;
+
+  QList<QByteArray> patterns;
+  bool delayed = false;
+  for (auto &rule : rules) {
+    patterns.append(rule.patternBytes());
+    responses.append(rule.responseBytes());
+    delays.append(qMax<qint64>(rule.delayUs, 0) * 1000);
+    delayed = delayed || rule.delayUs > 0;
+  }
+  automaton.build(patterns, false);
+  stats.resize(rules.size());
+  latencySums.fill(0, rules.size());
+
+  if (delayed) {
+    thread = QThread::create([this] { run(); });
+    thread->start(QThread::TimeCriticalPriority);
+  }
+}
+
+AutoResponder::~AutoResponder() {
+  if (thread) {
+    queueMutex.lock();
+    shouldStop = 1;
+    queueChanged.wakeAll();
+    queueMutex.unlock();
+    thread->wait();
+    delete thread;
+  }
+}
+
+void AutoResponder::process(const QByteArray &data, qint64 timestamp) {
+  if (automaton.isEmpty()) {
+    return;
+  }
+
+  auto p = (const quint8 *)data.constData();
+  int n = data.length();
+  for (int i = 0; i < n; i++) {
+    state = automaton.next(state, p[i]);
+    if (!automaton.hasMatches(state)) {
+      continue;
+    }
+    for (auto match = automaton.matchesBegin(state);
+         match != automaton.matchesEnd(state); match++) {
+      int rule = *match;
+      if (responses[rule].isEmpty()) {
+        continue;
+      }
+      if (delays[rule] == 0) {
+        port->write(responses[rule]);
+        record(rule, SerialPort::now() - timestamp);
+        emit replied(responses[rule]);
+        continue;
+      }
+
+      qint64 prompt = timestamp;
+      QMutexLocker locker(&queueMutex);
+      if (queue.size() >= MAX_PENDING_REPLIES) {
+        QMutexLocker statsLocker(&statsMutex);
+        stats[rule].dropped++;
+        continue;
+      }
+      queue.append(PendingReply{prompt + delays[rule], prompt, rule});
+      std::push_heap(queue.begin(), queue.end(), laterDeadline);
+      queueChanged.wakeAll();
+    }
+  }
+}
+
+void AutoResponder::run() {
+  QMutexLocker locker(&queueMutex);
+  while (!shouldStop) {
+    if (queue.isEmpty()) {
+      queueChanged.wait(&queueMutex);
+      continue;
+    }
+    qint64 remaining = queue.first().deadline - SerialPort::now();
+    if (remaining > PRECISE_WINDOW_NS) {
+      // woken early if a reply with an earlier deadline is queued
+      queueChanged.wait(&queueMutex,
+                        (remaining - PRECISE_WINDOW_NS) / 1000000 + 1);
+      continue;
+    }
+
+    std::pop_heap(queue.begin(), queue.end(), laterDeadline);
+    PendingReply reply = queue.takeLast();
+    locker.unlock();
+    SendScheduler::sleepUntil(reply.deadline);
+    port->write(responses[reply.rule]);
+    record(reply.rule, SerialPort::now() - reply.prompt);
+    emit replied(responses[reply.rule]);
+    locker.relock();
+  }
+}
+
+void AutoResponder::record(int rule, qint64 latencyNs) {
+  QMutexLocker locker(&statsMutex);
+  auto &s = stats[rule];
+  if (s.replies == 0 || latencyNs < s.minNs) {
+    s.minNs = latencyNs;
+  }
+  if (s.replies == 0 || latencyNs > s.maxNs) {
+    s.maxNs = latencyNs;
+  }
+  s.replies++;
+  s.lastNs = latencyNs;
+  latencySums[rule] += latencyNs;
+  s.meanNs = latencySums[rule] / s.replies;
+}
+
+QVector<ResponderStatistics> AutoResponder::statistics() {
+  QMutexLocker locker(&statsMutex);
+  return stats;
+}
+
+void AutoResponder::resetStatistics() {
+  QMutexLocker locker(&statsMutex);
+  stats.fill(ResponderStatistics());
+  latencySums.fill(0);
+}
@@ -0,0 +1,85 @@
+#ifndef AUTORESPONDER_H
+#define AUTORESPONDER_H
+
+#include "ahocorasick.h"
+#include "drivers/serialport.h"
+#include "sendencoder.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+struct ResponseRule : public MatchRule {
+  // measured from the arrival of the chunk that completed the prompt
+  qint64 delayUs = 0;
+};
+
+// prompt to reply latency of one rule, from the arrival of the chunk on the
+// host to the reply being handed to the driver
+struct ResponderStatistics {
+  qint64 replies = 0;
+  qint64 dropped = 0; // delayed replies that did not fit in the queue
+  qint64 minNs = 0;
+  qint64 maxNs = 0;
+  qint64 meanNs = 0;
+  qint64 lastNs = 0;
+};
+
+// Answers prompts straight from the port's reader thread without a round
+// trip through the GUI. Replies without a delay are written while the chunk
+// is being processed; delayed ones are handed to a high priority thread
+// that sleeps on absolute deadlines. The Respond action of a trigger is the
+// plain form of this, kept with the triggers so a prompt can be highlighted
+// or counted and answered by one rule; delays and latency statistics are
+// only here.
+class AutoResponder : public QObject, public ReceiveStage {
+  Q_OBJECT
+
+public:
+  AutoResponder(const QVector<ResponseRule> &rules, SerialPort *port,
+                QObject *parent = nullptr);
+  ~AutoResponder();
+
+  void process(const QByteArray &data, qint64 timestamp) override;
+  // indexed like the rules
+  QVector<ResponderStatistics> statistics();
+  void resetStatistics();
+
+signals:
+  // every reply handed to the port, for statistics and capture
+  void replied(QByteArray data);
+
+private:
+  struct PendingReply {
+    qint64 deadline; // SerialPort::now() based
+    qint64 prompt;
+    int rule;
+  };
+
+  static bool laterDeadline(const PendingReply &a, const PendingReply &b) {
+    return a.deadline > b.deadline;
+  }
+  void run();
+  void record(int rule, qint64 latencyNs);
+
+  AhoCorasick automaton;
+  QVector<QByteArray> responses;
+  QVector<qint64> delays; // ns
+  SerialPort *port;
+  int state;
+
+  QThread *thread;
+  QAtomicInt shouldStop;
+  QMutex queueMutex;
+  QWaitCondition queueChanged;
+  // min-heap on deadline
+  QVector<PendingReply> queue;
+
+  QMutex statsMutex;
+  QVector<ResponderStatistics> stats;
+  QVector<qint64> latencySums;
+};
+
+#endif
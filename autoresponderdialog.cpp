@@ -0,0 +1,148 @@
+#include "autoresponderdialog.h"
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QSpinBox>
+#include <QTimer>
+
+#define COLUMN_PATTERN 0
+#define COLUMN_HEX 1
+#define COLUMN_RESPONSE 2
+#define COLUMN_DELAY 3
+#define COLUMN_REPLIES 4
+#define COLUMN_MIN 5
+#define COLUMN_MEAN 6
+#define COLUMN_MAX 7
+#define COLUMN_LAST 8
+
+static QString formatLatency(qint64 ns) {
+  return QString::number(ns / 1000.0, 'f', 1);
+}
+
+AutoResponderDialog::AutoResponderDialog(const QVector<ResponseRule> &rules,
+                                         AutoResponder *responder,
+                                         QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->responder = responder;
+  ruleTableWidget->horizontalHeader()->setSectionResizeMode(
+      COLUMN_PATTERN, QHeaderView::Stretch);
+  ruleTableWidget->horizontalHeader()->setSectionResizeMode(
+      COLUMN_RESPONSE, QHeaderView::Stretch);
+
+  for (int i = 0; i < rules.size(); i++) {
+    addRow(rules[i], i);
+  }
+  refreshStatistics();
+
+  auto timer = new QTimer(this);
+  connect(timer, SIGNAL(timeout()), this, SLOT(refreshStatistics()));
+  timer->start(250);
+}
+
+void AutoResponderDialog::addRow(const ResponseRule &rule, int origin) {
+  int row = ruleTableWidget->rowCount();
+  ruleTableWidget->insertRow(row);
+
+  auto pattern = new QTableWidgetItem(rule.pattern);
+  pattern->setData(Qt::UserRole, origin);
+  ruleTableWidget->setItem(row, COLUMN_PATTERN, pattern);
+
+  auto hex = new QTableWidgetItem();
+  hex->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+  hex->setCheckState(rule.hex ? Qt::Checked : Qt::Unchecked);
+  ruleTableWidget->setItem(row, COLUMN_HEX, hex);
+
+  ruleTableWidget->setItem(row, COLUMN_RESPONSE,
+                           new QTableWidgetItem(rule.response));
+
+  auto delay = new QSpinBox();
+  delay->setRange(0, 10000000);
+  delay->setSuffix(" us");
+  delay->setValue(rule.delayUs);
+  ruleTableWidget->setCellWidget(row, COLUMN_DELAY, delay);
+
+  for (int column = COLUMN_REPLIES; column <= COLUMN_LAST; column++) {
+    auto item = new QTableWidgetItem();
+    item->setFlags(Qt::ItemIsEnabled);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    ruleTableWidget->setItem(row, column, item);
+  }
+}
+
+QVector<ResponseRule> AutoResponderDialog::rules() const {
+  QVector<ResponseRule> result;
+  for (int row = 0; row < ruleTableWidget->rowCount(); row++) {
+    ResponseRule rule;
+    rule.pattern = ruleTableWidget->item(row, COLUMN_PATTERN)->text();
+    rule.hex =
+        ruleTableWidget->item(row, COLUMN_HEX)->checkState() == Qt::Checked;
+    rule.response = ruleTableWidget->item(row, COLUMN_RESPONSE)->text();
+    rule.delayUs =
+        ((QSpinBox *)ruleTableWidget->cellWidget(row, COLUMN_DELAY))->value();
+    result.append(rule);
+  }
+  return result;
+}
+
+void AutoResponderDialog::accept() {
+  auto all = rules();
+  for (int row = 0; row < all.size(); row++) {
+    QString error = all[row].validate();
+    if (!error.isEmpty()) {
+      ruleTableWidget->setCurrentCell(row, COLUMN_PATTERN);
+      QMessageBox::warning(this, windowTitle(),
+                           QString("Row %1: %2").arg(row + 1).arg(error));
+      return;
+    }
+  }
+  QDialog::accept();
+}
+
+void AutoResponderDialog::onAdd() {
+  addRow(ResponseRule(), -1);
+  ruleTableWidget->editItem(
+      ruleTableWidget->item(ruleTableWidget->rowCount() - 1, COLUMN_PATTERN));
+}
+
+void AutoResponderDialog::onRemove() {
+  int row = ruleTableWidget->currentRow();
+  if (row >= 0) {
+    ruleTableWidget->removeRow(row);
+  }
+}
+
+void AutoResponderDialog::onResetStatistics() {
+  if (responder) {
+    responder->resetStatistics();
+  }
+  refreshStatistics();
+}
+
+void AutoResponderDialog::refreshStatistics() {
+  QVector<ResponderStatistics> statistics;
+  if (responder) {
+    statistics = responder->statistics();
+  }
+  for (int row = 0; row < ruleTableWidget->rowCount(); row++) {
+    int origin =
+        ruleTableWidget->item(row, COLUMN_PATTERN)->data(Qt::UserRole).toInt();
+    QStringList texts;
+    if (origin >= 0 && origin < statistics.size()) {
+      auto &s = statistics.at(origin);
+      QString replies = QString::number(s.replies);
+      if (s.dropped) {
+        replies += QString(" (%1 dropped)").arg(s.dropped);
+      }
+      texts << replies;
+      if (s.replies) {
+        texts << formatLatency(s.minNs) << formatLatency(s.meanNs)
+              << formatLatency(s.maxNs) << formatLatency(s.lastNs);
+      }
+    }
+    for (int column = COLUMN_REPLIES; column <= COLUMN_LAST; column++) {
+      int index = column - COLUMN_REPLIES;
+      ruleTableWidget->item(row, column)
+          ->setText(index < texts.size() ? texts[index] : QString());
+    }
+  }
+}
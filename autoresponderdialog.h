@@ -0,0 +1,36 @@
+#ifndef AUTORESPONDERDIALOG_H
+#define AUTORESPONDERDIALOG_H
+
+#include "autoresponder.h"
+#include "ui_autoresponderdialog.h"
+#include <QDialog>
+#include <QPointer>
+
+class AutoResponderDialog : public QDialog, private Ui::AutoResponderDialog {
+  Q_OBJECT
+
+public:
+  // responder is the one running for rules, if the port is open, and is
+  // polled for latencies while the dialog is shown
+  AutoResponderDialog(const QVector<ResponseRule> &rules,
+                      AutoResponder *responder, QWidget *parent = nullptr);
+
+  QVector<ResponseRule> rules() const;
+
+public slots:
+  // refuses rules that do not decode
+  void accept() override;
+
+private slots:
+  void onAdd();
+  void onRemove();
+  void onResetStatistics();
+  void refreshStatistics();
+
+private:
+  void addRow(const ResponseRule &rule, int origin);
+
+  QPointer<AutoResponder> responder;
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "capture.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <cstring>
+
+#define CAPTURE_MAGIC "QSCAP01"
+#define CAPTURE_HEADER_SIZE 16
+#define CAPTURE_RECORD_SIZE 16
+#define RAW_CHUNK_SIZE 4096
+
+CaptureWriter::CaptureWriter() {}
+
+CaptureWriter::~CaptureWriter() { close(); }
+
+bool CaptureWriter::open(const QString &fileName) {
+  close();
+  file.setFileName(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    return false;
+  }
+
+  char header[CAPTURE_HEADER_SIZE] = {0};
+  memcpy(header, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+  qToLittleEndian<quint64>(QDateTime::currentMSecsSinceEpoch(), header + 8);
+  file.write(header, sizeof(header));
+  clock.start();
+  return true;
+}
+
+void CaptureWriter::close() {
+  if (file.isOpen()) {
+    file.close();
+  }
+}
+
+void CaptureWriter::write(Capture::Direction direction, const QByteArray &data,
+                          qint64 timestamp) {
+  if (!file.isOpen() || data.isEmpty()) {
+    return;
+  }
+  if (timestamp < 0) {
+    timestamp = clock.nsecsElapsed();
+  }
+
+  char record[CAPTURE_RECORD_SIZE] = {0};
+  qToLittleEndian<quint64>(timestamp, record);
+  qToLittleEndian<quint32>(data.length(), record + 8);
+  record[12] = direction;
+  file.write(record, sizeof(record));
+  file.write(data);
+}
+
+CaptureReader::CaptureReader() {
+  base = nullptr;
+  length = 0;
+  pos = 0;
+  startMSecs = 0;
+  timed = false;
+}
+
+CaptureReader::~CaptureReader() { close(); }
+
+bool CaptureReader::open(const QString &fileName) {
+  close();
+  file.setFileName(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = file.errorString();
+    return false;
+  }
+  length = file.size();
+  if (length == 0) {
+    error = "Empty file";
+    file.close();
+    return false;
+  }
+  base = file.map(0, length);
+  if (!base) {
+    error = file.errorString();
+    file.close();
+    return false;
+  }
+
+  timed = length >= CAPTURE_HEADER_SIZE &&
+          memcmp(base, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) == 0;
+  startMSecs = timed ? qFromLittleEndian<quint64>(base + 8) : 0;
+  rewind();
+  return true;
+}
+
+void CaptureReader::close() {
+  if (base) {
+    file.unmap(base);
+    base = nullptr;
+  }
+  if (file.isOpen()) {
+    file.close();
+  }
+  length = 0;
+  pos = 0;
+}
+
+void CaptureReader::rewind() { pos = timed ? CAPTURE_HEADER_SIZE : 0; }
+
+bool CaptureReader::next(Record &record) {
+  if (!base || pos >= length) {
+    return false;
+  }
+
+  if (!timed) {
+    // raw file: fixed size chunks, no timing information
+    record.timestamp = 0;
+    record.direction = Capture::Received;
+    record.data = (const char *)base + pos;
+    record.length = qMin<qint64>(RAW_CHUNK_SIZE, length - pos);
+    record.offset = pos;
+    pos += record.length;
+    return true;
+  }
+
+  if (length - pos < CAPTURE_RECORD_SIZE) {
+    // truncated trailing header, e.g. capture still being written
+    return false;
+  }
+  const uchar *header = base + pos;
+  quint32 size = qFromLittleEndian<quint32>(header + 8);
+  if (length - pos - CAPTURE_RECORD_SIZE < size) {
+    return false;
+  }
+  record.timestamp = qFromLittleEndian<quint64>(header);
+  record.direction = (Capture::Direction)header[12];
+  record.data = (const char *)header + CAPTURE_RECORD_SIZE;
+  record.length = size;
+  record.offset = pos + CAPTURE_RECORD_SIZE;
+  pos += CAPTURE_RECORD_SIZE + size;
+  return true;
+}
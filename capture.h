@@ -0,0 +1,79 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+
+// On-disk capture of a session. A 16 byte file header is followed by
+// records, each a 16 byte record header and `length` bytes of payload.
+// All integers are little endian. Files without the magic are read back
+// as a raw byte stream without timing.
+
+namespace Capture {
+// a Bookmark payload is a UTF-8 label marking a point of interest
+enum Direction : quint8 { Received = 0, Sent = 1, Bookmark = 2 };
+}
+
+class CaptureWriter {
+public:
+  CaptureWriter();
+  ~CaptureWriter();
+
+  bool open(const QString &fileName);
+  bool isOpen() const { return file.isOpen(); }
+  void close();
+  // timestamp is in ns since open(), -1 to use the current time
+  void write(Capture::Direction direction, const QByteArray &data,
+             qint64 timestamp = -1);
+  qint64 elapsed() const { return clock.nsecsElapsed(); }
+  QString fileName() const { return file.fileName(); }
+  QString errorString() const { return file.errorString(); }
+
+private:
+  QFile file;
+  QElapsedTimer clock;
+};
+
+class CaptureReader {
+public:
+  struct Record {
+    qint64 timestamp; // ns since the start of the capture
+    Capture::Direction direction;
+    const char *data;
+    quint32 length;
+    qint64 offset; // of the payload within the file
+  };
+
+  CaptureReader();
+  ~CaptureReader();
+
+  bool open(const QString &fileName);
+  void close();
+  bool isOpen() const { return base != nullptr; }
+  // false if the file has no record headers
+  bool hasTiming() const { return timed; }
+  // wall clock time of the capture start, ms since epoch
+  qint64 startTime() const { return startMSecs; }
+  qint64 size() const { return length; }
+  const char *data() const { return (const char *)base; }
+  QString errorString() const { return error; }
+
+  bool next(Record &record);
+  void rewind();
+  // file offset of the next record
+  qint64 position() const { return pos; }
+  // offset must have been returned by position()
+  void seek(qint64 offset) { pos = offset; }
+
+private:
+  QFile file;
+  uchar *base;
+  qint64 length;
+  qint64 pos;
+  qint64 startMSecs;
+  bool timed;
+  QString error;
+};
+
+#endif
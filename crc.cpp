@@ -0,0 +1,73 @@
+#include "crc.h"
+
+namespace {
+
+struct Crc16XmodemTable {
+  quint16 table[256];
+  Crc16XmodemTable() {
+    for (int i = 0; i < 256; i++) {
+      quint16 crc = i << 8;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+      }
+      table[i] = crc;
+    }
+  }
+};
+
+struct Crc16ModbusTable {
+  quint16 table[256];
+  Crc16ModbusTable() {
+    for (int i = 0; i < 256; i++) {
+      quint16 crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+      }
+      table[i] = crc;
+    }
+  }
+};
+
+struct Crc32Table {
+  quint32 table[256];
+  Crc32Table() {
+    for (quint32 i = 0; i < 256; i++) {
+      quint32 crc = i;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+      }
+      table[i] = crc;
+    }
+  }
+};
+
+const Crc16XmodemTable crc16XmodemTable;
+const Crc16ModbusTable crc16ModbusTable;
+const Crc32Table crc32Table;
+
+} // namespace
+
+quint16 crc16Xmodem(const void *data, qint64 length, quint16 crc) {
+  auto p = (const quint8 *)data;
+  for (qint64 i = 0; i < length; i++) {
+    crc = (crc << 8) ^ crc16XmodemTable.table[((crc >> 8) ^ p[i]) & 0xff];
+  }
+  return crc;
+}
+
+quint16 crc16Modbus(const void *data, qint64 length, quint16 crc) {
+  auto p = (const quint8 *)data;
+  for (qint64 i = 0; i < length; i++) {
+    crc = (crc >> 8) ^ crc16ModbusTable.table[(crc ^ p[i]) & 0xff];
+  }
+  return crc;
+}
+
+quint32 crc32(const void *data, qint64 length, quint32 crc) {
+  auto p = (const quint8 *)data;
+  crc = ~crc;
+  for (qint64 i = 0; i < length; i++) {
+    crc = (crc >> 8) ^ crc32Table.table[(crc ^ p[i]) & 0xff];
+  }
+  return ~crc;
+}
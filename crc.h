@@ -0,0 +1,18 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <QtGlobal>
+
+// Table driven CRCs. Pass the previous result back in to continue a
+// running checksum over several buffers.
+
+// CRC-16/XMODEM: poly 0x1021, init 0, not reflected (XMODEM, ZMODEM)
+quint16 crc16Xmodem(const void *data, qint64 length, quint16 crc = 0);
+// CRC-16/MODBUS: poly 0xA001 reflected, init 0xFFFF. The CRC over a whole
+// RTU frame including its trailing checksum is 0.
+quint16 crc16Modbus(const void *data, qint64 length, quint16 crc = 0xFFFF);
+// CRC-32/ISO-HDLC as used by ZMODEM and zlib; init and xorout are handled
+// internally, so chaining works like the 16 bit variants
+quint32 crc32(const void *data, qint64 length, quint32 crc = 0);
+
+#endif
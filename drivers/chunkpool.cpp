@@ -0,0 +1,90 @@
+#include "chunkpool.h"
+#include <QAtomicInteger>
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#endif
+
+static QAtomicInteger<qint64> allocationCount;
+static QAtomicInteger<qint64> reuseCount;
+
+ChunkPool::ChunkPool(int blockSize, int maxBlocks) {
+  size = blockSize;
+  this->maxBlocks = maxBlocks;
+  next = 0;
+  locked = false;
+}
+
+ChunkPool::~ChunkPool() {
+  for (auto &block : blocks) {
+    release(block);
+  }
+  release(current);
+}
+
+void ChunkPool::release(const QByteArray &block) {
+#ifdef Q_OS_UNIX
+  // receivers may hold it a while longer, unlocked from here on
+  if (lockedBlocks.remove(block.constData())) {
+    munlock(block.constData(), size);
+  }
+#else
+  Q_UNUSED(block);
+#endif
+}
+
+char *ChunkPool::take() {
+  if (!current.isNull()) {
+    return current.data();
+  }
+  for (int i = 0; i < blocks.size(); i++) {
+    int at = (next + i) % blocks.size();
+    if (blocks[at].isDetached()) {
+      // only the pool holds it, taking it out keeps data() from copying
+      current.swap(blocks[at]);
+      blocks.removeAt(at);
+      next = at;
+      // within the allocation, cutting it to length did not shrink it
+      current.resize(size);
+      reuseCount.fetchAndAddRelaxed(1);
+      return current.data();
+    }
+  }
+  current = QByteArray(size, Qt::Uninitialized);
+  allocationCount.fetchAndAddRelaxed(1);
+#ifdef Q_OS_UNIX
+  if (locked) {
+    if (mlock(current.constData(), size) == 0) {
+      lockedBlocks.insert(current.constData());
+    } else {
+      qWarning() << "mlock:" << strerror(errno);
+      locked = false;
+    }
+  }
+#endif
+  return current.data();
+}
+
+QByteArray ChunkPool::finish(int length) {
+  if (length * 2 < size) {
+    // the block stays current and is taken again next time
+    allocationCount.fetchAndAddRelaxed(1);
+    return QByteArray(current.constData(), length);
+  }
+  current.resize(length);
+  QByteArray chunk;
+  chunk.swap(current);
+  if (blocks.size() < maxBlocks) {
+    blocks.append(chunk);
+  } else {
+    release(chunk);
+  }
+  return chunk;
+}
+
+qint64 ChunkPool::allocations() { return allocationCount.loadAcquire(); }
+
+qint64 ChunkPool::reuses() { return reuseCount.loadAcquire(); }
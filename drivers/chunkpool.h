@@ -0,0 +1,53 @@
+#ifndef CHUNKPOOL_H
+#define CHUNKPOOL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+
+// blocks kept per reader, more than this in flight are not recycled
+#define CHUNK_POOL_BLOCKS 32
+
+// Fixed-size receive buffers recycled by one reader thread, so delivering
+// every read as its own QByteArray does not cost an allocation each time.
+// The reader fills a block in place and delivers it; stages, socket
+// clients, capture and the GUI queue share that QByteArray without a copy
+// as usual. The pool keeps a reference of its own and a block is free
+// again once that is the only one left, so the implicit sharing refcount
+// does all the bookkeeping. A read that fills less than half a block is
+// copied out instead, since queues downstream bound themselves by length()
+// and a short chunk would otherwise pin a whole block.
+class ChunkPool {
+public:
+  explicit ChunkPool(int blockSize, int maxBlocks = CHUNK_POOL_BLOCKS);
+  ~ChunkPool();
+
+  // a block of blockSize() bytes that no receiver holds; calling it again
+  // without finish() hands out the same block
+  char *take();
+  // the taken block cut to length, at least 1, to be delivered
+  QByteArray finish(int length);
+  int blockSize() const { return size; }
+  // blocks allocated from now on are locked in RAM while the pool tracks
+  // them, see ReaderTuning
+  void setLocked(bool locked) { this->locked = locked; }
+
+  // process-wide, blocks and short copies allocated, blocks handed out
+  // again
+  static qint64 allocations();
+  static qint64 reuses();
+
+private:
+  int size;
+  int maxBlocks;
+  QList<QByteArray> blocks; // delivered, possibly still held elsewhere
+  int next;                 // where the search for a free block starts
+  bool locked;
+  QSet<const char *> lockedBlocks;
+  QByteArray current;
+
+  // before a block leaves the pool's hands for good
+  void release(const QByteArray &block);
+};
+
+#endif
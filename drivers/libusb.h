@@ -1,8 +1,11 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#ifdef QSERIAL_USB_EMULATOR
+#include "usbemulator.h"
+#else
 #include <libusb.h>
+#endif
 extern libusb_context *context;
 
 #endif
-
@@ -0,0 +1,168 @@
+#ifndef PRBS_H
+#define PRBS_H
+
+#include <QtAlgorithms>
+#include <QtGlobal>
+
+// bytes in a row PrbsChecker must predict right before it locks
+#define PRBS_LOCK_BYTES 4
+// locked, this many bit errors within PRBS_SLIP_WINDOW bytes mean the stream
+// slipped by a lost or extra byte rather than took bit errors
+#define PRBS_SLIP_WINDOW 16
+#define PRBS_SLIP_ERRORS 16
+
+// the LFSR's second tap for order: 7, 9, 15, 23 or 31, anything else is
+// changed to 15
+static inline int prbsTap(int &order) {
+  switch (order) {
+  case 7:
+    return 6;
+  case 9:
+    return 5;
+  case 23:
+    return 18;
+  case 31:
+    return 28;
+  default:
+    order = 15;
+    return 14;
+  }
+}
+
+// Pseudo-random binary sequences from ITU-T O.150, generated by a Fibonacci
+// LFSR and packed MSB first into bytes. The period is 2^order - 1 bits.
+class Prbs {
+public:
+  // 7, 9, 15, 23 or 31, anything else falls back to 15
+  explicit Prbs(int order = 15, quint32 seed = 0xFFFFFFFF) {
+    tap = prbsTap(order);
+    this->order = order;
+    mask = (1u << order) - 1;
+    state = seed & mask;
+    if (state == 0) {
+      // the all-zero state never leaves itself
+      state = mask;
+    }
+  }
+
+  int getOrder() const { return order; }
+
+  int nextBit() {
+    int bit = ((state >> (order - 1)) ^ (state >> (tap - 1))) & 1;
+    state = ((state << 1) | bit) & mask;
+    return bit;
+  }
+
+  quint8 nextByte() {
+    quint8 byte = 0;
+    for (int i = 0; i < 8; i++) {
+      byte = (byte << 1) | nextBit();
+    }
+    return byte;
+  }
+
+  void fill(char *data, qint64 length) {
+    for (qint64 i = 0; i < length; i++) {
+      data[i] = nextByte();
+    }
+  }
+
+private:
+  int order;
+  int tap;
+  quint32 mask;
+  quint32 state;
+};
+
+// Verifies a received PRBS without knowing where it started. Searching, it
+// predicts every bit from the order bits received before it, as the
+// generator's LFSR does, and locks once PRBS_LOCK_BYTES bytes in a row
+// match. Locked, it runs on from its own state so that each bit error
+// counts once, and goes back to searching when the errors show a slip; the
+// bits of the window that slipped are taken back out of the counts.
+class PrbsChecker {
+public:
+  explicit PrbsChecker(int order = 15) {
+    tap = prbsTap(order);
+    this->order = order;
+    mask = (1u << order) - 1;
+    state = 0;
+    history = 0;
+    matched = 0;
+    locked = false;
+    windowBytes = 0;
+    windowErrors = 0;
+    bits = 0;
+    errors = 0;
+    slips = 0;
+    unverified = 0;
+  }
+
+  void check(const char *data, qint64 length) {
+    for (qint64 i = 0; i < length; i++) {
+      quint8 received = data[i];
+      quint8 expected = 0;
+      for (int b = 7; b >= 0; b--) {
+        int bit = ((state >> (order - 1)) ^ (state >> (tap - 1))) & 1;
+        expected = (expected << 1) | bit;
+        int next = locked ? bit : (received >> b) & 1;
+        state = ((state << 1) | next) & mask;
+      }
+      int wrong = qPopulationCount((quint8)(expected ^ received));
+      if (locked) {
+        bits += 8;
+        errors += wrong;
+        windowBytes++;
+        windowErrors += wrong;
+        if (windowErrors >= PRBS_SLIP_ERRORS) {
+          bits -= windowBytes * 8;
+          errors -= windowErrors;
+          unverified += windowBytes;
+          slips++;
+          locked = false;
+          history = 0;
+          matched = 0;
+        } else if (windowBytes == PRBS_SLIP_WINDOW) {
+          windowBytes = 0;
+          windowErrors = 0;
+        }
+      } else {
+        unverified++;
+        // predictions only hold once order bits came before the byte
+        matched = history >= order && wrong == 0 ? matched + 1 : 0;
+        history = qMin(history + 8, order);
+        if (matched == PRBS_LOCK_BYTES) {
+          locked = true;
+          windowBytes = 0;
+          windowErrors = 0;
+        }
+      }
+    }
+  }
+
+  bool isLocked() const { return locked; }
+  // bits compared while locked and how many of them were wrong
+  qint64 getBits() const { return bits; }
+  qint64 getErrors() const { return errors; }
+  // times the lock was lost to a lost or extra byte
+  qint64 getSlips() const { return slips; }
+  // bytes that went by while searching
+  qint64 getUnverified() const { return unverified; }
+
+private:
+  int order;
+  int tap;
+  quint32 mask;
+  quint32 state;
+  int history; // bits received since searching began, up to order
+  int matched;
+  bool locked;
+  int windowBytes;
+  int windowErrors;
+  qint64 bits;
+  qint64 errors;
+  qint64 slips;
+  qint64 unverified;
+};
+
+#endif
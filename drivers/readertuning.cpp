@@ -0,0 +1,120 @@
+#include "readertuning.h"
+#include <QSettings>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#endif
+
+static QString settingsGroup(const QString &portName) {
+  QString name = portName;
+  name.replace('/', '_').replace('\\', '_');
+  return QString("reader/%1/").arg(name);
+}
+
+ReaderTuning ReaderTuning::load(const QString &portName) {
+  QSettings settings;
+  QString group = settingsGroup(portName);
+  ReaderTuning tuning;
+  tuning.cpu = settings.value(group + "cpu", -1).toInt();
+  tuning.policy = (Policy)settings.value(group + "policy", Normal).toInt();
+  tuning.priority = settings.value(group + "priority", 50).toInt();
+  tuning.lockMemory = settings.value(group + "lockMemory", false).toBool();
+  tuning.readMode =
+      (ReadMode)settings.value(group + "readMode", Bulk).toInt();
+  return tuning;
+}
+
+void ReaderTuning::save(const QString &portName) const {
+  QSettings settings;
+  QString group = settingsGroup(portName);
+  settings.setValue(group + "cpu", cpu);
+  settings.setValue(group + "policy", policy);
+  settings.setValue(group + "priority", priority);
+  settings.setValue(group + "lockMemory", lockMemory);
+  settings.setValue(group + "readMode", readMode);
+}
+
+bool ReaderTuning::apply(QString *error) const {
+  bool ok = true;
+#ifdef Q_OS_LINUX
+  if (cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+      *error += QString("CPU %1: %2. ").arg(cpu).arg(strerror(rc));
+      ok = false;
+    }
+  }
+  if (policy != Normal) {
+    int schedPolicy = policy == Fifo ? SCHED_FIFO : SCHED_RR;
+    struct sched_param param = {};
+    param.sched_priority =
+        qBound(sched_get_priority_min(schedPolicy), priority,
+               sched_get_priority_max(schedPolicy));
+    int rc = pthread_setschedparam(pthread_self(), schedPolicy, &param);
+    if (rc != 0) {
+      *error += QString("%1 priority %2: %3. ")
+                    .arg(policy == Fifo ? "SCHED_FIFO" : "SCHED_RR")
+                    .arg(param.sched_priority)
+                    .arg(strerror(rc));
+      ok = false;
+    }
+  }
+#else
+  if (cpu >= 0 || policy != Normal) {
+    *error += "CPU affinity and real-time priority need Linux. ";
+    ok = false;
+  }
+#endif
+  return ok;
+}
+
+SchedulingLatency::SchedulingLatency() { reset(); }
+
+void SchedulingLatency::record(qint64 expected, qint64 actual) {
+  // early is on time, the data was already waiting
+  qint64 late = qMax<qint64>(0, actual - expected);
+  qint64 us = late / 1000;
+  int bucket = 0;
+  while (us && bucket < LATENCY_BUCKETS - 1) {
+    us >>= 1;
+    bucket++;
+  }
+  buckets[bucket].fetchAndAddRelaxed(1);
+  samples.fetchAndAddRelaxed(1);
+  totalNs.fetchAndAddRelaxed(late);
+  qint64 max = maxNs.loadAcquire();
+  while (late > max && !maxNs.testAndSetRelaxed(max, late, max)) {
+  }
+}
+
+void SchedulingLatency::reset() {
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    buckets[i] = 0;
+  }
+  samples = 0;
+  totalNs = 0;
+  maxNs = 0;
+}
+
+SchedulingLatency::Summary SchedulingLatency::summary() const {
+  Summary summary;
+  summary.samples = samples.loadAcquire();
+  summary.meanNs =
+      summary.samples ? totalNs.loadAcquire() / summary.samples : 0;
+  summary.maxNs = maxNs.loadAcquire();
+  summary.p99Ns = 0;
+  qint64 counted = 0;
+  for (int i = 0; i < LATENCY_BUCKETS && summary.samples; i++) {
+    counted += buckets[i].loadAcquire();
+    if (counted * 100 >= summary.samples * 99) {
+      summary.p99Ns = qMin(((qint64)1 << i) * 1000, summary.maxNs);
+      break;
+    }
+  }
+  return summary;
+}
@@ -0,0 +1,62 @@
+#ifndef READERTUNING_H
+#define READERTUNING_H
+
+#include <QAtomicInteger>
+#include <QString>
+
+// buckets of the latency histogram, bucket i counts up to 2^i us
+#define LATENCY_BUCKETS 24
+
+// How a port's reader thread is scheduled, so that a loaded machine does
+// not leave it waiting while the adapter's FIFO overflows, and how the USB
+// drivers size their reads. Applies on the next open() except for readMode,
+// stored per port.
+struct ReaderTuning {
+  enum Policy { Normal, Fifo, RoundRobin };
+  // LowLatency reads a packet at a time and delivers it at once; Bulk reads
+  // large transfers and holds data back briefly to deliver bigger chunks
+  enum ReadMode { LowLatency, Bulk };
+
+  // CPU to pin the reader to, -1 for any
+  int cpu = -1;
+  Policy policy = Normal;
+  // 1 (lowest) to 99 for Fifo and RoundRobin
+  int priority = 50;
+  // keep the receive buffers in RAM
+  bool lockMemory = false;
+  // takes effect on the next read, without reopening; Bulk keeps the
+  // throughput of multi-packet reads unless latency is asked for
+  ReadMode readMode = Bulk;
+
+  static ReaderTuning load(const QString &portName);
+  void save(const QString &portName) const;
+  // Called on the thread to tune. What the system refuses, typically
+  // real-time priority without CAP_SYS_NICE or an rtprio limit, is left
+  // as it was and described in error.
+  bool apply(QString *error) const;
+};
+
+// How late reads come back compared to when they were due, recorded by the
+// reader thread and read from any thread.
+class SchedulingLatency {
+public:
+  struct Summary {
+    qint64 samples;
+    qint64 meanNs;
+    qint64 p99Ns; // upper bound of the bucket holding the 99th percentile
+    qint64 maxNs;
+  };
+
+  SchedulingLatency();
+  void record(qint64 expected, qint64 actual);
+  void reset();
+  Summary summary() const;
+
+private:
+  QAtomicInteger<qint64> buckets[LATENCY_BUCKETS];
+  QAtomicInteger<qint64> samples;
+  QAtomicInteger<qint64> totalNs;
+  QAtomicInteger<qint64> maxNs;
+};
+
+#endif
@@ -0,0 +1,218 @@
+#include "rfc2217.h"
+#include <QtEndian>
+#include <cstring>
+
+// longest subnegotiation kept, RFC 2217 ones are a few bytes
+#define MAX_SUB_LENGTH 256
+
+namespace Telnet {
+
+void Decoder::feed(const QByteArray &in, QByteArray &out,
+                   QVector<Event> &events) {
+  auto p = (const quint8 *)in.constData();
+  auto end = p + in.length();
+  while (p < end) {
+    if (state == Data) {
+      // plain data up to the next IAC in one go
+      auto iac = (const quint8 *)memchr(p, IAC, end - p);
+      auto stop = iac ? iac : end;
+      out.append((const char *)p, stop - p);
+      p = stop;
+      if (iac) {
+        state = Iac;
+        p++;
+      }
+      continue;
+    }
+
+    quint8 byte = *p++;
+    switch (state) {
+    case Iac:
+      if (byte == IAC) {
+        out.append((char)IAC);
+        state = Data;
+      } else if (byte >= WILL && byte <= DONT) {
+        verb = byte;
+        state = Option;
+      } else if (byte == SB) {
+        state = SubOption;
+      } else {
+        // NOP, GA and the like
+        state = Data;
+      }
+      break;
+    case Option:
+      events.append(Event{verb, byte, QByteArray()});
+      state = Data;
+      break;
+    case SubOption:
+      subOption = byte;
+      sub.clear();
+      state = Sub;
+      break;
+    case Sub:
+      if (byte == IAC) {
+        state = SubIac;
+      } else if (sub.length() < MAX_SUB_LENGTH) {
+        sub.append((char)byte);
+      }
+      break;
+    case SubIac:
+      if (byte == IAC) {
+        if (sub.length() < MAX_SUB_LENGTH) {
+          sub.append((char)IAC);
+        }
+        state = Sub;
+      } else {
+        if (byte == SE) {
+          events.append(Event{SB, subOption, sub});
+        }
+        state = Data;
+      }
+      break;
+    default:
+      state = Data;
+      break;
+    }
+  }
+}
+
+QByteArray escape(const QByteArray &data) {
+  if (!data.contains((char)IAC)) {
+    return data;
+  }
+  QByteArray result;
+  result.reserve(data.length() + 16);
+  for (auto byte : data) {
+    result.append(byte);
+    if ((quint8)byte == IAC) {
+      result.append(byte);
+    }
+  }
+  return result;
+}
+
+QByteArray negotiate(quint8 verb, quint8 option) {
+  QByteArray result;
+  result.append((char)IAC);
+  result.append((char)verb);
+  result.append((char)option);
+  return result;
+}
+
+} // namespace Telnet
+
+namespace Rfc2217 {
+
+QByteArray command(quint8 command, const QByteArray &value) {
+  QByteArray result;
+  result.append((char)Telnet::IAC);
+  result.append((char)Telnet::SB);
+  result.append((char)Telnet::COM_PORT_OPTION);
+  result.append((char)command);
+  result.append(Telnet::escape(value));
+  result.append((char)Telnet::IAC);
+  result.append((char)Telnet::SE);
+  return result;
+}
+
+QByteArray value32(quint32 value) {
+  char buffer[4];
+  qToBigEndian<quint32>(value, buffer);
+  return QByteArray(buffer, 4);
+}
+
+quint32 toValue32(const QByteArray &value) {
+  if (value.length() < 4) {
+    return 0;
+  }
+  return qFromBigEndian<quint32>(value.constData());
+}
+
+quint8 parityToWire(QSerialPort::Parity parity) {
+  switch (parity) {
+  case QSerialPort::NoParity:
+    return 1;
+  case QSerialPort::OddParity:
+    return 2;
+  case QSerialPort::EvenParity:
+    return 3;
+  case QSerialPort::MarkParity:
+    return 4;
+  case QSerialPort::SpaceParity:
+    return 5;
+  default:
+    return 0;
+  }
+}
+
+bool parityFromWire(quint8 value, QSerialPort::Parity *parity) {
+  static const QSerialPort::Parity parities[] = {
+      QSerialPort::NoParity, QSerialPort::OddParity, QSerialPort::EvenParity,
+      QSerialPort::MarkParity, QSerialPort::SpaceParity};
+  if (value < 1 || value > 5) {
+    return false;
+  }
+  *parity = parities[value - 1];
+  return true;
+}
+
+quint8 stopBitsToWire(QSerialPort::StopBits stopBits) {
+  switch (stopBits) {
+  case QSerialPort::OneStop:
+    return 1;
+  case QSerialPort::TwoStop:
+    return 2;
+  case QSerialPort::OneAndHalfStop:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+bool stopBitsFromWire(quint8 value, QSerialPort::StopBits *stopBits) {
+  switch (value) {
+  case 1:
+    *stopBits = QSerialPort::OneStop;
+    return true;
+  case 2:
+    *stopBits = QSerialPort::TwoStop;
+    return true;
+  case 3:
+    *stopBits = QSerialPort::OneAndHalfStop;
+    return true;
+  default:
+    return false;
+  }
+}
+
+quint8 flowControlToWire(QSerialPort::FlowControl flowControl) {
+  switch (flowControl) {
+  case QSerialPort::NoFlowControl:
+    return CONTROL_NO_FLOW;
+  case QSerialPort::SoftwareControl:
+    return CONTROL_XON_XOFF;
+  case QSerialPort::HardwareControl:
+    return CONTROL_HARDWARE;
+  default:
+    return CONTROL_REQUEST;
+  }
+}
+
+bool flowControlFromWire(quint8 value, QSerialPort::FlowControl *flowControl) {
+  switch (value) {
+  case CONTROL_NO_FLOW:
+    *flowControl = QSerialPort::NoFlowControl;
+    return true;
+  case CONTROL_XON_XOFF:
+    *flowControl = QSerialPort::SoftwareControl;
+    return true;
+  case CONTROL_HARDWARE:
+    *flowControl = QSerialPort::HardwareControl;
+    return true;
+  default:
+    return false;
+  }
+}
+
+} // namespace Rfc2217
@@ -0,0 +1,91 @@
+#ifndef RFC2217_H
+#define RFC2217_H
+
+#include <QByteArray>
+#include <QSerialPort>
+#include <QVector>
+
+// Telnet (RFC 854) framing and the COM port control option (RFC 2217),
+// shared by the client driver and the server.
+
+namespace Telnet {
+enum : quint8 {
+  SE = 240,
+  SB = 250,
+  WILL = 251,
+  WONT = 252,
+  DO = 253,
+  DONT = 254,
+  IAC = 255
+};
+enum : quint8 { BINARY = 0, SGA = 3, COM_PORT_OPTION = 44 };
+
+// Incremental decoder separating data from negotiation. verb is WILL, WONT,
+// DO, DONT or SB; payload is only set for SB.
+struct Event {
+  quint8 verb;
+  quint8 option;
+  QByteArray payload;
+};
+
+class Decoder {
+public:
+  // data goes to out, commands to events
+  void feed(const QByteArray &in, QByteArray &out, QVector<Event> &events);
+  void reset() { state = Data; }
+
+private:
+  enum State { Data, Iac, Option, SubOption, Sub, SubIac };
+  State state = Data;
+  quint8 verb = 0;
+  quint8 subOption = 0;
+  QByteArray sub;
+};
+
+QByteArray escape(const QByteArray &data);
+QByteArray negotiate(quint8 verb, quint8 option);
+} // namespace Telnet
+
+namespace Rfc2217 {
+// client to server, the server answers with the same command + SERVER
+enum : quint8 {
+  SET_BAUDRATE = 1,
+  SET_DATASIZE = 2,
+  SET_PARITY = 3,
+  SET_STOPSIZE = 4,
+  SET_CONTROL = 5,
+  NOTIFY_LINESTATE = 6,
+  NOTIFY_MODEMSTATE = 7,
+  FLOWCONTROL_SUSPEND = 8,
+  FLOWCONTROL_RESUME = 9,
+  SET_LINESTATE_MASK = 10,
+  SET_MODEMSTATE_MASK = 11,
+  PURGE_DATA = 12,
+  SERVER = 100
+};
+// SET_CONTROL values, 0 asks for the current flow control
+enum : quint8 {
+  CONTROL_REQUEST = 0,
+  CONTROL_NO_FLOW = 1,
+  CONTROL_XON_XOFF = 2,
+  CONTROL_HARDWARE = 3,
+  CONTROL_BREAK_ON = 5,
+  CONTROL_BREAK_OFF = 6
+};
+
+// IAC SB COM-PORT-OPTION command value IAC SE, value escaped
+QByteArray command(quint8 command, const QByteArray &value);
+QByteArray value32(quint32 value);
+quint32 toValue32(const QByteArray &value);
+
+// 0 where the wire value means "no change" or "query"; the *FromWire()
+// functions return false for it, and for anything else they do not know
+quint8 parityToWire(QSerialPort::Parity parity);
+bool parityFromWire(quint8 value, QSerialPort::Parity *parity);
+quint8 stopBitsToWire(QSerialPort::StopBits stopBits);
+bool stopBitsFromWire(quint8 value, QSerialPort::StopBits *stopBits);
+quint8 flowControlToWire(QSerialPort::FlowControl flowControl);
+bool flowControlFromWire(quint8 value, QSerialPort::FlowControl *flowControl);
+} // namespace Rfc2217
+
+#endif
@@ -1,9 +1,18 @@
 #include "serialport.h"
+#include "chunkpool.h"
+#include "serialportcdcacm.h"
 #include "serialportch34x.h"
 #include "serialportcp210x.h"
 #include "serialportpl2303.h"
 #include "serialportdummy.h"
+#include "serialportftdi.h"
+#include "serialportposix.h"
+#include "serialportpty.h"
 #include "serialportqt.h"
+#include "serialportrfc2217.h"
+#include <QDebug>
+#include <QDeadlineTimer>
+#include <QThread>
 
 SerialPort::SerialPort(QObject *parent) : QObject(parent) {
   currentBaudRate = QSerialPort::Baud115200;
@@ -11,6 +20,20 @@ SerialPort::SerialPort(QObject *parent) : QObject(parent) {
   currentParity = QSerialPort::NoParity;
   currentStopBits = QSerialPort::OneStop;
   currentFlowControl = QSerialPort::NoFlowControl;
+  pendingBytes = 0;
+  readModeValue = ReaderTuning().readMode;
+  worker = nullptr;
+  owner = nullptr;
+  lastStatus.open = false;
+  // the getters are not there yet
+  lastStatus.settings.baudRate = currentBaudRate;
+  lastStatus.settings.dataBits = currentDataBits;
+  lastStatus.settings.parity = currentParity;
+  lastStatus.settings.stopBits = currentStopBits;
+  lastStatus.settings.flowControl = currentFlowControl;
+  lastStatus.hasLineErrors = false;
+  lastStatus.lineErrors = LineErrors();
+  lastStatus.latency = latency.summary();
 }
 
 QList<SerialPort *> SerialPort::getAvailablePorts(QObject *parent) {
@@ -18,7 +41,238 @@ QList<SerialPort *> SerialPort::getAvailablePorts(QObject *parent) {
   result.append(SerialPortCP210X::availablePorts(parent));
   result.append(SerialPortCH34X::availablePorts(parent));
   result.append(SerialPortPL2303::availablePorts(parent));
+  result.append(SerialPortFTDI::availablePorts(parent));
+  result.append(SerialPortCDCACM::availablePorts(parent));
+#ifdef Q_OS_LINUX
+  result.append(SerialPortPosix::availablePorts(parent));
+  result.append(SerialPortPty::availablePorts(parent));
+#endif
   result.append(SerialPortQt::availablePorts(parent));
+  result.append(SerialPortRfc2217::availablePorts(parent));
   result.append(SerialPortDummy::availablePorts(parent));
   return result;
 }
+
+void SerialPort::write(const QByteArray &data) {
+  pendingBytes.fetchAndAddOrdered(data.length());
+  if (sendIsThreadSafe() || QThread::currentThread() == thread()) {
+    sendData(data);
+  } else {
+    QMetaObject::invokeMethod(this, "sendData", Qt::QueuedConnection,
+                              Q_ARG(QByteArray, data));
+  }
+}
+
+bool SerialPort::waitForBacklog(qint64 baseline, qint64 window,
+                                const QAtomicInt &stop) const {
+  while (!stop && bytesToWrite() - baseline > window) {
+    QThread::usleep(200);
+  }
+  return !stop;
+}
+
+qint64 SerialPort::now() {
+  return QDeadlineTimer::current(Qt::PreciseTimer).deadlineNSecs();
+}
+
+void SerialPort::addStage(ReceiveStage *stage) {
+  QMutexLocker locker(&stagesMutex);
+  stages.append(stage);
+}
+
+void SerialPort::removeStage(ReceiveStage *stage) {
+  QMutexLocker locker(&stagesMutex);
+  stages.removeAll(stage);
+}
+
+void SerialPort::deliver(const QByteArray &data, qint64 timestamp) {
+  if (data.isEmpty()) {
+    return;
+  }
+  if (timestamp < 0) {
+    timestamp = now();
+  }
+  {
+    QMutexLocker locker(&stagesMutex);
+    for (auto stage : stages) {
+      stage->process(data, timestamp);
+    }
+  }
+  emit receivedData(data);
+}
+
+void SerialPort::startWorker() {
+  if (worker) {
+    return;
+  }
+  // an object with a parent cannot change threads
+  owner = parent();
+  if (owner) {
+    setParent(nullptr);
+    ownerDestroyed = connect(owner, &QObject::destroyed, [this] {
+      owner = nullptr;
+      stopWorker();
+      delete this;
+    });
+  }
+  worker = new QThread();
+  worker->setObjectName(portName());
+  worker->start();
+  moveToThread(worker);
+}
+
+void SerialPort::stopWorker() {
+  if (!worker) {
+    return;
+  }
+  QThread *home = QThread::currentThread();
+  exec([this, home] {
+    if (isOpen()) {
+      close();
+    }
+    updateStatus();
+    // anything still posted follows the port back
+    moveToThread(home);
+  });
+  worker->quit();
+  worker->wait();
+  delete worker;
+  worker = nullptr;
+  if (owner) {
+    disconnect(ownerDestroyed);
+    setParent(owner);
+    owner = nullptr;
+  }
+}
+
+void SerialPort::post(std::function<void()> task) {
+  QMetaObject::invokeMethod(this, task, Qt::QueuedConnection);
+}
+
+void SerialPort::exec(std::function<void()> task) {
+  if (QThread::currentThread() == thread()) {
+    task();
+  } else {
+    QMetaObject::invokeMethod(this, task, Qt::BlockingQueuedConnection);
+  }
+}
+
+void SerialPort::openAsync(const PortSettings &settings) {
+  if (!worker && QThread::currentThread() == thread()) {
+    startWorker();
+  }
+  post([this, settings] {
+    bool ok = open();
+    if (ok) {
+      applySettings(settings);
+    }
+    updateStatus();
+    emit opened(ok);
+  });
+}
+
+void SerialPort::configureAsync(const PortSettings &settings) {
+  post([this, settings] {
+    applySettings(settings);
+    updateStatus();
+  });
+}
+
+void SerialPort::closeAsync() {
+  post([this] {
+    if (isOpen()) {
+      close();
+    }
+    updateStatus();
+  });
+}
+
+void SerialPort::breakAsync(uint msecs) {
+  post([this, msecs] { triggerBreak(msecs); });
+}
+
+void SerialPort::refreshStatusAsync() {
+  post([this] { updateStatus(); });
+}
+
+PortStatus SerialPort::status() {
+  QMutexLocker locker(&statusMutex);
+  return lastStatus;
+}
+
+void SerialPort::applySettings(const PortSettings &settings) {
+  setBaudRate(settings.baudRate);
+  setDataBits(settings.dataBits);
+  setParity(settings.parity);
+  setStopBits(settings.stopBits);
+  setFlowControl(settings.flowControl);
+  // not every driver keeps it, and there is no getter
+  currentFlowControl = settings.flowControl;
+}
+
+PortSettings SerialPort::currentSettings() {
+  PortSettings settings;
+  settings.baudRate = getBaudRate();
+  settings.dataBits = getDataBits();
+  settings.parity = getParity();
+  settings.stopBits = getStopBits();
+  settings.flowControl = currentFlowControl;
+  return settings;
+}
+
+void SerialPort::updateStatus() {
+  PortStatus status;
+  status.open = isOpen();
+  status.settings = currentSettings();
+  status.lineErrors = LineErrors();
+  status.hasLineErrors = getLineErrors(status.lineErrors);
+  status.latency = latency.summary();
+  {
+    QMutexLocker locker(&statusMutex);
+    lastStatus = status;
+  }
+  emit statusChanged();
+}
+
+void SerialPort::setReaderTuning(const ReaderTuning &tuning) {
+  QMutexLocker locker(&tuningMutex);
+  this->tuning = tuning;
+  readModeValue = tuning.readMode;
+}
+
+ReaderTuning SerialPort::readerTuning() {
+  QMutexLocker locker(&tuningMutex);
+  return tuning;
+}
+
+ReaderTuning SerialPort::tuneReaderThread(ChunkPool *pool) {
+  ReaderTuning tuning = readerTuning();
+  QString error;
+  if (!tuning.apply(&error)) {
+    qWarning() << portName() << error;
+  }
+  if (pool) {
+    pool->setLocked(tuning.lockMemory);
+  }
+  latency.reset();
+  return tuning;
+}
+
+void SerialPort::sampleRead(qint64 start, bool timedOut, int timeoutMs,
+                            int characters, bool full) {
+  qint64 expected;
+  if (timedOut) {
+    expected = start + timeoutMs * (qint64)1000000;
+  } else if (full && currentBaudRate > 0) {
+    // start, data, parity and stop bits
+    double bits = 1 + currentDataBits +
+                  (currentParity == QSerialPort::NoParity ? 0 : 1) +
+                  (currentStopBits == QSerialPort::OneAndHalfStop ? 1.5
+                   : currentStopBits == QSerialPort::TwoStop      ? 2
+                                                                   : 1);
+    expected = start + (qint64)(characters * bits * 1e9 / currentBaudRate);
+  } else {
+    return;
+  }
+  latency.record(expected, now());
+}
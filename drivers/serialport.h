@@ -1,8 +1,54 @@
 #ifndef SERIALPORT_H
 #define SERIALPORT_H
 
+#include "readertuning.h"
+#include <QAtomicInteger>
+#include <QMutex>
 #include <QObject>
 #include <QSerialPort>
+#include <functional>
+
+class ChunkPool;
+class QThread;
+
+// Sees every received chunk on the thread that read it, before the data is
+// queued to the GUI. Implementations must not block.
+class ReceiveStage {
+public:
+  virtual ~ReceiveStage() {}
+  // timestamp is SerialPort::now() when the chunk arrived
+  virtual void process(const QByteArray &data, qint64 timestamp) = 0;
+};
+
+// receive errors counted by the driver since it was loaded
+struct LineErrors {
+  qint64 framing;
+  qint64 overrun;
+  qint64 parity;
+  qint64 breaks;
+  qint64 bufferOverrun;
+};
+
+// everything the setters configure
+struct PortSettings {
+  qint32 baudRate;
+  QSerialPort::DataBits dataBits;
+  QSerialPort::Parity parity;
+  QSerialPort::StopBits stopBits;
+  QSerialPort::FlowControl flowControl;
+};
+
+// taken on the port's thread after each task, read from any thread
+struct PortStatus {
+  bool open;
+  PortSettings settings;
+  bool hasLineErrors; // lineErrors is only valid if set
+  LineErrors lineErrors;
+  SchedulingLatency::Summary latency;
+};
+
+// chunks a streaming sender keeps in flight, see waitForBacklog()
+#define SEND_WINDOW_CHUNKS 4
 
 class SerialPort : public QObject {
   Q_OBJECT
@@ -13,17 +59,86 @@ public:
   virtual void setBaudRate(qint32 baudRate) = 0;
   virtual qint32 getBaudRate() = 0;
   virtual void setDataBits(QSerialPort::DataBits dataBits) = 0;
+  virtual QSerialPort::DataBits getDataBits() = 0;
   virtual void setParity(QSerialPort::Parity parity) = 0;
   virtual QSerialPort::Parity getParity() = 0;
   virtual void setStopBits(QSerialPort::StopBits stopBits) = 0;
+  virtual QSerialPort::StopBits getStopBits() = 0;
   virtual void setFlowControl(QSerialPort::FlowControl flowControl) = 0;
   virtual bool open() = 0;
   virtual bool isOpen() = 0;
   virtual void close() = 0;
+  // false if the driver does not count errors
+  virtual bool getLineErrors(LineErrors &) { return false; }
+  // Safe to call from any thread, queued onto the port's thread if needed.
+  // Callers should use this rather than sendData() so that bytesToWrite()
+  // accounts for data still waiting in the queue.
+  void write(const QByteArray &data);
+  // Bytes passed to write() that the device has not accepted yet.
+  qint64 bytesToWrite() const { return pendingBytes.loadAcquire(); }
+  // Backpressure for senders on threads of their own: blocks while more
+  // than window bytes written since baseline, bytesToWrite() as the sender
+  // started, are still queued. What others queued before is not the
+  // caller's to wait for. False once stop is set.
+  bool waitForBacklog(qint64 baseline, qint64 window,
+                      const QAtomicInt &stop) const;
+  // Stages are not owned. Once removeStage() returns the stage is no longer
+  // called and may be deleted.
+  void addStage(ReceiveStage *stage);
+  void removeStage(ReceiveStage *stage);
+  // monotonic clock in ns used for receive timestamps
+  static qint64 now();
+
+  // Worker thread. Once started the port object lives on a thread of its
+  // own with an event loop, and open, close, configuration and sendData()
+  // all run there, so a blocking open or a slow control transfer never
+  // holds up the caller. Call startWorker() on the thread that created the
+  // port; a parent is dropped while the worker runs and restored by
+  // stopWorker(), which closes the port and moves it back. Should the
+  // parent be destroyed first, the port is stopped and deleted with it.
+  void startWorker();
+  void stopWorker();
+  bool hasWorker() const { return worker != nullptr; }
+  // Run task on the port's thread after everything posted before it.
+  // exec() waits for it and runs it directly if already there.
+  void post(std::function<void()> task);
+  void exec(std::function<void()> task);
+  // Posted forms of open(), the setters, close() and triggerBreak(), each
+  // followed by a status update. openAsync() starts the worker if there is
+  // none yet and reports through opened().
+  void openAsync(const PortSettings &settings);
+  void configureAsync(const PortSettings &settings);
+  void closeAsync();
+  void breakAsync(uint msecs);
+  // takes a fresh status, for line error counts that move while open
+  void refreshStatusAsync();
+  // the snapshot as of the last task
+  PortStatus status();
+
+  // all five setters, on the port's thread
+  void applySettings(const PortSettings &settings);
+  PortSettings currentSettings();
+
+  // takes effect on the next open(), the read mode on the next read, from
+  // any thread
+  void setReaderTuning(const ReaderTuning &tuning);
+  ReaderTuning readerTuning();
+  ReaderTuning::ReadMode readMode() const {
+    return (ReaderTuning::ReadMode)readModeValue.loadAcquire();
+  }
+  // since the last open(), only drivers whose reads have a deadline record
+  SchedulingLatency::Summary schedulingLatency() const {
+    return latency.summary();
+  }
 
 signals:
   void receivedData(QByteArray data);
   void breakChanged(bool set);
+  void opened(bool ok);
+  void statusChanged();
+  // the device went away or failed while open, from the reader thread; the
+  // port stops receiving but stays open until closed
+  void errorOccurred(QString message);
 
 public slots:
   virtual void sendData(const QByteArray &data) = 0;
@@ -31,12 +146,51 @@ public slots:
 
 protected:
   SerialPort(QObject *parent = nullptr);
+  // true if sendData() may be called from any thread, which lets write()
+  // skip the queued hop onto the port's thread. It may then race close()
+  // on the port's thread, so the driver must guard whatever close() tears
+  // down; the USB drivers send through UsbBulkWriter, which drops writes
+  // once its handle is gone.
+  virtual bool sendIsThreadSafe() { return false; }
+  // drivers pass every received chunk here, from whichever thread read it
+  void deliver(const QByteArray &data, qint64 timestamp = -1);
+  // on the port's thread
+  void updateStatus();
+  // first thing on a reader thread: applies readerTuning(), locking the
+  // pool's blocks if asked to, and starts counting latency afresh
+  ReaderTuning tuneReaderThread(ChunkPool *pool);
+  // A read started at start just returned. One that timed out was due at
+  // start + timeoutMs; one that came back full was due once characters
+  // took their time on the line. Anything else has no known due time.
+  void sampleRead(qint64 start, bool timedOut, int timeoutMs, int characters,
+                  bool full);
 
   qint32 currentBaudRate;
   QSerialPort::DataBits currentDataBits;
   QSerialPort::Parity currentParity;
   QSerialPort::StopBits currentStopBits;
   QSerialPort::FlowControl currentFlowControl;
+
+  // drivers subtract what completed, see bytesToWrite()
+  QAtomicInteger<qint64> pendingBytes;
+
+private:
+  QMutex stagesMutex;
+  QList<ReceiveStage *> stages;
+
+  QThread *worker;
+  QObject *owner; // the parent set aside while the worker runs
+  QMetaObject::Connection ownerDestroyed;
+  QMutex statusMutex;
+  PortStatus lastStatus;
+
+  QMutex tuningMutex;
+  ReaderTuning tuning;
+  QAtomicInt readModeValue;
+  SchedulingLatency latency;
+
+  friend class UsbBulkReader;
+  friend class UsbBulkWriter;
 };
 
 #endif
\ No newline at end of file
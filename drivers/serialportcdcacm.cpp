@@ -0,0 +1,435 @@
+#include "serialportcdcacm.h"
+#include <QDebug>
+#include <QVector>
+
+#define CDC_CLASS_COMM 0x02
+#define CDC_SUBCLASS_ACM 0x02
+
+// class specific interface descriptor, union functional descriptor
+#define CDC_CS_INTERFACE 0x24
+#define CDC_UNION_TYPE 0x06
+
+#define ACM_CTRL_OUT                                                           \
+  (LIBUSB_RECIPIENT_INTERFACE | LIBUSB_REQUEST_TYPE_CLASS |                    \
+   LIBUSB_ENDPOINT_OUT)
+
+#define ACM_REQ_SET_LINE_CODING 0x20
+#define ACM_REQ_SET_CONTROL_LINE_STATE 0x22
+#define ACM_REQ_SEND_BREAK 0x23
+
+#define ACM_CTRL_DTR 0x01
+#define ACM_CTRL_RTS 0x02
+
+#define ACM_NOTIFY_SERIAL_STATE 0x20
+#define ACM_NOTIFY_SIZE 64
+
+// bmUartState of SERIAL_STATE
+#define ACM_STATE_BREAK 0x04
+#define ACM_STATE_FRAMING 0x10
+#define ACM_STATE_PARITY 0x20
+#define ACM_STATE_OVERRUN 0x40
+
+#define TIMEOUT 300
+
+SerialPortCDCACM::SerialPortCDCACM(QObject *parent, libusb_device *device,
+                                   int controlInterface, int dataInterface,
+                                   bool composite)
+    : SerialPort(parent), reader(this), writer(this) {
+  libusb_ref_device(device);
+  this->device = device;
+  this->controlInterface = controlInterface;
+  this->dataInterface = dataInterface;
+  this->composite = composite;
+  handle = nullptr;
+  thread = nullptr;
+  breakTimer = nullptr;
+  detached[0] = detached[1] = false;
+  dataEPIn = dataEPOut = notifyEP = 0;
+  packetSize = 64;
+  notifyTransfer = nullptr;
+  breakOn = false;
+}
+
+SerialPortCDCACM::~SerialPortCDCACM() { libusb_unref_device(device); }
+
+// the data interface named by the union functional descriptor, usually the
+// one right after the control interface
+static int dataInterfaceOf(const libusb_interface_descriptor &ifaceDesc) {
+  const unsigned char *extra = ifaceDesc.extra;
+  int left = ifaceDesc.extra_length;
+  while (left >= 3 && extra[0] >= 3 && extra[0] <= left) {
+    if (extra[1] == CDC_CS_INTERFACE && extra[2] == CDC_UNION_TYPE &&
+        extra[0] >= 5) {
+      return extra[4];
+    }
+    left -= extra[0];
+    extra += extra[0];
+  }
+  return ifaceDesc.bInterfaceNumber + 1;
+}
+
+QList<SerialPort *> SerialPortCDCACM::availablePorts(QObject *parent) {
+  QList<SerialPort *> result;
+  libusb_device **list = nullptr;
+  auto count = libusb_get_device_list(context, &list);
+  for (auto i = 0; i < count; i++) {
+    auto device = list[i];
+    libusb_device_descriptor desc = {};
+    libusb_config_descriptor *cfgDesc;
+    if (libusb_get_device_descriptor(device, &desc) < 0 ||
+        libusb_get_config_descriptor(device, 0, &cfgDesc) < 0) {
+      continue;
+    }
+    QVector<QPair<int, int>> functions;
+    for (int j = 0; j < cfgDesc->bNumInterfaces; j++) {
+      if (cfgDesc->interface[j].num_altsetting < 1) {
+        continue;
+      }
+      auto &ifaceDesc = cfgDesc->interface[j].altsetting[0];
+      if (ifaceDesc.bInterfaceClass == CDC_CLASS_COMM &&
+          ifaceDesc.bInterfaceSubClass == CDC_SUBCLASS_ACM) {
+        functions.append(qMakePair((int)ifaceDesc.bInterfaceNumber,
+                                   dataInterfaceOf(ifaceDesc)));
+      }
+    }
+    libusb_free_config_descriptor(cfgDesc);
+    for (auto function : functions) {
+      // found
+      result.append(new SerialPortCDCACM(parent, device, function.first,
+                                         function.second,
+                                         functions.size() > 1));
+    }
+  }
+  libusb_free_device_list(list, true);
+  return result;
+}
+
+QString SerialPortCDCACM::portName() {
+  QString name = QString("CDC-ACM Bus %1 Addr %2")
+                     .arg(libusb_get_bus_number(device))
+                     .arg(libusb_get_device_address(device));
+  if (composite) {
+    name += QString(" If %1").arg(controlInterface);
+  }
+  return name;
+}
+
+bool SerialPortCDCACM::open() {
+  auto rc = libusb_open(device, &handle);
+  if (rc < 0)
+    return false;
+  int interfaces[2] = {controlInterface, dataInterface};
+  try {
+    for (int i = 0; i < 2; i++) {
+      if (libusb_kernel_driver_active(handle, interfaces[i]) == 1) {
+        if (libusb_detach_kernel_driver(handle, interfaces[i]) < 0) {
+          throw "Failed to detach the kernel driver";
+        }
+        detached[i] = true;
+      }
+      // the configuration is left alone, other functions may be in use
+      if (libusb_claim_interface(handle, interfaces[i]) < 0) {
+        throw "Failed to claim interface";
+      }
+    }
+
+    libusb_config_descriptor *cfgDesc;
+    if (libusb_get_config_descriptor(device, 0, &cfgDesc) < 0) {
+      throw "Failed to get config descriptor";
+    }
+    dataEPIn = 0;
+    dataEPOut = 0;
+    notifyEP = 0;
+    for (int j = 0; j < cfgDesc->bNumInterfaces; j++) {
+      auto &ifaceDesc = cfgDesc->interface[j].altsetting[0];
+      for (int k = 0; k < ifaceDesc.bNumEndpoints; k++) {
+        auto &endpoint = ifaceDesc.endpoint[k];
+        auto type = endpoint.bmAttributes & 0x3;
+        bool in = endpoint.bEndpointAddress & LIBUSB_ENDPOINT_IN;
+        if (ifaceDesc.bInterfaceNumber == controlInterface &&
+            type == LIBUSB_TRANSFER_TYPE_INTERRUPT && in) {
+          notifyEP = endpoint.bEndpointAddress;
+        } else if (ifaceDesc.bInterfaceNumber == dataInterface &&
+                   type == LIBUSB_TRANSFER_TYPE_BULK) {
+          if (in) {
+            dataEPIn = endpoint.bEndpointAddress;
+            // 64 at full speed, 512 at high speed
+            packetSize = endpoint.wMaxPacketSize;
+          } else {
+            dataEPOut = endpoint.bEndpointAddress;
+          }
+        }
+      }
+    }
+    libusb_free_config_descriptor(cfgDesc);
+    if (!dataEPIn || !dataEPOut || packetSize <= 0) {
+      throw "No bulk endpoints";
+    }
+
+    // the device keeps its line coding across opens, start from the
+    // settings this port last had
+    if (!setLineCoding(currentBaudRate, currentDataBits, currentParity,
+                       currentStopBits)) {
+      throw "Failed to set line coding";
+    }
+    // many firmwares only send once DTR is raised
+    setControlLines(ACM_CTRL_DTR | ACM_CTRL_RTS);
+  } catch (const char *err) {
+    qWarning() << err;
+    for (int i = 0; i < 2; i++) {
+      libusb_release_interface(handle, interfaces[i]);
+      if (detached[i]) {
+        libusb_attach_kernel_driver(handle, interfaces[i]);
+        detached[i] = false;
+      }
+    }
+    libusb_close(handle);
+    handle = nullptr;
+    return false;
+  }
+
+  shouldStop = 0;
+  breakOn = false;
+
+  // completed by whichever thread handles libusb events, the bulk reader
+  // below included
+  if (notifyEP) {
+    auto transfer = libusb_alloc_transfer(0);
+    libusb_fill_interrupt_transfer(transfer, handle, notifyEP,
+                                   new unsigned char[ACM_NOTIFY_SIZE],
+                                   ACM_NOTIFY_SIZE, notifyCallback, this, 0);
+    notifyTransfer = transfer;
+    if (libusb_submit_transfer(transfer) < 0) {
+      delete[] transfer->buffer;
+      libusb_free_transfer(transfer);
+      notifyTransfer = nullptr;
+    }
+  }
+
+  reader.reset(handle, dataEPIn, packetSize);
+
+  writer.reset(handle, dataEPOut);
+
+  thread = QThread::create([this] {
+    reader.tuneThread();
+    while (!shouldStop) {
+      QByteArray data = reader.read();
+      if (!data.isEmpty()) {
+        deliver(data);
+      } else if (reader.error() == LIBUSB_ERROR_NO_DEVICE) {
+        emit errorOccurred("Device disconnected");
+        break;
+      }
+    }
+  });
+  thread->start();
+  return true;
+}
+
+void SerialPortCDCACM::close() {
+  if (!isOpen())
+    return;
+  if (breakTimer && breakTimer->isActive()) {
+    breakTimer->stop();
+    setBreak(false);
+  }
+  shouldStop = 1;
+  reader.cancel();
+  thread->wait();
+  writer.cancel();
+  delete thread;
+  thread = nullptr;
+  auto transfer = notifyTransfer.loadAcquire();
+  if (transfer) {
+    libusb_cancel_transfer(transfer);
+    // the reader is gone, handle events here until the callback frees it
+    while (notifyTransfer.loadAcquire()) {
+      struct timeval tv = {0, 100000};
+      libusb_handle_events_timeout_completed(context, &tv, nullptr);
+    }
+  }
+  setControlLines(0);
+  int interfaces[2] = {controlInterface, dataInterface};
+  for (int i = 0; i < 2; i++) {
+    libusb_release_interface(handle, interfaces[i]);
+    if (detached[i]) {
+      // hand the interfaces back to cdc_acm
+      libusb_attach_kernel_driver(handle, interfaces[i]);
+      detached[i] = false;
+    }
+  }
+  libusb_close(handle);
+  handle = nullptr;
+}
+
+void SerialPortCDCACM::notifyCallback(libusb_transfer *transfer) {
+  auto port = (SerialPortCDCACM *)transfer->user_data;
+  if (transfer->status == LIBUSB_TRANSFER_COMPLETED) {
+    port->processNotification(transfer->buffer, transfer->actual_length);
+  }
+  if (port->shouldStop || transfer->status == LIBUSB_TRANSFER_CANCELLED ||
+      transfer->status == LIBUSB_TRANSFER_NO_DEVICE ||
+      libusb_submit_transfer(transfer) < 0) {
+    delete[] transfer->buffer;
+    libusb_free_transfer(transfer);
+    port->notifyTransfer = nullptr;
+  }
+}
+
+void SerialPortCDCACM::processNotification(const quint8 *data, int length) {
+  // bmRequestType, bNotification, wValue, wIndex, wLength, data
+  if (length < 10 || data[1] != ACM_NOTIFY_SERIAL_STATE) {
+    return;
+  }
+  quint16 state = data[8] | data[9] << 8;
+  if (state & ACM_STATE_FRAMING) {
+    framingErrors.fetchAndAddRelaxed(1);
+  }
+  if (state & ACM_STATE_PARITY) {
+    parityErrors.fetchAndAddRelaxed(1);
+  }
+  if (state & ACM_STATE_OVERRUN) {
+    overrunErrors.fetchAndAddRelaxed(1);
+  }
+  bool set = state & ACM_STATE_BREAK;
+  if (set != breakOn) {
+    // BREAK Changed
+    breakOn = set;
+    if (breakOn) {
+      breaks.fetchAndAddRelaxed(1);
+    }
+    emit breakChanged(breakOn);
+  }
+}
+
+bool SerialPortCDCACM::getLineErrors(LineErrors &errors) {
+  if (!notifyEP) {
+    return false;
+  }
+  errors.framing = framingErrors.loadAcquire();
+  errors.overrun = overrunErrors.loadAcquire();
+  errors.parity = parityErrors.loadAcquire();
+  errors.breaks = breaks.loadAcquire();
+  errors.bufferOverrun = 0;
+  return true;
+}
+
+bool SerialPortCDCACM::setLineCoding(qint32 baudRate,
+                                     QSerialPort::DataBits dataBits,
+                                     QSerialPort::Parity parity,
+                                     QSerialPort::StopBits stopBits) {
+  // dwDTERate, bCharFormat, bParityType, bDataBits
+  quint8 coding[7];
+  coding[0] = baudRate & 0xff;
+  coding[1] = (baudRate >> 8) & 0xff;
+  coding[2] = (baudRate >> 16) & 0xff;
+  coding[3] = (baudRate >> 24) & 0xff;
+  switch (stopBits) {
+  case QSerialPort::OneAndHalfStop:
+    coding[4] = 1;
+    break;
+  case QSerialPort::TwoStop:
+    coding[4] = 2;
+    break;
+  default:
+    coding[4] = 0;
+    break;
+  }
+  switch (parity) {
+  case QSerialPort::OddParity:
+    coding[5] = 1;
+    break;
+  case QSerialPort::EvenParity:
+    coding[5] = 2;
+    break;
+  case QSerialPort::MarkParity:
+    coding[5] = 3;
+    break;
+  case QSerialPort::SpaceParity:
+    coding[5] = 4;
+    break;
+  default:
+    coding[5] = 0;
+    break;
+  }
+  coding[6] = dataBits;
+  auto rc = libusb_control_transfer(handle, ACM_CTRL_OUT,
+                                    ACM_REQ_SET_LINE_CODING, 0,
+                                    controlInterface, coding, 7, TIMEOUT);
+  if (rc < 0) {
+    qWarning() << "setLineCoding" << rc;
+    return false;
+  }
+  currentBaudRate = baudRate;
+  currentDataBits = dataBits;
+  currentParity = parity;
+  currentStopBits = stopBits;
+  return true;
+}
+
+void SerialPortCDCACM::setBaudRate(qint32 baudRate) {
+  if (currentBaudRate != baudRate && baudRate > 0) {
+    setLineCoding(baudRate, currentDataBits, currentParity, currentStopBits);
+  }
+}
+
+void SerialPortCDCACM::setDataBits(QSerialPort::DataBits dataBits) {
+  if (currentDataBits != dataBits) {
+    setLineCoding(currentBaudRate, dataBits, currentParity, currentStopBits);
+  }
+}
+
+void SerialPortCDCACM::setParity(QSerialPort::Parity parity) {
+  if (currentParity != parity) {
+    setLineCoding(currentBaudRate, currentDataBits, parity, currentStopBits);
+  }
+}
+
+void SerialPortCDCACM::setStopBits(QSerialPort::StopBits stopBits) {
+  if (currentStopBits != stopBits) {
+    setLineCoding(currentBaudRate, currentDataBits, currentParity, stopBits);
+  }
+}
+
+void SerialPortCDCACM::setFlowControl(QSerialPort::FlowControl flowControl) {
+  // not part of ACM, the device handles it if at all
+  Q_UNUSED(flowControl);
+}
+
+void SerialPortCDCACM::setControlLines(quint16 lines) {
+  auto rc = libusb_control_transfer(handle, ACM_CTRL_OUT,
+                                    ACM_REQ_SET_CONTROL_LINE_STATE, lines,
+                                    controlInterface, nullptr, 0, TIMEOUT);
+  if (rc < 0) {
+    qWarning() << "setControlLines" << rc;
+  }
+}
+
+void SerialPortCDCACM::setBreak(bool set) {
+  // 0xFFFF holds the break until it is cleared with 0
+  auto rc = libusb_control_transfer(handle, ACM_CTRL_OUT, ACM_REQ_SEND_BREAK,
+                                    set ? 0xFFFF : 0, controlInterface,
+                                    nullptr, 0, TIMEOUT);
+  if (rc < 0) {
+    qWarning() << "setBreak" << rc;
+  }
+}
+
+void SerialPortCDCACM::sendData(const QByteArray &data) {
+  writer.send(data);
+}
+
+void SerialPortCDCACM::triggerBreak(uint msecs) {
+  setBreak(true);
+
+  if (breakTimer) {
+    breakTimer->stop();
+    delete breakTimer;
+  }
+  breakTimer = new QTimer(this);
+  breakTimer->setSingleShot(true);
+  connect(breakTimer, SIGNAL(timeout()), this, SLOT(breakTimeout()));
+  breakTimer->start(msecs);
+}
+
+void SerialPortCDCACM::breakTimeout() { setBreak(false); }
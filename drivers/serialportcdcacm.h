@@ -0,0 +1,85 @@
+#ifndef SERIALPORTCDCACM_H
+#define SERIALPORTCDCACM_H
+
+#include "libusb.h"
+#include "serialport.h"
+#include "usbbulkreader.h"
+#include "usbbulkwriter.h"
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QThread>
+#include <QTimer>
+
+// reference:
+// USB CDC PSTN Subclass 1.2
+// Linux kernel cdc-acm.c
+
+// Any device with a CDC Abstract Control Model function, which covers the
+// USB serial of most microcontroller firmware (STM32, RP2040, ...), one
+// port per function. Line errors and breaks come from SERIAL_STATE
+// notifications on the interrupt endpoint, read asynchronously alongside
+// the bulk reader. ACM has no flow control of its own.
+class SerialPortCDCACM : public SerialPort {
+  Q_OBJECT
+
+public:
+  static QList<SerialPort *> availablePorts(QObject *parent = nullptr);
+  QString portName() override;
+  void setBaudRate(qint32 baudRate) override;
+  qint32 getBaudRate() override { return currentBaudRate; }
+  void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override { return currentDataBits; }
+  void setParity(QSerialPort::Parity parity) override;
+  QSerialPort::Parity getParity() override { return currentParity; }
+  void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override { return currentStopBits; }
+  void setFlowControl(QSerialPort::FlowControl flowControl) override;
+  bool open() override;
+  bool isOpen() override { return handle != nullptr; }
+  void close() override;
+  bool getLineErrors(LineErrors &errors) override;
+
+public slots:
+  void sendData(const QByteArray &data) override;
+  void triggerBreak(uint msecs) override;
+
+private slots:
+  void breakTimeout();
+
+private:
+  bool sendIsThreadSafe() override { return true; }
+  static void notifyCallback(libusb_transfer *transfer);
+  SerialPortCDCACM(QObject *parent, libusb_device *device,
+                   int controlInterface, int dataInterface, bool composite);
+  ~SerialPortCDCACM();
+
+  bool setLineCoding(qint32 baudRate, QSerialPort::DataBits dataBits,
+                     QSerialPort::Parity parity,
+                     QSerialPort::StopBits stopBits);
+  void setControlLines(quint16 lines);
+  void setBreak(bool set);
+  void processNotification(const quint8 *data, int length);
+  libusb_device *device;
+  libusb_device_handle *handle;
+  QThread *thread;
+  QTimer *breakTimer;
+  int controlInterface;
+  int dataInterface;
+  bool composite; // more than one ACM function on the device
+  bool detached[2];
+  quint8 dataEPIn, dataEPOut, notifyEP;
+  int packetSize;
+
+  QAtomicInt shouldStop;
+  UsbBulkReader reader;
+  UsbBulkWriter writer;
+  // owned by whichever thread handles its completion, null once freed
+  QAtomicPointer<libusb_transfer> notifyTransfer;
+  bool breakOn; // touched by the notification callback only
+  QAtomicInteger<qint64> framingErrors;
+  QAtomicInteger<qint64> overrunErrors;
+  QAtomicInteger<qint64> parityErrors;
+  QAtomicInteger<qint64> breaks;
+};
+
+#endif
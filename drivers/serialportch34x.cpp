@@ -35,7 +35,7 @@
 #define TIMEOUT 300
 
 SerialPortCH34X::SerialPortCH34X(QObject *parent, libusb_device *device)
-    : SerialPort(parent) {
+    : SerialPort(parent), reader(this), writer(this) {
   libusb_ref_device(device);
   this->device = device;
   handle = nullptr;
@@ -126,7 +126,6 @@ void SerialPortCH34X::setParity(QSerialPort::Parity parity) {
   }
 }
 void SerialPortCH34X::setDataBits(QSerialPort::DataBits dataBits) {
-  // TODO: currentDataBits
   switch (dataBits) {
   case QSerialPort::Data5:
     this->dataBits = CH34X_LCR_CS5;
@@ -141,8 +140,9 @@ void SerialPortCH34X::setDataBits(QSerialPort::DataBits dataBits) {
     this->dataBits = CH34X_LCR_CS8;
     break;
   default:
-    break;
+    return;
   }
+  currentDataBits = dataBits;
   setLcr();
 }
 void SerialPortCH34X::setStopBits(QSerialPort::StopBits stopBits) {
@@ -154,8 +154,9 @@ void SerialPortCH34X::setStopBits(QSerialPort::StopBits stopBits) {
     this->stopBits = CH34X_LCR_STOP_BITS_2;
     break;
   default:
-    break;
+    return;
   }
+  currentStopBits = stopBits;
   setLcr();
 }
 void SerialPortCH34X::setFlowControl(QSerialPort::FlowControl flowControl) {
@@ -192,15 +193,18 @@ bool SerialPortCH34X::open() {
     setHandshake(0);
 
     shouldStop = 0;
+    reader.reset(handle, CH34X_DATA_IN, 64);
+    writer.reset(handle, CH34X_DATA_OUT);
 
     thread = QThread::create([this] {
-      quint8 data[64] = {0};
+      reader.tuneThread();
       while (!shouldStop) {
-        int len = 0;
-        auto rc = libusb_bulk_transfer(handle, CH34X_DATA_IN, data,
-                                       sizeof(data), &len, TIMEOUT);
-        if (rc >= 0 || (rc == LIBUSB_ERROR_TIMEOUT && len > 0)) {
-          emit this->receivedData(QByteArray((char *)data, len));
+        QByteArray data = reader.read();
+        if (!data.isEmpty()) {
+          deliver(data);
+        } else if (reader.error() == LIBUSB_ERROR_NO_DEVICE) {
+          emit errorOccurred("Device disconnected");
+          break;
         }
       }
     });
@@ -211,23 +215,14 @@ bool SerialPortCH34X::open() {
 bool SerialPortCH34X::isOpen() { return handle != nullptr; }
 void SerialPortCH34X::close() {
   shouldStop = 1;
+  reader.cancel();
   thread->wait();
+  writer.cancel();
   libusb_close(handle);
   handle = nullptr;
 }
-void ch34x_callback(libusb_transfer *transfer) {
-  delete[] (unsigned char *)transfer->user_data;
-  libusb_free_transfer(transfer);
-}
-
 void SerialPortCH34X::sendData(const QByteArray &data) {
-  auto transfer = libusb_alloc_transfer(0);
-  unsigned char *buffer = new unsigned char[data.length()];
-  memcpy(buffer, data.data(), data.length());
-
-  libusb_fill_bulk_transfer(transfer, handle, CH34X_DATA_OUT, buffer,
-                            data.length(), ch34x_callback, buffer, 0);
-  libusb_submit_transfer(transfer);
+  writer.send(data);
 }
 
 QVector<QPair<quint16, quint16>> supportedCH34XDevices = {
@@ -3,6 +3,8 @@
 
 #include "libusb.h"
 #include "serialport.h"
+#include "usbbulkreader.h"
+#include "usbbulkwriter.h"
 #include <QAtomicInt>
 #include <QThread>
 #include <QTimer>
@@ -20,18 +22,16 @@ public:
   void setBaudRate(qint32 baudRate) override;
   qint32 getBaudRate() override { return currentBaudRate; }
   void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override { return currentDataBits; }
   void setParity(QSerialPort::Parity parity) override;
   QSerialPort::Parity getParity() override { return currentParity; }
   void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override { return currentStopBits; }
   void setFlowControl(QSerialPort::FlowControl flowControl) override;
   bool open() override;
   bool isOpen() override;
   void close() override;
 
-signals:
-  void receivedData(QByteArray data);
-  void breakChanged(bool set);
-
 public slots:
   void sendData(const QByteArray &data) override;
   void triggerBreak(uint msecs) override;
@@ -40,6 +40,7 @@ private slots:
   void breakTimeout();
 
 private:
+  bool sendIsThreadSafe() override { return true; }
   SerialPortCH34X(QObject *parent = nullptr, libusb_device *device = nullptr);
   ~SerialPortCH34X();
 
@@ -55,6 +56,8 @@ private:
   quint8 stopBits;
 
   QAtomicInt shouldStop;
+  UsbBulkReader reader;
+  UsbBulkWriter writer;
 };
 
 #endif
\ No newline at end of file
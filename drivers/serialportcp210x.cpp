@@ -47,7 +47,7 @@ struct PACKED_STRUCT SerialStatusResponse {
 };
 
 SerialPortCP210X::SerialPortCP210X(QObject *parent, libusb_device *device)
-    : SerialPort(parent) {
+    : SerialPort(parent), reader(this), writer(this) {
   libusb_ref_device(device);
   this->device = device;
   handle = nullptr;
@@ -108,10 +108,10 @@ void SerialPortCP210X::setParity(QSerialPort::Parity parity) {
       lineCtl |= CP210X_LINE_CTL_PARITY_NONE;
       break;
     }
-    // SET_LINE_CTL
-    rc = libusb_control_transfer(
-        handle, CP210X_CTRL_OUT, CP210X_REQ_SET_LINE_CTL, 0, 0,
-        (unsigned char *)&lineCtl, sizeof(lineCtl), TIMEOUT);
+    // SET_LINE_CTL, the setting goes in wValue
+    rc = libusb_control_transfer(handle, CP210X_CTRL_OUT,
+                                 CP210X_REQ_SET_LINE_CTL, lineCtl, 0, nullptr,
+                                 0, TIMEOUT);
     Q_ASSERT(rc >= 0);
     currentParity = parity;
   }
@@ -125,11 +125,11 @@ void SerialPortCP210X::setDataBits(QSerialPort::DataBits dataBits) {
       (unsigned char *)&lineCtl, sizeof(lineCtl), TIMEOUT);
   Q_ASSERT(rc >= 0);
   lineCtl = (lineCtl & 0b0000000011111111) | (dataBits << 8);
-  // SET_LINE_CTL
+  // SET_LINE_CTL, the setting goes in wValue
   rc = libusb_control_transfer(handle, CP210X_CTRL_OUT, CP210X_REQ_SET_LINE_CTL,
-                               0, 0, (unsigned char *)&lineCtl, sizeof(lineCtl),
-                               TIMEOUT);
+                               lineCtl, 0, nullptr, 0, TIMEOUT);
   Q_ASSERT(rc >= 0);
+  currentDataBits = dataBits;
 }
 
 void SerialPortCP210X::setStopBits(QSerialPort::StopBits stopBits) {
@@ -141,11 +141,11 @@ void SerialPortCP210X::setStopBits(QSerialPort::StopBits stopBits) {
   Q_ASSERT(rc >= 0);
   const uint16_t mapping[] = {65535, 0, 2, 1}; // One, Two, OneAndHalf
   lineCtl = (lineCtl & 0b1111111111110000) | mapping[stopBits];
-  // SET_LINE_CTL
+  // SET_LINE_CTL, the setting goes in wValue
   rc = libusb_control_transfer(handle, CP210X_CTRL_OUT, CP210X_REQ_SET_LINE_CTL,
-                               0, 0, (unsigned char *)&lineCtl, sizeof(lineCtl),
-                               TIMEOUT);
+                               lineCtl, 0, nullptr, 0, TIMEOUT);
   Q_ASSERT(rc >= 0);
+  currentStopBits = stopBits;
 }
 
 void SerialPortCP210X::setFlowControl(QSerialPort::FlowControl flowControl) {
@@ -172,22 +172,25 @@ bool SerialPortCP210X::open() {
     Q_ASSERT(rc >= 0);
 
     shouldStop = 0;
+    reader.reset(handle, CP210X_DATA_IN, 64);
+    writer.reset(handle, CP210X_DATA_OUT);
 
     thread = QThread::create([this] {
-      quint8 data[64] = {0};
+      reader.tuneThread();
       SerialStatusResponse resp;
       bool breakOn = false;
       while (!shouldStop) {
-        int len = 0;
-        auto rc = libusb_bulk_transfer(handle, CP210X_DATA_IN, data,
-                                       sizeof(data), &len, TIMEOUT);
-        if (rc >= 0 || (rc == LIBUSB_ERROR_TIMEOUT && len > 0)) {
-          emit this->receivedData(QByteArray((char *)data, len));
+        QByteArray data = reader.read();
+        if (!data.isEmpty()) {
+          deliver(data);
+        } else if (reader.error() == LIBUSB_ERROR_NO_DEVICE) {
+          emit errorOccurred("Device disconnected");
+          break;
         }
 
-        rc = libusb_control_transfer(handle, CP210X_CTRL_IN,
+        auto rc = libusb_control_transfer(handle, CP210X_CTRL_IN,
                                      CP210X_REQ_GET_COMM_STATUS, 0, 0,
-                                     (quint8 *)&resp, sizeof(data), TIMEOUT);
+                                     (quint8 *)&resp, sizeof(resp), TIMEOUT);
         if (rc == sizeof(resp)) {
           if ((resp.ulErrors & 1) != breakOn) {
             // BREAK Changed
@@ -206,24 +209,15 @@ bool SerialPortCP210X::isOpen() { return handle != nullptr; }
 
 void SerialPortCP210X::close() {
   shouldStop = 1;
+  reader.cancel();
   thread->wait();
+  writer.cancel();
   libusb_close(handle);
   handle = nullptr;
 }
 
-void cp210x_callback(libusb_transfer *transfer) {
-  delete[] (unsigned char *)transfer->user_data;
-  libusb_free_transfer(transfer);
-}
-
 void SerialPortCP210X::sendData(const QByteArray &data) {
-  auto transfer = libusb_alloc_transfer(0);
-  unsigned char *buffer = new unsigned char[data.length()];
-  memcpy(buffer, data.data(), data.length());
-
-  libusb_fill_bulk_transfer(transfer, handle, CP210X_DATA_OUT, buffer,
-                            data.length(), cp210x_callback, buffer, 0);
-  libusb_submit_transfer(transfer);
+  writer.send(data);
 }
 
 QVector<QPair<quint16, quint16>> supportedCP210XDevices = {{0x10C4, 0xEA60},
@@ -3,6 +3,8 @@
 
 #include "libusb.h"
 #include "serialport.h"
+#include "usbbulkreader.h"
+#include "usbbulkwriter.h"
 #include <QAtomicInt>
 #include <QThread>
 #include <QTimer>
@@ -19,18 +21,16 @@ public:
   void setBaudRate(qint32 baudRate) override;
   qint32 getBaudRate() override { return currentBaudRate; }
   void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override { return currentDataBits; }
   void setParity(QSerialPort::Parity parity) override;
   QSerialPort::Parity getParity() override { return currentParity; }
   void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override { return currentStopBits; }
   void setFlowControl(QSerialPort::FlowControl flowControl) override;
   bool open() override;
   bool isOpen() override;
   void close() override;
 
-signals:
-  void receivedData(QByteArray data);
-  void breakChanged(bool set);
-
 public slots:
   void sendData(const QByteArray &data) override;
   void triggerBreak(uint msecs) override;
@@ -39,6 +39,7 @@ private slots:
   void breakTimeout();
 
 private:
+  bool sendIsThreadSafe() override { return true; }
   SerialPortCP210X(QObject *parent = nullptr, libusb_device *device = nullptr);
   ~SerialPortCP210X();
   libusb_device *device;
@@ -46,6 +47,8 @@ private:
   QThread *thread;
   QTimer *breakTimer;
   QAtomicInt shouldStop;
+  UsbBulkReader reader;
+  UsbBulkWriter writer;
 };
 
 #endif
\ No newline at end of file
@@ -14,23 +14,26 @@ public:
   void setBaudRate(qint32) override {}
   qint32 getBaudRate() override { return 115200; }
   void setDataBits(QSerialPort::DataBits) override {}
+  QSerialPort::DataBits getDataBits() override { return QSerialPort::Data8; }
   void setParity(QSerialPort::Parity) override {}
   QSerialPort::Parity getParity() override { return QSerialPort::NoParity; }
   void setStopBits(QSerialPort::StopBits) override {}
+  QSerialPort::StopBits getStopBits() override { return QSerialPort::OneStop; }
   void setFlowControl(QSerialPort::FlowControl) override {}
   bool open() override { return isOpening = true; }
   bool isOpen() override { return isOpening; }
   void close() override { isOpening = false; }
 
-signals:
-  void receivedData(QByteArray data);
-  void breakChanged(bool set);
-
 public slots:
-  void sendData(const QByteArray &data) override { emit receivedData(data); }
+  void sendData(const QByteArray &data) override {
+    pendingBytes.fetchAndAddOrdered(-data.length());
+    deliver(data);
+  }
   void triggerBreak(uint msecs) override { Q_UNUSED(msecs); };
 
 private:
+  bool sendIsThreadSafe() override { return true; }
+
   SerialPortDummy(QObject *parent = nullptr) : SerialPort(parent) {
     isOpening = false;
   }
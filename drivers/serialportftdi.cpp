@@ -0,0 +1,433 @@
+#include "serialportftdi.h"
+#include <QDebug>
+#include <QSettings>
+#include <QVector>
+
+#define VID_FTDI 0x0403
+
+#define FTDI_CTRL_OUT                                                          \
+  (LIBUSB_RECIPIENT_DEVICE | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_ENDPOINT_OUT)
+
+#define FTDI_SIO_RESET 0x00
+#define FTDI_SIO_MODEM_CTRL 0x01
+#define FTDI_SIO_SET_FLOW_CTRL 0x02
+#define FTDI_SIO_SET_BAUDRATE 0x03
+#define FTDI_SIO_SET_DATA 0x04
+#define FTDI_SIO_SET_EVENT_CHAR 0x06
+#define FTDI_SIO_SET_LATENCY_TIMER 0x09
+
+#define FTDI_SIO_RESET_SIO 0
+
+// high byte is the mask, low byte the new state
+#define FTDI_SIO_SET_DTR_HIGH 0x0101
+#define FTDI_SIO_SET_DTR_LOW 0x0100
+#define FTDI_SIO_SET_RTS_HIGH 0x0202
+#define FTDI_SIO_SET_RTS_LOW 0x0200
+
+#define FTDI_SIO_DISABLE_FLOW_CTRL 0x00
+#define FTDI_SIO_RTS_CTS_HS 0x01
+#define FTDI_SIO_XON_XOFF_HS 0x04
+
+#define FTDI_SIO_SET_BREAK (1 << 14)
+
+// second byte of every IN packet
+#define FTDI_RS_OE 0x02
+#define FTDI_RS_PE 0x04
+#define FTDI_RS_FE 0x08
+#define FTDI_RS_BI 0x10
+
+#define FTDI_STATUS_SIZE 2
+#define TIMEOUT 300
+
+// bcdDevice of the high speed chips: FT2232H, FT4232H, FT232H
+static const QVector<quint16> highSpeedChips = {0x0700, 0x0800, 0x0900};
+
+static const QVector<quint16> supportedFTDIProducts = {
+    0x6001, // FT232R, FT232BM, FT245
+    0x6010, // FT2232C/D, FT2232H
+    0x6011, // FT4232H
+    0x6014, // FT232H
+    0x6015, // FT-X
+};
+
+SerialPortFTDI::SerialPortFTDI(QObject *parent, libusb_device *device,
+                               int channel, int channels, bool highSpeed)
+    : SerialPort(parent), reader(this), writer(this) {
+  libusb_ref_device(device);
+  this->device = device;
+  this->channel = channel;
+  this->channels = channels;
+  this->highSpeed = highSpeed;
+  handle = nullptr;
+  thread = nullptr;
+  breakTimer = nullptr;
+  detached = false;
+  // the multi-channel chips number their ports from 1 in wIndex
+  portIndex = channels > 1 ? channel + 1 : 0;
+  dataEPIn = dataEPOut = 0;
+  packetSize = 64;
+  breakOn = false;
+
+  QSettings settings;
+  latencyTimer = settings.value("ftdi/latencyTimer", 1).toInt();
+  eventCharacter = settings.value("ftdi/eventCharacter", -1).toInt();
+}
+
+SerialPortFTDI::~SerialPortFTDI() { libusb_unref_device(device); }
+
+QList<SerialPort *> SerialPortFTDI::availablePorts(QObject *parent) {
+  QList<SerialPort *> result;
+  libusb_device **list = nullptr;
+  auto count = libusb_get_device_list(context, &list);
+  for (auto i = 0; i < count; i++) {
+    auto device = list[i];
+    libusb_device_descriptor desc = {};
+    auto rc = libusb_get_device_descriptor(device, &desc);
+    if (rc < 0 || desc.idVendor != VID_FTDI ||
+        !supportedFTDIProducts.contains(desc.idProduct)) {
+      continue;
+    }
+    libusb_config_descriptor *cfgDesc;
+    if (libusb_get_config_descriptor(device, 0, &cfgDesc) < 0) {
+      continue;
+    }
+    int channels = cfgDesc->bNumInterfaces;
+    libusb_free_config_descriptor(cfgDesc);
+    bool highSpeed = highSpeedChips.contains(desc.bcdDevice);
+    for (int channel = 0; channel < channels; channel++) {
+      result.append(
+          new SerialPortFTDI(parent, device, channel, channels, highSpeed));
+    }
+  }
+  libusb_free_device_list(list, true);
+  return result;
+}
+
+QString SerialPortFTDI::portName() {
+  QString name = QString("FTDI Bus %1 Addr %2")
+                     .arg(libusb_get_bus_number(device))
+                     .arg(libusb_get_device_address(device));
+  if (channels > 1) {
+    name += QString(" Port %1").arg(QChar('A' + channel));
+  }
+  return name;
+}
+
+bool SerialPortFTDI::control(quint8 request, quint16 value, quint16 index) {
+  auto rc = libusb_control_transfer(handle, FTDI_CTRL_OUT, request, value,
+                                    index, nullptr, 0, TIMEOUT);
+  if (rc < 0) {
+    qWarning() << "FTDI request" << request << rc;
+  }
+  return rc >= 0;
+}
+
+bool SerialPortFTDI::open() {
+  auto rc = libusb_open(device, &handle);
+  if (rc < 0)
+    return false;
+  try {
+    if (libusb_kernel_driver_active(handle, channel) == 1) {
+      if (libusb_detach_kernel_driver(handle, channel) < 0) {
+        throw "Failed to detach the kernel driver";
+      }
+      detached = true;
+    }
+    // the configuration is left alone, the other channels may be in use
+    if (libusb_claim_interface(handle, channel) < 0) {
+      throw "Failed to claim interface";
+    }
+
+    libusb_config_descriptor *cfgDesc;
+    if (libusb_get_config_descriptor(device, 0, &cfgDesc) < 0) {
+      throw "Failed to get config descriptor";
+    }
+    dataEPIn = 0;
+    dataEPOut = 0;
+    auto &ifaceDesc = cfgDesc->interface[channel].altsetting[0];
+    for (int i = 0; i < ifaceDesc.bNumEndpoints; i++) {
+      auto &endpoint = ifaceDesc.endpoint[i];
+      if (LIBUSB_TRANSFER_TYPE_BULK != (endpoint.bmAttributes & 0x3)) {
+        continue;
+      }
+      if (endpoint.bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+        dataEPIn = endpoint.bEndpointAddress;
+        // 512 on a high speed chip unless it runs behind a full speed hub
+        packetSize = endpoint.wMaxPacketSize;
+      } else {
+        dataEPOut = endpoint.bEndpointAddress;
+      }
+    }
+    libusb_free_config_descriptor(cfgDesc);
+    if (!dataEPIn || !dataEPOut || packetSize <= FTDI_STATUS_SIZE) {
+      throw "No bulk endpoints";
+    }
+
+    if (!control(FTDI_SIO_RESET, FTDI_SIO_RESET_SIO, portIndex)) {
+      throw "Failed to reset";
+    }
+    control(FTDI_SIO_MODEM_CTRL, FTDI_SIO_SET_DTR_HIGH, portIndex);
+    control(FTDI_SIO_MODEM_CTRL, FTDI_SIO_SET_RTS_HIGH, portIndex);
+    // the chip keeps its settings across opens, start from a known state
+    currentBaudRate = 0;
+    setBaudRate(9600);
+    setLineProperties(QSerialPort::Data8, QSerialPort::NoParity,
+                      QSerialPort::OneStop, false);
+    setFlowControl(QSerialPort::NoFlowControl);
+    setLatencyTimer(latencyTimer);
+    setEventCharacter(eventCharacter);
+  } catch (const char *err) {
+    qWarning() << err;
+    libusb_release_interface(handle, channel);
+    if (detached) {
+      libusb_attach_kernel_driver(handle, channel);
+      detached = false;
+    }
+    libusb_close(handle);
+    handle = nullptr;
+    return false;
+  }
+
+  shouldStop = 0;
+  breakOn = false;
+  reader.reset(handle, dataEPIn, packetSize);
+  writer.reset(handle, dataEPOut);
+
+  thread = QThread::create([this] {
+    reader.tuneThread();
+    // every packet starts with the modem and line status, the chip sends
+    // status-only packets when the latency timer runs out with no data;
+    // the payloads are moved together in place
+    auto stripStatus = [this](unsigned char *data, int len) {
+      int length = 0;
+      for (int offset = 0; offset + FTDI_STATUS_SIZE <= len;
+           offset += packetSize) {
+        int payload = qMin(packetSize, len - offset) - FTDI_STATUS_SIZE;
+        processStatus(data[offset + 1]);
+        memmove(data + length, data + offset + FTDI_STATUS_SIZE, payload);
+        length += payload;
+      }
+      return length;
+    };
+    while (!shouldStop) {
+      QByteArray data = reader.read(stripStatus);
+      if (!data.isEmpty()) {
+        deliver(data);
+      }
+      if (reader.error() == LIBUSB_ERROR_NO_DEVICE) {
+        emit errorOccurred("Device disconnected");
+        break;
+      }
+    }
+  });
+  thread->start();
+  return true;
+}
+
+void SerialPortFTDI::processStatus(quint8 lineStatus) {
+  if (lineStatus & FTDI_RS_OE) {
+    overrunErrors.fetchAndAddRelaxed(1);
+  }
+  if (lineStatus & FTDI_RS_PE) {
+    parityErrors.fetchAndAddRelaxed(1);
+  }
+  if (lineStatus & FTDI_RS_FE) {
+    framingErrors.fetchAndAddRelaxed(1);
+  }
+  bool set = lineStatus & FTDI_RS_BI;
+  if (set != breakOn) {
+    // BREAK Changed
+    breakOn = set;
+    if (breakOn) {
+      breaks.fetchAndAddRelaxed(1);
+    }
+    emit breakChanged(breakOn);
+  }
+}
+
+bool SerialPortFTDI::getLineErrors(LineErrors &errors) {
+  errors.framing = framingErrors.loadAcquire();
+  errors.overrun = overrunErrors.loadAcquire();
+  errors.parity = parityErrors.loadAcquire();
+  errors.breaks = breaks.loadAcquire();
+  errors.bufferOverrun = 0;
+  return true;
+}
+
+void SerialPortFTDI::close() {
+  if (!isOpen())
+    return;
+  if (breakTimer && breakTimer->isActive()) {
+    breakTimer->stop();
+    breakTimeout();
+  }
+  shouldStop = 1;
+  reader.cancel();
+  thread->wait();
+  writer.cancel();
+  delete thread;
+  thread = nullptr;
+  control(FTDI_SIO_MODEM_CTRL, FTDI_SIO_SET_DTR_LOW, portIndex);
+  control(FTDI_SIO_MODEM_CTRL, FTDI_SIO_SET_RTS_LOW, portIndex);
+  libusb_release_interface(handle, channel);
+  if (detached) {
+    // hand the channel back to ftdi_sio
+    libusb_attach_kernel_driver(handle, channel);
+    detached = false;
+  }
+  libusb_close(handle);
+  handle = nullptr;
+}
+
+// AN232B-05: the divisor is 3 MHz (12 MHz on the high speed chips, which
+// sample 10 rather than 16 times per bit) over the baud rate with three
+// fractional bits, the fraction encoded in bits 14-16
+static quint32 baudDivisor(qint32 baudRate, bool highSpeed) {
+  static const quint8 divfrac[8] = {0, 3, 2, 4, 1, 5, 6, 7};
+  // below 1200 baud the high speed chips fall back to the 3 MHz clock
+  bool fast = highSpeed && baudRate >= 1200;
+  qint64 base = fast ? 12000000 : 3000000;
+  quint32 divisor3 = (quint32)((base * 8 + baudRate / 2) / baudRate);
+  quint32 divisor = divisor3 >> 3;
+  divisor |= (quint32)divfrac[divisor3 & 0x7] << 14;
+  // special cases for the highest rates
+  if (divisor == 1) {
+    divisor = 0;
+  } else if (divisor == 0x4001) {
+    divisor = 1;
+  }
+  if (fast) {
+    // turns off the divide by 2.5, needed above 3 Mbaud
+    divisor |= 0x00020000;
+  }
+  return divisor;
+}
+
+void SerialPortFTDI::setBaudRate(qint32 baudRate) {
+  qint32 maximum = highSpeed ? 12000000 : 3000000;
+  if (currentBaudRate == baudRate || baudRate <= 0 || baudRate > maximum) {
+    return;
+  }
+  quint32 divisor = baudDivisor(baudRate, highSpeed);
+  quint16 value = divisor & 0xffff;
+  quint16 index = divisor >> 16;
+  if (highSpeed || channels > 1) {
+    index = (index << 8) | portIndex;
+  }
+  if (control(FTDI_SIO_SET_BAUDRATE, value, index)) {
+    currentBaudRate = baudRate;
+  }
+}
+
+bool SerialPortFTDI::setLineProperties(QSerialPort::DataBits dataBits,
+                                       QSerialPort::Parity parity,
+                                       QSerialPort::StopBits stopBits,
+                                       bool breakSet) {
+  quint16 value = dataBits;
+  switch (parity) {
+  case QSerialPort::OddParity:
+    value |= 1 << 8;
+    break;
+  case QSerialPort::EvenParity:
+    value |= 2 << 8;
+    break;
+  case QSerialPort::MarkParity:
+    value |= 3 << 8;
+    break;
+  case QSerialPort::SpaceParity:
+    value |= 4 << 8;
+    break;
+  default:
+    break;
+  }
+  switch (stopBits) {
+  case QSerialPort::OneAndHalfStop:
+    value |= 1 << 11;
+    break;
+  case QSerialPort::TwoStop:
+    value |= 2 << 11;
+    break;
+  default:
+    break;
+  }
+  if (breakSet) {
+    value |= FTDI_SIO_SET_BREAK;
+  }
+  if (!control(FTDI_SIO_SET_DATA, value, portIndex)) {
+    return false;
+  }
+  currentDataBits = dataBits;
+  currentParity = parity;
+  currentStopBits = stopBits;
+  return true;
+}
+
+void SerialPortFTDI::setDataBits(QSerialPort::DataBits dataBits) {
+  // only 7 and 8 are supported by the chip
+  if (currentDataBits != dataBits) {
+    setLineProperties(dataBits, currentParity, currentStopBits, false);
+  }
+}
+
+void SerialPortFTDI::setParity(QSerialPort::Parity parity) {
+  if (currentParity != parity) {
+    setLineProperties(currentDataBits, parity, currentStopBits, false);
+  }
+}
+
+void SerialPortFTDI::setStopBits(QSerialPort::StopBits stopBits) {
+  if (currentStopBits != stopBits) {
+    setLineProperties(currentDataBits, currentParity, stopBits, false);
+  }
+}
+
+void SerialPortFTDI::setFlowControl(QSerialPort::FlowControl flowControl) {
+  quint16 value = 0;
+  quint16 mode = FTDI_SIO_DISABLE_FLOW_CTRL;
+  if (flowControl == QSerialPort::HardwareControl) {
+    mode = FTDI_SIO_RTS_CTS_HS;
+  } else if (flowControl == QSerialPort::SoftwareControl) {
+    mode = FTDI_SIO_XON_XOFF_HS;
+    value = 0x13 << 8 | 0x11; // XOFF, XON
+  }
+  if (control(FTDI_SIO_SET_FLOW_CTRL, value, mode << 8 | portIndex)) {
+    currentFlowControl = flowControl;
+  }
+}
+
+void SerialPortFTDI::setLatencyTimer(int msecs) {
+  latencyTimer = qBound(1, msecs, 255);
+  if (isOpen()) {
+    control(FTDI_SIO_SET_LATENCY_TIMER, latencyTimer, portIndex);
+  }
+}
+
+void SerialPortFTDI::setEventCharacter(int character) {
+  eventCharacter = character < 0 ? -1 : character & 0xff;
+  if (isOpen()) {
+    // bit 8 enables the character
+    quint16 value = eventCharacter < 0 ? 0 : 0x100 | eventCharacter;
+    control(FTDI_SIO_SET_EVENT_CHAR, value, portIndex);
+  }
+}
+
+void SerialPortFTDI::sendData(const QByteArray &data) {
+  writer.send(data);
+}
+
+void SerialPortFTDI::triggerBreak(uint msecs) {
+  setLineProperties(currentDataBits, currentParity, currentStopBits, true);
+
+  if (breakTimer) {
+    breakTimer->stop();
+    delete breakTimer;
+  }
+  breakTimer = new QTimer(this);
+  breakTimer->setSingleShot(true);
+  connect(breakTimer, SIGNAL(timeout()), this, SLOT(breakTimeout()));
+  breakTimer->start(msecs);
+}
+
+void SerialPortFTDI::breakTimeout() {
+  setLineProperties(currentDataBits, currentParity, currentStopBits, false);
+}
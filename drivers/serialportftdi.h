@@ -0,0 +1,91 @@
+#ifndef SERIALPORTFTDI_H
+#define SERIALPORTFTDI_H
+
+#include "libusb.h"
+#include "serialport.h"
+#include "usbbulkreader.h"
+#include "usbbulkwriter.h"
+#include <QAtomicInt>
+#include <QThread>
+#include <QTimer>
+
+// reference:
+// FTDI AN232B-04, AN232B-05, AN_120
+// Linux kernel ftdi_sio.c
+
+// FT232R/FT232BM/FT-X (full speed, 64 byte packets) and FT2232H/FT4232H/
+// FT232H (high speed, 512 byte packets), one port per channel. The chip
+// holds received data until a packet fills up or its latency timer runs
+// out, 16 ms out of reset; the timer is set from "ftdi/latencyTimer" when
+// the port opens, and an event character flushes the buffer as soon as
+// that byte is received.
+class SerialPortFTDI : public SerialPort {
+  Q_OBJECT
+
+public:
+  static QList<SerialPort *> availablePorts(QObject *parent = nullptr);
+  QString portName() override;
+  void setBaudRate(qint32 baudRate) override;
+  qint32 getBaudRate() override { return currentBaudRate; }
+  void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override { return currentDataBits; }
+  void setParity(QSerialPort::Parity parity) override;
+  QSerialPort::Parity getParity() override { return currentParity; }
+  void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override { return currentStopBits; }
+  void setFlowControl(QSerialPort::FlowControl flowControl) override;
+  bool open() override;
+  bool isOpen() override { return handle != nullptr; }
+  void close() override;
+  bool getLineErrors(LineErrors &errors) override;
+
+  // 1 to 255 ms, applied right away if open
+  void setLatencyTimer(int msecs);
+  int getLatencyTimer() { return latencyTimer; }
+  // the byte that flushes the chip's buffer, -1 for none
+  void setEventCharacter(int character);
+  int getEventCharacter() { return eventCharacter; }
+
+public slots:
+  void sendData(const QByteArray &data) override;
+  void triggerBreak(uint msecs) override;
+
+private slots:
+  void breakTimeout();
+
+private:
+  bool sendIsThreadSafe() override { return true; }
+  SerialPortFTDI(QObject *parent, libusb_device *device, int channel,
+                 int channels, bool highSpeed);
+  ~SerialPortFTDI();
+
+  bool control(quint8 request, quint16 value, quint16 index);
+  bool setLineProperties(QSerialPort::DataBits dataBits,
+                         QSerialPort::Parity parity,
+                         QSerialPort::StopBits stopBits, bool breakSet);
+  void processStatus(quint8 lineStatus);
+  libusb_device *device;
+  libusb_device_handle *handle;
+  QThread *thread;
+  QTimer *breakTimer;
+  int channel;  // interface number
+  int channels; // interfaces on the chip
+  bool highSpeed;
+  bool detached;
+  quint16 portIndex; // wIndex of vendor requests
+  quint8 dataEPIn, dataEPOut;
+  int packetSize;
+  int latencyTimer;
+  int eventCharacter;
+
+  QAtomicInt shouldStop;
+  UsbBulkReader reader;
+  UsbBulkWriter writer;
+  bool breakOn; // reader thread only
+  QAtomicInteger<qint64> framingErrors;
+  QAtomicInteger<qint64> overrunErrors;
+  QAtomicInteger<qint64> parityErrors;
+  QAtomicInteger<qint64> breaks;
+};
+
+#endif
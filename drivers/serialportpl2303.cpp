@@ -72,7 +72,7 @@ static QMap<quint16, quint8> pidAndQuirkOfProlific = {
 };
 
 SerialPortPL2303::SerialPortPL2303(QObject *parent, libusb_device *device)
-    : SerialPort(parent) {
+    : SerialPort(parent), reader(this), writer(this) {
   libusb_ref_device(device);
   this->device = device;
   handle = nullptr;
@@ -220,15 +220,18 @@ bool SerialPortPL2303::open() {
   }
 
   shouldStop = 0;
+  reader.reset(handle, dataEPIn, 64);
+  writer.reset(handle, dataEPOut);
 
   thread = QThread::create([this] {
-    quint8 data[64] = {0};
+    reader.tuneThread();
     while (!shouldStop) {
-      int len = 0;
-      auto rc =
-          libusb_bulk_transfer(handle, dataEPIn, data, sizeof(data), &len, 300);
-      if (rc >= 0 || (rc == LIBUSB_ERROR_TIMEOUT && len > 0)) {
-        emit this->receivedData(QByteArray((char *)data, len));
+      QByteArray data = reader.read();
+      if (!data.isEmpty()) {
+        deliver(data);
+      } else if (reader.error() == LIBUSB_ERROR_NO_DEVICE) {
+        emit errorOccurred("Device disconnected");
+        break;
       }
     }
   });
@@ -241,7 +244,9 @@ void SerialPortPL2303::close() {
     return;
   setBreak(false);
   shouldStop = 1;
+  reader.cancel();
   thread->wait();
+  writer.cancel();
   libusb_close(handle);
   handle = nullptr;
 }
@@ -408,19 +413,8 @@ void SerialPortPL2303::setBaudRate(qint32 baudRate) {
   }
 }
 
-static void pl2303_callback(libusb_transfer *transfer) {
-  delete[] (unsigned char *)transfer->user_data;
-  libusb_free_transfer(transfer);
-}
-
 void SerialPortPL2303::sendData(const QByteArray &data) {
-  auto transfer = libusb_alloc_transfer(0);
-  unsigned char *buffer = new unsigned char[data.length()];
-  memcpy(buffer, data.data(), data.length());
-
-  libusb_fill_bulk_transfer(transfer, handle, dataEPOut, buffer, data.length(),
-                            pl2303_callback, buffer, 0);
-  libusb_submit_transfer(transfer);
+  writer.send(data);
 }
 
 bool SerialPortPL2303::vendorRead(quint16 val, unsigned char buf[1]) {
@@ -0,0 +1,352 @@
+#include "serialportposix.h"
+#include "chunkpool.h"
+
+#ifdef Q_OS_LINUX
+
+#include <QDir>
+#include <QFile>
+#include <asm/termbits.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+// one read() pulls at most this much, the tty buffer is usually smaller
+#define READ_BUFFER_SIZE (64 * 1024)
+
+SerialPortPosix::SerialPortPosix(QObject *parent, QString path)
+    : SerialPort(parent) {
+  this->path = path;
+  fd = -1;
+  wakeFd = -1;
+  thread = nullptr;
+  breakTimer = nullptr;
+  lowLatencyWasSet = false;
+}
+
+SerialPortPosix::~SerialPortPosix() {
+  if (isOpen()) {
+    close();
+  }
+}
+
+QList<SerialPort *> SerialPortPosix::availablePorts(QObject *parent) {
+  QList<SerialPort *> result;
+  QDir dev("/dev");
+  for (auto &name : dev.entryList({"ttyUSB*", "ttyACM*"}, QDir::System,
+                                  QDir::Name)) {
+    result.append(new SerialPortPosix(parent, dev.filePath(name)));
+  }
+  return result;
+}
+
+bool SerialPortPosix::applySettings() {
+  if (fd < 0) {
+    return true;
+  }
+  struct termios2 tio;
+  if (ioctl(fd, TCGETS2, &tio) < 0) {
+    return false;
+  }
+  // raw mode, see cfmakeraw(3)
+  tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL |
+                   IXON | IXOFF | IXANY);
+  tio.c_oflag &= ~OPOST;
+  tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+  tio.c_cflag &= ~(CSIZE | PARENB | PARODD | CMSPAR | CSTOPB | CRTSCTS);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+
+  // any rate, not just the Bxxx table
+  tio.c_cflag &= ~CBAUD;
+  tio.c_cflag |= BOTHER;
+  tio.c_ispeed = tio.c_ospeed = currentBaudRate;
+
+  static const tcflag_t sizes[] = {CS5, CS6, CS7, CS8};
+  int dataBits = qBound<int>(5, currentDataBits, 8);
+  tio.c_cflag |= sizes[dataBits - 5];
+
+  switch (currentParity) {
+  case QSerialPort::EvenParity:
+    tio.c_cflag |= PARENB;
+    break;
+  case QSerialPort::OddParity:
+    tio.c_cflag |= PARENB | PARODD;
+    break;
+  case QSerialPort::MarkParity:
+    tio.c_cflag |= PARENB | CMSPAR | PARODD;
+    break;
+  case QSerialPort::SpaceParity:
+    tio.c_cflag |= PARENB | CMSPAR;
+    break;
+  default:
+    break;
+  }
+  // CSTOPB means 1.5 stop bits with 5 data bits
+  if (currentStopBits != QSerialPort::OneStop) {
+    tio.c_cflag |= CSTOPB;
+  }
+  if (currentFlowControl == QSerialPort::HardwareControl) {
+    tio.c_cflag |= CRTSCTS;
+  } else if (currentFlowControl == QSerialPort::SoftwareControl) {
+    tio.c_iflag |= IXON | IXOFF;
+  }
+  return ioctl(fd, TCSETS2, &tio) >= 0;
+}
+
+void SerialPortPosix::setBaudRate(qint32 baudRate) {
+  currentBaudRate = baudRate;
+  applySettings();
+}
+
+void SerialPortPosix::setDataBits(QSerialPort::DataBits dataBits) {
+  currentDataBits = dataBits;
+  applySettings();
+}
+
+void SerialPortPosix::setParity(QSerialPort::Parity parity) {
+  currentParity = parity;
+  applySettings();
+}
+
+void SerialPortPosix::setStopBits(QSerialPort::StopBits stopBits) {
+  currentStopBits = stopBits;
+  applySettings();
+}
+
+void SerialPortPosix::setFlowControl(QSerialPort::FlowControl flowControl) {
+  currentFlowControl = flowControl;
+  applySettings();
+}
+
+bool SerialPortPosix::open() {
+  fd = ::open(QFile::encodeName(path).constData(),
+              O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd < 0 || ioctl(fd, TIOCEXCL) < 0 || !applySettings()) {
+    close();
+    return false;
+  }
+
+  // not every driver has it, the port works either way
+  struct serial_struct serial;
+  lowLatencyWasSet = true;
+  if (ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+    lowLatencyWasSet = serial.flags & ASYNC_LOW_LATENCY;
+    serial.flags |= ASYNC_LOW_LATENCY;
+    ioctl(fd, TIOCSSERIAL, &serial);
+  }
+  ioctl(fd, TCFLSH, TCIOFLUSH);
+
+  shouldStop = 0;
+  thread = QThread::create([this] { run(); });
+  thread->start();
+  return true;
+}
+
+void SerialPortPosix::close() {
+  if (thread) {
+    shouldStop = 1;
+    wake();
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+  }
+  if (breakTimer) {
+    breakTimer->stop();
+  }
+  if (fd >= 0) {
+    struct serial_struct serial;
+    if (!lowLatencyWasSet && ioctl(fd, TIOCGSERIAL, &serial) == 0) {
+      serial.flags &= ~ASYNC_LOW_LATENCY;
+      ioctl(fd, TIOCSSERIAL, &serial);
+    }
+    ::close(fd);
+    fd = -1;
+  }
+  if (wakeFd >= 0) {
+    ::close(wakeFd);
+    wakeFd = -1;
+  }
+  QMutexLocker locker(&writeMutex);
+  writeQueue.clear();
+  pendingBytes = 0;
+}
+
+void SerialPortPosix::wake() {
+  quint64 one = 1;
+  if (::write(wakeFd, &one, sizeof(one)) < 0) {
+    // already signalled, the counter is saturated
+  }
+}
+
+void SerialPortPosix::sendData(const QByteArray &data) {
+  if (fd < 0) {
+    pendingBytes.fetchAndAddOrdered(-data.length());
+    return;
+  }
+  {
+    QMutexLocker locker(&writeMutex);
+    writeQueue.append(data);
+  }
+  wake();
+}
+
+void SerialPortPosix::run() {
+  int epoll = epoll_create1(EPOLL_CLOEXEC);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+  event.data.fd = wakeFd;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, wakeFd, &event);
+
+  ChunkPool pool(READ_BUFFER_SIZE);
+  tuneReaderThread(&pool);
+  QByteArray writing; // head of the queue, partly written
+  qint64 written = 0;
+  bool waitingForOut = false;
+  QString error; // why the loop gave up, empty if asked to stop
+  while (!shouldStop) {
+    struct epoll_event events[2];
+    int count = epoll_wait(epoll, events, 2, -1);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error = strerror(errno);
+      break;
+    }
+    bool failed = false;
+    for (int i = 0; i < count; i++) {
+      if (events[i].data.fd == wakeFd) {
+        quint64 value;
+        if (::read(wakeFd, &value, sizeof(value)) < 0) {
+          // spurious, nothing to clear
+        }
+        continue;
+      }
+      if (events[i].events & EPOLLIN) {
+        // everything available in one chunk
+        char *buffer = pool.take();
+        qint64 length = 0;
+        forever {
+          ssize_t rc = ::read(fd, buffer + length, pool.blockSize() - length);
+          if (rc > 0) {
+            length += rc;
+            if (length == pool.blockSize()) {
+              break;
+            }
+          } else if (rc < 0 && errno == EINTR) {
+            continue;
+          } else {
+            // 0 with VMIN 0 means drained, EIO means the device went away
+            failed = rc < 0 && errno != EAGAIN;
+            if (failed) {
+              error = strerror(errno);
+            }
+            break;
+          }
+        }
+        if (length > 0) {
+          deliver(pool.finish(length));
+        }
+      }
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        if (!failed) {
+          error = events[i].events & EPOLLHUP ? "Device hung up"
+                                              : "Device error";
+        }
+        failed = true;
+      }
+    }
+    if (failed) {
+      break;
+    }
+
+    // drain the write queue until the tty pushes back
+    forever {
+      if (writing.isEmpty()) {
+        QMutexLocker locker(&writeMutex);
+        if (writeQueue.isEmpty()) {
+          break;
+        }
+        writing = writeQueue.takeFirst();
+        written = 0;
+      }
+      ssize_t rc = ::write(fd, writing.constData() + written,
+                           writing.length() - written);
+      if (rc < 0) {
+        if (errno == EAGAIN) {
+          break;
+        }
+        if (errno == EINTR) {
+          continue;
+        }
+        // drop it, the port is failing
+        rc = writing.length() - written;
+      }
+      written += rc;
+      pendingBytes.fetchAndAddOrdered(-rc);
+      if (written == writing.length()) {
+        writing.clear();
+      }
+    }
+    bool wantOut = !writing.isEmpty();
+    if (wantOut != waitingForOut) {
+      event.events = EPOLLIN | (wantOut ? EPOLLOUT : 0);
+      event.data.fd = fd;
+      epoll_ctl(epoll, EPOLL_CTL_MOD, fd, &event);
+      waitingForOut = wantOut;
+    }
+  }
+  ::close(epoll);
+  // isOpen() stays true until the owner closes the port
+  if (!shouldStop && !error.isEmpty()) {
+    emit errorOccurred(error);
+  }
+}
+
+bool SerialPortPosix::getLineErrors(LineErrors &errors) {
+  struct serial_icounter_struct count;
+  if (fd < 0 || ioctl(fd, TIOCGICOUNT, &count) < 0) {
+    return false;
+  }
+  errors.framing = count.frame;
+  errors.overrun = count.overrun;
+  errors.parity = count.parity;
+  errors.breaks = count.brk;
+  errors.bufferOverrun = count.buf_overrun;
+  return true;
+}
+
+void SerialPortPosix::triggerBreak(uint msecs) {
+  if (fd < 0) {
+    return;
+  }
+  ioctl(fd, TIOCSBRK);
+  if (breakTimer) {
+    breakTimer->stop();
+    delete breakTimer;
+  }
+  breakTimer = new QTimer(this);
+  breakTimer->setSingleShot(true);
+  connect(breakTimer, SIGNAL(timeout()), this, SLOT(breakTimeout()));
+  breakTimer->start(msecs);
+}
+
+void SerialPortPosix::breakTimeout() {
+  if (fd >= 0) {
+    ioctl(fd, TIOCCBRK);
+  }
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef SERIALPORTPOSIX_H
+#define SERIALPORTPOSIX_H
+
+#include "serialport.h"
+#include <QAtomicInt>
+#include <QThread>
+#include <QTimer>
+
+#ifdef Q_OS_LINUX
+
+// Linux ttys (/dev/ttyUSB*, /dev/ttyACM*, ...) driven directly rather than
+// through QSerialPort. An epoll thread reads everything available in one
+// go and delivers it from there, so throughput does not depend on the GUI
+// event loop, and it also drains the write queue. termios2 with BOTHER
+// allows any baud rate the UART can generate, and ASYNC_LOW_LATENCY is
+// requested while open so the tty layer pushes data up without waiting.
+class SerialPortPosix : public SerialPort {
+  Q_OBJECT
+
+public:
+  static QList<SerialPort *> availablePorts(QObject *parent = nullptr);
+  QString portName() override { return path; }
+  void setBaudRate(qint32 baudRate) override;
+  qint32 getBaudRate() override { return currentBaudRate; }
+  void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override { return currentDataBits; }
+  void setParity(QSerialPort::Parity parity) override;
+  QSerialPort::Parity getParity() override { return currentParity; }
+  void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override { return currentStopBits; }
+  void setFlowControl(QSerialPort::FlowControl flowControl) override;
+  bool open() override;
+  bool isOpen() override { return fd >= 0; }
+  void close() override;
+  bool getLineErrors(LineErrors &errors) override;
+
+public slots:
+  void sendData(const QByteArray &data) override;
+  void triggerBreak(uint msecs) override;
+
+private slots:
+  void breakTimeout();
+
+protected:
+  SerialPortPosix(QObject *parent, QString path);
+  ~SerialPortPosix();
+
+  QString path;
+
+private:
+  // only queues and wakes the epoll thread
+  bool sendIsThreadSafe() override { return true; }
+  bool applySettings();
+  void run();
+  void wake();
+
+  int fd;
+  int wakeFd; // eventfd, wakes the epoll thread for writes and close
+  QThread *thread;
+  QTimer *breakTimer;
+  QAtomicInt shouldStop;
+  bool lowLatencyWasSet;
+
+  QMutex writeMutex;
+  QList<QByteArray> writeQueue;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+#include "serialportpty.h"
+#include <QSettings>
+
+#ifdef Q_OS_LINUX
+#include "prbs.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <unistd.h>
+
+#define CHUNK_SIZE 4096
+// longest the generator waits before checking whether it should stop
+#define POLL_INTERVAL_MS 50
+#endif
+PtyGenerator PtyGenerator::load() {
+  QSettings settings;
+  PtyGenerator generator;
+  generator.mode = (Mode)settings.value("pty/mode", Echo).toInt();
+  generator.rate = settings.value("pty/rate", 0).toLongLong();
+  generator.prbsOrder = settings.value("pty/prbsOrder", 15).toInt();
+  generator.replayFile = settings.value("pty/replayFile").toString();
+  generator.burstSize = settings.value("pty/burstSize", 256).toInt();
+  generator.burstIntervalMs =
+      settings.value("pty/burstIntervalMs", 100).toInt();
+  return generator;
+}
+
+void PtyGenerator::save() const {
+  QSettings settings;
+  settings.setValue("pty/mode", mode);
+  settings.setValue("pty/rate", rate);
+  settings.setValue("pty/prbsOrder", prbsOrder);
+  settings.setValue("pty/replayFile", replayFile);
+  settings.setValue("pty/burstSize", burstSize);
+  settings.setValue("pty/burstIntervalMs", burstIntervalMs);
+}
+
+#ifdef Q_OS_LINUX
+
+SerialPortPty::SerialPortPty(QObject *parent)
+    : SerialPortPosix(parent, QString()) {
+  generator = PtyGenerator::load();
+  master = -1;
+  generatorThread = nullptr;
+}
+
+SerialPortPty::~SerialPortPty() {
+  if (isOpen()) {
+    close();
+  }
+}
+
+QList<SerialPort *> SerialPortPty::availablePorts(QObject *parent) {
+  return QList<SerialPort *>{new SerialPortPty(parent)};
+}
+
+bool SerialPortPty::open() {
+  QByteArray replay;
+  if (generator.mode == PtyGenerator::Replay) {
+    QFile file(generator.replayFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+      return false;
+    }
+    replay = file.readAll();
+    if (replay.isEmpty()) {
+      return false;
+    }
+  }
+
+  int slave;
+  if (openpty(&master, &slave, nullptr, nullptr, nullptr) < 0) {
+    return false;
+  }
+  path = QFile::decodeName(ttyname(slave));
+  fcntl(master, F_SETFD, FD_CLOEXEC);
+  fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+  // opens the slave again by name, keep ours until then so the pair stays
+  bool opened = SerialPortPosix::open();
+  ::close(slave);
+  if (!opened) {
+    ::close(master);
+    master = -1;
+    return false;
+  }
+
+  generatedBytes = 0;
+  consumedBytes = 0;
+  generatorShouldStop = 0;
+  generatorThread = QThread::create([this, replay] { run(replay); });
+  generatorThread->start();
+  return true;
+}
+
+void SerialPortPty::close() {
+  if (generatorThread) {
+    generatorShouldStop = 1;
+    generatorThread->wait();
+    delete generatorThread;
+    generatorThread = nullptr;
+  }
+  SerialPortPosix::close();
+  if (master >= 0) {
+    ::close(master);
+    master = -1;
+  }
+}
+
+void SerialPortPty::run(QByteArray replay) {
+  Prbs prbs(generator.prbsOrder);
+  qint64 replayOffset = 0;
+  QElapsedTimer clock;
+  clock.start();
+  // bytes the rate allows so far, for Prbs and Replay
+  qint64 sent = 0;
+  qint64 nextBurstMs = 0;
+
+  QByteArray pending; // generated but not yet taken by the pty
+  char buffer[CHUNK_SIZE];
+  while (!generatorShouldStop) {
+    // top up what goes out next
+    int timeout = POLL_INTERVAL_MS;
+    if (pending.isEmpty()) {
+      qint64 allowed = CHUNK_SIZE;
+      switch (generator.mode) {
+      case PtyGenerator::Prbs:
+      case PtyGenerator::Replay:
+        if (generator.rate > 0) {
+          allowed = qMin<qint64>(
+              CHUNK_SIZE, generator.rate * clock.elapsed() / 1000 - sent);
+          if (allowed <= 0) {
+            // until one more byte is due
+            timeout = qBound<qint64>(
+                1, (sent + 1) * 1000 / generator.rate - clock.elapsed(),
+                POLL_INTERVAL_MS);
+            allowed = 0;
+          }
+        }
+        if (allowed > 0 && generator.mode == PtyGenerator::Prbs) {
+          pending.resize(allowed);
+          prbs.fill(pending.data(), allowed);
+        } else if (allowed > 0) {
+          while (pending.length() < allowed) {
+            qint64 length = qMin<qint64>(allowed - pending.length(),
+                                         replay.length() - replayOffset);
+            pending.append(replay.constData() + replayOffset, length);
+            replayOffset = (replayOffset + length) % replay.length();
+          }
+        }
+        sent += pending.length();
+        break;
+      case PtyGenerator::Burst:
+        if (clock.elapsed() >= nextBurstMs) {
+          pending.resize(generator.burstSize);
+          for (int i = 0; i < pending.length(); i++) {
+            pending[i] = (char)i;
+          }
+          nextBurstMs += qMax(1, generator.burstIntervalMs);
+        } else {
+          timeout = qMin<qint64>(timeout, nextBurstMs - clock.elapsed());
+        }
+        break;
+      default:
+        break;
+      }
+    }
+
+    struct pollfd fds = {master, POLLIN, 0};
+    if (!pending.isEmpty()) {
+      fds.events |= POLLOUT;
+    }
+    if (poll(&fds, 1, timeout) < 0 && errno != EINTR) {
+      break;
+    }
+    if (fds.revents & POLLIN) {
+      ssize_t length = ::read(master, buffer, sizeof(buffer));
+      if (length > 0) {
+        consumedBytes.fetchAndAddRelaxed(length);
+        if (generator.mode == PtyGenerator::Echo) {
+          pending.append(buffer, length);
+        }
+      }
+    }
+    if (fds.revents & POLLOUT && !pending.isEmpty()) {
+      ssize_t length = ::write(master, pending.constData(), pending.length());
+      if (length > 0) {
+        generatedBytes.fetchAndAddRelaxed(length);
+        pending.remove(0, length);
+      }
+    }
+    if (fds.revents & (POLLERR | POLLNVAL)) {
+      break;
+    }
+  }
+}
+
+#endif
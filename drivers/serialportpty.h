@@ -0,0 +1,63 @@
+#ifndef SERIALPORTPTY_H
+#define SERIALPORTPTY_H
+
+#include "serialportposix.h"
+
+// What the far end of the loopback port does.
+struct PtyGenerator {
+  enum Mode { Echo, Prbs, Replay, Burst };
+
+  Mode mode = Echo;
+  // bytes per second for Prbs and Replay, 0 for as fast as the pty takes
+  qint64 rate = 0;
+  int prbsOrder = 15;
+  // sent over and over
+  QString replayFile;
+  // Burst sends burstSize bytes every burstIntervalMs
+  int burstSize = 256;
+  int burstIntervalMs = 100;
+
+  static PtyGenerator load();
+  void save() const;
+};
+
+#ifdef Q_OS_LINUX
+
+// A pseudo terminal pair: the application side is opened by
+// SerialPortPosix exactly like a real tty, so reads, writes and timing go
+// through the same epoll thread, kernel tty layer and buffering. The other
+// side is driven by a built-in generator thread that echoes, or produces
+// PRBS, a replayed file or fixed-size bursts at a set rate; what the
+// application sends is then read and discarded.
+class SerialPortPty : public SerialPortPosix {
+  Q_OBJECT
+
+public:
+  static QList<SerialPort *> availablePorts(QObject *parent = nullptr);
+  QString portName() override { return "loopback (pty)"; }
+  bool open() override;
+  void close() override;
+  // applies on the next open(), loaded from the settings by default
+  void setGenerator(const PtyGenerator &generator) {
+    this->generator = generator;
+  }
+  // bytes the generator wrote and read since open()
+  qint64 generated() const { return generatedBytes.loadAcquire(); }
+  qint64 consumed() const { return consumedBytes.loadAcquire(); }
+
+private:
+  SerialPortPty(QObject *parent);
+  ~SerialPortPty();
+  void run(QByteArray replay);
+
+  PtyGenerator generator;
+  int master;
+  QThread *generatorThread;
+  QAtomicInt generatorShouldStop;
+  QAtomicInteger<qint64> generatedBytes;
+  QAtomicInteger<qint64> consumedBytes;
+};
+
+#endif
+
+#endif
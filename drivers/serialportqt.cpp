@@ -7,6 +7,8 @@ SerialPortQt::SerialPortQt(QObject *parent, QString portName)
   port = new QSerialPort(this);
   port->setPortName(portName);
   connect(port, SIGNAL(readyRead()), this, SLOT(handleReadyRead()));
+  connect(port, SIGNAL(bytesWritten(qint64)), this,
+          SLOT(handleBytesWritten(qint64)));
   breakTimer = nullptr;
 }
 
@@ -22,21 +24,33 @@ QSerialPort::Parity SerialPortQt::getParity() { return port->parity(); }
 void SerialPortQt::setDataBits(QSerialPort::DataBits dataBits) {
   port->setDataBits(dataBits);
 }
+QSerialPort::DataBits SerialPortQt::getDataBits() { return port->dataBits(); }
 void SerialPortQt::setStopBits(QSerialPort::StopBits stopBits) {
   port->setStopBits(stopBits);
 }
+QSerialPort::StopBits SerialPortQt::getStopBits() { return port->stopBits(); }
 void SerialPortQt::setFlowControl(QSerialPort::FlowControl flowControl) {
   port->setFlowControl(flowControl);
 }
 bool SerialPortQt::open() { return port->open(QIODevice::ReadWrite); }
 bool SerialPortQt::isOpen() { return port->isOpen(); }
-void SerialPortQt::close() { return port->close(); }
-void SerialPortQt::sendData(const QByteArray &data) { port->write(data); }
+void SerialPortQt::close() {
+  port->close();
+  pendingBytes = 0;
+}
+void SerialPortQt::sendData(const QByteArray &data) {
+  if (port->write(data) < 0) {
+    pendingBytes.fetchAndAddOrdered(-data.length());
+  }
+}
+void SerialPortQt::handleBytesWritten(qint64 bytes) {
+  pendingBytes.fetchAndAddOrdered(-bytes);
+}
 
 void SerialPortQt::handleReadyRead() {
   while (port->bytesAvailable()) {
     auto data = port->readAll();
-    emit receivedData(data);
+    deliver(data);
   }
 }
 QList<SerialPort *> SerialPortQt::availablePorts(QObject *parent) {
@@ -13,24 +13,23 @@ public:
   void setBaudRate(qint32 baudRate) override;
   qint32 getBaudRate() override;
   void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override;
   void setParity(QSerialPort::Parity parity) override;
   QSerialPort::Parity getParity() override;
   void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override;
   void setFlowControl(QSerialPort::FlowControl flowControl) override;
   bool open() override;
   bool isOpen() override;
   void close() override;
 
-signals:
-  void receivedData(QByteArray data);
-  void breakChanged(bool set); // not supported
-
 public slots:
   void sendData(const QByteArray &data) override;
   void triggerBreak(uint msecs) override;
 
 private slots:
   void handleReadyRead();
+  void handleBytesWritten(qint64 bytes);
   void breakTimeout();
 
 private:
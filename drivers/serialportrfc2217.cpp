@@ -0,0 +1,283 @@
+#include "serialportrfc2217.h"
+#include <QSettings>
+
+#define CONNECT_TIMEOUT_MS 3000
+
+SerialPortRfc2217::SerialPortRfc2217(QObject *parent, QString host,
+                                     quint16 port)
+    : SerialPort(parent) {
+  this->host = host;
+  this->port = port;
+  socket = new QTcpSocket(this);
+  connect(socket, SIGNAL(readyRead()), this, SLOT(handleReadyRead()));
+  connect(socket, SIGNAL(bytesWritten(qint64)), this,
+          SLOT(handleBytesWritten(qint64)));
+  connect(socket, SIGNAL(disconnected()), this, SLOT(handleDisconnected()));
+  closing = false;
+  breakTimer = nullptr;
+  outgoingRaw = 0;
+  flushPending = false;
+}
+
+QList<SerialPort *> SerialPortRfc2217::availablePorts(QObject *parent) {
+  QList<SerialPort *> result;
+  QSettings settings;
+  for (auto &address : settings.value("rfc2217/remotes").toStringList()) {
+    auto port = fromAddress(address, parent);
+    if (port) {
+      result.append(port);
+    }
+  }
+  return result;
+}
+
+SerialPort *SerialPortRfc2217::fromAddress(const QString &address,
+                                           QObject *parent) {
+  int colon = address.lastIndexOf(':');
+  if (colon <= 0) {
+    return nullptr;
+  }
+  bool ok;
+  uint port = address.mid(colon + 1).toUInt(&ok);
+  if (!ok || port == 0 || port > 65535) {
+    return nullptr;
+  }
+  QString host = address.left(colon);
+  // [::1]:2217
+  if (host.startsWith('[') && host.endsWith(']')) {
+    host = host.mid(1, host.length() - 2);
+  }
+  return new SerialPortRfc2217(parent, host, port);
+}
+
+QString SerialPortRfc2217::portName() {
+  return QString(host.contains(':') ? "rfc2217://[%1]:%2"
+                                    : "rfc2217://%1:%2")
+      .arg(host)
+      .arg(port);
+}
+
+void SerialPortRfc2217::sendCommand(quint8 command, const QByteArray &value) {
+  if (isOpen()) {
+    socket->write(Rfc2217::command(command, value));
+  }
+}
+
+void SerialPortRfc2217::setBaudRate(qint32 baudRate) {
+  currentBaudRate = baudRate;
+  sendCommand(Rfc2217::SET_BAUDRATE, Rfc2217::value32(baudRate));
+}
+qint32 SerialPortRfc2217::getBaudRate() { return currentBaudRate; }
+void SerialPortRfc2217::setDataBits(QSerialPort::DataBits dataBits) {
+  currentDataBits = dataBits;
+  sendCommand(Rfc2217::SET_DATASIZE, QByteArray(1, (char)dataBits));
+}
+QSerialPort::DataBits SerialPortRfc2217::getDataBits() {
+  return currentDataBits;
+}
+void SerialPortRfc2217::setParity(QSerialPort::Parity parity) {
+  currentParity = parity;
+  sendCommand(Rfc2217::SET_PARITY,
+              QByteArray(1, (char)Rfc2217::parityToWire(parity)));
+}
+QSerialPort::Parity SerialPortRfc2217::getParity() { return currentParity; }
+void SerialPortRfc2217::setStopBits(QSerialPort::StopBits stopBits) {
+  currentStopBits = stopBits;
+  sendCommand(Rfc2217::SET_STOPSIZE,
+              QByteArray(1, (char)Rfc2217::stopBitsToWire(stopBits)));
+}
+QSerialPort::StopBits SerialPortRfc2217::getStopBits() {
+  return currentStopBits;
+}
+void SerialPortRfc2217::setFlowControl(QSerialPort::FlowControl flowControl) {
+  currentFlowControl = flowControl;
+  sendCommand(Rfc2217::SET_CONTROL,
+              QByteArray(1, (char)Rfc2217::flowControlToWire(flowControl)));
+}
+
+bool SerialPortRfc2217::open() {
+  socket->connectToHost(host, port);
+  if (!socket->waitForConnected(CONNECT_TIMEOUT_MS)) {
+    socket->abort();
+    return false;
+  }
+  socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+  decoder.reset();
+  localOptions.clear();
+  remoteOptions.clear();
+
+  QByteArray hello;
+  hello += Telnet::negotiate(Telnet::WILL, Telnet::COM_PORT_OPTION);
+  hello += Telnet::negotiate(Telnet::WILL, Telnet::BINARY);
+  hello += Telnet::negotiate(Telnet::DO, Telnet::BINARY);
+  hello += Telnet::negotiate(Telnet::WILL, Telnet::SGA);
+  hello += Telnet::negotiate(Telnet::DO, Telnet::SGA);
+  localOptions << Telnet::COM_PORT_OPTION << Telnet::BINARY << Telnet::SGA;
+  remoteOptions << Telnet::BINARY << Telnet::SGA;
+  socket->write(hello);
+  // the remote port starts with whatever it had, push ours
+  setBaudRate(currentBaudRate);
+  setDataBits(currentDataBits);
+  setParity(currentParity);
+  setStopBits(currentStopBits);
+  setFlowControl(currentFlowControl);
+  return true;
+}
+
+bool SerialPortRfc2217::isOpen() {
+  return socket->state() == QAbstractSocket::ConnectedState;
+}
+
+void SerialPortRfc2217::close() {
+  closing = true;
+  socket->abort();
+  closing = false;
+  outgoing.clear();
+  outgoingRaw = 0;
+  inFlight.clear();
+  pendingBytes = 0;
+}
+
+void SerialPortRfc2217::handleDisconnected() {
+  // the server went away, isOpen() is false from here and writes are
+  // dropped, so say so rather than look open
+  if (!closing) {
+    emit errorOccurred("Connection closed");
+  }
+}
+
+void SerialPortRfc2217::sendData(const QByteArray &data) {
+  if (!isOpen()) {
+    pendingBytes.fetchAndAddOrdered(-data.length());
+    return;
+  }
+  outgoing += Telnet::escape(data);
+  outgoingRaw += data.length();
+  if (!flushPending) {
+    flushPending = true;
+    QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+  }
+}
+
+void SerialPortRfc2217::flush() {
+  flushPending = false;
+  if (outgoing.isEmpty()) {
+    return;
+  }
+  if (socket->write(outgoing) < 0) {
+    pendingBytes.fetchAndAddOrdered(-outgoingRaw);
+  } else {
+    inFlight.append(qMakePair((qint64)outgoing.length(), outgoingRaw));
+  }
+  outgoing.clear();
+  outgoingRaw = 0;
+}
+
+void SerialPortRfc2217::handleBytesWritten(qint64 bytes) {
+  // bytesWritten also counts commands, which are not in inFlight; those are
+  // small and only make the count drop a little early
+  while (bytes > 0 && !inFlight.isEmpty()) {
+    auto &front = inFlight.first();
+    qint64 wire = qMin(bytes, front.first);
+    qint64 raw = front.second * wire / front.first;
+    front.first -= wire;
+    front.second -= raw;
+    bytes -= wire;
+    pendingBytes.fetchAndAddOrdered(-raw);
+    if (front.first == 0) {
+      pendingBytes.fetchAndAddOrdered(-front.second);
+      inFlight.removeFirst();
+    }
+  }
+}
+
+void SerialPortRfc2217::handleReadyRead() {
+  QByteArray data;
+  QVector<Telnet::Event> events;
+  decoder.feed(socket->readAll(), data, events);
+  for (auto &event : events) {
+    handleEvent(event);
+  }
+  deliver(data);
+}
+
+void SerialPortRfc2217::handleEvent(const Telnet::Event &event) {
+  bool local = event.verb == Telnet::DO || event.verb == Telnet::DONT;
+  auto &options = local ? localOptions : remoteOptions;
+  switch (event.verb) {
+  case Telnet::DO:
+  case Telnet::WILL:
+    if (!options.contains(event.option)) {
+      bool supported = event.option == Telnet::BINARY ||
+                       event.option == Telnet::SGA ||
+                       (local && event.option == Telnet::COM_PORT_OPTION);
+      if (supported) {
+        options.append(event.option);
+      }
+      socket->write(Telnet::negotiate(
+          local ? (supported ? Telnet::WILL : Telnet::WONT)
+                : (supported ? Telnet::DO : Telnet::DONT),
+          event.option));
+    }
+    break;
+  case Telnet::DONT:
+  case Telnet::WONT:
+    if (options.removeAll(event.option) > 0) {
+      socket->write(Telnet::negotiate(local ? Telnet::WONT : Telnet::DONT,
+                                      event.option));
+    }
+    break;
+  case Telnet::SB:
+    if (event.option == Telnet::COM_PORT_OPTION && !event.payload.isEmpty()) {
+      handleReply((quint8)event.payload[0], event.payload.mid(1));
+    }
+    break;
+  }
+}
+
+void SerialPortRfc2217::handleReply(quint8 command, const QByteArray &value) {
+  if (command < Rfc2217::SERVER || value.isEmpty()) {
+    return;
+  }
+  // the server answers with what it actually set
+  quint8 byte = value[0];
+  switch (command - Rfc2217::SERVER) {
+  case Rfc2217::SET_BAUDRATE:
+    if (Rfc2217::toValue32(value)) {
+      currentBaudRate = Rfc2217::toValue32(value);
+    }
+    break;
+  case Rfc2217::SET_DATASIZE:
+    if (byte >= 5 && byte <= 8) {
+      currentDataBits = (QSerialPort::DataBits)byte;
+    }
+    break;
+  case Rfc2217::SET_PARITY:
+    Rfc2217::parityFromWire(byte, &currentParity);
+    break;
+  case Rfc2217::SET_STOPSIZE:
+    Rfc2217::stopBitsFromWire(byte, &currentStopBits);
+    break;
+  case Rfc2217::SET_CONTROL:
+    Rfc2217::flowControlFromWire(byte, &currentFlowControl);
+    break;
+  }
+}
+
+void SerialPortRfc2217::triggerBreak(uint msecs) {
+  sendCommand(Rfc2217::SET_CONTROL,
+              QByteArray(1, (char)Rfc2217::CONTROL_BREAK_ON));
+  if (breakTimer) {
+    breakTimer->stop();
+    delete breakTimer;
+  }
+  breakTimer = new QTimer(this);
+  breakTimer->setSingleShot(true);
+  connect(breakTimer, SIGNAL(timeout()), this, SLOT(breakTimeout()));
+  breakTimer->start(msecs);
+}
+
+void SerialPortRfc2217::breakTimeout() {
+  sendCommand(Rfc2217::SET_CONTROL,
+              QByteArray(1, (char)Rfc2217::CONTROL_BREAK_OFF));
+}
@@ -0,0 +1,74 @@
+#ifndef SERIALPORTRFC2217_H
+#define SERIALPORTRFC2217_H
+
+#include "rfc2217.h"
+#include "serialport.h"
+#include <QList>
+#include <QTcpSocket>
+#include <QTimer>
+
+// A remote port reached over TCP with the Telnet COM port control option
+// (RFC 2217), e.g. from ser2net or another QSerial serving its port.
+// Remotes are kept as host:port entries under "rfc2217/remotes".
+//
+// Writes made in one event loop pass are escaped into a single buffer and
+// handed to the socket at once, and Nagle's algorithm is turned off, so
+// small writes go out immediately without being split up.
+class SerialPortRfc2217 : public SerialPort {
+  Q_OBJECT
+
+public:
+  static QList<SerialPort *> availablePorts(QObject *parent = nullptr);
+  // nullptr if address is not host:port
+  static SerialPort *fromAddress(const QString &address,
+                                 QObject *parent = nullptr);
+  QString portName() override;
+  void setBaudRate(qint32 baudRate) override;
+  qint32 getBaudRate() override;
+  void setDataBits(QSerialPort::DataBits dataBits) override;
+  QSerialPort::DataBits getDataBits() override;
+  void setParity(QSerialPort::Parity parity) override;
+  QSerialPort::Parity getParity() override;
+  void setStopBits(QSerialPort::StopBits stopBits) override;
+  QSerialPort::StopBits getStopBits() override;
+  void setFlowControl(QSerialPort::FlowControl flowControl) override;
+  bool open() override;
+  bool isOpen() override;
+  void close() override;
+
+public slots:
+  void sendData(const QByteArray &data) override;
+  void triggerBreak(uint msecs) override;
+
+private slots:
+  void handleReadyRead();
+  void handleBytesWritten(qint64 bytes);
+  void handleDisconnected();
+  void breakTimeout();
+  void flush();
+
+private:
+  SerialPortRfc2217(QObject *parent, QString host, quint16 port);
+  void sendCommand(quint8 command, const QByteArray &value);
+  void handleEvent(const Telnet::Event &event);
+  void handleReply(quint8 command, const QByteArray &value);
+
+  QString host;
+  quint16 port;
+  QTcpSocket *socket;
+  bool closing; // the disconnect is ours, not the server's
+  QTimer *breakTimer;
+  Telnet::Decoder decoder;
+  // options either side has agreed to, so that negotiation never loops
+  QList<quint8> localOptions;
+  QList<quint8> remoteOptions;
+
+  // escaped data not yet given to the socket
+  QByteArray outgoing;
+  qint64 outgoingRaw;
+  bool flushPending;
+  // per write to the socket, wire bytes and the data bytes they carry
+  QList<QPair<qint64, qint64>> inFlight;
+};
+
+#endif
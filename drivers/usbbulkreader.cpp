@@ -0,0 +1,142 @@
+#include "usbbulkreader.h"
+
+UsbBulkReader::UsbBulkReader(SerialPort *port) : port(port) {
+  handle = nullptr;
+  endpoint = 0;
+  packetSize = 64;
+  packets = nullptr;
+  blocks = nullptr;
+  usbTransfer = libusb_alloc_transfer(0);
+  completed = 0;
+  lastError = LIBUSB_SUCCESS;
+  cancelled = false;
+  inFlight = false;
+}
+
+UsbBulkReader::~UsbBulkReader() {
+  libusb_free_transfer(usbTransfer);
+  delete packets;
+  delete blocks;
+}
+
+void UsbBulkReader::reset(libusb_device_handle *handle,
+                          unsigned char endpoint, int packetSize) {
+  this->handle = handle;
+  this->endpoint = endpoint;
+  if (!packets || packetSize != this->packetSize) {
+    this->packetSize = packetSize;
+    delete packets;
+    delete blocks;
+    packets = new ChunkPool(packetSize);
+    // whole packets, so no transfer can end in the middle of one
+    blocks = new ChunkPool(BULK_READ_SIZE - BULK_READ_SIZE % packetSize);
+  }
+  lastError = LIBUSB_SUCCESS;
+  QMutexLocker locker(&mutex);
+  cancelled = false;
+}
+
+void UsbBulkReader::tuneThread() {
+  blocks->setLocked(port->tuneReaderThread(packets).lockMemory);
+}
+
+QByteArray UsbBulkReader::read(const Filter &filter) {
+  bool bulk = port->readMode() == ReaderTuning::Bulk;
+  ChunkPool *pool = bulk ? blocks : packets;
+  auto buffer = (unsigned char *)pool->take();
+  int filled = 0;
+  qint64 begin = SerialPort::now();
+  qint64 deadline = -1; // once data came, when Bulk stops waiting for more
+  forever {
+    int requested = pool->blockSize() - filled;
+    requested -= requested % packetSize;
+    unsigned int timeout = bulk ? BULK_IDLE_TIMEOUT : LOW_LATENCY_TIMEOUT;
+    if (deadline >= 0) {
+      qint64 remaining = (deadline - SerialPort::now()) / 1000000;
+      if (remaining <= 0 || requested <= 0) {
+        break;
+      }
+      timeout = remaining;
+    }
+    int transferred = 0;
+    qint64 start = SerialPort::now();
+    lastError = transfer(buffer + filled, requested, &transferred, timeout);
+    int kept = filter ? filter(buffer + filled, transferred) : transferred;
+    port->sampleRead(start, lastError == LIBUSB_ERROR_TIMEOUT, timeout, kept,
+                     transferred == requested);
+    filled += kept;
+    if (!bulk || (lastError < 0 && lastError != LIBUSB_ERROR_TIMEOUT)) {
+      break;
+    }
+    if (filled > 0 && deadline < 0) {
+      deadline = start + BULK_COALESCE_MS * (qint64)1000000;
+    }
+    // nothing but status packets, give the reader loop its turn
+    if (filled == 0 && (lastError == LIBUSB_ERROR_TIMEOUT ||
+                        SerialPort::now() - begin >=
+                            BULK_IDLE_TIMEOUT * (qint64)1000000)) {
+      break;
+    }
+  }
+  if (filled == 0) {
+    return QByteArray();
+  }
+  return pool->finish(filled);
+}
+
+void UsbBulkReader::cancel() {
+  QMutexLocker locker(&mutex);
+  cancelled = true;
+  if (inFlight) {
+    libusb_cancel_transfer(usbTransfer);
+  }
+}
+
+int UsbBulkReader::transfer(unsigned char *buffer, int length,
+                            int *transferred, unsigned int timeout) {
+  *transferred = 0;
+  {
+    QMutexLocker locker(&mutex);
+    if (cancelled) {
+      return LIBUSB_ERROR_INTERRUPTED;
+    }
+    libusb_fill_bulk_transfer(usbTransfer, handle, endpoint, buffer, length,
+                              callback, this, timeout);
+    completed = 0;
+    int rc = libusb_submit_transfer(usbTransfer);
+    if (rc < 0) {
+      return rc;
+    }
+    inFlight = true;
+  }
+  // whichever thread handles events runs the callback, this one included
+  while (!completed) {
+    libusb_handle_events_completed(context, &completed);
+  }
+  {
+    QMutexLocker locker(&mutex);
+    inFlight = false;
+  }
+  *transferred = usbTransfer->actual_length;
+  switch (usbTransfer->status) {
+  case LIBUSB_TRANSFER_COMPLETED:
+    return LIBUSB_SUCCESS;
+  case LIBUSB_TRANSFER_TIMED_OUT:
+    return LIBUSB_ERROR_TIMEOUT;
+  case LIBUSB_TRANSFER_CANCELLED:
+    return LIBUSB_ERROR_INTERRUPTED;
+  case LIBUSB_TRANSFER_STALL:
+    return LIBUSB_ERROR_PIPE;
+  case LIBUSB_TRANSFER_NO_DEVICE:
+    return LIBUSB_ERROR_NO_DEVICE;
+  case LIBUSB_TRANSFER_OVERFLOW:
+    return LIBUSB_ERROR_OVERFLOW;
+  default:
+    return LIBUSB_ERROR_IO;
+  }
+}
+
+void UsbBulkReader::callback(libusb_transfer *transfer) {
+  auto reader = (UsbBulkReader *)transfer->user_data;
+  reader->completed = 1;
+}
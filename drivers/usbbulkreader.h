@@ -0,0 +1,66 @@
+#ifndef USBBULKREADER_H
+#define USBBULKREADER_H
+
+#include "chunkpool.h"
+#include "libusb.h"
+#include "serialport.h"
+#include <QMutex>
+#include <functional>
+
+// ReaderTuning::LowLatency: one packet per transfer, and how long an idle
+// read waits before the reader loop gets to run again
+#define LOW_LATENCY_TIMEOUT 100
+// ReaderTuning::Bulk: transfer size, how long data is held back for more to
+// join it, and the idle wait
+#define BULK_READ_SIZE 16384
+#define BULK_COALESCE_MS 20
+#define BULK_IDLE_TIMEOUT 300
+
+// Reads a bulk IN endpoint for a USB driver's reader thread, shaped by the
+// port's read mode. Each read is a single asynchronous transfer, so close()
+// can cancel it rather than wait for its timeout to run out.
+class UsbBulkReader {
+public:
+  // Sees each transfer's data where it landed and returns how much of it
+  // to keep, moved to the front. Every transfer starts at a packet.
+  typedef std::function<int(unsigned char *data, int length)> Filter;
+
+  explicit UsbBulkReader(SerialPort *port);
+  ~UsbBulkReader();
+
+  // in open(), before the reader thread starts
+  void reset(libusb_device_handle *handle, unsigned char endpoint,
+             int packetSize);
+  // First thing on the reader thread, see SerialPort::tuneReaderThread().
+  void tuneThread();
+  // On the reader thread: the next chunk to deliver, or an empty one if
+  // the read timed out, failed (see error()) or was cancelled.
+  QByteArray read(const Filter &filter = Filter());
+  // the last transfer's result, LIBUSB_ERROR_INTERRUPTED once cancelled
+  int error() const { return lastError; }
+  // From any thread: the read in flight returns, later ones fail at once
+  // until the next reset().
+  void cancel();
+
+private:
+  // one transfer, returns like libusb_bulk_transfer()
+  int transfer(unsigned char *buffer, int length, int *transferred,
+               unsigned int timeout);
+  static void callback(libusb_transfer *transfer);
+
+  SerialPort *port;
+  libusb_device_handle *handle;
+  unsigned char endpoint;
+  int packetSize;
+  ChunkPool *packets; // LowLatency, one packet each
+  ChunkPool *blocks;  // Bulk
+  libusb_transfer *usbTransfer;
+  int completed; // set by callback(), libusb polls it
+  int lastError;
+
+  QMutex mutex; // guards the two below against cancel()
+  bool cancelled;
+  bool inFlight;
+};
+
+#endif
@@ -0,0 +1,63 @@
+#include "usbbulkwriter.h"
+#include <cstring>
+
+UsbBulkWriter::UsbBulkWriter(SerialPort *port) : port(port) {
+  handle = nullptr;
+  endpoint = 0;
+}
+
+void UsbBulkWriter::reset(libusb_device_handle *handle,
+                          unsigned char endpoint) {
+  QMutexLocker locker(&mutex);
+  this->handle = handle;
+  this->endpoint = endpoint;
+}
+
+void UsbBulkWriter::send(const QByteArray &data) {
+  QMutexLocker locker(&mutex);
+  if (!handle) {
+    port->pendingBytes.fetchAndAddOrdered(-data.length());
+    return;
+  }
+  auto transfer = libusb_alloc_transfer(0);
+  unsigned char *buffer = new unsigned char[data.length()];
+  memcpy(buffer, data.data(), data.length());
+
+  libusb_fill_bulk_transfer(transfer, handle, endpoint, buffer, data.length(),
+                            callback, this, 0);
+  if (libusb_submit_transfer(transfer) < 0) {
+    port->pendingBytes.fetchAndAddOrdered(-data.length());
+    delete[] buffer;
+    libusb_free_transfer(transfer);
+    return;
+  }
+  inFlight.insert(transfer);
+}
+
+void UsbBulkWriter::cancel() {
+  QMutexLocker locker(&mutex);
+  handle = nullptr;
+  for (auto transfer : inFlight) {
+    libusb_cancel_transfer(transfer);
+  }
+  // nobody else may be handling events, do it here until all are back
+  while (!inFlight.isEmpty()) {
+    locker.unlock();
+    struct timeval tv = {0, 100000};
+    libusb_handle_events_timeout_completed(context, &tv, nullptr);
+    locker.relock();
+  }
+  port->pendingBytes = 0;
+}
+
+void UsbBulkWriter::callback(libusb_transfer *transfer) {
+  auto writer = (UsbBulkWriter *)transfer->user_data;
+  {
+    // under the lock, so cancel() cannot zero the count in between
+    QMutexLocker locker(&writer->mutex);
+    writer->inFlight.remove(transfer);
+    writer->port->pendingBytes.fetchAndAddOrdered(-transfer->length);
+  }
+  delete[] transfer->buffer;
+  libusb_free_transfer(transfer);
+}
@@ -0,0 +1,35 @@
+#ifndef USBBULKWRITER_H
+#define USBBULKWRITER_H
+
+#include "libusb.h"
+#include "serialport.h"
+#include <QMutex>
+#include <QSet>
+
+// Writes to a bulk OUT endpoint for a USB driver, one asynchronous transfer
+// per sendData(). Keeps the transfers in flight so close() can cancel and
+// reap them before libusb_close(), which must not see any.
+class UsbBulkWriter {
+public:
+  explicit UsbBulkWriter(SerialPort *port);
+
+  // in open(), once the interface is claimed
+  void reset(libusb_device_handle *handle, unsigned char endpoint);
+  // From any thread. Dropped, and taken off bytesToWrite(), once closed.
+  void send(const QByteArray &data);
+  // In close(), after the reader thread is gone and before libusb_close():
+  // cancels the writes in flight, handles events until they are reaped and
+  // zeroes bytesToWrite().
+  void cancel();
+
+private:
+  static void callback(libusb_transfer *transfer);
+
+  SerialPort *port;
+  QMutex mutex; // guards the three below against the callback and cancel()
+  libusb_device_handle *handle; // null once cancelled
+  unsigned char endpoint;
+  QSet<libusb_transfer *> inFlight;
+};
+
+#endif
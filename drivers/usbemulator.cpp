@@ -0,0 +1,663 @@
+#include "libusb.h"
+
+#ifdef QSERIAL_USB_EMULATOR
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <cstring>
+
+// bytes the chip buffers on its receive side before it loses data
+#define RX_FIFO_SIZE 512
+// full speed USB, bulk IN completes at a frame boundary unless a whole
+// buffer is ready earlier
+#define FRAME_US 1000
+#define PACKET_SIZE 64
+
+enum Chip { CP210X, CH34X, PL2303 };
+
+struct libusb_context {
+  int unused;
+};
+
+// a submitted bulk IN transfer, completed from event handling
+struct PendingIn {
+  libusb_transfer *transfer;
+  QElapsedTimer waited;
+  qint64 startFrame; // device clock frame it was submitted in
+  bool cancelled;
+};
+
+struct libusb_device {
+  Chip chip;
+  uint8_t address;
+  libusb_device_descriptor descriptor;
+  libusb_endpoint_descriptor endpoints[3];
+  libusb_interface_descriptor altsetting;
+  libusb_interface interface;
+  libusb_config_descriptor config;
+  unsigned char bulkIn;
+  unsigned char bulkOut;
+
+  QMutex mutex;
+  bool open = false;
+  // line settings as the chip sees them
+  qint32 baudRate = 9600;
+  int dataBits = 8;
+  int parityBits = 0;
+  double stopBits = 1;
+  // CP210x line control, CH34x registers, PL2303 line coding
+  uint16_t lineCtl = 0x0800;
+  uint8_t registers[256] = {};
+  unsigned char lineCoding[7] = {};
+  // receive side: generated counts bytes produced since open at the line
+  // rate, taken counts bytes handed to the host or lost
+  QElapsedTimer clock;
+  qint64 generated = 0;
+  qint64 taken = 0;
+  quint8 pattern = 0;
+  QList<libusb_transfer *> outTransfers;
+  QList<libusb_transfer *> cancelledOut;
+  QList<PendingIn> inTransfers;
+  UsbEmulator::DeviceStats stats = {};
+};
+
+struct libusb_device_handle {
+  libusb_device *device;
+};
+
+static libusb_device *devices[3];
+static QAtomicInteger<qint64> forcedLineRate;
+
+static void initDevices() {
+  if (devices[0]) {
+    return;
+  }
+  struct Model {
+    Chip chip;
+    const char *name;
+    uint16_t vendor, product;
+    uint8_t deviceClass;
+    unsigned char in, out;
+  };
+  static const Model models[] = {
+      {CP210X, "CP2102", 0x10C4, 0xEA60, 0x00, 0x81, 0x01},
+      {CH34X, "CH340", 0x1A86, 0x7523, 0xFF, 0x82, 0x02},
+      {PL2303, "PL2303HX", 0x067B, 0x2303, 0x00, 0x83, 0x02}};
+  for (int i = 0; i < 3; i++) {
+    auto device = new libusb_device;
+    auto &model = models[i];
+    device->chip = model.chip;
+    device->address = i + 1;
+    device->stats.name = model.name;
+    device->bulkIn = model.in;
+    device->bulkOut = model.out;
+    auto &desc = device->descriptor;
+    memset(&desc, 0, sizeof(desc));
+    desc.bLength = 18;
+    desc.bDescriptorType = 1;
+    desc.bcdUSB = 0x0110;
+    desc.bDeviceClass = model.deviceClass;
+    desc.bMaxPacketSize0 = 0x40; // tells the PL2303 driver it is an HX
+    desc.idVendor = model.vendor;
+    desc.idProduct = model.product;
+    desc.bNumConfigurations = 1;
+
+    memset(device->endpoints, 0, sizeof(device->endpoints));
+    device->endpoints[0] = {7, 5, model.in, LIBUSB_TRANSFER_TYPE_BULK,
+                            PACKET_SIZE, 0, 0, 0, nullptr, 0};
+    device->endpoints[1] = {7, 5, model.out, LIBUSB_TRANSFER_TYPE_BULK,
+                            PACKET_SIZE, 0, 0, 0, nullptr, 0};
+    device->endpoints[2] = {7, 5, 0x8A, LIBUSB_TRANSFER_TYPE_INTERRUPT,
+                            10, 1, 0, 0, nullptr, 0};
+    memset(&device->altsetting, 0, sizeof(device->altsetting));
+    device->altsetting.bLength = 9;
+    device->altsetting.bDescriptorType = 4;
+    device->altsetting.bNumEndpoints = 3;
+    device->altsetting.bInterfaceClass = 0xFF;
+    device->altsetting.endpoint = device->endpoints;
+    device->interface = {&device->altsetting, 1};
+    memset(&device->config, 0, sizeof(device->config));
+    device->config.bLength = 9;
+    device->config.bDescriptorType = 2;
+    device->config.bNumInterfaces = 1;
+    device->config.bConfigurationValue = 1;
+    device->config.interface = &device->interface;
+    devices[i] = device;
+  }
+}
+
+// bytes per second for the current settings, caller holds the mutex
+static qint64 lineRate(libusb_device *device) {
+  qint64 forced = forcedLineRate.loadAcquire();
+  if (forced > 0) {
+    return forced;
+  }
+  double bits = 1 + device->dataBits + device->parityBits + device->stopBits;
+  return qMax<qint64>(1, device->baudRate / bits);
+}
+
+// bytes produced since open, caller holds the mutex
+static qint64 due(libusb_device *device) {
+  return device->generated +
+         lineRate(device) * device->clock.nsecsElapsed() / 1000000000;
+}
+
+// the rate changes from here on, caller holds the mutex
+static void restartClock(libusb_device *device, qint64 generated) {
+  device->generated = generated;
+  device->clock.restart();
+  device->stats.baudRate = device->baudRate;
+  device->stats.lineRate = lineRate(device);
+}
+
+// bytes waiting in the receive FIFO, what overflowed it is counted as lost
+static qint64 fifoLevel(libusb_device *device) {
+  qint64 level = due(device) - device->taken;
+  if (level > RX_FIFO_SIZE) {
+    qint64 lost = level - RX_FIFO_SIZE;
+    device->stats.overrun += lost;
+    device->taken += lost;
+    // the pattern skips what was lost, so a reader can tell drops apart
+    device->pattern += lost;
+    level = RX_FIFO_SIZE;
+  }
+  return level;
+}
+
+// vendor and class requests each chip understands, returns the byte count
+// or LIBUSB_ERROR_PIPE for a stall
+static int control(libusb_device *device, uint8_t requestType,
+                   uint8_t request, uint16_t value, uint16_t index,
+                   unsigned char *data, uint16_t length) {
+  bool in = requestType & LIBUSB_ENDPOINT_IN;
+  switch (device->chip) {
+  case CP210X:
+    // AN571
+    switch (request) {
+    case 0x00: // IFC_ENABLE
+    case 0x05: // SET_BREAK
+    case 0x07: // SET_MHS
+      return in ? LIBUSB_ERROR_PIPE : 0;
+    case 0x03: // SET_LINE_CTL, in wValue
+      if (in) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      device->lineCtl = value;
+      device->stopBits = (value & 0x0F) == 0 ? 1 : (value & 0x0F) == 1 ? 1.5
+                                                                        : 2;
+      device->parityBits = (value & 0xF0) ? 1 : 0;
+      device->dataBits = value >> 8;
+      return 0;
+    case 0x04: // GET_LINE_CTL
+      if (!in || length < 2) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      memcpy(data, &device->lineCtl, 2);
+      return 2;
+    case 0x10: { // GET_COMM_STATUS
+      unsigned char status[19] = {};
+      qint64 level = fifoLevel(device);
+      memcpy(status + 8, &level, 4);
+      int size = qMin<int>(length, sizeof(status));
+      memcpy(data, status, size);
+      return in ? size : LIBUSB_ERROR_PIPE;
+    }
+    case 0x1D: // GET_BAUDRATE
+      if (!in || length < 4) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      memcpy(data, &device->baudRate, 4);
+      return 4;
+    case 0x1E: // SET_BAUDRATE
+      if (in || length < 4) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      memcpy(&device->baudRate, data, 4);
+      return 4;
+    }
+    break;
+  case CH34X:
+    switch (request) {
+    case 0x5F: // READ_VERSION
+      if (!in || length < 2) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      data[0] = 0x30;
+      data[1] = 0x00;
+      return 2;
+    case 0xA1: // SERIAL_INIT
+    case 0xA4: // MODEM_CTRL
+      return in ? LIBUSB_ERROR_PIPE : 0;
+    case 0x95: // READ_REG, two registers named in wValue
+      if (!in || length < 2) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      data[0] = device->registers[value & 0xFF];
+      data[1] = device->registers[value >> 8];
+      return 2;
+    case 0x9A: { // WRITE_REG, two registers, values in wIndex
+      if (in) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      device->registers[value & 0xFF] = index & 0xFF;
+      device->registers[value >> 8] = index >> 8;
+      // prescaler 0x12 and divisor 0x13, see ch341_set_baudrate_lcr
+      int prescaler = device->registers[0x12] & 0x07;
+      int divisor = 0x100 - device->registers[0x13];
+      if (divisor > 0 && prescaler <= 3) {
+        device->baudRate =
+            1532620800 / ((qint64)(divisor << 8) << (3 * (3 - prescaler)));
+      }
+      uint8_t lcr = device->registers[0x18];
+      device->dataBits = 5 + (lcr & 0x03);
+      device->parityBits = (lcr & 0x08) ? 1 : 0;
+      device->stopBits = (lcr & 0x04) ? 2 : 1;
+      return 0;
+    }
+    }
+    break;
+  case PL2303:
+    switch (request) {
+    case 0x01: // vendor read/write
+    case 0x80:
+    case 0x81:
+      if (in) {
+        if (length < 1) {
+          return LIBUSB_ERROR_PIPE;
+        }
+        data[0] = 0;
+        return 1;
+      }
+      return 0;
+    case 0x20: // SET_LINE_CODING
+      if (in || length < 7) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      memcpy(device->lineCoding, data, 7);
+      memcpy(&device->baudRate, data, 4);
+      device->stopBits = data[4] == 0 ? 1 : data[4] == 1 ? 1.5 : 2;
+      device->parityBits = data[5] ? 1 : 0;
+      device->dataBits = data[6];
+      return 7;
+    case 0x21: // GET_LINE_CODING
+      if (!in || length < 7) {
+        return LIBUSB_ERROR_PIPE;
+      }
+      memcpy(data, device->lineCoding, 7);
+      return 7;
+    case 0x22: // SET_CONTROL_LINE_STATE
+    case 0x23: // SEND_BREAK
+      return in ? LIBUSB_ERROR_PIPE : 0;
+    }
+    break;
+  }
+  return LIBUSB_ERROR_PIPE;
+}
+
+// Hands the host what is in the receive FIFO: a full buffer right away,
+// anything less at the next frame after startFrame (set on the first call).
+// Returns the byte count, or 0 with sleepUs saying how long until it could
+// be more. Caller holds the mutex.
+static int takeIn(libusb_device *device, unsigned char *data, int length,
+                  qint64 *startFrame, qint64 *sleepUs) {
+  qint64 level = fifoLevel(device);
+  qint64 nowUs = device->clock.nsecsElapsed() / 1000;
+  if (*startFrame < 0) {
+    *startFrame = nowUs / FRAME_US;
+  }
+  bool frameDue = nowUs / FRAME_US != *startFrame;
+  if (level >= length || (level > 0 && frameDue)) {
+    int size = qMin<qint64>(level, length);
+    for (int i = 0; i < size; i++) {
+      data[i] = device->pattern++;
+    }
+    device->taken += size;
+    device->stats.bulkIn += size;
+    return size;
+  }
+  // until the buffer fills up or the next frame, whichever is first
+  *sleepUs = qMin((length - level) * 1000000 / lineRate(device) + 1,
+                  FRAME_US - nowUs % FRAME_US);
+  return 0;
+}
+
+// Completes the IN transfers that are done, cancelled or timed out and
+// lowers sleepUs to when the next one could be. Returns how many completed.
+static int completeInTransfers(libusb_device *device, qint64 *sleepUs) {
+  QList<libusb_transfer *> done;
+  {
+    QMutexLocker locker(&device->mutex);
+    for (int i = 0; i < device->inTransfers.size();) {
+      auto &pending = device->inTransfers[i];
+      auto transfer = pending.transfer;
+      qint64 wait = FRAME_US;
+      int size = 0;
+      if (pending.cancelled) {
+        transfer->status = LIBUSB_TRANSFER_CANCELLED;
+      } else if ((size = takeIn(device, transfer->buffer, transfer->length,
+                                &pending.startFrame, &wait)) > 0) {
+        transfer->status = LIBUSB_TRANSFER_COMPLETED;
+      } else if (transfer->timeout &&
+                 pending.waited.elapsed() >= transfer->timeout) {
+        transfer->status = LIBUSB_TRANSFER_TIMED_OUT;
+      } else {
+        if (transfer->timeout) {
+          wait = qMin(wait, (transfer->timeout - pending.waited.elapsed()) *
+                                1000);
+        }
+        *sleepUs = qMin(*sleepUs, wait);
+        i++;
+        continue;
+      }
+      transfer->actual_length = size;
+      done.append(transfer);
+      device->inTransfers.removeAt(i);
+    }
+  }
+  for (auto transfer : done) {
+    transfer->callback(transfer);
+  }
+  return done.size();
+}
+
+// runs write callbacks the way libusb does from event handling
+static void completeOutTransfers(libusb_device *device) {
+  QList<libusb_transfer *> done, cancelled;
+  {
+    QMutexLocker locker(&device->mutex);
+    done.swap(device->outTransfers);
+    cancelled.swap(device->cancelledOut);
+  }
+  for (auto transfer : cancelled) {
+    transfer->status = LIBUSB_TRANSFER_CANCELLED;
+    transfer->actual_length = 0;
+    transfer->callback(transfer);
+  }
+  for (auto transfer : done) {
+    transfer->status = LIBUSB_TRANSFER_COMPLETED;
+    transfer->actual_length = transfer->length;
+    transfer->callback(transfer);
+  }
+}
+
+int libusb_init(libusb_context **context) {
+  initDevices();
+  *context = new libusb_context;
+  return LIBUSB_SUCCESS;
+}
+
+void libusb_exit(libusb_context *context) { delete context; }
+
+ssize_t libusb_get_device_list(libusb_context *, libusb_device ***list) {
+  initDevices();
+  *list = new libusb_device *[4];
+  for (int i = 0; i < 3; i++) {
+    (*list)[i] = devices[i];
+  }
+  (*list)[3] = nullptr;
+  return 3;
+}
+
+void libusb_free_device_list(libusb_device **list, int) { delete[] list; }
+
+// the models live as long as the process
+libusb_device *libusb_ref_device(libusb_device *device) { return device; }
+void libusb_unref_device(libusb_device *) {}
+
+uint8_t libusb_get_bus_number(libusb_device *) { return 0; }
+
+uint8_t libusb_get_device_address(libusb_device *device) {
+  return device->address;
+}
+
+int libusb_get_device_descriptor(libusb_device *device,
+                                 libusb_device_descriptor *descriptor) {
+  *descriptor = device->descriptor;
+  return LIBUSB_SUCCESS;
+}
+
+int libusb_get_config_descriptor(libusb_device *device, uint8_t index,
+                                 libusb_config_descriptor **config) {
+  if (index != 0) {
+    return LIBUSB_ERROR_NOT_FOUND;
+  }
+  *config = &device->config;
+  return LIBUSB_SUCCESS;
+}
+
+void libusb_free_config_descriptor(libusb_config_descriptor *) {}
+
+int libusb_open(libusb_device *device, libusb_device_handle **handle) {
+  QMutexLocker locker(&device->mutex);
+  if (device->open) {
+    return LIBUSB_ERROR_BUSY;
+  }
+  device->open = true;
+  device->taken = 0;
+  device->pattern = 0;
+  restartClock(device, 0);
+  *handle = new libusb_device_handle{device};
+  return LIBUSB_SUCCESS;
+}
+
+void libusb_close(libusb_device_handle *handle) {
+  QMutexLocker locker(&handle->device->mutex);
+  // the drivers cancel and reap their reads and writes before closing
+  Q_ASSERT(handle->device->inTransfers.isEmpty());
+  Q_ASSERT(handle->device->outTransfers.isEmpty());
+  Q_ASSERT(handle->device->cancelledOut.isEmpty());
+  handle->device->open = false;
+  delete handle;
+}
+
+int libusb_kernel_driver_active(libusb_device_handle *, int) { return 0; }
+int libusb_detach_kernel_driver(libusb_device_handle *, int) {
+  return LIBUSB_SUCCESS;
+}
+int libusb_attach_kernel_driver(libusb_device_handle *, int) {
+  return LIBUSB_ERROR_NOT_FOUND;
+}
+int libusb_set_configuration(libusb_device_handle *, int) {
+  return LIBUSB_SUCCESS;
+}
+int libusb_claim_interface(libusb_device_handle *, int interface) {
+  return interface == 0 ? LIBUSB_SUCCESS : LIBUSB_ERROR_NOT_FOUND;
+}
+int libusb_release_interface(libusb_device_handle *, int) {
+  return LIBUSB_SUCCESS;
+}
+int libusb_clear_halt(libusb_device_handle *, unsigned char) {
+  return LIBUSB_SUCCESS;
+}
+
+int libusb_control_transfer(libusb_device_handle *handle, uint8_t requestType,
+                            uint8_t request, uint16_t value, uint16_t index,
+                            unsigned char *data, uint16_t length,
+                            unsigned int) {
+  auto device = handle->device;
+  QMutexLocker locker(&device->mutex);
+  device->stats.controlTransfers++;
+  // what was generated at the old settings stays
+  fifoLevel(device);
+  qint64 generated = due(device);
+  qint32 baudRate = device->baudRate;
+  int dataBits = device->dataBits;
+  int parityBits = device->parityBits;
+  double stopBits = device->stopBits;
+  int rc = control(device, requestType, request, value, index, data, length);
+  if (rc == LIBUSB_ERROR_PIPE) {
+    device->stats.stalls++;
+  }
+  if (baudRate != device->baudRate || dataBits != device->dataBits ||
+      parityBits != device->parityBits || stopBits != device->stopBits) {
+    restartClock(device, generated);
+  }
+  return rc;
+}
+
+int libusb_bulk_transfer(libusb_device_handle *handle, unsigned char endpoint,
+                         unsigned char *data, int length, int *transferred,
+                         unsigned int timeout) {
+  auto device = handle->device;
+  *transferred = 0;
+  // the synchronous call also drives event handling in libusb
+  completeOutTransfers(device);
+  if (endpoint != device->bulkIn) {
+    if (endpoint != device->bulkOut) {
+      return LIBUSB_ERROR_PIPE;
+    }
+    QMutexLocker locker(&device->mutex);
+    device->stats.bulkOut += length;
+    *transferred = length;
+    return LIBUSB_SUCCESS;
+  }
+
+  QElapsedTimer waited;
+  waited.start();
+  qint64 startFrame = -1;
+  forever {
+    qint64 sleepUs;
+    {
+      QMutexLocker locker(&device->mutex);
+      int size = takeIn(device, data, length, &startFrame, &sleepUs);
+      if (size > 0) {
+        *transferred = size;
+        return LIBUSB_SUCCESS;
+      }
+    }
+    qint64 remainingUs = (qint64)timeout * 1000 - waited.nsecsElapsed() / 1000;
+    if (timeout && remainingUs <= 0) {
+      return LIBUSB_ERROR_TIMEOUT;
+    }
+    if (timeout) {
+      sleepUs = qMin(sleepUs, remainingUs);
+    }
+    QThread::usleep(qMax<qint64>(1, sleepUs));
+  }
+}
+
+libusb_transfer *libusb_alloc_transfer(int) {
+  auto transfer = new libusb_transfer;
+  memset(transfer, 0, sizeof(*transfer));
+  return transfer;
+}
+
+void libusb_free_transfer(libusb_transfer *transfer) { delete transfer; }
+
+int libusb_submit_transfer(libusb_transfer *transfer) {
+  auto device = transfer->dev_handle->device;
+  QMutexLocker locker(&device->mutex);
+  if (transfer->endpoint == device->bulkIn) {
+    PendingIn pending;
+    pending.transfer = transfer;
+    pending.waited.start();
+    pending.startFrame = -1;
+    pending.cancelled = false;
+    device->inTransfers.append(pending);
+    return LIBUSB_SUCCESS;
+  }
+  if (transfer->endpoint != device->bulkOut) {
+    return LIBUSB_ERROR_NOT_SUPPORTED;
+  }
+  device->stats.bulkOut += transfer->length;
+  device->outTransfers.append(transfer);
+  return LIBUSB_SUCCESS;
+}
+
+int libusb_cancel_transfer(libusb_transfer *transfer) {
+  auto device = transfer->dev_handle->device;
+  QMutexLocker locker(&device->mutex);
+  if (device->outTransfers.removeOne(transfer)) {
+    device->cancelledOut.append(transfer);
+    return LIBUSB_SUCCESS;
+  }
+  for (auto &pending : device->inTransfers) {
+    if (pending.transfer == transfer && !pending.cancelled) {
+      pending.cancelled = true;
+      return LIBUSB_SUCCESS;
+    }
+  }
+  return LIBUSB_ERROR_NOT_FOUND;
+}
+
+// Like libusb, returns once something completed, completed is set or tv
+// has passed; a zero tv makes one pass, a null one waits indefinitely.
+int libusb_handle_events_timeout_completed(libusb_context *,
+                                           struct timeval *tv,
+                                           int *completed) {
+  QElapsedTimer waited;
+  waited.start();
+  qint64 limitUs = tv ? tv->tv_sec * 1000000LL + tv->tv_usec : -1;
+  forever {
+    qint64 sleepUs = FRAME_US;
+    int done = 0;
+    for (auto device : devices) {
+      if (device) {
+        completeOutTransfers(device);
+        done += completeInTransfers(device, &sleepUs);
+      }
+    }
+    if (done || (completed && *completed)) {
+      return LIBUSB_SUCCESS;
+    }
+    if (limitUs >= 0) {
+      qint64 remainingUs = limitUs - waited.nsecsElapsed() / 1000;
+      if (remainingUs <= 0) {
+        return LIBUSB_SUCCESS;
+      }
+      sleepUs = qMin(sleepUs, remainingUs);
+    }
+    QThread::usleep(qMax<qint64>(1, sleepUs));
+  }
+}
+
+int libusb_handle_events_completed(libusb_context *context, int *completed) {
+  return libusb_handle_events_timeout_completed(context, nullptr, completed);
+}
+
+namespace UsbEmulator {
+
+void setLineRate(qint64 bytesPerSecond) {
+  initDevices();
+  qint64 generated[3];
+  for (int i = 0; i < 3; i++) {
+    QMutexLocker locker(&devices[i]->mutex);
+    fifoLevel(devices[i]);
+    generated[i] = due(devices[i]);
+  }
+  forcedLineRate = bytesPerSecond;
+  for (int i = 0; i < 3; i++) {
+    QMutexLocker locker(&devices[i]->mutex);
+    restartClock(devices[i], generated[i]);
+  }
+}
+
+QVector<DeviceStats> stats() {
+  initDevices();
+  QVector<DeviceStats> result;
+  for (auto device : devices) {
+    QMutexLocker locker(&device->mutex);
+    if (device->open) {
+      fifoLevel(device);
+    }
+    result.append(device->stats);
+  }
+  return result;
+}
+
+void resetStats() {
+  initDevices();
+  for (auto device : devices) {
+    QMutexLocker locker(&device->mutex);
+    QString name = device->stats.name;
+    device->stats = DeviceStats();
+    device->stats.name = name;
+    device->stats.baudRate = device->baudRate;
+    device->stats.lineRate = lineRate(device);
+  }
+}
+
+} // namespace UsbEmulator
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef USBEMULATOR_H
+#define USBEMULATOR_H
+
+// Stands in for libusb when built with QSERIAL_USB_EMULATOR: the subset of
+// the libusb API the drivers use, backed by models of a CP2102, a CH340 and
+// a PL2303HX. Each model answers its chip's vendor requests, keeps the line
+// settings they set and produces bulk IN data at the resulting line rate, so
+// the drivers run unchanged without hardware.
+
+#include <QString>
+#include <QVector>
+#include <cstdint>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/time.h>
+#endif
+
+#define LIBUSB_CALL
+
+struct libusb_context;
+struct libusb_device;
+struct libusb_device_handle;
+
+enum libusb_endpoint_direction {
+  LIBUSB_ENDPOINT_OUT = 0x00,
+  LIBUSB_ENDPOINT_IN = 0x80
+};
+
+enum libusb_request_type {
+  LIBUSB_REQUEST_TYPE_STANDARD = 0x00 << 5,
+  LIBUSB_REQUEST_TYPE_CLASS = 0x01 << 5,
+  LIBUSB_REQUEST_TYPE_VENDOR = 0x02 << 5
+};
+
+enum libusb_request_recipient {
+  LIBUSB_RECIPIENT_DEVICE = 0x00,
+  LIBUSB_RECIPIENT_INTERFACE = 0x01,
+  LIBUSB_RECIPIENT_ENDPOINT = 0x02
+};
+
+enum libusb_transfer_type {
+  LIBUSB_TRANSFER_TYPE_CONTROL = 0,
+  LIBUSB_TRANSFER_TYPE_ISOCHRONOUS = 1,
+  LIBUSB_TRANSFER_TYPE_BULK = 2,
+  LIBUSB_TRANSFER_TYPE_INTERRUPT = 3
+};
+
+enum libusb_error {
+  LIBUSB_SUCCESS = 0,
+  LIBUSB_ERROR_IO = -1,
+  LIBUSB_ERROR_INVALID_PARAM = -2,
+  LIBUSB_ERROR_ACCESS = -3,
+  LIBUSB_ERROR_NO_DEVICE = -4,
+  LIBUSB_ERROR_NOT_FOUND = -5,
+  LIBUSB_ERROR_BUSY = -6,
+  LIBUSB_ERROR_TIMEOUT = -7,
+  LIBUSB_ERROR_OVERFLOW = -8,
+  LIBUSB_ERROR_PIPE = -9,
+  LIBUSB_ERROR_INTERRUPTED = -10,
+  LIBUSB_ERROR_NO_MEM = -11,
+  LIBUSB_ERROR_NOT_SUPPORTED = -12,
+  LIBUSB_ERROR_OTHER = -99
+};
+
+enum libusb_transfer_status {
+  LIBUSB_TRANSFER_COMPLETED,
+  LIBUSB_TRANSFER_ERROR,
+  LIBUSB_TRANSFER_TIMED_OUT,
+  LIBUSB_TRANSFER_CANCELLED,
+  LIBUSB_TRANSFER_STALL,
+  LIBUSB_TRANSFER_NO_DEVICE,
+  LIBUSB_TRANSFER_OVERFLOW
+};
+
+struct libusb_device_descriptor {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint16_t bcdUSB;
+  uint8_t bDeviceClass;
+  uint8_t bDeviceSubClass;
+  uint8_t bDeviceProtocol;
+  uint8_t bMaxPacketSize0;
+  uint16_t idVendor;
+  uint16_t idProduct;
+  uint16_t bcdDevice;
+  uint8_t iManufacturer;
+  uint8_t iProduct;
+  uint8_t iSerialNumber;
+  uint8_t bNumConfigurations;
+};
+
+struct libusb_endpoint_descriptor {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bEndpointAddress;
+  uint8_t bmAttributes;
+  uint16_t wMaxPacketSize;
+  uint8_t bInterval;
+  uint8_t bRefresh;
+  uint8_t bSynchAddress;
+  const unsigned char *extra;
+  int extra_length;
+};
+
+struct libusb_interface_descriptor {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint8_t bInterfaceNumber;
+  uint8_t bAlternateSetting;
+  uint8_t bNumEndpoints;
+  uint8_t bInterfaceClass;
+  uint8_t bInterfaceSubClass;
+  uint8_t bInterfaceProtocol;
+  uint8_t iInterface;
+  const libusb_endpoint_descriptor *endpoint;
+  const unsigned char *extra;
+  int extra_length;
+};
+
+struct libusb_interface {
+  const libusb_interface_descriptor *altsetting;
+  int num_altsetting;
+};
+
+struct libusb_config_descriptor {
+  uint8_t bLength;
+  uint8_t bDescriptorType;
+  uint16_t wTotalLength;
+  uint8_t bNumInterfaces;
+  uint8_t bConfigurationValue;
+  uint8_t iConfiguration;
+  uint8_t bmAttributes;
+  uint8_t MaxPower;
+  const libusb_interface *interface;
+  const unsigned char *extra;
+  int extra_length;
+};
+
+struct libusb_transfer;
+typedef void (*libusb_transfer_cb_fn)(libusb_transfer *transfer);
+
+struct libusb_transfer {
+  libusb_device_handle *dev_handle;
+  uint8_t flags;
+  unsigned char endpoint;
+  unsigned char type;
+  unsigned int timeout;
+  libusb_transfer_status status;
+  int length;
+  int actual_length;
+  libusb_transfer_cb_fn callback;
+  void *user_data;
+  unsigned char *buffer;
+  int num_iso_packets;
+};
+
+int libusb_init(libusb_context **context);
+void libusb_exit(libusb_context *context);
+ssize_t libusb_get_device_list(libusb_context *context,
+                               libusb_device ***list);
+void libusb_free_device_list(libusb_device **list, int unrefDevices);
+libusb_device *libusb_ref_device(libusb_device *device);
+void libusb_unref_device(libusb_device *device);
+uint8_t libusb_get_bus_number(libusb_device *device);
+uint8_t libusb_get_device_address(libusb_device *device);
+int libusb_get_device_descriptor(libusb_device *device,
+                                 libusb_device_descriptor *descriptor);
+int libusb_get_config_descriptor(libusb_device *device, uint8_t index,
+                                 libusb_config_descriptor **config);
+void libusb_free_config_descriptor(libusb_config_descriptor *config);
+int libusb_open(libusb_device *device, libusb_device_handle **handle);
+void libusb_close(libusb_device_handle *handle);
+int libusb_kernel_driver_active(libusb_device_handle *handle, int interface);
+int libusb_detach_kernel_driver(libusb_device_handle *handle, int interface);
+int libusb_attach_kernel_driver(libusb_device_handle *handle, int interface);
+int libusb_set_configuration(libusb_device_handle *handle, int configuration);
+int libusb_claim_interface(libusb_device_handle *handle, int interface);
+int libusb_release_interface(libusb_device_handle *handle, int interface);
+int libusb_clear_halt(libusb_device_handle *handle, unsigned char endpoint);
+int libusb_control_transfer(libusb_device_handle *handle, uint8_t requestType,
+                            uint8_t request, uint16_t value, uint16_t index,
+                            unsigned char *data, uint16_t length,
+                            unsigned int timeout);
+int libusb_bulk_transfer(libusb_device_handle *handle, unsigned char endpoint,
+                         unsigned char *data, int length, int *transferred,
+                         unsigned int timeout);
+libusb_transfer *libusb_alloc_transfer(int isoPackets);
+void libusb_free_transfer(libusb_transfer *transfer);
+int libusb_submit_transfer(libusb_transfer *transfer);
+int libusb_cancel_transfer(libusb_transfer *transfer);
+int libusb_handle_events_timeout_completed(libusb_context *context,
+                                           struct timeval *tv,
+                                           int *completed);
+int libusb_handle_events_completed(libusb_context *context, int *completed);
+
+static inline void
+libusb_fill_bulk_transfer(libusb_transfer *transfer,
+                          libusb_device_handle *handle, unsigned char endpoint,
+                          unsigned char *buffer, int length,
+                          libusb_transfer_cb_fn callback, void *userData,
+                          unsigned int timeout) {
+  transfer->dev_handle = handle;
+  transfer->endpoint = endpoint;
+  transfer->type = LIBUSB_TRANSFER_TYPE_BULK;
+  transfer->timeout = timeout;
+  transfer->buffer = buffer;
+  transfer->length = length;
+  transfer->user_data = userData;
+  transfer->callback = callback;
+}
+
+static inline void libusb_fill_interrupt_transfer(
+    libusb_transfer *transfer, libusb_device_handle *handle,
+    unsigned char endpoint, unsigned char *buffer, int length,
+    libusb_transfer_cb_fn callback, void *userData, unsigned int timeout) {
+  libusb_fill_bulk_transfer(transfer, handle, endpoint, buffer, length,
+                            callback, userData, timeout);
+  transfer->type = LIBUSB_TRANSFER_TYPE_INTERRUPT;
+}
+
+namespace UsbEmulator {
+struct DeviceStats {
+  QString name;
+  qint32 baudRate;
+  qint64 lineRate;      // bytes per second generated
+  qint64 bulkIn;        // bytes taken by the host
+  qint64 bulkOut;       // bytes sent by the host
+  qint64 overrun;       // bytes lost because the host did not read in time
+  qint64 controlTransfers;
+  qint64 stalls;        // requests the chip model does not know
+};
+
+// bytes per second on every device, 0 to follow the line settings
+void setLineRate(qint64 bytesPerSecond);
+QVector<DeviceStats> stats();
+void resetStats();
+} // namespace UsbEmulator
+
+#endif
@@ -0,0 +1,71 @@
+#include "filesenddialog.h"
+#include <QFileDialog>
+#include <QSettings>
+
+FileSendDialog::FileSendDialog(FileSender *sender, SerialPort *port,
+                               QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->sender = sender;
+  this->port = port;
+
+  QSettings settings;
+  fileLineEdit->setText(settings.value("sendFile/file").toString());
+  chunkSizeSpinBox->setValue(settings.value("sendFile/chunkSize", 1024).toInt());
+  delaySpinBox->setValue(settings.value("sendFile/delay", 0).toInt());
+
+  connect(sender, SIGNAL(progress(qint64, qint64, double)), this,
+          SLOT(onProgress(qint64, qint64, double)));
+  connect(sender, SIGNAL(finished(bool, qint64, double)), this,
+          SLOT(onFinished(bool, qint64, double)));
+}
+
+void FileSendDialog::onBrowse() {
+  auto fileName =
+      QFileDialog::getOpenFileName(this, "Send File", fileLineEdit->text());
+  if (!fileName.isEmpty()) {
+    fileLineEdit->setText(fileName);
+  }
+}
+
+void FileSendDialog::onStart() {
+  if (!sender->start(fileLineEdit->text(), port, chunkSizeSpinBox->value(),
+                     delaySpinBox->value())) {
+    statusLabel->setText(sender->errorString());
+    return;
+  }
+
+  QSettings settings;
+  settings.setValue("sendFile/file", fileLineEdit->text());
+  settings.setValue("sendFile/chunkSize", chunkSizeSpinBox->value());
+  settings.setValue("sendFile/delay", delaySpinBox->value());
+
+  progressBar->setValue(0);
+  statusLabel->setText("Sending...");
+  startButton->setEnabled(false);
+  cancelButton->setEnabled(true);
+}
+
+void FileSendDialog::onCancel() { sender->cancel(); }
+
+void FileSendDialog::onProgress(qint64 sent, qint64 total, double rate) {
+  progressBar->setValue(total ? sent * 100 / total : 100);
+  statusLabel->setText(QString("%1 / %2 bytes, %3 KiB/s")
+                           .arg(sent)
+                           .arg(total)
+                           .arg(rate / 1024, 0, 'f', 2));
+}
+
+void FileSendDialog::onFinished(bool cancelled, qint64 sent, double rate) {
+  statusLabel->setText(QString("%1 %2 bytes, %3 KiB/s")
+                           .arg(cancelled ? "Cancelled after" : "Sent")
+                           .arg(sent)
+                           .arg(rate / 1024, 0, 'f', 2));
+  startButton->setEnabled(true);
+  cancelButton->setEnabled(false);
+}
+
+void FileSendDialog::done(int result) {
+  sender->cancel();
+  QDialog::done(result);
+}
@@ -0,0 +1,29 @@
+#ifndef FILESENDDIALOG_H
+#define FILESENDDIALOG_H
+
+#include "filesender.h"
+#include "ui_filesenddialog.h"
+#include <QDialog>
+
+class FileSendDialog : public QDialog, private Ui::FileSendDialog {
+  Q_OBJECT
+
+public:
+  FileSendDialog(FileSender *sender, SerialPort *port,
+                 QWidget *parent = nullptr);
+
+private slots:
+  void onBrowse();
+  void onStart();
+  void onCancel();
+  void onProgress(qint64 sent, qint64 total, double rate);
+  void onFinished(bool cancelled, qint64 sent, double rate);
+
+private:
+  void done(int result) override;
+
+  FileSender *sender;
+  SerialPort *port;
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "filesender.h"
+#include "sendscheduler.h"
+#include <QElapsedTimer>
+#include <QFile>
+
+#define PROGRESS_INTERVAL_MS 100
+// give up waiting for the port to drain after this long without progress
+#define DRAIN_TIMEOUT_MS 5000
+
+FileSender::FileSender(QObject *parent) : QObject(parent) {
+  thread = nullptr;
+  shouldStop = 0;
+}
+
+FileSender::~FileSender() { cancel(); }
+
+bool FileSender::start(const QString &fileName, SerialPort *port,
+                       int chunkSize, int delayUs) {
+  cancel();
+
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = file.errorString();
+    return false;
+  }
+  if (!port->status().open) {
+    error = "Serial port is not open";
+    return false;
+  }
+  file.close();
+
+  shouldStop = 0;
+  thread = QThread::create([this, fileName, port, chunkSize, delayUs] {
+    run(fileName, port, qMax(chunkSize, 1), delayUs);
+  });
+  thread->start();
+  return true;
+}
+
+void FileSender::cancel() {
+  if (thread) {
+    shouldStop = 1;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+  }
+}
+
+void FileSender::run(QString fileName, SerialPort *port, int chunkSize,
+                     int delayUs) {
+  QFile file(fileName);
+  qint64 total = 0;
+  const char *data = nullptr;
+  if (file.open(QIODevice::ReadOnly)) {
+    total = file.size();
+    data = total ? (const char *)file.map(0, total) : nullptr;
+  }
+  if (total && !data) {
+    emit finished(false, 0, 0);
+    return;
+  }
+
+  QElapsedTimer clock, lastProgress;
+  clock.start();
+  lastProgress.start();
+  auto rate = [&](qint64 sent) {
+    qint64 ns = clock.nsecsElapsed();
+    return ns > 0 ? sent * 1e9 / ns : 0.0;
+  };
+
+  const qint64 baseline = port->bytesToWrite();
+  const qint64 window = (qint64)chunkSize * SEND_WINDOW_CHUNKS;
+  qint64 sent = 0;
+  // absolute deadlines so the pacing does not drift with send overhead
+  qint64 deadline = SerialPort::now();
+  while (sent < total && !shouldStop) {
+    if (!port->waitForBacklog(baseline, window, shouldStop)) {
+      break;
+    }
+
+    qint64 size = qMin<qint64>(chunkSize, total - sent);
+    // copy one chunk so the mapping can go away while it is queued
+    port->write(QByteArray(data + sent, size));
+    sent += size;
+
+    if (lastProgress.elapsed() >= PROGRESS_INTERVAL_MS) {
+      lastProgress.restart();
+      emit progress(sent, total, rate(sent));
+    }
+    if (delayUs > 0 && sent < total) {
+      deadline = qMax(deadline + delayUs * 1000LL, SerialPort::now());
+      SendScheduler::sleepUntil(deadline);
+    }
+  }
+
+  // wait for the tail so the rate reflects the wire, not the queue
+  QElapsedTimer drain;
+  drain.start();
+  qint64 lastPending = -1;
+  while (!shouldStop && port->bytesToWrite() > baseline) {
+    qint64 pending = port->bytesToWrite();
+    if (pending != lastPending) {
+      lastPending = pending;
+      drain.restart();
+    } else if (drain.elapsed() > DRAIN_TIMEOUT_MS) {
+      break;
+    }
+    QThread::msleep(1);
+  }
+
+  emit progress(sent, total, rate(sent));
+  emit finished(shouldStop, sent, rate(sent));
+}
@@ -0,0 +1,40 @@
+#ifndef FILESENDER_H
+#define FILESENDER_H
+
+#include "drivers/serialport.h"
+#include <QAtomicInt>
+#include <QObject>
+#include <QThread>
+
+// Streams a file out of a serial port in fixed size chunks. The file is
+// mapped rather than read, and a chunk is only queued when the port has
+// less than a few chunks outstanding, so memory use does not depend on
+// the file size.
+class FileSender : public QObject {
+  Q_OBJECT
+
+public:
+  explicit FileSender(QObject *parent = nullptr);
+  ~FileSender();
+
+  // delayUs is an optional pause between chunks
+  bool start(const QString &fileName, SerialPort *port, int chunkSize,
+             int delayUs);
+  void cancel();
+  bool isRunning() { return thread && thread->isRunning(); }
+  QString errorString() { return error; }
+
+signals:
+  // rate is in bytes per second, averaged since the start
+  void progress(qint64 sent, qint64 total, double rate);
+  void finished(bool cancelled, qint64 sent, double rate);
+
+private:
+  void run(QString fileName, SerialPort *port, int chunkSize, int delayUs);
+
+  QThread *thread;
+  QAtomicInt shouldStop;
+  QString error;
+};
+
+#endif
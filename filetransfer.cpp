@@ -0,0 +1,828 @@
+#include "filetransfer.h"
+#include "crc.h"
+#include <QDateTime>
+#include <QFileInfo>
+#include <cstring>
+
+#define SOH 0x01
+#define STX 0x02
+#define EOT 0x04
+#define ACK 0x06
+#define BS 0x08
+#define NAK 0x15
+#define CAN 0x18
+#define CPMEOF 0x1A
+
+#define MAX_RETRIES 10
+#define START_TIMEOUT_MS 60000
+#define BLOCK_TIMEOUT_MS 10000
+#define CHAR_TIMEOUT_MS 1000
+#define PROGRESS_INTERVAL_NS 100000000LL
+
+#define ZPAD '*'
+#define ZDLE 0x18
+#define ZBIN 'A'
+#define ZHEX 'B'
+#define ZBIN32 'C'
+#define XON 0x11
+
+#define ZRQINIT 0
+#define ZRINIT 1
+#define ZACK 3
+#define ZFILE 4
+#define ZSKIP 5
+#define ZNAK 6
+#define ZABORT 7
+#define ZFIN 8
+#define ZRPOS 9
+#define ZDATA 10
+#define ZEOF 11
+#define ZFERR 12
+#define ZCHALLENGE 14
+#define ZCAN 16
+
+#define ZCRCE 'h'
+#define ZCRCG 'i'
+#define ZCRCQ 'j'
+#define ZCRCW 'k'
+#define ZRUB0 'l'
+#define ZRUB1 'm'
+
+// ZRINIT capability flags in ZF0
+#define CANFC32 0x20
+#define ESCCTL 0x40
+// ZFILE conversion option: binary
+#define ZCBIN 1
+
+#define ZSUBPACKET_SIZE 1024
+// without a receiver buffer limit, ask for an ACK this often and never
+// run further ahead of the last one than ZWINDOW
+#define ZACK_INTERVAL 8192
+#define ZWINDOW 32768
+
+// return codes of readByte / zReadHeader besides data
+#define TIMEOUT -1
+#define CANCELLED -2
+#define BAD_HEADER -3
+
+FileTransfer::FileTransfer(QObject *parent) : QObject(parent) {
+  thread = nullptr;
+  shouldStop = 0;
+  port = nullptr;
+  inputPos = 0;
+  lastReceived = 0;
+  lastProgress = 0;
+  startTime = 0;
+  sent = 0;
+  total = 0;
+  retries = 0;
+  zCrc32 = false;
+  zEscapeControl = false;
+  zReceiverBuffer = 0;
+  clock.start();
+}
+
+FileTransfer::~FileTransfer() { cancel(); }
+
+bool FileTransfer::start(const QString &fileName, Protocol protocol,
+                         SerialPort *port) {
+  cancel();
+  if (!port->status().open) {
+    error = "Serial port is not open";
+    return false;
+  }
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = file.errorString();
+    return false;
+  }
+  file.close();
+
+  this->port = port;
+  flushInput();
+  // bytes are queued on whatever thread the port delivers them on
+  connect(port, SIGNAL(receivedData(QByteArray)), this,
+          SLOT(onReceived(QByteArray)), Qt::DirectConnection);
+
+  auto settings = port->status().settings;
+  qint32 baudRate = settings.baudRate;
+  int bits = settings.parity == QSerialPort::NoParity ? 10 : 11;
+  shouldStop = 0;
+  thread = QThread::create([this, fileName, protocol, baudRate, bits] {
+    run(fileName, protocol, baudRate, bits);
+  });
+  thread->start();
+  return true;
+}
+
+void FileTransfer::cancel() {
+  if (thread) {
+    shouldStop = 1;
+    arrived.wakeAll();
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+  }
+  if (port) {
+    disconnect(port, nullptr, this, nullptr);
+    port = nullptr;
+  }
+}
+
+void FileTransfer::onReceived(QByteArray data) {
+  QMutexLocker locker(&mutex);
+  input.append(data);
+  lastReceived = clock.nsecsElapsed();
+  arrived.wakeAll();
+}
+
+int FileTransfer::readByte(int timeoutMs, bool fromLastReceive) {
+  QMutexLocker locker(&mutex);
+  qint64 begin = fromLastReceive ? lastReceived : clock.nsecsElapsed();
+  qint64 deadline = begin + timeoutMs * 1000000LL;
+  for (;;) {
+    if (inputPos < input.length()) {
+      quint8 ch = input[inputPos++];
+      if (inputPos > 4096 && inputPos * 2 > input.length()) {
+        input.remove(0, inputPos);
+        inputPos = 0;
+      }
+      return ch;
+    }
+    if (shouldStop) {
+      return CANCELLED;
+    }
+    qint64 remaining = deadline - clock.nsecsElapsed();
+    if (remaining <= 0) {
+      return TIMEOUT;
+    }
+    // wake up regularly to notice cancellation
+    arrived.wait(&mutex, qMin<qint64>(remaining / 1000000 + 1, 100));
+  }
+}
+
+bool FileTransfer::inputPending() {
+  QMutexLocker locker(&mutex);
+  return inputPos < input.length();
+}
+
+void FileTransfer::flushInput() {
+  QMutexLocker locker(&mutex);
+  input.clear();
+  inputPos = 0;
+}
+
+void FileTransfer::send(const QByteArray &data) { port->write(data); }
+
+void FileTransfer::reportProgress(bool force) {
+  qint64 now = clock.nsecsElapsed();
+  if (force || now - lastProgress > PROGRESS_INTERVAL_NS) {
+    lastProgress = now;
+    double seconds = (now - startTime) / 1e9;
+    emit progress(sent, total, seconds > 0 ? sent / seconds : 0);
+  }
+}
+
+void FileTransfer::run(QString fileName, Protocol protocol, qint32 baudRate,
+                       int bits) {
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly)) {
+    emit finished(false, file.errorString());
+    return;
+  }
+  total = file.size();
+  sent = 0;
+  retries = 0;
+  error.clear();
+
+  startTime = clock.nsecsElapsed();
+  bool ok = false;
+  switch (protocol) {
+  case XModem:
+    ok = sendXmodem(file, 128);
+    break;
+  case XModem1K:
+    ok = sendXmodem(file, 1024);
+    break;
+  case YModem:
+    ok = sendYmodem(file);
+    break;
+  case ZModem:
+    ok = sendZmodem(file);
+    break;
+  }
+
+  if (!ok && shouldStop) {
+    error = "Cancelled";
+    if (protocol == ZModem) {
+      send(QByteArray(8, CAN) + QByteArray(8, BS));
+    } else {
+      send(QByteArray(3, CAN));
+    }
+  }
+
+  // stop queueing input until the next transfer
+  disconnect(port, nullptr, this, nullptr);
+
+  double seconds = (clock.nsecsElapsed() - startTime) / 1e9;
+  double rate = seconds > 0 ? sent / seconds : 0;
+  double wire = baudRate > 0 ? (double)baudRate / bits : 0;
+  emit progress(sent, total, rate);
+  auto result = QString("%1 %2 / %3 bytes in %4 s, %5 KiB/s")
+                    .arg(ok ? "Sent" : error)
+                    .arg(sent)
+                    .arg(total)
+                    .arg(seconds, 0, 'f', 2)
+                    .arg(rate / 1024, 0, 'f', 2);
+  if (wire > 0) {
+    result += QString(", %1% of the %2 baud wire rate")
+                  .arg(rate * 100 / wire, 0, 'f', 1)
+                  .arg(baudRate);
+  }
+  if (retries) {
+    result += QString(", %1 retries").arg(retries);
+  }
+  emit finished(ok, result);
+}
+
+// XMODEM / YMODEM
+
+bool FileTransfer::waitStart(bool &useCrc) {
+  emit message("Waiting for receiver");
+  for (;;) {
+    int ch = readByte(START_TIMEOUT_MS);
+    if (ch == 'C' || ch == NAK) {
+      useCrc = ch == 'C';
+      return true;
+    } else if (ch == CAN) {
+      if (readByte(CHAR_TIMEOUT_MS) == CAN) {
+        error = "Cancelled by receiver";
+        return false;
+      }
+    } else if (ch == TIMEOUT) {
+      error = "Receiver did not start";
+      return false;
+    } else if (ch == CANCELLED) {
+      return false;
+    }
+  }
+}
+
+bool FileTransfer::waitFor(quint8 expected, int timeoutMs) {
+  for (;;) {
+    int ch = readByte(timeoutMs);
+    if (ch == expected) {
+      return true;
+    } else if (ch == CAN) {
+      if (readByte(CHAR_TIMEOUT_MS) == CAN) {
+        error = "Cancelled by receiver";
+        return false;
+      }
+    } else if (ch < 0) {
+      if (ch == TIMEOUT) {
+        error = "Timed out waiting for receiver";
+      }
+      return false;
+    }
+  }
+}
+
+bool FileTransfer::sendBlock(quint8 number, const char *data, int size,
+                             bool useCrc) {
+  QByteArray packet;
+  packet.reserve(size + 5);
+  packet.append(size == 1024 ? STX : SOH);
+  packet.append(number);
+  packet.append(255 - number);
+  packet.append(data, size);
+  if (useCrc) {
+    quint16 crc = crc16Xmodem(data, size);
+    packet.append(crc >> 8);
+    packet.append(crc & 0xff);
+  } else {
+    quint8 sum = 0;
+    for (int i = 0; i < size; i++) {
+      sum += data[i];
+    }
+    packet.append(sum);
+  }
+
+  for (int attempt = 0; attempt < MAX_RETRIES; attempt++) {
+    // drop duplicate 'C' / NAK requests before sending
+    flushInput();
+    send(packet);
+    for (;;) {
+      int ch = readByte(BLOCK_TIMEOUT_MS);
+      if (ch == ACK) {
+        return true;
+      } else if (ch == CAN) {
+        if (readByte(CHAR_TIMEOUT_MS) == CAN) {
+          error = "Cancelled by receiver";
+          return false;
+        }
+      } else if (ch == NAK || ch == TIMEOUT) {
+        retries++;
+        break;
+      } else if (ch == CANCELLED) {
+        return false;
+      }
+    }
+  }
+  error = QString("Block %1 failed %2 times").arg(number).arg(MAX_RETRIES);
+  return false;
+}
+
+bool FileTransfer::sendBlocks(QFile &file, int blockSize, bool useCrc) {
+  char buffer[1024];
+  quint8 number = 1;
+  while (sent < total) {
+    // a short tail goes into a 128 byte block to save padding
+    int size = (blockSize == 1024 && total - sent > 128) ? 1024 : 128;
+    qint64 n = file.read(buffer, size);
+    if (n <= 0) {
+      error = file.errorString();
+      return false;
+    }
+    memset(buffer + n, CPMEOF, size - n);
+    if (!sendBlock(number++, buffer, size, useCrc)) {
+      return false;
+    }
+    sent += n;
+    reportProgress();
+  }
+  return true;
+}
+
+bool FileTransfer::sendEot() {
+  // YMODEM receivers NAK the first EOT on purpose
+  for (int attempt = 0; attempt < MAX_RETRIES; attempt++) {
+    send(QByteArray(1, EOT));
+    int ch = readByte(BLOCK_TIMEOUT_MS);
+    if (ch == ACK) {
+      return true;
+    } else if (ch == CANCELLED) {
+      return false;
+    }
+  }
+  error = "EOT not acknowledged";
+  return false;
+}
+
+bool FileTransfer::sendXmodem(QFile &file, int blockSize) {
+  bool useCrc;
+  if (!waitStart(useCrc)) {
+    return false;
+  }
+  if (!useCrc) {
+    // 1K blocks need CRC
+    blockSize = 128;
+  }
+  emit message(QString("Sending with %1 byte blocks, %2")
+                   .arg(blockSize)
+                   .arg(useCrc ? "CRC" : "checksum"));
+  return sendBlocks(file, blockSize, useCrc) && sendEot();
+}
+
+bool FileTransfer::sendYmodem(QFile &file) {
+  bool useCrc;
+  if (!waitStart(useCrc)) {
+    return false;
+  }
+
+  QFileInfo info(file.fileName());
+  auto header = info.fileName().toUtf8();
+  header.append('\0');
+  header.append(QString("%1 %2 %3")
+                    .arg(total)
+                    .arg(info.lastModified().toSecsSinceEpoch(), 0, 8)
+                    .arg(0644, 0, 8)
+                    .toLatin1());
+  int size = header.length() < 128 ? 128 : 1024;
+  header = header.left(size - 1);
+  header.append(QByteArray(size - header.length(), '\0'));
+
+  emit message("Sending header");
+  if (!sendBlock(0, header.constData(), size, true) ||
+      !waitFor('C', BLOCK_TIMEOUT_MS)) {
+    return false;
+  }
+  if (!sendBlocks(file, 1024, true) || !sendEot()) {
+    return false;
+  }
+
+  // an empty header ends the batch
+  if (!waitFor('C', BLOCK_TIMEOUT_MS)) {
+    return false;
+  }
+  QByteArray empty(128, '\0');
+  return sendBlock(0, empty.constData(), 128, true);
+}
+
+// ZMODEM
+
+QByteArray FileTransfer::zEscape(const char *data, int length) {
+  QByteArray result;
+  result.reserve(length + length / 8);
+  for (int i = 0; i < length; i++) {
+    quint8 ch = data[i];
+    bool escape;
+    switch (ch) {
+    case ZDLE:
+    case 0x10:
+    case XON:
+    case 0x13:
+    case 0x90:
+    case 0x91:
+    case 0x93:
+      escape = true;
+      break;
+    default:
+      escape = zEscapeControl && (ch & 0x60) == 0;
+      break;
+    }
+    if (escape) {
+      result.append(ZDLE);
+      result.append(ch ^ 0x40);
+    } else {
+      result.append(ch);
+    }
+  }
+  return result;
+}
+
+QByteArray FileTransfer::zHexHeader(quint8 type, const quint8 header[4]) {
+  quint8 frame[5] = {type, header[0], header[1], header[2], header[3]};
+  quint16 crc = crc16Xmodem(frame, sizeof(frame));
+  QByteArray raw((const char *)frame, sizeof(frame));
+  raw.append(crc >> 8);
+  raw.append(crc & 0xff);
+
+  QByteArray result;
+  result.append(ZPAD);
+  result.append(ZPAD);
+  result.append(ZDLE);
+  result.append(ZHEX);
+  result.append(raw.toHex());
+  result.append('\r');
+  result.append((char)0x8a);
+  if (type != ZFIN && type != ZACK) {
+    result.append(XON);
+  }
+  return result;
+}
+
+QByteArray FileTransfer::zBinaryHeader(quint8 type, const quint8 header[4]) {
+  quint8 frame[5] = {type, header[0], header[1], header[2], header[3]};
+  QByteArray raw((const char *)frame, sizeof(frame));
+  QByteArray result;
+  result.append(ZPAD);
+  result.append(ZDLE);
+  if (zCrc32) {
+    quint32 crc = crc32(frame, sizeof(frame));
+    for (int i = 0; i < 4; i++) {
+      raw.append((crc >> (8 * i)) & 0xff);
+    }
+    result.append(ZBIN32);
+  } else {
+    quint16 crc = crc16Xmodem(frame, sizeof(frame));
+    raw.append(crc >> 8);
+    raw.append(crc & 0xff);
+    result.append(ZBIN);
+  }
+  result.append(zEscape(raw.constData(), raw.length()));
+  return result;
+}
+
+QByteArray FileTransfer::zSubpacket(const char *data, int length,
+                                    quint8 frameEnd) {
+  QByteArray result = zEscape(data, length);
+  result.append(ZDLE);
+  result.append(frameEnd);
+  QByteArray crc;
+  if (zCrc32) {
+    quint32 value = crc32(&frameEnd, 1, crc32(data, length));
+    for (int i = 0; i < 4; i++) {
+      crc.append((value >> (8 * i)) & 0xff);
+    }
+  } else {
+    quint16 value = crc16Xmodem(&frameEnd, 1, crc16Xmodem(data, length));
+    crc.append(value >> 8);
+    crc.append(value & 0xff);
+  }
+  result.append(zEscape(crc.constData(), crc.length()));
+  if (frameEnd == ZCRCW) {
+    result.append(XON);
+  }
+  return result;
+}
+
+int FileTransfer::zReadByte(int timeoutMs) {
+  int ch = readByte(timeoutMs, true);
+  if (ch != ZDLE) {
+    return ch;
+  }
+  ch = readByte(timeoutMs, true);
+  if (ch < 0) {
+    return ch;
+  }
+  if (ch == ZRUB0) {
+    return 0x7f;
+  } else if (ch == ZRUB1) {
+    return 0xff;
+  }
+  return ch ^ 0x40;
+}
+
+// Returns the frame type, or TIMEOUT / CANCELLED / BAD_HEADER.
+int FileTransfer::zReadHeader(quint8 header[4], int timeoutMs) {
+  int cans = 0;
+  int pads = 0;
+  for (;;) {
+    int ch = readByte(timeoutMs);
+    if (ch < 0) {
+      return ch;
+    }
+    ch &= 0x7f;
+    if (ch == CAN) {
+      if (++cans >= 5) {
+        error = "Cancelled by receiver";
+        return CANCELLED;
+      }
+    } else {
+      cans = 0;
+    }
+    if (ch == ZPAD) {
+      pads++;
+      continue;
+    }
+    if (ch != ZDLE || pads == 0) {
+      pads = 0;
+      continue;
+    }
+    pads = 0;
+
+    int format = readByte(CHAR_TIMEOUT_MS, true);
+    quint8 frame[9];
+    int length;
+    if (format == ZHEX) {
+      length = 7;
+      for (int i = 0; i < length; i++) {
+        char hex[2];
+        for (int j = 0; j < 2; j++) {
+          int digit = readByte(CHAR_TIMEOUT_MS, true);
+          if (digit < 0) {
+            return digit;
+          }
+          hex[j] = digit & 0x7f;
+        }
+        auto value = QByteArray::fromHex(QByteArray(hex, 2));
+        if (value.length() != 1) {
+          return BAD_HEADER;
+        }
+        frame[i] = value[0];
+      }
+      if (crc16Xmodem(frame, 5) != ((frame[5] << 8) | frame[6])) {
+        return BAD_HEADER;
+      }
+    } else if (format == ZBIN || format == ZBIN32) {
+      length = format == ZBIN ? 7 : 9;
+      for (int i = 0; i < length; i++) {
+        int value = zReadByte(CHAR_TIMEOUT_MS);
+        if (value < 0) {
+          return value;
+        }
+        frame[i] = value;
+      }
+      if (format == ZBIN) {
+        if (crc16Xmodem(frame, 5) != ((frame[5] << 8) | frame[6])) {
+          return BAD_HEADER;
+        }
+      } else {
+        quint32 crc = frame[5] | (frame[6] << 8) | (frame[7] << 16) |
+                      ((quint32)frame[8] << 24);
+        if (crc32(frame, 5) != crc) {
+          return BAD_HEADER;
+        }
+      }
+    } else if (format < 0) {
+      return format;
+    } else {
+      continue;
+    }
+    memcpy(header, frame + 1, 4);
+    return frame[0];
+  }
+}
+
+inline qint64 zPosition(const quint8 header[4]) {
+  return header[0] | (header[1] << 8) | (header[2] << 16) |
+         ((qint64)header[3] << 24);
+}
+
+inline void zSetPosition(quint8 header[4], qint64 position) {
+  for (int i = 0; i < 4; i++) {
+    header[i] = (position >> (8 * i)) & 0xff;
+  }
+}
+
+// Streams from position until the end of file. Returns true once the
+// whole file was acknowledged by ZRINIT after ZEOF.
+bool FileTransfer::zSendData(QFile &file, qint64 position, qint64 &acked) {
+  quint8 header[4];
+  char buffer[ZSUBPACKET_SIZE];
+
+  for (int attempt = 0; attempt < MAX_RETRIES;) {
+    if (!file.seek(position)) {
+      error = file.errorString();
+      return false;
+    }
+    zSetPosition(header, position);
+    send(zBinaryHeader(ZDATA, header));
+    qint64 lastAckRequest = position;
+    bool restart = false;
+
+    while (position < total && !restart) {
+      qint64 n = file.read(buffer, sizeof(buffer));
+      if (n <= 0) {
+        error = file.errorString();
+        return false;
+      }
+      quint8 frameEnd = ZCRCG;
+      bool last = position + n >= total;
+      if (last) {
+        frameEnd = ZCRCE;
+      } else if (zReceiverBuffer &&
+                 position + n - lastAckRequest >= zReceiverBuffer) {
+        frameEnd = ZCRCW;
+      } else if (!zReceiverBuffer &&
+                 position + n - lastAckRequest >= ZACK_INTERVAL) {
+        frameEnd = ZCRCQ;
+      }
+      send(zSubpacket(buffer, n, frameEnd));
+      position += n;
+      sent = position;
+      reportProgress();
+      if (frameEnd == ZCRCW || frameEnd == ZCRCQ) {
+        lastAckRequest = position;
+      }
+
+      // handle what the receiver said, blocking while the window is full
+      // or when it must answer a ZCRCW before we can go on
+      while (!restart) {
+        bool mustWait = frameEnd == ZCRCW ? acked < position
+                                          : position - acked > ZWINDOW;
+        if (!mustWait && !inputPending()) {
+          break;
+        }
+        // only block for a reply when one is required
+        int type = zReadHeader(header, mustWait ? BLOCK_TIMEOUT_MS : 0);
+        if (type == ZACK) {
+          acked = qMax(acked, zPosition(header));
+        } else if (type == ZRPOS) {
+          // receiver lost data, go back
+          position = zPosition(header);
+          acked = position;
+          retries++;
+          attempt++;
+          restart = true;
+        } else if (type == ZSKIP || type == ZABORT || type == ZFERR ||
+                   type == ZCAN || type == CANCELLED) {
+          if (type != CANCELLED) {
+            error = "Aborted by receiver";
+          }
+          return false;
+        } else if (type == TIMEOUT) {
+          if (mustWait) {
+            // resync from what was acknowledged last
+            position = acked;
+            retries++;
+            attempt++;
+            restart = true;
+          }
+          break;
+        }
+      }
+      if (frameEnd == ZCRCW && !restart) {
+        // ZCRCW ends the frame, the next one needs a new header
+        zSetPosition(header, position);
+        send(zBinaryHeader(ZDATA, header));
+      }
+    }
+    if (restart) {
+      continue;
+    }
+
+    // everything is out, confirm the end of file
+    for (;;) {
+      zSetPosition(header, total);
+      send(zHexHeader(ZEOF, header));
+      int type = zReadHeader(header, BLOCK_TIMEOUT_MS);
+      if (type == ZRINIT) {
+        acked = total;
+        return true;
+      } else if (type == ZRPOS) {
+        position = zPosition(header);
+        retries++;
+        attempt++;
+        break;
+      } else if (type == CANCELLED || type == ZCAN || type == ZABORT ||
+                 type == ZFERR) {
+        return false;
+      } else if (++attempt >= MAX_RETRIES) {
+        break;
+      }
+    }
+  }
+  error = "Too many errors";
+  return false;
+}
+
+bool FileTransfer::sendZmodem(QFile &file) {
+  quint8 header[4] = {0};
+  zCrc32 = false;
+  zEscapeControl = false;
+  zReceiverBuffer = 0;
+
+  // wake up the receiver and learn its capabilities
+  emit message("Waiting for receiver");
+  send("rz\r");
+  int type = TIMEOUT;
+  for (int attempt = 0; attempt < MAX_RETRIES && type != ZRINIT; attempt++) {
+    memset(header, 0, sizeof(header));
+    send(zHexHeader(ZRQINIT, header));
+    for (;;) {
+      type = zReadHeader(header, BLOCK_TIMEOUT_MS);
+      if (type == ZCHALLENGE) {
+        send(zHexHeader(ZACK, header));
+      } else if (type == CANCELLED) {
+        return false;
+      } else if (type == ZRINIT || type == TIMEOUT) {
+        break;
+      }
+    }
+  }
+  if (type != ZRINIT) {
+    error = "Receiver did not start";
+    return false;
+  }
+  zCrc32 = header[3] & CANFC32;
+  zEscapeControl = header[3] & ESCCTL;
+  zReceiverBuffer = header[0] | (header[1] << 8);
+  emit message(QString("Receiver ready, CRC-%1, buffer %2")
+                   .arg(zCrc32 ? 32 : 16)
+                   .arg(zReceiverBuffer ? QString::number(zReceiverBuffer)
+                                        : QString("unlimited")));
+
+  // file information
+  QFileInfo info(file.fileName());
+  auto fileInfo = info.fileName().toUtf8();
+  fileInfo.append('\0');
+  fileInfo.append(QString("%1 %2 %3 0 1 %1")
+                      .arg(total)
+                      .arg(info.lastModified().toSecsSinceEpoch(), 0, 8)
+                      .arg(0100644, 0, 8)
+                      .toLatin1());
+  fileInfo.append('\0');
+
+  qint64 position = -1;
+  for (int attempt = 0; attempt < MAX_RETRIES && position < 0; attempt++) {
+    quint8 fileHeader[4] = {0, 0, 0, ZCBIN};
+    send(zBinaryHeader(ZFILE, fileHeader));
+    send(zSubpacket(fileInfo.constData(), fileInfo.length(), ZCRCW));
+    type = zReadHeader(header, BLOCK_TIMEOUT_MS);
+    if (type == ZRPOS) {
+      position = zPosition(header);
+    } else if (type == ZSKIP) {
+      error = "Skipped by receiver";
+      return false;
+    } else if (type == CANCELLED) {
+      return false;
+    } else {
+      retries++;
+    }
+  }
+  if (position < 0) {
+    error = "Receiver did not accept the file";
+    return false;
+  }
+
+  if (position > 0) {
+    emit message(QString("Resuming at %1").arg(position));
+  }
+  qint64 acked = position;
+  if (!zSendData(file, position, acked)) {
+    return false;
+  }
+
+  // end the session
+  for (int attempt = 0; attempt < 3; attempt++) {
+    memset(header, 0, sizeof(header));
+    send(zHexHeader(ZFIN, header));
+    type = zReadHeader(header, BLOCK_TIMEOUT_MS);
+    if (type == ZFIN || type == CANCELLED) {
+      break;
+    }
+  }
+  send("OO");
+  return true;
+}
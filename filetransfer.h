@@ -0,0 +1,91 @@
+#ifndef FILETRANSFER_H
+#define FILETRANSFER_H
+
+#include "drivers/serialport.h"
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+// Sends a file with XMODEM (checksum/CRC, 128 or 1K blocks), YMODEM batch
+// or ZMODEM. Received bytes are taken straight from the port's reader
+// thread into a queue, the protocol itself runs on a worker thread, so the
+// GUI thread is never on the data path.
+class FileTransfer : public QObject {
+  Q_OBJECT
+
+public:
+  enum Protocol { XModem, XModem1K, YModem, ZModem };
+
+  explicit FileTransfer(QObject *parent = nullptr);
+  ~FileTransfer();
+
+  bool start(const QString &fileName, Protocol protocol, SerialPort *port);
+  void cancel();
+  bool isRunning() { return thread && thread->isRunning(); }
+  QString errorString() { return error; }
+
+signals:
+  void progress(qint64 sent, qint64 total, double rate);
+  void message(QString text);
+  void finished(bool ok, QString result);
+
+private slots:
+  void onReceived(QByteArray data);
+
+private:
+  void run(QString fileName, Protocol protocol, qint32 baudRate, int bits);
+
+  // XMODEM / YMODEM
+  bool waitStart(bool &useCrc);
+  bool waitFor(quint8 expected, int timeoutMs);
+  bool sendBlock(quint8 number, const char *data, int size, bool useCrc);
+  bool sendBlocks(QFile &file, int blockSize, bool useCrc);
+  bool sendEot();
+  bool sendXmodem(QFile &file, int blockSize);
+  bool sendYmodem(QFile &file);
+
+  // ZMODEM
+  QByteArray zEscape(const char *data, int length);
+  QByteArray zHexHeader(quint8 type, const quint8 header[4]);
+  QByteArray zBinaryHeader(quint8 type, const quint8 header[4]);
+  QByteArray zSubpacket(const char *data, int length, quint8 frameEnd);
+  int zReadByte(int timeoutMs);
+  int zReadHeader(quint8 header[4], int timeoutMs);
+  bool zSendData(QFile &file, qint64 position, qint64 &acked);
+  bool sendZmodem(QFile &file);
+
+  // receive queue, filled on the port's thread
+  int readByte(int timeoutMs, bool fromLastReceive = false);
+  bool inputPending();
+  void flushInput();
+  void send(const QByteArray &data);
+  void reportProgress(bool force = false);
+
+  QThread *thread;
+  QAtomicInt shouldStop;
+  SerialPort *port;
+  QString error;
+
+  QMutex mutex;
+  QWaitCondition arrived;
+  QByteArray input;
+  int inputPos;
+  qint64 lastReceived; // ns on clock
+
+  QElapsedTimer clock;
+  qint64 lastProgress;
+  qint64 startTime;
+  qint64 sent;
+  qint64 total;
+  int retries;
+
+  bool zCrc32;
+  bool zEscapeControl;
+  int zReceiverBuffer;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#include "filetransferdialog.h"
+#include <QFileDialog>
+#include <QSettings>
+
+FileTransferDialog::FileTransferDialog(FileTransfer *transfer,
+                                       SerialPort *port, QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->transfer = transfer;
+  this->port = port;
+
+  QSettings settings;
+  fileLineEdit->setText(settings.value("transfer/file").toString());
+  protocolComboBox->setCurrentIndex(
+      settings.value("transfer/protocol", 0).toInt());
+
+  connect(transfer, SIGNAL(progress(qint64, qint64, double)), this,
+          SLOT(onProgress(qint64, qint64, double)));
+  connect(transfer, SIGNAL(message(QString)), this, SLOT(onMessage(QString)));
+  connect(transfer, SIGNAL(finished(bool, QString)), this,
+          SLOT(onFinished(bool, QString)));
+}
+
+void FileTransferDialog::onBrowse() {
+  auto fileName =
+      QFileDialog::getOpenFileName(this, "Send File", fileLineEdit->text());
+  if (!fileName.isEmpty()) {
+    fileLineEdit->setText(fileName);
+  }
+}
+
+void FileTransferDialog::onStart() {
+  auto protocol = (FileTransfer::Protocol)protocolComboBox->currentIndex();
+  if (!transfer->start(fileLineEdit->text(), protocol, port)) {
+    statusLabel->setText(transfer->errorString());
+    return;
+  }
+
+  QSettings settings;
+  settings.setValue("transfer/file", fileLineEdit->text());
+  settings.setValue("transfer/protocol", protocolComboBox->currentIndex());
+
+  logTextBrowser->clear();
+  progressBar->setValue(0);
+  statusLabel->setText("");
+  startButton->setEnabled(false);
+  cancelButton->setEnabled(true);
+}
+
+void FileTransferDialog::onCancel() { transfer->cancel(); }
+
+void FileTransferDialog::onProgress(qint64 sent, qint64 total, double rate) {
+  progressBar->setValue(total ? sent * 100 / total : 100);
+  statusLabel->setText(QString("%1 / %2 bytes, %3 KiB/s")
+                           .arg(sent)
+                           .arg(total)
+                           .arg(rate / 1024, 0, 'f', 2));
+}
+
+void FileTransferDialog::onMessage(QString text) {
+  logTextBrowser->append(text);
+}
+
+void FileTransferDialog::onFinished(bool ok, QString result) {
+  Q_UNUSED(ok);
+  logTextBrowser->append(result);
+  statusLabel->setText(result);
+  startButton->setEnabled(true);
+  cancelButton->setEnabled(false);
+}
+
+void FileTransferDialog::done(int result) {
+  transfer->cancel();
+  QDialog::done(result);
+}
@@ -0,0 +1,30 @@
+#ifndef FILETRANSFERDIALOG_H
+#define FILETRANSFERDIALOG_H
+
+#include "filetransfer.h"
+#include "ui_filetransferdialog.h"
+#include <QDialog>
+
+class FileTransferDialog : public QDialog, private Ui::FileTransferDialog {
+  Q_OBJECT
+
+public:
+  FileTransferDialog(FileTransfer *transfer, SerialPort *port,
+                     QWidget *parent = nullptr);
+
+private slots:
+  void onBrowse();
+  void onStart();
+  void onCancel();
+  void onProgress(qint64 sent, qint64 total, double rate);
+  void onMessage(QString text);
+  void onFinished(bool ok, QString result);
+
+private:
+  void done(int result) override;
+
+  FileTransfer *transfer;
+  SerialPort *port;
+};
+
+#endif
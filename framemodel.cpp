@@ -0,0 +1,122 @@
+#include "framemodel.h"
+#include <QBrush>
+
+#define MAX_FRAME_ROWS 200000
+// bytes shown in the data column
+#define PREVIEW_BYTES 64
+
+FrameModel::FrameModel(QObject *parent) : QAbstractTableModel(parent) {
+  dropped = 0;
+  origin = -1;
+  describer = nullptr;
+}
+
+int FrameModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : frames.size();
+}
+
+int FrameModel::columnCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant FrameModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= frames.size()) {
+    return QVariant();
+  }
+  const Frame &frame = frames[index.row()];
+
+  if (role == Qt::ForegroundRole && frame.flags) {
+    return QBrush(Qt::red);
+  }
+  if (role != Qt::DisplayRole) {
+    return QVariant();
+  }
+
+  switch (index.column()) {
+  case Index:
+    return dropped + index.row() + 1;
+  case Time:
+    return QString::number((frame.firstTimestamp - origin) / 1e9, 'f', 6);
+  case Duration:
+    return QString::number((frame.lastTimestamp - frame.firstTimestamp) / 1e3,
+                           'f', 0);
+  case Length:
+    return frame.data.length();
+  case Data: {
+    auto text = QString::fromLatin1(frame.data.left(PREVIEW_BYTES).toHex(' '));
+    if (frame.data.length() > PREVIEW_BYTES) {
+      text += " ...";
+    }
+    return text;
+  }
+  case Status: {
+    QStringList status;
+    if (frame.flags & Frame::Malformed) {
+      status << "Malformed";
+    }
+    if (frame.flags & Frame::Truncated) {
+      status << "Truncated";
+    }
+    if (frame.flags & Frame::BadChecksum) {
+      status << "Bad CRC";
+    }
+    return status.join(", ");
+  }
+  case Info:
+    return describer ? describer(frame.data) : QVariant();
+  }
+  return QVariant();
+}
+
+QVariant FrameModel::headerData(int section, Qt::Orientation orientation,
+                                int role) const {
+  if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+    return QVariant();
+  }
+  const char *names[] = {"#",    "Time (s)", "Duration (us)", "Length",
+                         "Data", "Status",   "Info"};
+  return section < ColumnCount ? names[section] : QVariant();
+}
+
+void FrameModel::setDescriber(Describer describer) {
+  this->describer = describer;
+  if (!frames.isEmpty()) {
+    emit dataChanged(index(0, Info), index(frames.size() - 1, Info));
+  }
+}
+
+void FrameModel::append(QVector<Frame> frames) {
+  if (frames.isEmpty()) {
+    return;
+  }
+  if (origin < 0) {
+    origin = frames.first().firstTimestamp;
+  }
+
+  if (!this->frames.isEmpty() &&
+      this->frames.size() + frames.size() > MAX_FRAME_ROWS) {
+    // drop a tenth at a time so that trimming is not paid on every batch
+    int count = qMin(this->frames.size(),
+                     this->frames.size() + frames.size() - MAX_FRAME_ROWS +
+                         MAX_FRAME_ROWS / 10);
+    beginRemoveRows(QModelIndex(), 0, count - 1);
+    this->frames.erase(this->frames.begin(), this->frames.begin() + count);
+    dropped += count;
+    endRemoveRows();
+  }
+
+  int first = this->frames.size();
+  beginInsertRows(QModelIndex(), first, first + frames.size() - 1);
+  for (auto &frame : frames) {
+    this->frames.append(frame);
+  }
+  endInsertRows();
+}
+
+void FrameModel::clear() {
+  beginResetModel();
+  frames.clear();
+  dropped = 0;
+  origin = -1;
+  endResetModel();
+}
@@ -0,0 +1,50 @@
+#ifndef FRAMEMODEL_H
+#define FRAMEMODEL_H
+
+#include "framer.h"
+#include <QAbstractTableModel>
+
+// One row per frame. Cells are formatted when the view asks for them, so
+// only the visible rows are ever turned into text. The oldest frames are
+// dropped past MAX_FRAME_ROWS.
+class FrameModel : public QAbstractTableModel {
+  Q_OBJECT
+
+public:
+  enum Column {
+    Index,
+    Time,
+    Duration,
+    Length,
+    Data,
+    Status,
+    Info,
+    ColumnCount
+  };
+  typedef QString (*Describer)(const QByteArray &frame);
+
+  explicit FrameModel(QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  // fills the info column for a protocol, nullptr leaves it empty
+  void setDescriber(Describer describer);
+
+public slots:
+  void append(QVector<Frame> frames);
+  void clear();
+
+private:
+  QList<Frame> frames;
+  // number of frames dropped from the front, so rows keep their numbers
+  qint64 dropped;
+  // first timestamp of the first frame, times are relative to it
+  qint64 origin;
+  Describer describer;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "framer.h"
+#include "crc.h"
+#include "modbus.h"
+#include <cstring>
+
+#define MAX_FRAME_SIZE 65536
+// address, function and CRC
+#define MODBUS_MIN_FRAME 4
+// least silence before a pending RTU frame is flushed, adapters with a
+// receive latency timer may sit on bytes about this long
+#define MODBUS_MIN_IDLE_NS 20000000
+
+#define SLIP_END '\xC0'
+#define SLIP_ESC '\xDB'
+#define SLIP_ESC_END '\xDC'
+#define SLIP_ESC_ESC '\xDD'
+
+Framer::Framer(const Settings &settings, QObject *parent) : QObject(parent) {
+  qRegisterMetaType<Frame>();
+  qRegisterMetaType<QVector<Frame>>("QVector<Frame>");
+  this->settings = settings;
+  if (this->settings.delimiter.isEmpty()) {
+    this->settings.delimiter = "\n";
+  }
+  inFrame = false;
+  escaped = false;
+  cobsLeft = 0;
+  cobsZero = false;
+  matched = 0;
+  remaining = -1;
+  idleFlushPending = false;
+  idleTimer = new QTimer(this);
+  idleTimer->setSingleShot(true);
+  idleTimer->setTimerType(Qt::PreciseTimer);
+  connect(idleTimer, SIGNAL(timeout()), this, SLOT(flushIdleFrame()));
+
+  // KMP: longest proper prefix of the delimiter that is also a suffix of
+  // its first i + 1 bytes
+  auto &delimiter = this->settings.delimiter;
+  fallback.resize(delimiter.length());
+  fallback[0] = 0;
+  for (int i = 1, k = 0; i < delimiter.length(); i++) {
+    while (k > 0 && delimiter[i] != delimiter[k]) {
+      k = fallback[k - 1];
+    }
+    if (delimiter[i] == delimiter[k]) {
+      k++;
+    }
+    fallback[i] = k;
+  }
+}
+
+void Framer::process(const QByteArray &data, qint64 timestamp) {
+  QMutexLocker locker(&mutex);
+  switch (settings.type) {
+  case Slip:
+    processSlip(data, timestamp);
+    break;
+  case Cobs:
+    processCobs(data, timestamp);
+    break;
+  case Delimiter:
+    processDelimiter(data, timestamp);
+    break;
+  case LengthPrefix:
+    processLengthPrefix(data, timestamp);
+    break;
+  case ModbusRtu:
+    processModbus(data, timestamp);
+    if (inFrame && !idleFlushPending) {
+      idleFlushPending = true;
+      QMetaObject::invokeMethod(this, "flushIdleFrame", Qt::QueuedConnection);
+    }
+    break;
+  }
+  if (!batch.isEmpty()) {
+    emit framesReceived(batch);
+    batch.clear();
+  }
+}
+
+void Framer::flushIdleFrame() {
+  QVector<Frame> frames;
+  {
+    QMutexLocker locker(&mutex);
+    if (!inFrame) {
+      idleFlushPending = false;
+      return;
+    }
+    qint64 left = qMax<qint64>(settings.frameGapNs, MODBUS_MIN_IDLE_NS) -
+                  (SerialPort::now() - current.lastTimestamp);
+    if (left > 0) {
+      // more bytes may have arrived since this was armed
+      idleTimer->start((left + 999999) / 1000000);
+      return;
+    }
+    idleFlushPending = false;
+    finishModbusFrame();
+    frames.swap(batch);
+  }
+  emit framesReceived(frames);
+}
+
+void Framer::append(char byte, qint64 timestamp) {
+  if (!inFrame) {
+    inFrame = true;
+    current.firstTimestamp = timestamp;
+  }
+  if (current.data.length() < MAX_FRAME_SIZE) {
+    current.data.append(byte);
+  } else {
+    current.flags |= Frame::Truncated;
+  }
+  current.lastTimestamp = timestamp;
+}
+
+void Framer::append(const QByteArray &data, int offset, int length,
+                    qint64 timestamp) {
+  if (length <= 0) {
+    return;
+  }
+  if (!inFrame) {
+    inFrame = true;
+    current.firstTimestamp = timestamp;
+    current.data = data.mid(offset, length);
+  } else {
+    current.data.append(data.constData() + offset, length);
+  }
+  if (current.data.length() > MAX_FRAME_SIZE) {
+    current.data.truncate(MAX_FRAME_SIZE);
+    current.flags |= Frame::Truncated;
+  }
+  current.lastTimestamp = timestamp;
+}
+
+void Framer::finishFrame() {
+  // back to back delimiters are not frames
+  if (inFrame && !current.data.isEmpty()) {
+    batch.append(current);
+  }
+  current = Frame();
+  inFrame = false;
+}
+
+void Framer::processSlip(const QByteArray &data, qint64 timestamp) {
+  const char *p = data.constData();
+  int n = data.length();
+  // start of the bytes not yet added to the frame
+  int segment = 0;
+  for (int i = 0; i < n; i++) {
+    char ch = p[i];
+    if (escaped) {
+      escaped = false;
+      segment = i + 1;
+      if (ch == SLIP_ESC_END) {
+        append(SLIP_END, timestamp);
+      } else if (ch == SLIP_ESC_ESC) {
+        append(SLIP_ESC, timestamp);
+      } else if (ch == SLIP_END) {
+        current.flags |= Frame::Malformed;
+        finishFrame();
+      } else {
+        current.flags |= Frame::Malformed;
+        append(ch, timestamp);
+      }
+    } else if (ch == SLIP_END) {
+      append(data, segment, i - segment, timestamp);
+      finishFrame();
+      segment = i + 1;
+    } else if (ch == SLIP_ESC) {
+      append(data, segment, i - segment, timestamp);
+      escaped = true;
+      segment = i + 1;
+    }
+  }
+  append(data, segment, n - segment, timestamp);
+}
+
+void Framer::processCobs(const QByteArray &data, qint64 timestamp) {
+  const char *p = data.constData();
+  int n = data.length();
+  int i = 0;
+  while (i < n) {
+    if (p[i] == 0) {
+      // a zero always ends the frame, even in the middle of a block
+      if (cobsLeft) {
+        current.flags |= Frame::Malformed;
+      }
+      finishFrame();
+      cobsLeft = 0;
+      cobsZero = false;
+      i++;
+    } else if (cobsLeft == 0) {
+      // code byte, the previous block implies a zero unless it was full
+      if (cobsZero) {
+        append('\0', timestamp);
+      }
+      cobsLeft = (quint8)p[i] - 1;
+      cobsZero = (quint8)p[i] != 0xFF;
+      i++;
+    } else {
+      int length = qMin(cobsLeft, n - i);
+      auto zero = (const char *)memchr(p + i, 0, length);
+      if (zero) {
+        length = zero - (p + i);
+      }
+      append(data, i, length, timestamp);
+      cobsLeft -= length;
+      i += length;
+    }
+  }
+}
+
+void Framer::processDelimiter(const QByteArray &data, qint64 timestamp) {
+  const char *p = data.constData();
+  const QByteArray &delimiter = settings.delimiter;
+  int n = data.length();
+  int size = delimiter.length();
+  int segment = 0;
+  int i = 0;
+  while (i < n) {
+    // index just past the end of the next delimiter
+    int end = -1;
+    if (size == 1) {
+      auto hit = (const char *)memchr(p + i, delimiter[0], n - i);
+      if (hit) {
+        end = hit - p + 1;
+      }
+    } else {
+      for (; i < n; i++) {
+        while (matched > 0 && p[i] != delimiter[matched]) {
+          matched = fallback[matched - 1];
+        }
+        if (p[i] == delimiter[matched] && ++matched == size) {
+          end = i + 1;
+          break;
+        }
+      }
+    }
+    if (end < 0) {
+      break;
+    }
+
+    int frameEnd = end - size;
+    if (frameEnd >= segment) {
+      append(data, segment, frameEnd - segment, timestamp);
+    } else {
+      // the delimiter started in an earlier chunk
+      current.data.chop(qMin(segment - frameEnd, current.data.length()));
+    }
+    finishFrame();
+    matched = 0;
+    segment = i = end;
+  }
+  append(data, segment, n - segment, timestamp);
+}
+
+void Framer::processLengthPrefix(const QByteArray &data, qint64 timestamp) {
+  auto p = (const quint8 *)data.constData();
+  int n = data.length();
+  int size = settings.lengthSize;
+  auto parse = [this, size](const quint8 *header) {
+    qint64 value = 0;
+    for (int k = 0; k < size; k++) {
+      int index = settings.bigEndian ? k : size - 1 - k;
+      value = (value << 8) | header[index];
+    }
+    return value + settings.lengthAdjust;
+  };
+
+  int i = 0;
+  while (i < n) {
+    if (remaining < 0) {
+      qint64 length = -1;
+      if (!inFrame && n - i >= size) {
+        length = parse(p + i);
+        if (length >= 0 && length <= MAX_FRAME_SIZE && n - i >= size + length) {
+          // the whole frame is in this chunk
+          append(data, i, size + length, timestamp);
+          finishFrame();
+          i += size + length;
+          continue;
+        }
+        append(data, i, size, timestamp);
+        i += size;
+      } else {
+        append(p[i++], timestamp);
+        if (current.data.length() < size) {
+          continue;
+        }
+        length = parse((const quint8 *)current.data.constData());
+      }
+      if (length < 0 || length > MAX_FRAME_SIZE) {
+        // a length this far off means we are out of sync, show the header
+        // on its own and carry on after it
+        current.flags |= Frame::Malformed;
+        finishFrame();
+      } else if (length == 0) {
+        finishFrame();
+      } else {
+        remaining = length;
+      }
+    } else {
+      int length = qMin<qint64>(remaining, n - i);
+      append(data, i, length, timestamp);
+      remaining -= length;
+      i += length;
+      if (remaining == 0) {
+        finishFrame();
+        remaining = -1;
+      }
+    }
+  }
+}
+
+void Framer::processModbus(const QByteArray &data, qint64 timestamp) {
+  // A chunk is stamped when its last byte arrived, so its first byte
+  // started about one character per byte earlier. Anything longer than the
+  // frame gap between that and the end of the previous chunk is a boundary.
+  qint64 start = timestamp - data.length() * settings.characterNs;
+  if (inFrame && start - current.lastTimestamp >= settings.frameGapNs) {
+    finishModbusFrame();
+  }
+  append(data, 0, data.length(), timestamp);
+
+  // the gap after a frame is only seen once the next one starts, so a
+  // frame whose checksum already works, at a size its function allows, is
+  // taken as complete
+  if (current.data.length() >= MODBUS_MIN_FRAME &&
+      crc16Modbus(current.data.constData(), current.data.length()) == 0 &&
+      modbusLengthFits((const quint8 *)current.data.constData(),
+                       current.data.length())) {
+    finishModbusFrame();
+  }
+}
+
+void Framer::finishModbusFrame() {
+  if (!inFrame) {
+    return;
+  }
+  // Adapters with a receive latency timer can pack several back to back
+  // frames into one chunk with no visible gap. Split them where a prefix
+  // has a valid checksum and a size its function code allows; a checksum
+  // alone comes out right by chance about once per 65536 bytes.
+  const QByteArray &data = current.data;
+  auto p = (const quint8 *)data.constData();
+  int begin = 0;
+  while (data.length() - begin > MODBUS_MIN_FRAME) {
+    quint16 crc = 0xFFFF;
+    int end = -1;
+    for (int i = begin; i < data.length() - 1; i++) {
+      crc = crc16Modbus(p + i, 1, crc);
+      if (crc == 0 && i + 1 - begin >= MODBUS_MIN_FRAME &&
+          modbusLengthFits(p + begin, i + 1 - begin)) {
+        end = i + 1;
+        break;
+      }
+    }
+    if (end < 0) {
+      break;
+    }
+    Frame frame = current;
+    frame.data = data.mid(begin, end - begin);
+    frame.flags = 0;
+    batch.append(frame);
+    begin = end;
+  }
+
+  Frame frame = current;
+  if (begin > 0) {
+    frame.data = data.mid(begin);
+  }
+  if (frame.data.length() < MODBUS_MIN_FRAME ||
+      crc16Modbus(frame.data.constData(), frame.data.length()) != 0) {
+    frame.flags |= Frame::BadChecksum;
+  }
+  batch.append(frame);
+  current = Frame();
+  inFrame = false;
+}
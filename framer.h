@@ -0,0 +1,107 @@
+#ifndef FRAMER_H
+#define FRAMER_H
+
+#include "drivers/serialport.h"
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QTimer>
+#include <QVector>
+
+struct Frame {
+  enum Flag {
+    // an escape or COBS code that does not decode, the bytes are kept
+    Malformed = 1,
+    // longer than MAX_FRAME_SIZE, cut at that size
+    Truncated = 2,
+    // ModbusRtu: the CRC does not match
+    BadChecksum = 4,
+  };
+
+  QByteArray data;
+  // SerialPort::now() of the chunks holding the first and the last byte
+  qint64 firstTimestamp = 0;
+  qint64 lastTimestamp = 0;
+  int flags = 0;
+};
+Q_DECLARE_METATYPE(Frame)
+Q_DECLARE_METATYPE(QVector<Frame>)
+
+// Splits the received stream into frames on the port's reader thread and
+// hands them to the GUI in one batch per received chunk. A framer is
+// configured once; to change the settings replace it on the port.
+//
+// An RTU frame whose checksum fails is only known to have ended by the
+// silence after it, so one left pending is flushed by a timer on the GUI
+// thread once the line has been idle for the frame gap. Frames that arrive
+// with no visible gap between them are split where a checksum works out
+// at a size the function code allows. That is a heuristic: a frame whose
+// data happens to contain such a prefix is still cut in two, and one with
+// a function code of free size is cut wherever its checksum comes out.
+class Framer : public QObject, public ReceiveStage {
+  Q_OBJECT
+
+public:
+  enum Type { Slip, Cobs, Delimiter, LengthPrefix, ModbusRtu };
+
+  struct Settings {
+    Type type = Slip;
+    // Delimiter: bytes ending each frame, not part of it
+    QByteArray delimiter = "\n";
+    // LengthPrefix: the frame starts with a 1, 2 or 4 byte length, followed
+    // by that many bytes plus lengthAdjust (negative if the length counts
+    // itself, positive for a trailer such as a CRC)
+    int lengthSize = 1;
+    bool bigEndian = false;
+    int lengthAdjust = 0;
+    // ModbusRtu: see modbusCharacterNs() and modbusFrameGapNs()
+    qint64 characterNs = 0;
+    qint64 frameGapNs = 0;
+  };
+
+  explicit Framer(const Settings &settings, QObject *parent = nullptr);
+
+  void process(const QByteArray &data, qint64 timestamp) override;
+
+signals:
+  void framesReceived(QVector<Frame> frames);
+
+private slots:
+  void flushIdleFrame();
+
+private:
+  void processSlip(const QByteArray &data, qint64 timestamp);
+  void processCobs(const QByteArray &data, qint64 timestamp);
+  void processDelimiter(const QByteArray &data, qint64 timestamp);
+  void processLengthPrefix(const QByteArray &data, qint64 timestamp);
+  void processModbus(const QByteArray &data, qint64 timestamp);
+  void finishModbusFrame();
+  // add to the frame being built, ranges are shared with the chunk when
+  // they make up the whole frame
+  void append(char byte, qint64 timestamp);
+  void append(const QByteArray &data, int offset, int length,
+              qint64 timestamp);
+  void finishFrame();
+
+  Settings settings;
+  // the reader thread and the idle timer both finish frames
+  QMutex mutex;
+  QTimer *idleTimer;
+  bool idleFlushPending;
+  Frame current;
+  bool inFrame;
+  QVector<Frame> batch;
+
+  // SLIP and COBS decoder state
+  bool escaped;
+  int cobsLeft;
+  bool cobsZero;
+  // Delimiter match progress and its KMP fallback table
+  int matched;
+  QVector<int> fallback;
+  // LengthPrefix bytes still expected for the current frame, -1 while the
+  // length field is incomplete
+  qint64 remaining;
+};
+
+#endif
@@ -0,0 +1,440 @@
+#include "headless.h"
+#include "drivers/chunkpool.h"
+#include "drivers/serialportdummy.h"
+#include "drivers/serialportftdi.h"
+#include "drivers/serialportpty.h"
+#include "drivers/serialportrfc2217.h"
+#include "sendencoder.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QTimer>
+#include <csignal>
+#include <cstdio>
+
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#define TICK_INTERVAL_MS 100
+#define STDIN_CHUNK_SIZE 4096
+
+// set by SIGINT/SIGTERM and on the way out
+static QAtomicInt shouldStop;
+static QMutex stdoutMutex;
+// held by the stdin thread while it sends to the sinks; static since the
+// thread may outlive the Headless object while blocked in a read
+static QMutex sinksMutex;
+static bool sinksGone;
+
+static void onSignal(int) { shouldStop = 1; }
+
+void Headless::Sink::process(const QByteArray &data, qint64) {
+  received.fetchAndAddRelaxed(data.length());
+  if (capture) {
+    QMutexLocker locker(&mutex);
+    capture->write(Capture::Received, data);
+  }
+  if (toStdout) {
+    QMutexLocker locker(&stdoutMutex);
+    fwrite(data.constData(), 1, data.length(), stdout);
+    if (unbuffered) {
+      fflush(stdout);
+    }
+  }
+}
+
+void Headless::Sink::send(const QByteArray &data) {
+  sent.fetchAndAddRelaxed(data.length());
+  if (capture) {
+    QMutexLocker locker(&mutex);
+    capture->write(Capture::Sent, data);
+  }
+  port->write(data);
+}
+
+Headless::Headless(QObject *parent) : QObject(parent) {
+  deadline = 0;
+  stdinThread = nullptr;
+}
+
+Headless::~Headless() {
+  shouldStop = 1;
+  {
+    // the stdin thread checks this before touching the sinks again
+    QMutexLocker locker(&sinksMutex);
+    sinksGone = true;
+  }
+  for (auto sink : sinks) {
+    sink->port->removeStage(sink);
+    sink->port->close();
+    delete sink->capture;
+    fprintf(stderr, "%s: %lld bytes received, %lld bytes sent\n",
+            qPrintable(sink->port->portName()),
+            (long long)sink->received.loadAcquire(),
+            (long long)sink->sent.loadAcquire());
+    auto latency = sink->port->schedulingLatency();
+    if (latency.samples) {
+      fprintf(stderr,
+              "%s: reads late by %lld us on average, p99 %lld us, max %lld "
+              "us over %lld reads\n",
+              qPrintable(sink->port->portName()),
+              (long long)latency.meanNs / 1000,
+              (long long)latency.p99Ns / 1000,
+              (long long)latency.maxNs / 1000, (long long)latency.samples);
+    }
+    delete sink;
+  }
+  fflush(stdout);
+  if (!sinks.isEmpty()) {
+    fprintf(stderr, "receive buffers: %lld allocated, %lld reused\n",
+            (long long)ChunkPool::allocations(),
+            (long long)ChunkPool::reuses());
+  }
+  // a read from stdin cannot be interrupted portably; if it is still
+  // blocked the thread is left to die with the process
+  if (stdinThread && stdinThread->isFinished()) {
+    delete stdinThread;
+  }
+}
+
+bool Headless::requested(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (qstrcmp(argv[i], "--headless") == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int Headless::start(const QStringList &arguments) {
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Opens serial ports without a GUI and logs what they receive.");
+  parser.addHelpOption();
+  parser.addOptions({
+      {"headless", "Run without a GUI (implied by qserial-cli)."},
+      {{"l", "list"}, "List available ports and exit."},
+      {{"p", "port"},
+       "Port to open, may be repeated. host:port opens a port served over "
+       "RFC 2217.",
+       "name"},
+      {{"a", "all"}, "Open every available local port."},
+      {{"b", "baud"}, "Baud rate, 115200 by default.", "rate", "115200"},
+      {"data-bits", "5, 6, 7 or 8.", "bits", "8"},
+      {"parity", "none, even, odd, space or mark.", "parity", "none"},
+      {"stop-bits", "1, 1.5 or 2.", "bits", "1"},
+      {"flow", "none, hardware or software.", "flow", "none"},
+      {{"c", "capture"},
+       "Write a capture file, %p in the name is replaced by the port name "
+       "and is required when more than one port is open.",
+       "file"},
+      {{"o", "stdout"},
+       "Write received bytes to stdout as they arrive, interleaved if more "
+       "than one port is open. The default without --capture."},
+      {"unbuffered",
+       "Flush stdout after every received chunk instead of every "
+       "100 ms."},
+      {{"s", "send"}, "Send text once the ports are open.", "text"},
+      {"send-hex", "Send hex bytes once the ports are open.", "hex"},
+      {"stdin", "Send everything read from stdin to every open port."},
+      {{"t", "duration"}, "Exit after this many seconds.", "seconds"},
+      {"generator",
+       "What drives the far end of the loopback (pty) port: echo, prbs7, "
+       "prbs9, prbs15, prbs23, prbs31, replay:FILE or burst:BYTES:MS.",
+       "mode"},
+      {"rate", "Bytes per second for prbs and replay, unlimited by default.",
+       "bytes"},
+      {"ftdi-latency",
+       "Latency timer of FTDI ports in ms, 1 to 255. 1 unless set in the "
+       "GUI.",
+       "ms"},
+      {"ftdi-event-char",
+       "Byte in hex that FTDI ports send up as soon as it is received.",
+       "hex"},
+      {"cpu",
+       "CPU to pin each open port's reader thread to, comma-separated in "
+       "the order of --list; one CPU applies to every port.",
+       "list"},
+      {"sched",
+       "Real-time scheduling of the reader threads, fifo:PRIORITY or "
+       "rr:PRIORITY, if permitted.",
+       "policy"},
+      {"mlock", "Lock the receive buffers in memory."},
+      {"read-mode",
+       "How USB ports read: low-latency delivers every packet at once, bulk "
+       "reads large transfers and coalesces, the default.",
+       "mode"},
+  });
+  if (!parser.parse(arguments)) {
+    fprintf(stderr, "%s\n", qPrintable(parser.errorText()));
+    return 1;
+  }
+  if (parser.isSet("help")) {
+    printf("%s", qPrintable(parser.helpText()));
+    return 0;
+  }
+
+  auto available = SerialPort::getAvailablePorts(this);
+  if (parser.isSet("list")) {
+    for (auto port : available) {
+      printf("%s\n", qPrintable(port->portName()));
+    }
+    return 0;
+  }
+
+  QStringList names = parser.values("port");
+  for (auto port : available) {
+    bool local = !qobject_cast<SerialPortDummy *>(port) &&
+                 !qobject_cast<SerialPortRfc2217 *>(port);
+#ifdef Q_OS_LINUX
+    local = local && !qobject_cast<SerialPortPty *>(port);
+#endif
+    bool wanted = parser.isSet("all") ? local
+                                      : names.removeAll(port->portName()) > 0;
+    if (wanted) {
+      ports.append(port);
+    }
+  }
+  for (auto &name : QStringList(names)) {
+    auto port = SerialPortRfc2217::fromAddress(name, this);
+    if (port) {
+      ports.append(port);
+      names.removeAll(name);
+    }
+  }
+  if (!names.isEmpty()) {
+    fprintf(stderr, "No such port: %s\n", qPrintable(names.join(", ")));
+    return 1;
+  }
+  if (ports.isEmpty()) {
+    fprintf(stderr, "No port given, see --list, --port and --all\n");
+    return 1;
+  }
+
+  if (parser.isSet("generator") || parser.isSet("rate")) {
+    PtyGenerator generator = PtyGenerator::load();
+    QStringList mode = parser.value("generator").split(':');
+    generator.rate = parser.value("rate").toLongLong();
+    if (mode[0] == "echo") {
+      generator.mode = PtyGenerator::Echo;
+    } else if (mode[0].startsWith("prbs")) {
+      generator.mode = PtyGenerator::Prbs;
+      generator.prbsOrder = mode[0].mid(4).toInt();
+    } else if (mode[0] == "replay" && mode.size() >= 2) {
+      generator.mode = PtyGenerator::Replay;
+      // the file name may contain colons itself
+      generator.replayFile = mode.mid(1).join(':');
+    } else if (mode[0] == "burst" && mode.size() == 3) {
+      generator.mode = PtyGenerator::Burst;
+      generator.burstSize = qMax(1, mode[1].toInt());
+      generator.burstIntervalMs = qMax(1, mode[2].toInt());
+    } else if (parser.isSet("generator")) {
+      fprintf(stderr, "Invalid generator: %s\n",
+              qPrintable(parser.value("generator")));
+      return 1;
+    }
+#ifdef Q_OS_LINUX
+    for (auto port : ports) {
+      auto pty = qobject_cast<SerialPortPty *>(port);
+      if (pty) {
+        pty->setGenerator(generator);
+      }
+    }
+#endif
+  }
+
+  for (auto port : ports) {
+    auto ftdi = qobject_cast<SerialPortFTDI *>(port);
+    if (!ftdi) {
+      continue;
+    }
+    if (parser.isSet("ftdi-latency")) {
+      ftdi->setLatencyTimer(parser.value("ftdi-latency").toInt());
+    }
+    if (parser.isSet("ftdi-event-char")) {
+      ftdi->setEventCharacter(
+          parser.value("ftdi-event-char").toInt(nullptr, 16));
+    }
+  }
+
+  // the GUI's settings unless given here
+  QStringList cpus;
+  if (parser.isSet("cpu")) {
+    cpus = parser.value("cpu").split(',');
+  }
+  QStringList sched = parser.value("sched").split(':');
+  static const QStringList policies = {"", "fifo", "rr"};
+  int policy = policies.indexOf(sched[0]);
+  if (parser.isSet("sched") && (policy <= 0 || sched.size() != 2)) {
+    fprintf(stderr, "Unknown scheduling %s\n",
+            qPrintable(parser.value("sched")));
+    return 1;
+  }
+  static const QStringList readModes = {"low-latency", "bulk"};
+  int readMode = readModes.indexOf(parser.value("read-mode"));
+  if (parser.isSet("read-mode") && readMode < 0) {
+    fprintf(stderr, "Unknown read mode %s\n",
+            qPrintable(parser.value("read-mode")));
+    return 1;
+  }
+  for (int i = 0; i < ports.size(); i++) {
+    auto tuning = ReaderTuning::load(ports[i]->portName());
+    if (!cpus.isEmpty()) {
+      tuning.cpu = cpus[qMin(i, cpus.size() - 1)].toInt();
+    }
+    if (parser.isSet("sched")) {
+      tuning.policy = (ReaderTuning::Policy)policy;
+      tuning.priority = sched[1].toInt();
+    }
+    if (parser.isSet("mlock")) {
+      tuning.lockMemory = true;
+    }
+    if (readMode >= 0) {
+      tuning.readMode = (ReaderTuning::ReadMode)readMode;
+    }
+    ports[i]->setReaderTuning(tuning);
+  }
+
+  static const QStringList parities = {"none", "even", "odd", "space", "mark"};
+  static const QSerialPort::Parity parityValues[] = {
+      QSerialPort::NoParity, QSerialPort::EvenParity, QSerialPort::OddParity,
+      QSerialPort::SpaceParity, QSerialPort::MarkParity};
+  static const QStringList stopBits = {"1", "2", "1.5"};
+  static const QStringList flows = {"none", "hardware", "software"};
+  int parity = parities.indexOf(parser.value("parity"));
+  int stop = stopBits.indexOf(parser.value("stop-bits"));
+  int flow = flows.indexOf(parser.value("flow"));
+  int baud = parser.value("baud").toInt();
+  int dataBits = parser.value("data-bits").toInt();
+  if (parity < 0 || stop < 0 || flow < 0 || baud <= 0 || dataBits < 5 ||
+      dataBits > 8) {
+    fprintf(stderr, "Invalid serial settings\n");
+    return 1;
+  }
+  // parsed like the send box, a typo must not send different bytes
+  QByteArray sendHex;
+  qint64 offset = SendEncoder::decode(parser.value("send-hex"),
+                                      SendEncoder::Hex, &sendHex);
+  if (offset >= 0) {
+    fprintf(stderr, "Invalid --send-hex at offset %lld\n", offset);
+    return 1;
+  }
+
+  QString capture = parser.value("capture");
+  if (!capture.isEmpty() && ports.size() > 1 && !capture.contains("%p")) {
+    fprintf(stderr, "--capture needs %%p with more than one port\n");
+    return 1;
+  }
+  bool toStdout = parser.isSet("stdout") || capture.isEmpty();
+  if (toStdout) {
+#ifdef Q_OS_WIN
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+  }
+
+  for (auto port : ports) {
+    if (!port->open()) {
+      fprintf(stderr, "Failed to open %s\n", qPrintable(port->portName()));
+      // with --all the same device may be listed by more than one driver
+      if (parser.isSet("all")) {
+        continue;
+      }
+      return 1;
+    }
+    port->setBaudRate(baud);
+    port->setDataBits((QSerialPort::DataBits)dataBits);
+    port->setParity(parityValues[parity]);
+    port->setStopBits((QSerialPort::StopBits)(stop + 1));
+    port->setFlowControl((QSerialPort::FlowControl)flow);
+
+    auto sink = new Sink;
+    sink->port = port;
+    sink->toStdout = toStdout;
+    sink->unbuffered = parser.isSet("unbuffered");
+    sinks.append(sink);
+    if (!capture.isEmpty()) {
+      QString name = port->portName();
+      name.replace('/', '_').replace('\\', '_');
+      QString fileName = QString(capture).replace("%p", name);
+      sink->capture = new CaptureWriter();
+      if (!sink->capture->open(fileName)) {
+        fprintf(stderr, "%s: %s\n", qPrintable(fileName),
+                qPrintable(sink->capture->errorString()));
+        return 1;
+      }
+    }
+    port->addStage(sink);
+    connect(port, SIGNAL(errorOccurred(QString)), this,
+            SLOT(onPortError(QString)));
+  }
+
+  if (sinks.isEmpty()) {
+    return 1;
+  }
+
+  QByteArray data = parser.value("send").toUtf8();
+  data += sendHex;
+  if (!data.isEmpty()) {
+    for (auto sink : sinks) {
+      sink->send(data);
+    }
+  }
+  if (parser.isSet("stdin")) {
+    stdinThread = QThread::create([this] { readStdin(); });
+    stdinThread->start();
+  }
+
+  if (parser.isSet("duration")) {
+    deadline = QDateTime::currentMSecsSinceEpoch() +
+               (qint64)(parser.value("duration").toDouble() * 1000);
+  }
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  auto timer = new QTimer(this);
+  connect(timer, SIGNAL(timeout()), this, SLOT(onTick()));
+  timer->start(TICK_INTERVAL_MS);
+  return -1;
+}
+
+void Headless::readStdin() {
+  QFile input;
+  if (!input.open(stdin, QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+    return;
+  }
+  char buffer[STDIN_CHUNK_SIZE];
+  forever {
+    qint64 length = input.read(buffer, sizeof(buffer));
+    if (length <= 0 || shouldStop) {
+      break;
+    }
+    QByteArray data(buffer, length);
+    QMutexLocker locker(&sinksMutex);
+    if (sinksGone) {
+      break;
+    }
+    for (auto sink : sinks) {
+      sink->send(data);
+    }
+  }
+}
+
+void Headless::onPortError(QString message) {
+  // the other ports keep going, --duration or a signal still ends the run
+  auto port = qobject_cast<SerialPort *>(sender());
+  fprintf(stderr, "%s: %s\n", qPrintable(port->portName()),
+          qPrintable(message));
+}
+
+void Headless::onTick() {
+  {
+    QMutexLocker locker(&stdoutMutex);
+    fflush(stdout);
+  }
+  if (shouldStop ||
+      (deadline && QDateTime::currentMSecsSinceEpoch() >= deadline)) {
+    QCoreApplication::quit();
+  }
+}
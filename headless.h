@@ -0,0 +1,54 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "capture.h"
+#include "drivers/serialport.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+
+// Command line mode without any widgets: opens ports, logs what they
+// receive to capture files and/or stdout straight from the reader threads,
+// and optionally sends data given on the command line or read from stdin.
+class Headless : public QObject {
+  Q_OBJECT
+
+public:
+  explicit Headless(QObject *parent = nullptr);
+  ~Headless();
+
+  // whether the GUI binary was asked to run headless
+  static bool requested(int argc, char *argv[]);
+  // parses the arguments and opens the ports, returns the exit code if the
+  // program should end right away or -1 to run the event loop
+  int start(const QStringList &arguments);
+
+private slots:
+  void onTick();
+  void onPortError(QString message);
+
+private:
+  // per open port, runs on its reader thread
+  struct Sink : public ReceiveStage {
+    SerialPort *port = nullptr;
+    CaptureWriter *capture = nullptr;
+    bool toStdout = false;
+    bool unbuffered = false; // flush stdout after every chunk
+    QMutex mutex; // capture is also written by senders
+    QAtomicInteger<qint64> received;
+    QAtomicInteger<qint64> sent;
+
+    void process(const QByteArray &data, qint64 timestamp) override;
+    void send(const QByteArray &data);
+  };
+
+  void readStdin();
+
+  QList<SerialPort *> ports;
+  QList<Sink *> sinks;
+  qint64 deadline; // ms since epoch, 0 for none
+  QThread *stdinThread;
+};
+
+#endif
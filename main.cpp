@@ -1,6 +1,10 @@
 #include "drivers/libusb.h"
+#include "headless.h"
+#include <QCoreApplication>
+#ifndef QSERIAL_HEADLESS
 #include "mainwindow.h"
 #include <QApplication>
+#endif
 
 libusb_context *context = nullptr;
 
@@ -13,10 +17,22 @@ int main(int argc, char *argv[]) {
   QCoreApplication::setOrganizationDomain("tuna.tsinghua.edu.cn");
   QCoreApplication::setApplicationName("QSerial");
 
-  QApplication app(argc, argv);
+#ifndef QSERIAL_HEADLESS
+  if (!Headless::requested(argc, argv)) {
+    QApplication app(argc, argv);
 
-  MainWindow mw;
-  mw.show();
+    MainWindow mw;
+    mw.show();
 
+    return app.exec();
+  }
+#endif
+
+  QCoreApplication app(argc, argv);
+  Headless headless;
+  int code = headless.start(app.arguments());
+  if (code >= 0) {
+    return code;
+  }
   return app.exec();
 }
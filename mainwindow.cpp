@@ -1,14 +1,32 @@
 #include "mainwindow.h"
 #include "drivers/libusb.h"
+#include "drivers/serialportdummy.h"
+#include "drivers/serialportftdi.h"
+#include "drivers/serialportpty.h"
+#include "drivers/serialportrfc2217.h"
+#include "modbus.h"
+#include "filesenddialog.h"
+#include "filetransferdialog.h"
 #include "mutualtest.h"
+#include "replaydialog.h"
+#include "sendschedulerdialog.h"
+#include "triggerdialog.h"
+#include "autoresponderdialog.h"
+#include "portsharedialog.h"
+#include "ptygeneratordialog.h"
+#include "readertuningdialog.h"
 #include <QDateTime>
 #include <QDebug>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QInputDialog>
 #include <QScrollBar>
 #include <QSerialPortInfo>
 #include <QTextCodec>
 #include <QTimer>
 #include <QWebChannel>
 #include <QMessageBox>
+#include <algorithm>
 
 #define INDEX_LINE_LF 0
 #define INDEX_LINE_CRLF 1
@@ -29,6 +47,29 @@
 #define INDEX_RECV_SHIFTJIS 3
 #define INDEX_RECV_HEX 4
 
+#define INDEX_FRAMER_NONE 0
+#define INDEX_FRAMER_DELIMITER 3
+#define INDEX_FRAMER_LENGTH 4
+#define INDEX_FRAMER_MODBUS 5
+
+#define INDEX_PLOT_SPAN_ALL 4
+
+#define SESSION_RENDER_INTERVAL_MS 33
+// how often data queued by the reader thread is shown, and how much may
+// pile up if the GUI falls behind before newer data is dropped
+#define RECEIVE_DRAIN_INTERVAL_MS 20
+#define MAX_PENDING_RECEIVED (64 * 1024 * 1024)
+
+// samples kept per plotted series
+#define PLOT_CAPACITY (1 << 20)
+
+// longest send echoed verbatim to the display
+#define ECHO_LIMIT 4096
+
+// received bytes kept for searching, older data is in the capture file;
+// trimmed to three quarters so the search index is not rebuilt per chunk
+#define MAX_SCROLLBACK (16 * 1024 * 1024)
+
 void JsInterface::sendBytes(const QJsonArray& dat) const {
   QJsonArray::const_iterator itrArray = dat.begin();
   QByteArray aryBytes;
@@ -46,15 +87,58 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
   serialPortComboBox->clear();
   for (auto port : ports) {
     serialPortComboBox->addItem(port->portName());
-    connect(port, SIGNAL(receivedData(QByteArray)), this,
-            SLOT(onDataReceived(QByteArray)));
-    connect(port, SIGNAL(breakChanged(bool)), this, SLOT(onBreakChanged(bool)));
+    sessionPortComboBox->addItem(port->portName());
+    port->setReaderTuning(ReaderTuning::load(port->portName()));
   }
 
+  isOpened = false;
+  openingPort = nullptr;
+  pendingReceivedBytes = 0;
+  droppedReceived = 0;
+  framer = nullptr;
+  framerPort = nullptr;
+  frameModel = new FrameModel(this);
+  frameTableView->setModel(frameModel);
+  frameTableView->verticalHeader()->hide();
+  frameTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+  frameTableView->horizontalHeader()->setStretchLastSection(true);
+
+  triggerEngine = nullptr;
+  triggerPort = nullptr;
+  nextTriggerId = 0;
+  displayPaused = false;
+  highlighter = new TriggerHighlighter(textBrowser->document());
+  loadTriggers();
+  responder = nullptr;
+  responderPort = nullptr;
+  loadResponseRules();
+
+  plotStore = new PlotStore(PLOT_CAPACITY);
+  plotParser = new PlotParser(plotStore, this);
+  plotPort = nullptr;
+  portServer = nullptr;
+  portServerPort = nullptr;
+  rfc2217Server = nullptr;
+  rfc2217ServerPort = nullptr;
+#ifndef Q_OS_LINUX
+  // the loopback port needs Linux ptys
+  actionLoopbackGenerator->setVisible(false);
+#endif
+  plotWidget->setStore(plotStore);
+
+  // one tick renders every session
+  auto sessionTimer = new QTimer(this);
+  connect(sessionTimer, SIGNAL(timeout()), this, SLOT(onRenderSessions()));
+  sessionTimer->start(SESSION_RENDER_INTERVAL_MS);
+
   loadSettings();
 
   bytesRecv = 0;
   bytesSent = 0;
+  // received data is queued from the reader thread and shown in batches
+  auto receiveTimer = new QTimer(this);
+  connect(receiveTimer, SIGNAL(timeout()), this, SLOT(onDrainReceived()));
+  receiveTimer->start(RECEIVE_DRAIN_INTERVAL_MS);
 
   timer = new QTimer(this);
   connect(timer, SIGNAL(timeout()), this, SLOT(onIdle()));
@@ -78,19 +162,43 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
   playIcon = QIcon(":/resources/play.svg");
   stopIcon = QIcon(":/resources/stop.svg");
-  isOpened = false;
   refreshOpenStatus();
+
+  replayEngine = new ReplayEngine(this);
+  connect(replayEngine, SIGNAL(replayedData(QByteArray)), this,
+          SLOT(onDataReceived(QByteArray)));
+
+  searchDialog = new SearchDialog(&scrollback, this);
+  connect(searchDialog, SIGNAL(jumpTo(qint64, QByteArray)), this,
+          SLOT(onJumpTo(qint64, QByteArray)));
+
+  fileSender = new FileSender(this);
+  fileBytesCounted = 0;
+  connect(fileSender, SIGNAL(progress(qint64, qint64, double)), this,
+          SLOT(onFileSendProgress(qint64, qint64, double)));
+  fileTransfer = new FileTransfer(this);
+  connect(fileTransfer, SIGNAL(progress(qint64, qint64, double)), this,
+          SLOT(onFileSendProgress(qint64, qint64, double)));
+  sendEncoder = new SendEncoder(this);
+  connect(sendEncoder, SIGNAL(accepted(QString)), this,
+          SLOT(onSendAccepted(QString)));
+  connect(sendEncoder, SIGNAL(failed(qint64, QString)), this,
+          SLOT(onSendFailed(qint64, QString)));
+  connect(sendEncoder, SIGNAL(sent(QByteArray)), this,
+          SLOT(onEncodedSent(QByteArray)));
+  sendScheduler = new SendScheduler(this);
+  connect(sendScheduler, SIGNAL(statisticsUpdated(SchedulerStatistics)), this,
+          SLOT(onScheduledProgress(SchedulerStatistics)));
+  connect(sendScheduler, SIGNAL(finished(SchedulerStatistics)), this,
+          SLOT(onScheduledProgress(SchedulerStatistics)));
 }
 
-inline int fromHex(char ch) {
-  if ('0' <= ch && ch <= '9') {
-    return ch - '0';
-  } else if ('a' <= ch && ch <= 'f') {
-    return ch - 'a' + 10;
-  } else if ('A' <= ch && ch <= 'F') {
-    return ch - 'A' + 10;
-  } else {
-    return -1;
+MainWindow::~MainWindow() {
+  onCloseAllSessions();
+  onClose();
+  // back on this thread, to be deleted along with the window
+  for (auto port : ports) {
+    port->stopWorker();
   }
 }
 
@@ -132,17 +240,41 @@ void MainWindow::refreshStatistics() {
           .arg(toHumanRate(txspeed))
           .arg(bytesRecv)
           .arg(toHumanRate(rxspeed));
+  PortStatus status = PortStatus();
+  if (isOpened) {
+    auto serialPort = ports[serialPortComboBox->currentIndex()];
+    status = serialPort->status();
+    // counted on the port's thread, shown on the next refresh
+    serialPort->refreshStatusAsync();
+  }
+  if (status.hasLineErrors) {
+    // the driver counts since it was loaded, show what happened while open
+    const LineErrors &errors = status.lineErrors;
+    txt += QString("  Errors: F%1 O%2 P%3 B%4")
+               .arg(errors.framing - openLineErrors.framing)
+               .arg(errors.overrun + errors.bufferOverrun -
+                    openLineErrors.overrun - openLineErrors.bufferOverrun)
+               .arg(errors.parity - openLineErrors.parity)
+               .arg(errors.breaks - openLineErrors.breaks);
+  }
+  if (status.latency.samples) {
+    // how late the reader thread got to reads that were due
+    txt += QString("  Late: p99 %1 us, max %2 us")
+               .arg(status.latency.p99Ns / 1000)
+               .arg(status.latency.maxNs / 1000);
+  }
   statisticsLabel->setText(txt);
 }
 
 void MainWindow::sendBytes(const QByteArray& data) {
   auto serialPort = ports[serialPortComboBox->currentIndex()];
 
-  if (!serialPort->isOpen()) {
+  if (!isOpened) {
     return;
   }
 
-  serialPort->sendData(data);
+  serialPort->write(data);
+  capture.write(Capture::Sent, data);
 
   bytesSent += data.length();
   qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
@@ -150,99 +282,27 @@ void MainWindow::sendBytes(const QByteArray& data) {
 }
 
 void MainWindow::onSend() {
-  onOpen();
-
-  auto text = inputPlainTextEdit->toPlainText();
-  auto codec = QTextCodec::codecForName("UTF-8");
-  auto textData = codec->fromUnicode(text);
-  QByteArray data;
-  bool isFirst;
-  int currentByte;
-  switch (sendParseAsComboBox->currentIndex()) {
-  case INDEX_SEND_UTF8:
-    // text utf-8
-    data = textData;
-    break;
-  case INDEX_SEND_BIG5:
-    // text big5
-    codec = QTextCodec::codecForName("Big5");
-    data = codec->fromUnicode(text);
-    break;
-  case INDEX_SEND_GB18030:
-    // text gb18030
-    codec = QTextCodec::codecForName("GB18030");
-    data = codec->fromUnicode(text);
-    break;
-  case INDEX_SEND_SHIFTJIS:
-    // text shift-jis
-    codec = QTextCodec::codecForName("Shift-JIS");
-    data = codec->fromUnicode(text);
-    break;
-  case INDEX_SEND_HEX:
-    // hex
-    isFirst = true;
-    currentByte = 0;
-    for (auto ch : textData) {
-      if (ch == ' ' || ch == '\r' || ch == '\n') {
-        continue;
-      }
-      if (ch == 'x' || ch == 'X') {
-        if (isFirst == false && currentByte == 0) {
-          // 0x
-          isFirst = true;
-          continue;
-        } else {
-          // fail
-          break;
-        }
-      }
-      int cur = fromHex(ch);
-      if (cur == -1) {
-        statusBar()->showMessage("Invalid hex");
-        return;
-      }
-      if (isFirst) {
-        currentByte = cur;
-        isFirst = false;
-      } else {
-        currentByte = (currentByte << 4) + cur;
-        data.append(currentByte);
-        isFirst = true;
-      }
-    }
-    if (!isFirst) {
-      statusBar()->showMessage("Invalid hex");
-      return;
-    }
-    break;
-  case INDEX_SEND_BASE64:
-    // base64
-    data = QByteArray::fromBase64(textData);
-    break;
-  case INDEX_SEND_PERCENT:
-    // percent encoding
-    data = QByteArray::fromPercentEncoding(textData);
-    break;
-  default:
-    // never happens
-    break;
+  if (!openThen([this] { onSend(); })) {
+    return;
   }
 
+  auto serialPort = ports[serialPortComboBox->currentIndex()];
+  auto text = inputPlainTextEdit->toPlainText();
+  QByteArray suffix;
   if (sendParseAsComboBox->currentIndex() != INDEX_SEND_HEX) {
     // no line ending in hex mode
     switch (lineEndingComboBox->currentIndex()) {
     case INDEX_LINE_LF:
       // lf
-      data.append('\n');
+      suffix = "\n";
       break;
     case INDEX_LINE_CRLF:
       // cr lf
-      data.append('\r');
-      data.append('\n');
+      suffix = "\r\n";
       break;
     case INDEX_LINE_CR:
       // cr
-      data.append('\r');
+      suffix = "\r";
       break;
     default:
       // none
@@ -250,20 +310,52 @@ void MainWindow::onSend() {
     }
   }
 
+  QString echo;
   if (echoCheckBox->isChecked()) {
+    echo = text;
+    if (echo.length() > ECHO_LIMIT) {
+      // a pasted dump would take the display down with it
+      echo = QString("%1... (%2 characters)")
+                 .arg(echo.left(ECHO_LIMIT), QString::number(text.length()));
+    }
     if (sendShowTimeCheckBox->isChecked()) {
-      text = QString("[%1] %2")
+      echo = QString("[%1] %2")
                  .arg(QDateTime::currentDateTime().toString(Qt::ISODate))
-                 .arg(text);
+                 .arg(echo);
     }
-    appendText(text, Qt::green);
   }
 
-  sendBytes(data);
+  // parsing happens on the encoder thread, see onSendAccepted/onSendFailed
+  sendEncoder->send(serialPort, text,
+                    (SendEncoder::Format)sendParseAsComboBox->currentIndex(),
+                    suffix, echo);
 
   inputPlainTextEdit->setFocus();
 }
 
+void MainWindow::onSendAccepted(QString echo) {
+  if (!echo.isEmpty()) {
+    appendText(echo, Qt::green);
+  }
+}
+
+void MainWindow::onSendFailed(qint64 offset, QString message) {
+  statusBar()->showMessage(message);
+  // point at the offending character
+  auto cursor = inputPlainTextEdit->textCursor();
+  cursor.setPosition(qMin<qint64>(offset, inputPlainTextEdit->document()
+                                              ->characterCount() - 1));
+  cursor.movePosition(QTextCursor::NextCharacter, QTextCursor::KeepAnchor);
+  inputPlainTextEdit->setTextCursor(cursor);
+}
+
+void MainWindow::onEncodedSent(QByteArray data) {
+  capture.write(Capture::Sent, data);
+  bytesSent += data.length();
+  qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
+  sentRecord.push_back(QPair<quint64, qint64>(data.length(), currentTime));
+}
+
 inline char toHex(int value) {
   if (0 <= value && value <= 9) {
     return '0' + value;
@@ -274,10 +366,93 @@ inline char toHex(int value) {
   }
 }
 
+void MainWindow::process(const QByteArray &data, qint64 timestamp) {
+  QMutexLocker locker(&receivedMutex);
+  if (pendingReceivedBytes + data.length() > MAX_PENDING_RECEIVED) {
+    droppedReceived += data.length();
+    return;
+  }
+  pendingReceivedBytes += data.length();
+  pendingReceived.append(qMakePair(data, timestamp));
+}
+
+void MainWindow::onDrainReceived() {
+  QList<QPair<QByteArray, qint64>> chunks;
+  qint64 dropped;
+  {
+    QMutexLocker locker(&receivedMutex);
+    chunks.swap(pendingReceived);
+    pendingReceivedBytes = 0;
+    dropped = droppedReceived;
+    droppedReceived = 0;
+  }
+  if (dropped) {
+    statusBar()->showMessage(
+        tr("Display fell behind, %1 bytes dropped").arg(dropped));
+  }
+  if (chunks.isEmpty()) {
+    return;
+  }
+  // accounted chunk by chunk, drawn once
+  QByteArray batch;
+  for (auto &chunk : chunks) {
+    recordReceived(chunk.first, chunk.second);
+  }
+  if (chunks.size() == 1) {
+    batch = chunks.first().first;
+  } else {
+    int length = 0;
+    for (auto &chunk : chunks) {
+      length += chunk.first.length();
+    }
+    batch.reserve(length);
+    for (auto &chunk : chunks) {
+      batch.append(chunk.first);
+    }
+  }
+  showReceived(batch);
+}
+
 void MainWindow::onDataReceived(QByteArray data) {
+  recordReceived(data);
+  showReceived(data);
+}
+
+void MainWindow::recordReceived(const QByteArray &data, qint64 arrival) {
   bytesRecv += data.length();
-  qint64 currentTime = QDateTime::currentMSecsSinceEpoch();
-  recvRecord.push_back(QPair<quint64, qint64>(data.length(), currentTime));
+  // stamped when it arrived, not when the drain tick got to it
+  qint64 age = arrival < 0 ? 0 : qMax<qint64>(0, SerialPort::now() - arrival);
+  qint64 arrivalTime = QDateTime::currentMSecsSinceEpoch() - age / 1000000;
+  recvRecord.push_back(QPair<quint64, qint64>(data.length(), arrivalTime));
+  if (capture.isOpen()) {
+    capture.write(Capture::Received, data,
+                  qMax<qint64>(0, capture.elapsed() - age));
+  }
+  scrollback.append(data);
+  if (scrollback.length() > MAX_SCROLLBACK) {
+    qint64 removed = scrollback.length() - MAX_SCROLLBACK * 3 / 4;
+    scrollback.remove(0, removed);
+    // keep the chunk the new start falls in, at offset 0
+    int gone = 0;
+    for (auto &entry : shownOffsets) {
+      entry.first -= removed;
+      if (entry.first <= 0) {
+        gone++;
+      }
+    }
+    if (gone > 0) {
+      shownOffsets.remove(0, gone - 1);
+      shownOffsets.first().first = 0;
+    }
+    // offsets moved, the index no longer matches
+    searchDialog->resetScrollback();
+  }
+}
+
+void MainWindow::showReceived(const QByteArray &data) {
+  if (displayPaused) {
+    return;
+  }
 
   QString text;
   QTextCodec *codec;
@@ -304,6 +479,7 @@ void MainWindow::onDataReceived(QByteArray data) {
     break;
   case INDEX_RECV_HEX:
     // hex
+    text.reserve(data.length() * 3);
     for (auto byte : data) {
       text += toHex((byte & 0xF0) >> 4);
       text += toHex(byte & 0x0F);
@@ -314,19 +490,33 @@ void MainWindow::onDataReceived(QByteArray data) {
     // never happens
     break;
   }
+  // data was appended to the scrollback just before
+  shownOffsets.append(
+      qMakePair(qMax<qint64>(0, scrollback.length() - data.length()),
+                textBrowser->document()->characterCount() - 1));
   appendText(text, Qt::red);
 }
 
 void MainWindow::appendText(QString text, QColor color) {
-  QString arr;
-  const ushort *s = text.utf16();
-  while (*s != 0) {
-    arr += QString("%1").arg(*s);
-    arr += ',';
-    s++;
+  // built in one allocation, a temporary per character adds up at speed
+  QString js;
+  js.reserve(text.length() * 6 + 32);
+  js += QLatin1String("term.write(String.fromCharCode(");
+  for (int i = 0; i < text.length(); i++) {
+    char digits[8];
+    int n = 0;
+    ushort value = text[i].unicode();
+    do {
+      digits[sizeof(digits) - 1 - n++] = '0' + value % 10;
+      value /= 10;
+    } while (value);
+    if (i) {
+      js += QLatin1Char(',');
+    }
+    js += QLatin1String(digits + sizeof(digits) - n, n);
   }
+  js += QLatin1String("));");
   fitTerminal();
-  QString js = QString("term.write(String.fromCharCode(") + arr + QString("));");
   webEngineView->page()->runJavaScript(js);
 
   if (recvShowTimeCheckBox->isChecked()) {
@@ -388,50 +578,112 @@ void MainWindow::refreshOpenStatus() {
 
 void MainWindow::onOpen() {
   auto serialPort = ports[serialPortComboBox->currentIndex()];
-  if (!isOpened) {
-    if (serialPort->open()) {
-      isOpened = true;
-      serialPort->setBaudRate(baudRateComboBox->currentText().toInt());
-      serialPort->setDataBits(
-          (QSerialPort::DataBits)dataBitsComboBox->currentText().toInt());
-      QSerialPort::Parity parity[] = {
-          QSerialPort::NoParity, QSerialPort::EvenParity,
-          QSerialPort::OddParity, QSerialPort::SpaceParity,
-          QSerialPort::MarkParity};
-      QString parityName[] = {"U", "N", "E", "O", "S", "M"};
-      serialPort->setParity(parity[parityComboBox->currentIndex()]);
-      serialPort->setStopBits(
-          (QSerialPort::StopBits)(stopBitsComboBox->currentIndex() + 1));
-      serialPort->setFlowControl(
-          (QSerialPort::FlowControl)flowControlComboBox->currentIndex());
-
-      statusBar()->showMessage(tr("%1 %2-%3%4%5-%6 Open")
-                                   .arg(serialPort->portName())
-                                   .arg(serialPort->getBaudRate())
-                                   .arg(dataBitsComboBox->currentText())
-                                   .arg(parityName[serialPort->getParity() + 1]) // getParity() may return -1
-                                   .arg(stopBitsComboBox->currentText())
-                                   .arg(flowControlComboBox->currentText()));
-      refreshOpenStatus();
-      saveSettings();
-
-      // set focus to corresponding widget upon connection
-      onTabPageChanged(tabWidget->currentIndex());
-    } else {
-      statusBar()->showMessage("Failed");
+  if (!isOpened && !openingPort) {
+    if (sessionFor(serialPort)) {
+      statusBar()->showMessage(
+          tr("%1 is open in a session").arg(serialPort->portName()));
+      return;
     }
+    // opened on the port's worker thread, the window keeps drawing and
+    // onOpened() picks up the outcome, see openThen() for the callers
+    // that send right after opening
+    openingPort = serialPort;
+    openCloseButton->setEnabled(false);
+    serialPortComboBox->setEnabled(false);
+    statusBar()->showMessage(tr("Opening %1...").arg(serialPort->portName()));
+    connect(serialPort, SIGNAL(opened(bool)), this, SLOT(onOpened(bool)));
+    serialPort->openAsync(portSettings());
   }
 }
 
+void MainWindow::onOpened(bool ok) {
+  auto serialPort = openingPort;
+  disconnect(serialPort, SIGNAL(opened(bool)), this, SLOT(onOpened(bool)));
+  openingPort = nullptr;
+  openCloseButton->setEnabled(true);
+  auto action = afterOpen;
+  afterOpen = nullptr;
+
+  if (ok) {
+    isOpened = true;
+    auto status = serialPort->status();
+    openLineErrors = status.lineErrors;
+    // straight from the reader thread, drawn on the next drain tick
+    serialPort->addStage(this);
+    connect(serialPort, SIGNAL(breakChanged(bool)), this,
+            SLOT(onBreakChanged(bool)));
+    connect(serialPort, SIGNAL(errorOccurred(QString)), this,
+            SLOT(onPortError(QString)));
+
+    statusBar()->showMessage(
+        tr("%1 Open").arg(
+            portDescription(serialPort->portName(), status.settings)));
+    refreshOpenStatus();
+    saveSettings();
+    attachFramer(serialPort);
+    attachTriggers(serialPort);
+    attachResponder(serialPort);
+    attachPlot(serialPort);
+
+    // set focus to corresponding widget upon connection
+    onTabPageChanged(tabWidget->currentIndex());
+  } else {
+    statusBar()->showMessage("Failed");
+    refreshOpenStatus();
+  }
+
+  if (ok && action) {
+    action();
+  }
+}
+
+bool MainWindow::openThen(std::function<void()> action) {
+  if (isOpened) {
+    return true;
+  }
+  if (!openingPort) {
+    afterOpen = action;
+    onOpen();
+    if (!openingPort) {
+      afterOpen = nullptr;
+    }
+  }
+  return false;
+}
+
 void MainWindow::onClose() {
   auto serialPort = ports[serialPortComboBox->currentIndex()];
   if (isOpened) {
     isOpened = false;
-    serialPort->close();
+    sendEncoder->cancel();
+    detachFramer();
+    detachTriggers();
+    detachResponder();
+    detachPlot();
+    onStopSharing();
+    // stops the server through onServeRfc2217()
+    actionServeRfc2217->setChecked(false);
+    serialPort->removeStage(this);
+    disconnect(serialPort, SIGNAL(breakChanged(bool)), this,
+               SLOT(onBreakChanged(bool)));
+    disconnect(serialPort, SIGNAL(errorOccurred(QString)), this,
+               SLOT(onPortError(QString)));
+    serialPort->closeAsync();
     refreshOpenStatus();
   }
 }
 
+void MainWindow::onPortError(QString message) {
+  // the reader has stopped, close so the port shows as it is and can be
+  // opened again once the device is back
+  auto serialPort = ports[serialPortComboBox->currentIndex()];
+  if (isOpened && sender() == serialPort) {
+    onClose();
+    statusBar()->showMessage(
+        tr("%1 closed: %2").arg(serialPort->portName(), message));
+  }
+}
+
 void MainWindow::onToggleOpen() {
   if (isOpened) {
     onClose();
@@ -443,7 +695,7 @@ void MainWindow::onToggleOpen() {
 void MainWindow::onBreak() {
   auto serialPort = ports[serialPortComboBox->currentIndex()];
   uint time = breakDurationLineEdit->text().toInt();
-  serialPort->triggerBreak(time);
+  serialPort->breakAsync(time);
 }
 
 void MainWindow::onBreakChanged(bool set) {
@@ -455,6 +707,9 @@ void MainWindow::onBreakChanged(bool set) {
 }
 
 void MainWindow::onClear() {
+  scrollback.clear();
+  shownOffsets.clear();
+  searchDialog->resetScrollback();
   textBrowser->setPlainText("");
   webEngineView->page()->runJavaScript(QString("if (term) term.clear();"));
 }
@@ -464,6 +719,109 @@ void MainWindow::onMutualTest() {
   test.exec();
 }
 
+void MainWindow::onStartCapture() {
+  auto fileName = QFileDialog::getSaveFileName(
+      this, "Save Capture", settings.value("captureFile").toString(),
+      "QSerial Capture (*.qscap);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+  if (!capture.open(fileName)) {
+    statusBar()->showMessage(capture.errorString());
+    return;
+  }
+  settings.setValue("captureFile", fileName);
+  actionStartCapture->setEnabled(false);
+  actionStopCapture->setEnabled(true);
+  statusBar()->showMessage(QString("Capturing to %1").arg(fileName));
+}
+
+void MainWindow::onStopCapture() {
+  capture.close();
+  actionStartCapture->setEnabled(true);
+  actionStopCapture->setEnabled(false);
+  statusBar()->showMessage("Capture stopped");
+}
+
+void MainWindow::onFind() {
+  searchDialog->show();
+  searchDialog->raise();
+  searchDialog->activateWindow();
+}
+
+void MainWindow::onJumpTo(qint64 offset, QByteArray match) {
+  tabWidget->setCurrentWidget(tab_text);
+  auto document = textBrowser->document();
+  // the last chunk drawn that starts at or before the match
+  auto it = std::upper_bound(
+      shownOffsets.constBegin(), shownOffsets.constEnd(), offset,
+      [](qint64 value, const QPair<qint64, int> &entry) {
+        return value < entry.first;
+      });
+  int position = it == shownOffsets.constBegin() ? 0 : (it - 1)->second;
+  QTextCursor cursor(document);
+  cursor.setPosition(qMin(position, document->characterCount() - 1));
+  // the match itself pins the spot within the chunk; in hex view or with
+  // the display paused it may not be there, the chunk is the best guess
+  auto found = document->find(QString::fromUtf8(match), cursor);
+  textBrowser->setTextCursor(found.isNull() ? cursor : found);
+  textBrowser->ensureCursorVisible();
+}
+
+void MainWindow::onSendFile() {
+  if (!openThen([this] { onSendFile(); })) {
+    return;
+  }
+  fileBytesCounted = 0;
+  FileSendDialog dialog(fileSender, ports[serialPortComboBox->currentIndex()],
+                        this);
+  dialog.exec();
+}
+
+void MainWindow::onFileSendProgress(qint64 sent, qint64 total, double rate) {
+  Q_UNUSED(total);
+  Q_UNUSED(rate);
+  if (sent < fileBytesCounted) {
+    // a new transfer started
+    fileBytesCounted = 0;
+  }
+  qint64 delta = sent - fileBytesCounted;
+  fileBytesCounted = sent;
+  bytesSent += delta;
+  sentRecord.push_back(
+      QPair<quint64, qint64>(delta, QDateTime::currentMSecsSinceEpoch()));
+}
+
+void MainWindow::onFileTransfer() {
+  if (!openThen([this] { onFileTransfer(); })) {
+    return;
+  }
+  fileBytesCounted = 0;
+  FileTransferDialog dialog(fileTransfer,
+                            ports[serialPortComboBox->currentIndex()], this);
+  dialog.exec();
+}
+
+void MainWindow::onScheduledSend() {
+  if (!openThen([this] { onScheduledSend(); })) {
+    return;
+  }
+  fileBytesCounted = 0;
+  SendSchedulerDialog dialog(sendScheduler,
+                             ports[serialPortComboBox->currentIndex()], this);
+  dialog.exec();
+}
+
+void MainWindow::onScheduledProgress(SchedulerStatistics statistics) {
+  onFileSendProgress(statistics.bytes, 0, 0);
+}
+
+void MainWindow::onReplay() {
+  ReplayDialog dialog(replayEngine, ports[serialPortComboBox->currentIndex()],
+                      this);
+  dialog.exec();
+}
+
 bool MainWindow::eventFilter(QObject *object, QEvent *event) {
     if (object == inputPlainTextEdit && event->type() == QEvent::KeyPress) {
         QKeyEvent *key = (QKeyEvent *)event;
@@ -526,4 +884,700 @@ void MainWindow::loadSettings() {
   }
 
   tabWidget->setCurrentIndex(settings.value("tabPane", 0).toInt());
+
+  delimiterLineEdit->setText(
+      settings.value("framer/delimiter", "0a").toString());
+  lengthFieldComboBox->setCurrentIndex(
+      settings.value("framer/lengthField", 0).toInt());
+  lengthAdjustSpinBox->setValue(settings.value("framer/lengthAdjust", 0).toInt());
+  framerComboBox->setCurrentIndex(settings.value("framer/type", 0).toInt());
+  onFramerChanged();
+
+  plotSpanComboBox->setCurrentIndex(
+      settings.value("plot/span", INDEX_PLOT_SPAN_ALL).toInt());
+  plotCheckBox->setChecked(settings.value("plot/enabled", false).toBool());
+  onPlotChanged();
+}
+
+void MainWindow::onFramerChanged() {
+  int type = framerComboBox->currentIndex();
+  delimiterLineEdit->setEnabled(type == INDEX_FRAMER_DELIMITER);
+  lengthFieldComboBox->setEnabled(type == INDEX_FRAMER_LENGTH);
+  lengthAdjustSpinBox->setEnabled(type == INDEX_FRAMER_LENGTH);
+  frameModel->setDescriber(type == INDEX_FRAMER_MODBUS ? modbusDescribe
+                                                       : nullptr);
+
+  settings.setValue("framer/type", type);
+  settings.setValue("framer/delimiter", delimiterLineEdit->text());
+  settings.setValue("framer/lengthField", lengthFieldComboBox->currentIndex());
+  settings.setValue("framer/lengthAdjust", lengthAdjustSpinBox->value());
+
+  if (isOpened) {
+    attachFramer(ports[serialPortComboBox->currentIndex()]);
+  }
+}
+
+void MainWindow::attachFramer(SerialPort *port) {
+  detachFramer();
+  int type = framerComboBox->currentIndex();
+  if (type == INDEX_FRAMER_NONE) {
+    return;
+  }
+
+  Framer::Settings framerSettings;
+  framerSettings.type = (Framer::Type)(type - 1);
+  if (type == INDEX_FRAMER_DELIMITER) {
+    // Framer would fall back to a newline for an empty delimiter
+    qint64 offset = SendEncoder::decode(
+        delimiterLineEdit->text(), SendEncoder::Hex, &framerSettings.delimiter);
+    if (offset >= 0) {
+      statusBar()->showMessage(
+          tr("Invalid hex in the frame delimiter at offset %1, not framing")
+              .arg(offset));
+      return;
+    }
+    if (framerSettings.delimiter.isEmpty()) {
+      statusBar()->showMessage(tr("Empty frame delimiter, not framing"));
+      return;
+    }
+  }
+  int lengthField = lengthFieldComboBox->currentIndex();
+  framerSettings.lengthSize = lengthField == 0 ? 1 : lengthField <= 2 ? 2 : 4;
+  framerSettings.bigEndian = lengthField == 2 || lengthField == 4;
+  framerSettings.lengthAdjust = lengthAdjustSpinBox->value();
+  // RTU framing is timed from the settings actually applied to the port
+  auto applied = port->status().settings;
+  framerSettings.characterNs = modbusCharacterNs(
+      applied.baudRate, applied.dataBits, applied.parity, applied.stopBits);
+  framerSettings.frameGapNs =
+      modbusFrameGapNs(applied.baudRate, framerSettings.characterNs);
+
+  framer = new Framer(framerSettings, this);
+  connect(framer, SIGNAL(framesReceived(QVector<Frame>)), this,
+          SLOT(onFramesReceived(QVector<Frame>)));
+  framerPort = port;
+  framerPort->addStage(framer);
+}
+
+void MainWindow::detachFramer() {
+  if (framer) {
+    framerPort->removeStage(framer);
+    delete framer;
+    framer = nullptr;
+    framerPort = nullptr;
+  }
+}
+
+void MainWindow::onFramesReceived(QVector<Frame> frames) {
+  auto scrollBar = frameTableView->verticalScrollBar();
+  bool follow = scrollBar->value() == scrollBar->maximum();
+  frameModel->append(frames);
+  if (follow) {
+    frameTableView->scrollToBottom();
+  }
+}
+
+void MainWindow::onClearFrames() { frameModel->clear(); }
+
+void MainWindow::loadTriggers() {
+  triggers.clear();
+  int count = settings.beginReadArray("triggers");
+  for (int i = 0; i < count; i++) {
+    settings.setArrayIndex(i);
+    Trigger trigger;
+    trigger.pattern = settings.value("pattern").toString();
+    trigger.hex = settings.value("hex").toBool();
+    trigger.action = (Trigger::Action)settings.value("action").toInt();
+    trigger.response = settings.value("response").toString();
+    trigger.id = nextTriggerId++;
+    triggers.append(trigger);
+  }
+  settings.endArray();
+  triggersIgnoreCase = settings.value("triggersIgnoreCase").toBool();
+  triggerCounts.fill(0, triggers.size());
+
+  QList<QByteArray> patterns;
+  for (auto &trigger : triggers) {
+    patterns.append(trigger.action == Trigger::Highlight
+                        ? trigger.patternBytes()
+                        : QByteArray());
+  }
+  highlighter->setPatterns(patterns, triggersIgnoreCase);
+}
+
+void MainWindow::saveTriggers() {
+  settings.beginWriteArray("triggers", triggers.size());
+  for (int i = 0; i < triggers.size(); i++) {
+    settings.setArrayIndex(i);
+    settings.setValue("pattern", triggers[i].pattern);
+    settings.setValue("hex", triggers[i].hex);
+    settings.setValue("action", triggers[i].action);
+    settings.setValue("response", triggers[i].response);
+  }
+  settings.endArray();
+  settings.setValue("triggersIgnoreCase", triggersIgnoreCase);
+}
+
+void MainWindow::attachTriggers(SerialPort *port) {
+  detachTriggers();
+  if (triggers.isEmpty()) {
+    return;
+  }
+  triggerEngine = new TriggerEngine(triggers, triggersIgnoreCase, port, this);
+  connect(triggerEngine, SIGNAL(triggered(QVector<TriggerHit>)), this,
+          SLOT(onTriggered(QVector<TriggerHit>)));
+  // replies count and are captured like anything sent by hand
+  connect(triggerEngine, SIGNAL(replied(QByteArray)), this,
+          SLOT(onEncodedSent(QByteArray)));
+  triggerPort = port;
+  triggerPort->addStage(triggerEngine);
+}
+
+void MainWindow::detachTriggers() {
+  if (triggerEngine) {
+    triggerPort->removeStage(triggerEngine);
+    delete triggerEngine;
+    triggerEngine = nullptr;
+    triggerPort = nullptr;
+  }
+}
+
+void MainWindow::onTriggers() {
+  TriggerDialog dialog(triggers, triggersIgnoreCase, &triggerCounts, this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+
+  // keep the counts and ids of triggers that survived the edit, so hits
+  // still queued from the old engine land on the same trigger
+  QVector<qint64> counts;
+  QVector<int> ids;
+  for (auto origin : dialog.origins()) {
+    counts.append(origin >= 0 ? triggerCounts[origin] : 0);
+    ids.append(origin >= 0 ? triggers[origin].id : -1);
+  }
+  triggers = dialog.triggers();
+  triggersIgnoreCase = dialog.ignoreCase();
+  saveTriggers();
+  loadTriggers();
+  triggerCounts = counts;
+  for (int i = 0; i < triggers.size(); i++) {
+    if (ids[i] >= 0) {
+      triggers[i].id = ids[i];
+    }
+  }
+  if (isOpened) {
+    attachTriggers(ports[serialPortComboBox->currentIndex()]);
+  }
+}
+
+void MainWindow::onTriggered(QVector<TriggerHit> hits) {
+  for (auto &hit : hits) {
+    int index = 0;
+    while (index < triggers.size() && triggers[index].id != hit.trigger) {
+      index++;
+    }
+    // queued by an engine since replaced, for a trigger since deleted
+    if (index == triggers.size()) {
+      continue;
+    }
+    triggerCounts[index] += hit.count;
+    const Trigger &trigger = triggers[index];
+    switch (trigger.action) {
+    case Trigger::Bookmark:
+      if (capture.isOpen()) {
+        capture.write(Capture::Bookmark, trigger.pattern.toUtf8());
+        statusBar()->showMessage(
+            QString("Bookmarked \"%1\" in capture").arg(trigger.pattern));
+      }
+      break;
+    case Trigger::Pause:
+      // the chunk with the match is still on its way, let it show first
+      QMetaObject::invokeMethod(actionPauseDisplay, "setChecked",
+                                Qt::QueuedConnection, Q_ARG(bool, true));
+      statusBar()->showMessage(
+          QString("Display paused on \"%1\"").arg(trigger.pattern));
+      break;
+    default:
+      // Respond replies are accounted through replied()
+      break;
+    }
+  }
+}
+
+void MainWindow::onPauseDisplay(bool paused) {
+  displayPaused = paused;
+  if (!paused) {
+    statusBar()->showMessage("Display resumed");
+  }
+}
+
+void MainWindow::loadResponseRules() {
+  responseRules.clear();
+  int count = settings.beginReadArray("responder");
+  for (int i = 0; i < count; i++) {
+    settings.setArrayIndex(i);
+    ResponseRule rule;
+    rule.pattern = settings.value("pattern").toString();
+    rule.hex = settings.value("hex").toBool();
+    rule.response = settings.value("response").toString();
+    rule.delayUs = settings.value("delayUs").toLongLong();
+    responseRules.append(rule);
+  }
+  settings.endArray();
+}
+
+void MainWindow::saveResponseRules() {
+  settings.beginWriteArray("responder", responseRules.size());
+  for (int i = 0; i < responseRules.size(); i++) {
+    settings.setArrayIndex(i);
+    settings.setValue("pattern", responseRules[i].pattern);
+    settings.setValue("hex", responseRules[i].hex);
+    settings.setValue("response", responseRules[i].response);
+    settings.setValue("delayUs", responseRules[i].delayUs);
+  }
+  settings.endArray();
+}
+
+void MainWindow::attachResponder(SerialPort *port) {
+  detachResponder();
+  if (responseRules.isEmpty()) {
+    return;
+  }
+  responder = new AutoResponder(responseRules, port, this);
+  connect(responder, SIGNAL(replied(QByteArray)), this,
+          SLOT(onEncodedSent(QByteArray)));
+  responderPort = port;
+  responderPort->addStage(responder);
+}
+
+void MainWindow::detachResponder() {
+  if (responder) {
+    responderPort->removeStage(responder);
+    delete responder;
+    responder = nullptr;
+    responderPort = nullptr;
+  }
+}
+
+void MainWindow::onAutoResponder() {
+  AutoResponderDialog dialog(responseRules, responder, this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+
+  responseRules = dialog.rules();
+  saveResponseRules();
+  if (isOpened) {
+    attachResponder(ports[serialPortComboBox->currentIndex()]);
+  }
+}
+
+void MainWindow::onPlotChanged() {
+  static const qint64 spans[] = {1000, 10000, 100000, 1000000, 0};
+  int index = plotSpanComboBox->currentIndex();
+  plotWidget->setSpan(index >= 0 ? spans[index] : 0);
+
+  settings.setValue("plot/enabled", plotCheckBox->isChecked());
+  settings.setValue("plot/span", index);
+
+  if (isOpened) {
+    attachPlot(ports[serialPortComboBox->currentIndex()]);
+  }
+}
+
+void MainWindow::onClearPlot() { plotParser->reset(); }
+
+void MainWindow::attachPlot(SerialPort *port) {
+  detachPlot();
+  if (!plotCheckBox->isChecked()) {
+    return;
+  }
+  // straight from the thread that read the data, feed() only queues it
+  connect(port, SIGNAL(receivedData(QByteArray)), plotParser,
+          SLOT(feed(QByteArray)), Qt::DirectConnection);
+  plotPort = port;
+}
+
+void MainWindow::detachPlot() {
+  if (plotPort) {
+    disconnect(plotPort, SIGNAL(receivedData(QByteArray)), plotParser,
+               SLOT(feed(QByteArray)));
+    plotPort = nullptr;
+  }
+}
+
+PortSettings MainWindow::portSettings() {
+  PortSettings settings;
+  settings.baudRate = baudRateComboBox->currentText().toInt();
+  settings.dataBits =
+      (QSerialPort::DataBits)dataBitsComboBox->currentText().toInt();
+  QSerialPort::Parity parity[] = {
+      QSerialPort::NoParity, QSerialPort::EvenParity, QSerialPort::OddParity,
+      QSerialPort::SpaceParity, QSerialPort::MarkParity};
+  settings.parity = parity[parityComboBox->currentIndex()];
+  settings.stopBits =
+      (QSerialPort::StopBits)(stopBitsComboBox->currentIndex() + 1);
+  settings.flowControl =
+      (QSerialPort::FlowControl)flowControlComboBox->currentIndex();
+  return settings;
+}
+
+QString MainWindow::portDescription(const QString &name,
+                                    const PortSettings &settings) {
+  QString parityName[] = {"U", "N", "E", "O", "S", "M"};
+  return QString("%1 %2-%3%4%5-%6")
+      .arg(name)
+      .arg(settings.baudRate)
+      .arg(dataBitsComboBox->currentText())
+      .arg(parityName[settings.parity + 1]) // the parity may be -1
+      .arg(stopBitsComboBox->currentText())
+      .arg(flowControlComboBox->currentText());
+}
+
+Session *MainWindow::sessionFor(SerialPort *port) {
+  for (auto session : sessions) {
+    if (session->port() == port) {
+      return session;
+    }
+  }
+  return nullptr;
+}
+
+bool MainWindow::openSession(SerialPort *port) {
+  if ((isOpened && port == ports[serialPortComboBox->currentIndex()]) ||
+      port == openingPort || sessionFor(port)) {
+    return false;
+  }
+  auto settings = portSettings();
+  auto session = new Session(port, portDescription(port->portName(), settings),
+                             sessionContainer);
+  // the session shows whether it worked
+  port->openAsync(settings);
+  connect(session, SIGNAL(closeRequested(Session *)), this,
+          SLOT(onCloseSession(Session *)));
+  sessions.append(session);
+  return true;
+}
+
+void MainWindow::onOpenSession() {
+  int index = sessionPortComboBox->currentIndex();
+  if (index < 0) {
+    return;
+  }
+  if (openSession(ports[index])) {
+    layoutSessions();
+  } else {
+    statusBar()->showMessage(
+        tr("%1 is already open").arg(ports[index]->portName()));
+  }
+}
+
+void MainWindow::onOpenAllSessions() {
+  int opened = 0;
+  for (auto port : ports) {
+    // remote ports would each wait on a connection
+    if (qobject_cast<SerialPortDummy *>(port) ||
+        qobject_cast<SerialPortRfc2217 *>(port)) {
+      continue;
+    }
+#ifdef Q_OS_LINUX
+    if (qobject_cast<SerialPortPty *>(port)) {
+      continue;
+    }
+#endif
+    opened += openSession(port);
+  }
+  layoutSessions();
+  statusBar()->showMessage(tr("Opening %1 sessions").arg(opened));
+}
+
+void MainWindow::onCloseAllSessions() {
+  for (auto session : sessions) {
+    delete session;
+  }
+  sessions.clear();
+  layoutSessions();
+}
+
+void MainWindow::onCloseSession(Session *session) {
+  sessions.removeOne(session);
+  // the session is still in the middle of emitting
+  session->hide();
+  session->deleteLater();
+  layoutSessions();
+}
+
+void MainWindow::onRenderSessions() {
+  for (auto session : sessions) {
+    session->render();
+  }
+}
+
+void MainWindow::layoutSessions() {
+  for (auto session : sessions) {
+    sessionGridLayout->removeWidget(session);
+  }
+  // as square a grid as the number of sessions allows
+  int columns = 1;
+  while (columns * columns < sessions.size()) {
+    columns++;
+  }
+  for (int i = 0; i < sessions.size(); i++) {
+    sessionGridLayout->addWidget(sessions[i], i / columns, i % columns);
+    sessions[i]->show();
+  }
+}
+
+void MainWindow::onSharePort() {
+  auto serialPort = ports[serialPortComboBox->currentIndex()];
+  QString name = QString("qserial-%1").arg(serialPort->portName());
+  name.replace('/', '_').replace('\\', '_');
+  PortShareDialog dialog(
+      settings.value("share/name", name).toString(),
+      (PortServer::Policy)settings.value("share/policy", 0).toInt(), this);
+  dialog.setServer(portServer);
+  connect(&dialog, SIGNAL(startRequested(QString, PortServer::Policy)), this,
+          SLOT(onStartSharing(QString, PortServer::Policy)));
+  connect(&dialog, SIGNAL(stopRequested()), this, SLOT(onStopSharing()));
+  dialog.exec();
+}
+
+void MainWindow::onStartSharing(QString name, PortServer::Policy policy) {
+  auto dialog = qobject_cast<PortShareDialog *>(sender());
+  if (!isOpened) {
+    QMessageBox::warning(dialog, "Share Port", "Open the port first.");
+    return;
+  }
+  onStopSharing();
+
+  auto serialPort = ports[serialPortComboBox->currentIndex()];
+  portServer = new PortServer(serialPort, policy, this);
+  if (!portServer->listen(name)) {
+    QMessageBox::warning(dialog, "Share Port", portServer->errorString());
+    delete portServer;
+    portServer = nullptr;
+    return;
+  }
+  connect(portServer, SIGNAL(written(QByteArray)), this,
+          SLOT(onEncodedSent(QByteArray)));
+  portServerPort = serialPort;
+  portServerPort->addStage(portServer);
+  settings.setValue("share/name", name);
+  settings.setValue("share/policy", policy);
+  statusBar()->showMessage(
+      tr("Sharing on %1").arg(portServer->fullServerName()));
+  if (dialog) {
+    dialog->setServer(portServer);
+  }
+}
+
+void MainWindow::onStopSharing() {
+  if (portServer) {
+    portServerPort->removeStage(portServer);
+    delete portServer;
+    portServer = nullptr;
+    portServerPort = nullptr;
+  }
+  auto dialog = qobject_cast<PortShareDialog *>(sender());
+  if (dialog) {
+    dialog->setServer(nullptr);
+  }
+}
+
+void MainWindow::onServeRfc2217(bool serve) {
+  if (rfc2217Server) {
+    rfc2217ServerPort->removeStage(rfc2217Server);
+    delete rfc2217Server;
+    rfc2217Server = nullptr;
+    rfc2217ServerPort = nullptr;
+    statusBar()->showMessage(tr("Stopped serving over RFC 2217"));
+  }
+  if (!serve) {
+    return;
+  }
+  if (!isOpened) {
+    QMessageBox::warning(this, "Serve over RFC 2217", "Open the port first.");
+    actionServeRfc2217->setChecked(false);
+    return;
+  }
+  bool ok;
+  // loopback unless asked otherwise, clients are not authenticated
+  QString bindAddress =
+      QInputDialog::getText(
+          this, "Serve over RFC 2217",
+          "Listen on address (0.0.0.0 or :: for every interface):",
+          QLineEdit::Normal,
+          settings.value("rfc2217/bindAddress", "127.0.0.1").toString(), &ok)
+          .trimmed();
+  if (!ok) {
+    actionServeRfc2217->setChecked(false);
+    return;
+  }
+  QHostAddress address;
+  if (!address.setAddress(bindAddress)) {
+    QMessageBox::warning(this, "Serve over RFC 2217",
+                         "Expected an IP address, e.g. 127.0.0.1.");
+    actionServeRfc2217->setChecked(false);
+    return;
+  }
+  int tcpPort = QInputDialog::getInt(
+      this, "Serve over RFC 2217", "TCP port:",
+      settings.value("rfc2217/serverPort", 2217).toInt(), 1, 65535, 1, &ok);
+  if (!ok) {
+    actionServeRfc2217->setChecked(false);
+    return;
+  }
+
+  auto serialPort = ports[serialPortComboBox->currentIndex()];
+  rfc2217Server = new Rfc2217Server(serialPort, this);
+  if (!rfc2217Server->listen(address, tcpPort)) {
+    QMessageBox::warning(this, "Serve over RFC 2217",
+                         rfc2217Server->errorString());
+    delete rfc2217Server;
+    rfc2217Server = nullptr;
+    actionServeRfc2217->setChecked(false);
+    return;
+  }
+  connect(rfc2217Server, SIGNAL(written(QByteArray)), this,
+          SLOT(onEncodedSent(QByteArray)));
+  connect(rfc2217Server, SIGNAL(settingsChanged()), this,
+          SLOT(onRfc2217SettingsChanged()));
+  rfc2217ServerPort = serialPort;
+  rfc2217ServerPort->addStage(rfc2217Server);
+  settings.setValue("rfc2217/bindAddress", bindAddress);
+  settings.setValue("rfc2217/serverPort", tcpPort);
+  statusBar()->showMessage(tr("Serving over RFC 2217 on %1 TCP port %2")
+                               .arg(bindAddress)
+                               .arg(tcpPort));
+}
+
+void MainWindow::onRfc2217SettingsChanged() {
+  // keep the settings shown in line with what the client set
+  QSerialPort::Parity parity[] = {
+      QSerialPort::NoParity, QSerialPort::EvenParity, QSerialPort::OddParity,
+      QSerialPort::SpaceParity, QSerialPort::MarkParity};
+  // what was handed to the port's worker, it may not have run yet
+  auto requested = rfc2217Server->getSettings();
+  baudRateComboBox->setCurrentText(QString::number(requested.baudRate));
+  dataBitsComboBox->setCurrentText(QString::number(requested.dataBits));
+  for (int i = 0; i < 5; i++) {
+    if (parity[i] == requested.parity) {
+      parityComboBox->setCurrentIndex(i);
+    }
+  }
+  stopBitsComboBox->setCurrentIndex(requested.stopBits - 1);
+  flowControlComboBox->setCurrentIndex(requested.flowControl);
+  statusBar()->showMessage(
+      tr("%1 set by RFC 2217 client")
+          .arg(portDescription(rfc2217ServerPort->portName(), requested)));
+}
+
+void MainWindow::onAddRemotePort() {
+  bool ok;
+  QString address = QInputDialog::getText(
+      this, "Add Remote Port", "RFC 2217 server (host:port):",
+      QLineEdit::Normal, "localhost:2217", &ok).trimmed();
+  if (!ok || address.isEmpty()) {
+    return;
+  }
+  auto port = SerialPortRfc2217::fromAddress(address, this);
+  if (!port) {
+    QMessageBox::warning(this, "Add Remote Port",
+                         "Expected host:port, e.g. localhost:2217.");
+    return;
+  }
+  for (auto existing : ports) {
+    if (existing->portName() == port->portName()) {
+      delete port;
+      if (!isOpened) {
+        serialPortComboBox->setCurrentIndex(ports.indexOf(existing));
+      }
+      return;
+    }
+  }
+
+  QStringList remotes = settings.value("rfc2217/remotes").toStringList();
+  remotes.append(address);
+  settings.setValue("rfc2217/remotes", remotes);
+  ports.append(port);
+  serialPortComboBox->addItem(port->portName());
+  sessionPortComboBox->addItem(port->portName());
+  if (!isOpened) {
+    serialPortComboBox->setCurrentIndex(ports.size() - 1);
+  }
+}
+
+void MainWindow::onLoopbackGenerator() {
+  PtyGeneratorDialog dialog(PtyGenerator::load(), this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+  auto generator = dialog.generator();
+  generator.save();
+#ifdef Q_OS_LINUX
+  for (auto port : ports) {
+    auto pty = qobject_cast<SerialPortPty *>(port);
+    if (pty) {
+      // read by open() on the port's thread
+      pty->post([pty, generator] { pty->setGenerator(generator); });
+    }
+  }
+#endif
+}
+
+void MainWindow::onFtdiSettings() {
+  bool ok;
+  int latency = QInputDialog::getInt(
+      this, "FTDI Latency",
+      "Latency timer (ms), how long the chip holds a partial packet:",
+      settings.value("ftdi/latencyTimer", 1).toInt(), 1, 255, 1, &ok);
+  if (!ok) {
+    return;
+  }
+  int character = settings.value("ftdi/eventCharacter", -1).toInt();
+  QString hex = QInputDialog::getText(
+      this, "FTDI Latency",
+      "Event character in hex, sent up at once when received (empty for "
+      "none):",
+      QLineEdit::Normal,
+      character < 0 ? QString() : QString::number(character, 16), &ok)
+                    .trimmed();
+  if (!ok) {
+    return;
+  }
+  character = hex.isEmpty() ? -1 : hex.toInt(&ok, 16);
+  if (!ok || character > 0xff) {
+    QMessageBox::warning(this, "FTDI Latency",
+                         "Expected a byte in hex, e.g. 0a.");
+    return;
+  }
+  settings.setValue("ftdi/latencyTimer", latency);
+  settings.setValue("ftdi/eventCharacter", character);
+  for (auto port : ports) {
+    auto ftdi = qobject_cast<SerialPortFTDI *>(port);
+    if (ftdi) {
+      ftdi->post([ftdi, latency, character] {
+        ftdi->setLatencyTimer(latency);
+        ftdi->setEventCharacter(character);
+      });
+    }
+  }
+}
+
+void MainWindow::onReaderTuning() {
+  auto serialPort = ports[serialPortComboBox->currentIndex()];
+  ReaderTuningDialog dialog(serialPort->portName(),
+                            serialPort->readerTuning(), this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+  auto tuning = dialog.tuning();
+  tuning.save(serialPort->portName());
+  serialPort->setReaderTuning(tuning);
+  if (isOpened) {
+    statusBar()->showMessage(
+        tr("Read mode applies now, the rest the next time %1 is opened")
+            .arg(serialPort->portName()));
+  }
 }
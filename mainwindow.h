@@ -1,19 +1,38 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "autoresponder.h"
+#include "capture.h"
 #include "drivers/serialport.h"
+#include "filesender.h"
+#include "filetransfer.h"
+#include "framemodel.h"
+#include "replayengine.h"
+#include "searchdialog.h"
+#include "plotparser.h"
+#include "portserver.h"
+#include "rfc2217server.h"
+#include "sendencoder.h"
+#include "sendscheduler.h"
+#include "session.h"
+#include "triggerengine.h"
+#include "triggerhighlighter.h"
 #include "ui_mainwindow.h"
 #include <QMainWindow>
+#include <QMutex>
 #include <QSerialPort>
 #include <QWidget>
 #include <QJsonArray>
 #include <QSettings>
 
-class MainWindow : public QMainWindow, private Ui::MainWindow {
+class MainWindow : public QMainWindow,
+                   public ReceiveStage,
+                   private Ui::MainWindow {
   Q_OBJECT
 
 public:
   explicit MainWindow(QWidget *parent = nullptr);
+  ~MainWindow();
   void sendBytes(const QByteArray &data);
 
 protected:
@@ -22,13 +41,52 @@ protected:
 private slots:
   void onReset();
   void onSend();
+  void onSendAccepted(QString echo);
+  void onSendFailed(qint64 offset, QString message);
+  void onEncodedSent(QByteArray data);
   void onBreak();
   void onClear();
   void onOpen();
+  void onOpened(bool ok);
   void onClose();
+  void onPortError(QString message);
   void onToggleOpen();
   void onMutualTest();
   void onTabPageChanged(int index);
+  void onStartCapture();
+  void onStopCapture();
+  void onReplay();
+  void onFind();
+  void onJumpTo(qint64 offset, QByteArray match);
+  void onSendFile();
+  void onFileSendProgress(qint64 sent, qint64 total, double rate);
+  void onFileTransfer();
+  void onScheduledSend();
+  void onScheduledProgress(SchedulerStatistics statistics);
+  void onFramerChanged();
+  void onFramesReceived(QVector<Frame> frames);
+  void onClearFrames();
+  void onTriggers();
+  void onTriggered(QVector<TriggerHit> hits);
+  void onPauseDisplay(bool paused);
+  void onAutoResponder();
+  void onPlotChanged();
+  void onClearPlot();
+  void onOpenSession();
+  void onOpenAllSessions();
+  void onCloseAllSessions();
+  void onCloseSession(Session *session);
+  void onRenderSessions();
+  void onDrainReceived();
+  void onSharePort();
+  void onStartSharing(QString name, PortServer::Policy policy);
+  void onStopSharing();
+  void onServeRfc2217(bool serve);
+  void onRfc2217SettingsChanged();
+  void onAddRemotePort();
+  void onLoopbackGenerator();
+  void onFtdiSettings();
+  void onReaderTuning();
   void refreshStatistics();
 
   void onDataReceived(QByteArray data);
@@ -38,11 +96,35 @@ private slots:
 private:
   QList<SerialPort *> ports;
   void appendText(QString text, QColor color);
+  // on the open port's reader thread, only queues for onDrainReceived()
+  void process(const QByteArray &data, qint64 timestamp) override;
+  // arrival is SerialPort::now() when the chunk came in, -1 for now
+  // true if the port is open, otherwise opens it and runs action after
+  bool openThen(std::function<void()> action);
+  void recordReceived(const QByteArray &data, qint64 arrival = -1);
+  void showReceived(const QByteArray &data);
   bool eventFilter(QObject *object, QEvent *event);
   void fitTerminal();
   void refreshOpenStatus();
   void saveSettings();
   void loadSettings();
+  void attachFramer(SerialPort *port);
+  void detachFramer();
+  void loadTriggers();
+  void saveTriggers();
+  void attachTriggers(SerialPort *port);
+  void detachTriggers();
+  void loadResponseRules();
+  void saveResponseRules();
+  void attachResponder(SerialPort *port);
+  void detachResponder();
+  void attachPlot(SerialPort *port);
+  void detachPlot();
+  PortSettings portSettings();
+  QString portDescription(const QString &name, const PortSettings &settings);
+  bool openSession(SerialPort *port);
+  Session *sessionFor(SerialPort *port);
+  void layoutSessions();
 
   quint64 bytesRecv;
   quint64 bytesSent;
@@ -50,9 +132,51 @@ private:
   QList<QPair<quint64, qint64>> sentRecord;
   QTimer *timer;
   QLabel *statisticsLabel;
+  LineErrors openLineErrors;
   QIcon playIcon, stopIcon;
   bool isOpened;
+  SerialPort *openingPort; // until the worker reports back to onOpened()
+  // run once the port opened, by the actions that open it on demand
+  std::function<void()> afterOpen;
+  QMutex receivedMutex;
+  QList<QPair<QByteArray, qint64>> pendingReceived; // with arrival time
+  qint64 pendingReceivedBytes;
+  qint64 droppedReceived; // while pendingReceived was full
   QSettings settings;
+  CaptureWriter capture;
+  ReplayEngine *replayEngine;
+  QByteArray scrollback; // latest received bytes, for searching
+  // scrollback offset of each chunk drawn and the text browser position it
+  // was drawn at, ascending, to jump to search matches by offset
+  QVector<QPair<qint64, int>> shownOffsets;
+  SearchDialog *searchDialog;
+  FileSender *fileSender;
+  qint64 fileBytesCounted;
+  FileTransfer *fileTransfer;
+  SendScheduler *sendScheduler;
+  SendEncoder *sendEncoder;
+  Framer *framer;
+  SerialPort *framerPort;
+  FrameModel *frameModel;
+  QVector<Trigger> triggers;
+  bool triggersIgnoreCase;
+  QVector<qint64> triggerCounts;
+  int nextTriggerId;
+  TriggerEngine *triggerEngine;
+  SerialPort *triggerPort;
+  TriggerHighlighter *highlighter;
+  bool displayPaused;
+  QVector<ResponseRule> responseRules;
+  AutoResponder *responder;
+  SerialPort *responderPort;
+  PlotStore *plotStore;
+  PlotParser *plotParser;
+  SerialPort *plotPort;
+  QList<Session *> sessions;
+  PortServer *portServer;
+  SerialPort *portServerPort;
+  Rfc2217Server *rfc2217Server;
+  SerialPort *rfc2217ServerPort;
 };
 
 class JsInterface : public QObject
@@ -0,0 +1,186 @@
+#include "modbus.h"
+
+qint64 modbusCharacterNs(qint32 baudRate, QSerialPort::DataBits dataBits,
+                         QSerialPort::Parity parity,
+                         QSerialPort::StopBits stopBits) {
+  // in half bits so that 1.5 stop bits stay exact
+  int halfBits = 2 + 2 * dataBits;
+  if (parity != QSerialPort::NoParity) {
+    halfBits += 2;
+  }
+  halfBits += stopBits == QSerialPort::TwoStop          ? 4
+              : stopBits == QSerialPort::OneAndHalfStop ? 3
+                                                        : 2;
+  return baudRate > 0 ? halfBits * 500000000LL / baudRate : 0;
+}
+
+qint64 modbusFrameGapNs(qint32 baudRate, qint64 characterNs) {
+  return baudRate > 19200 ? 1750000 : characterNs * 7 / 2;
+}
+
+static QString functionName(int function) {
+  switch (function) {
+  case 1:
+    return "Read Coils";
+  case 2:
+    return "Read Discrete Inputs";
+  case 3:
+    return "Read Holding Registers";
+  case 4:
+    return "Read Input Registers";
+  case 5:
+    return "Write Single Coil";
+  case 6:
+    return "Write Single Register";
+  case 7:
+    return "Read Exception Status";
+  case 8:
+    return "Diagnostics";
+  case 11:
+    return "Get Comm Event Counter";
+  case 12:
+    return "Get Comm Event Log";
+  case 15:
+    return "Write Multiple Coils";
+  case 16:
+    return "Write Multiple Registers";
+  case 17:
+    return "Report Server ID";
+  case 20:
+    return "Read File Record";
+  case 21:
+    return "Write File Record";
+  case 22:
+    return "Mask Write Register";
+  case 23:
+    return "Read/Write Multiple Registers";
+  case 24:
+    return "Read FIFO Queue";
+  case 43:
+    return "Encapsulated Interface Transport";
+  default:
+    return QString("Function %1").arg(function);
+  }
+}
+
+static QString exceptionName(int code) {
+  switch (code) {
+  case 1:
+    return "Illegal Function";
+  case 2:
+    return "Illegal Data Address";
+  case 3:
+    return "Illegal Data Value";
+  case 4:
+    return "Server Device Failure";
+  case 5:
+    return "Acknowledge";
+  case 6:
+    return "Server Device Busy";
+  case 8:
+    return "Memory Parity Error";
+  case 10:
+    return "Gateway Path Unavailable";
+  case 11:
+    return "Gateway Target Device Failed to Respond";
+  default:
+    return QString("Exception %1").arg(code);
+  }
+}
+
+QString modbusDescribe(const QByteArray &frame) {
+  if (frame.length() < 4) {
+    return "Too short";
+  }
+  auto p = (const quint8 *)frame.constData();
+  // without address, function and checksum
+  int length = frame.length() - 4;
+  auto word = [p](int offset) { return (p[offset] << 8) | p[offset + 1]; };
+
+  QString text = p[0] ? QString("Unit %1, ").arg(p[0]) : "Broadcast, ";
+  int function = p[1] & 0x7F;
+  text += functionName(function);
+  if (p[1] & 0x80) {
+    return text + ": " + exceptionName(length >= 1 ? p[2] : 0);
+  }
+
+  // requests and responses share function codes, tell them apart by size
+  switch (function) {
+  case 1:
+  case 2:
+  case 3:
+  case 4:
+    if (length >= 1 && p[2] == length - 1) {
+      text += QString(", %1 bytes").arg(p[2]);
+    } else if (length == 4) {
+      text += QString(", start %1, count %2").arg(word(2)).arg(word(4));
+    }
+    break;
+  case 5:
+  case 6:
+    if (length == 4) {
+      text += QString(", address %1, value 0x%2")
+                  .arg(word(2))
+                  .arg(word(4), 4, 16, QLatin1Char('0'));
+    }
+    break;
+  case 15:
+  case 16:
+    if (length >= 5 && p[6] == length - 5) {
+      text += QString(", start %1, count %2, %3 bytes")
+                  .arg(word(2))
+                  .arg(word(4))
+                  .arg(p[6]);
+    } else if (length == 4) {
+      text += QString(", start %1, count %2").arg(word(2)).arg(word(4));
+    }
+    break;
+  }
+  return text;
+}
+
+bool modbusLengthFits(const quint8 *frame, int length) {
+  if (length < 4) {
+    return false;
+  }
+  // byte counts at the offset, as a request or a response would have them
+  auto counted = [frame, length](int offset, int fixed) {
+    return length > offset && length == fixed + frame[offset];
+  };
+  int function = frame[1];
+  if (function & 0x80) {
+    return length == 5;
+  }
+  switch (function) {
+  case 1:
+  case 2:
+  case 3:
+  case 4:
+    return length == 8 || counted(2, 5);
+  case 5:
+  case 6:
+    return length == 8;
+  case 7:
+    return length == 4 || length == 5;
+  case 11:
+    return length == 4 || length == 8;
+  case 12:
+  case 17:
+    return length == 4 || counted(2, 5);
+  case 15:
+  case 16:
+    return length == 8 || counted(6, 9);
+  case 20:
+  case 21:
+    return counted(2, 5);
+  case 22:
+    return length == 10;
+  case 23:
+    return counted(10, 13) || counted(2, 5);
+  case 24:
+    return length == 6 || length == 6 + ((frame[2] << 8) | frame[3]);
+  default:
+    // diagnostics, encapsulated transport and anything unknown
+    return true;
+  }
+}
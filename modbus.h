@@ -0,0 +1,24 @@
+#ifndef MODBUS_H
+#define MODBUS_H
+
+#include <QSerialPort>
+#include <QString>
+
+// Modbus RTU timing and frame descriptions, see the Modbus over serial line
+// specification v1.02.
+
+// time on the wire of one character in ns, start and stop bits included
+qint64 modbusCharacterNs(qint32 baudRate, QSerialPort::DataBits dataBits,
+                         QSerialPort::Parity parity,
+                         QSerialPort::StopBits stopBits);
+// silence that separates frames: 3.5 characters, fixed at 1750 us above
+// 19200 baud
+qint64 modbusFrameGapNs(qint32 baudRate, qint64 characterNs);
+// one line summary of a frame, address and checksum included
+QString modbusDescribe(const QByteArray &frame);
+// whether a frame of length bytes, address and checksum included, has a
+// size its function code allows for a request or a response; codes of
+// free or unknown size allow any
+bool modbusLengthFits(const quint8 *frame, int length);
+
+#endif
@@ -1,7 +1,26 @@
 #include "mutualtest.h"
+#include "drivers/prbs.h"
+#include "drivers/serialportdummy.h"
+#include "drivers/serialportpty.h"
+#include "drivers/serialportqt.h"
+#include "drivers/serialportrfc2217.h"
 #include <QDebug>
+#include <QFile>
+#include <QFileDialog>
+#include <QMutex>
 #include <QScrollBar>
+#include <QSettings>
+#include <QTextStream>
 #include <QThread>
+#include <QVector>
+#include <algorithm>
+
+// sweep: how long a packet may take to arrive before the setting fails
+#define SWEEP_TIMEOUT_MS 100
+// PRBS test: how much line time each write covers, and how long the tail may
+// take to arrive once the last one went out
+#define PRBS_WRITE_INTERVAL_MS 10
+#define PRBS_DRAIN_MS 500
 
 struct Packet {
   quint32 len;
@@ -13,51 +32,325 @@ struct Packet {
   quint32 checksum;
 };
 
+// Collects what the receiving port gets during one setting of the sweep.
+struct SweepReceiver : public ReceiveStage {
+  QMutex mutex;
+  QByteArray data;
+
+  void process(const QByteArray &chunk, qint64) override {
+    QMutexLocker locker(&mutex);
+    data.append(chunk);
+  }
+
+  QByteArray take() {
+    QMutexLocker locker(&mutex);
+    QByteArray taken = data;
+    data.clear();
+    return taken;
+  }
+};
+
+// Checks the stream on the receiving port's reader thread and times every
+// written chunk until its last byte is in.
+struct PrbsReceiver : public ReceiveStage {
+  QMutex mutex;
+  PrbsChecker checker;
+  qint64 received = 0;
+  qint64 lastAt = 0;
+  // end offset and write time of the chunks still on their way
+  QList<QPair<qint64, qint64>> inFlight;
+  QVector<qint64> latencies;
+
+  explicit PrbsReceiver(int order) : checker(order) {}
+
+  void expect(qint64 end, qint64 writtenAt) {
+    QMutexLocker locker(&mutex);
+    inFlight.append({end, writtenAt});
+  }
+
+  qint64 bytes() {
+    QMutexLocker locker(&mutex);
+    return received;
+  }
+
+  void process(const QByteArray &data, qint64 timestamp) override {
+    QMutexLocker locker(&mutex);
+    checker.check(data.constData(), data.length());
+    received += data.length();
+    lastAt = timestamp;
+    while (!inFlight.isEmpty() && inFlight.first().first <= received) {
+      latencies.append(timestamp - inFlight.takeFirst().second);
+    }
+  }
+};
+
+static QString berText(qint64 errors, qint64 bits) {
+  return bits ? QString::number((double)errors / bits, 'e', 2)
+              : QString("n/a");
+}
+
+// the columns of the results table and the exported CSV
+static const QStringList resultColumns = {
+    "From",  "To",      "Setting", "Result", "Bytes/s", "Bits",  "Errors",
+    "BER",   "Dropped", "Slips",   "p50 ms", "p99 ms",  "Max ms"};
+
+static QStringList resultFields(const TestResult &result) {
+  QStringList fields = {result.from, result.to, result.setting,
+                        result.pass ? "OK" : "FAIL"};
+  if (result.sent == 0) {
+    // the sweep only says whether the packet made it
+    while (fields.size() < resultColumns.size()) {
+      fields.append(QString());
+    }
+    return fields;
+  }
+  fields << QString::number(result.bytesPerSecond, 'f', 0)
+         << QString::number(result.bits) << QString::number(result.errors)
+         << berText(result.errors, result.bits)
+         << QString::number(result.sent - result.received)
+         << QString::number(result.slips)
+         << QString::number(result.p50Ns / 1e6, 'f', 1)
+         << QString::number(result.p99Ns / 1e6, 'f', 1)
+         << QString::number(result.maxNs / 1e6, 'f', 1);
+  return fields;
+}
+
+static QString csvField(const QString &field) {
+  if (!field.contains(',') && !field.contains('"') && !field.contains('\n')) {
+    return field;
+  }
+  QString quoted = field;
+  quoted.replace("\"", "\"\"");
+  return "\"" + quoted + "\"";
+}
+
 MutualTest::MutualTest(QWidget *parent) : QDialog(parent) {
   setupUi(this);
 
+  thread = nullptr;
+  shouldStop = 0;
   ports = SerialPort::getAvailablePorts(this);
   device1ComboBox->clear();
   device2ComboBox->clear();
 
   for (auto port : ports) {
     device1ComboBox->addItem(port->portName());
-    connect(port, SIGNAL(receivedData(QByteArray)), this,
-            SLOT(receivedData(QByteArray)));
-  }
-  for (auto port : ports) {
     device2ComboBox->addItem(port->portName());
   }
 
+  resultsTableWidget->setColumnCount(resultColumns.size());
+  resultsTableWidget->setHorizontalHeaderLabels(resultColumns);
+
   connect(this, SIGNAL(appendText(QString)), this, SLOT(doAppendText(QString)));
+  connect(this, SIGNAL(resultAdded()), this, SLOT(onResultAdded()));
+}
 
-  buffer.clear();
+MutualTest::~MutualTest() {
+  shouldStop = 1;
+  if (thread) {
+    thread->wait();
+    delete thread;
+  }
+  for (auto port : ports) {
+    port->stopWorker();
+  }
+}
+
+void MutualTest::addPair(int port1, int port2) {
+  if (port1 < 0 || port2 < 0 || port1 == port2 ||
+      pairs.contains(qMakePair(port1, port2)) ||
+      pairs.contains(qMakePair(port2, port1))) {
+    return;
+  }
+  pairs.append({port1, port2});
+  pairsListWidget->addItem(QString("%1 <-> %2")
+                               .arg(ports[port1]->portName())
+                               .arg(ports[port2]->portName()));
+}
+
+void MutualTest::onAddPair() {
+  addPair(device1ComboBox->currentIndex(), device2ComboBox->currentIndex());
+}
+
+bool MutualTest::isLocalPort(int index) {
+  auto port = ports[index];
+  // the same filter as opening all sessions: remote ports would each wait
+  // on a connection and the loopback has no far end to pair with
+  if (qobject_cast<SerialPortDummy *>(port) ||
+      qobject_cast<SerialPortRfc2217 *>(port)) {
+    return false;
+  }
+#ifdef Q_OS_LINUX
+  if (qobject_cast<SerialPortPty *>(port)) {
+    return false;
+  }
+  // the Qt backend lists the native tty ports again under a short name
+  if (qobject_cast<SerialPortQt *>(port)) {
+    QString path = "/dev/" + port->portName();
+    for (auto other : ports) {
+      if (other != port && other->portName() == path) {
+        return false;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
+void MutualTest::onAddReference() {
+  // device 1 is the reference, every other local port a device under test;
+  // the pairs all share the reference, so they run one round after another
+  int reference = device1ComboBox->currentIndex();
+  int added = pairs.size();
+  for (int i = 0; i < ports.size(); i++) {
+    if (isLocalPort(i)) {
+      addPair(reference, i);
+    }
+  }
+  added = pairs.size() - added;
+  if (added > 0) {
+    doAppendText(QString("Added %1 pairs with %2, tested one after another")
+                     .arg(added)
+                     .arg(ports[reference]->portName()));
+  }
+}
+
+void MutualTest::onClearPairs() {
+  pairs.clear();
+  pairsListWidget->clear();
 }
 
 void MutualTest::onBegin() {
-  thread = QThread::create([this] {
-    doWork(0);
-    doWork(1);
+  if (thread) {
+    if (thread->isRunning()) {
+      return;
+    }
+    delete thread;
+    thread = nullptr;
+  }
+
+  plan.prbs = testComboBox->currentIndex() == 1;
+  static const int orders[] = {7, 15, 23};
+  plan.order = orders[prbsComboBox->currentIndex()];
+  plan.baudRates.clear();
+  for (auto text : baudRatesLineEdit->text().split(',')) {
+    qint32 baudRate = text.trimmed().toInt();
+    if (baudRate > 0) {
+      plan.baudRates.append(baudRate);
+    }
+  }
+  plan.seconds = secondsSpinBox->value();
+  if (plan.prbs && plan.baudRates.isEmpty()) {
+    doAppendText("No baud rates to test");
+    return;
+  }
+
+  auto testPairs = pairs;
+  if (testPairs.isEmpty()) {
+    testPairs.append(
+        {device1ComboBox->currentIndex(), device2ComboBox->currentIndex()});
+  }
+  // pairs sharing a port, like a reference against many, wait for a later
+  // round; the rest run at the same time
+  QList<QList<QPair<int, int>>> rounds;
+  for (auto &pair : testPairs) {
+    int round = 0;
+    for (; round < rounds.size(); round++) {
+      bool busy = false;
+      for (auto &other : rounds[round]) {
+        busy |= pair.first == other.first || pair.first == other.second ||
+                pair.second == other.first || pair.second == other.second;
+      }
+      if (!busy) {
+        break;
+      }
+    }
+    if (round == rounds.size()) {
+      rounds.append(QList<QPair<int, int>>());
+    }
+    rounds[round].append(pair);
+  }
+
+  // the pair threads drive the ports through their workers
+  for (auto &pair : testPairs) {
+    ports[pair.first]->startWorker();
+    ports[pair.second]->startWorker();
+  }
+  {
+    QMutexLocker locker(&resultsMutex);
+    results.clear();
+  }
+  resultsTableWidget->setRowCount(0);
+
+  shouldStop = 0;
+  thread = QThread::create([this, rounds] {
+    for (int i = 0; i < rounds.size() && !shouldStop; i++) {
+      appendText(QString("Round %1 of %2, %3 pairs")
+                     .arg(i + 1)
+                     .arg(rounds.size())
+                     .arg(rounds[i].size()));
+      QList<QThread *> workers;
+      for (auto &pair : rounds[i]) {
+        auto port1 = ports[pair.first];
+        auto port2 = ports[pair.second];
+        auto worker =
+            QThread::create([this, port1, port2] { runPair(port1, port2); });
+        worker->start();
+        workers.append(worker);
+      }
+      for (auto worker : workers) {
+        worker->wait();
+        delete worker;
+      }
+    }
+    if (shouldStop) {
+      appendText("Stopped");
+    }
+    report();
   });
   thread->start();
 }
 
-void MutualTest::doWork(int direction) {
-  // direction=0 : 1 => 2
-  // direction=1 : 2 => 1
-  appendText("Begin test");
-  auto device1 = ports[device1ComboBox->currentIndex()];
-  auto device2 = ports[device2ComboBox->currentIndex()];
-  auto from = direction ? device2 : device1;
-  auto to = direction ? device1 : device2;
-  if (!from->open()) {
-    from->open();
+void MutualTest::onStop() {
+  if (thread && thread->isRunning()) {
+    shouldStop = 1;
+    doAppendText("Stopping...");
+  }
+}
+
+void MutualTest::runPair(SerialPort *port1, SerialPort *port2) {
+  for (int direction = 0; direction < 2 && !shouldStop; direction++) {
+    auto from = direction ? port2 : port1;
+    auto to = direction ? port1 : port2;
+    if (plan.prbs) {
+      doPrbs(from, to);
+    } else {
+      doWork(direction, from, to);
+    }
   }
-  if (!to->open()) {
-    to->open();
+}
+
+void MutualTest::addResult(const TestResult &result) {
+  {
+    QMutexLocker locker(&resultsMutex);
+    results.append(result);
   }
+  emit resultAdded();
+}
 
-  if (from->isOpen() && to->isOpen()) {
+void MutualTest::doWork(int direction, SerialPort *from, SerialPort *to) {
+  QString fromName = from->portName();
+  QString toName = to->portName();
+  appendText(QString("Begin test %1 -> %2").arg(fromName).arg(toName));
+  bool fromOpen = false;
+  bool toOpen = false;
+  from->exec([from, &fromOpen] { fromOpen = from->open() || from->open(); });
+  to->exec([to, &toOpen] { toOpen = to->open() || to->open(); });
+
+  TestResult result = {};
+  result.from = fromName;
+  result.to = toName;
+  if (fromOpen && toOpen) {
     QList<qint32> allBaudRate = {9600, 115200};
     QList<QSerialPort::DataBits> allDataBits = {
         QSerialPort::Data5, QSerialPort::Data6, QSerialPort::Data7,
@@ -73,19 +366,27 @@ void MutualTest::doWork(int direction) {
     };
     char buffer[64] = {0};
     struct Packet *packet = (struct Packet *)buffer;
+    PortSettings settings;
+    settings.flowControl = QSerialPort::NoFlowControl;
+    SweepReceiver receiver;
+    to->addStage(&receiver);
     for (auto baudRate : allBaudRate) {
-      from->setBaudRate(baudRate);
-      to->setBaudRate(baudRate);
+      settings.baudRate = baudRate;
       for (auto dataBits : allDataBits) {
-        from->setDataBits(dataBits);
-        to->setDataBits(dataBits);
+        settings.dataBits = dataBits;
         for (auto i = 0; i < allParity.size(); i++) {
           auto parity = allParity[i];
-          from->setParity(parity);
-          to->setParity(parity);
+          settings.parity = parity;
           for (auto stopBits : allStopBits) {
-            from->setStopBits(stopBits);
-            to->setStopBits(stopBits);
+            if (shouldStop) {
+              break;
+            }
+            settings.stopBits = stopBits;
+            // both applied before the packet goes out
+            from->exec([from, settings] { from->applySettings(settings); });
+            to->exec([to, settings] { to->applySettings(settings); });
+            // whatever trailed in from the last setting
+            receiver.take();
 
             packet->len = sizeof(struct Packet);
             packet->direction = direction;
@@ -97,28 +398,282 @@ void MutualTest::doWork(int direction) {
                                packet->dataBits + packet->parity +
                                packet->stopBits;
 
-            from->sendData(QByteArray(buffer, packet->len));
+            // the line only carries the low dataBits of each byte
+            QByteArray sent(buffer, packet->len);
+            QByteArray expected = sent;
+            for (auto &byte : expected) {
+              byte &= (1 << dataBits) - 1;
+            }
+            from->write(sent);
+
+            // done as soon as the whole packet is in
+            QByteArray got;
+            qint64 deadline =
+                SerialPort::now() + SWEEP_TIMEOUT_MS * (qint64)1000000;
+            while (got.size() < expected.size() &&
+                   SerialPort::now() < deadline && !shouldStop) {
+              QThread::msleep(1);
+              got.append(receiver.take());
+            }
+            for (auto &byte : got) {
+              byte &= (1 << dataBits) - 1;
+            }
 
-            appendText(QString("%1 %3 %4%5%6")
-                           .arg(direction ? "<-" : "->")
-                           .arg(baudRate)
-                           .arg(dataBits)
-                           .arg(parityName[i])
-                           .arg(stopBits));
-            QThread::msleep(100);
+            result.setting = QString("%1 %2%3%4")
+                                 .arg(baudRate)
+                                 .arg(dataBits)
+                                 .arg(parityName[i])
+                                 .arg(stopBits);
+            result.pass = got == expected;
+            addResult(result);
+            appendText(QString("%1 -> %2 %3 %4")
+                           .arg(fromName)
+                           .arg(toName)
+                           .arg(result.setting)
+                           .arg(result.pass ? "OK" : "FAIL"));
           }
         }
       }
     }
+    to->removeStage(&receiver);
+  } else {
+    appendText("Failed to open device");
+    result.setting = "open";
+    result.pass = false;
+    addResult(result);
+  }
+  from->exec([from] {
+    if (from->isOpen()) {
+      from->close();
+    }
+  });
+  to->exec([to] {
+    if (to->isOpen()) {
+      to->close();
+    }
+  });
+}
+
+void MutualTest::doPrbs(SerialPort *from, SerialPort *to) {
+  QString fromName = from->portName();
+  QString toName = to->portName();
+  appendText(QString("Begin PRBS-%1 test %2 -> %3")
+                 .arg(plan.order)
+                 .arg(fromName)
+                 .arg(toName));
+  bool fromOpen = false;
+  bool toOpen = false;
+  from->exec([from, &fromOpen] { fromOpen = from->open() || from->open(); });
+  to->exec([to, &toOpen] { toOpen = to->open() || to->open(); });
+
+  if (fromOpen && toOpen) {
+    PortSettings settings;
+    settings.dataBits = QSerialPort::Data8;
+    settings.parity = QSerialPort::NoParity;
+    settings.stopBits = QSerialPort::OneStop;
+    settings.flowControl = QSerialPort::NoFlowControl;
+    Prbs prbs(plan.order);
+    for (auto baudRate : plan.baudRates) {
+      if (shouldStop) {
+        break;
+      }
+      settings.baudRate = baudRate;
+      from->exec([from, settings] { from->applySettings(settings); });
+      to->exec([to, settings] { to->applySettings(settings); });
+
+      PrbsReceiver receiver(plan.order);
+      to->addStage(&receiver);
+      // 8N1 takes ten bits a byte on the line
+      int chunkSize = qMax(1, baudRate / 10 * PRBS_WRITE_INTERVAL_MS / 1000);
+      qint64 sent = 0;
+      qint64 start = SerialPort::now();
+      qint64 end = start + plan.seconds * 1000000000LL;
+      while (SerialPort::now() < end && !shouldStop) {
+        // one chunk queued behind the one going out keeps the line busy
+        // without the queue adding much latency
+        if (from->bytesToWrite() < chunkSize) {
+          QByteArray chunk(chunkSize, 0);
+          prbs.fill(chunk.data(), chunkSize);
+          sent += chunkSize;
+          receiver.expect(sent, SerialPort::now());
+          from->write(chunk);
+        } else {
+          QThread::msleep(1);
+        }
+      }
+      // until everything is in or nothing more came for a while
+      qint64 received = -1;
+      qint64 quietSince = SerialPort::now();
+      while (received < sent && !shouldStop &&
+             SerialPort::now() - quietSince < PRBS_DRAIN_MS * 1000000LL) {
+        QThread::msleep(10);
+        qint64 count = receiver.bytes();
+        if (count != received) {
+          received = count;
+          quietSince = SerialPort::now();
+        }
+      }
+      to->removeStage(&receiver);
+      if (shouldStop) {
+        // cut short, the numbers would only mislead
+        break;
+      }
+
+      TestResult result = {};
+      result.from = fromName;
+      result.to = toName;
+      result.setting = QString("PRBS-%1 %2 8N1").arg(plan.order).arg(baudRate);
+      result.sent = sent;
+      result.received = receiver.received;
+      result.bits = receiver.checker.getBits();
+      result.errors = receiver.checker.getErrors();
+      result.slips = receiver.checker.getSlips();
+      result.pass = result.bits > 0 && result.errors == 0 &&
+                    result.sent == result.received && result.slips == 0;
+      result.bytesPerSecond =
+          receiver.lastAt > start
+              ? receiver.received * 1e9 / (receiver.lastAt - start)
+              : 0;
+      auto &latencies = receiver.latencies;
+      std::sort(latencies.begin(), latencies.end());
+      auto percentile = [&latencies](int percent) -> qint64 {
+        if (latencies.isEmpty()) {
+          return 0;
+        }
+        return latencies[qMin(latencies.size() - 1,
+                              latencies.size() * percent / 100)];
+      };
+      result.p50Ns = percentile(50);
+      result.p99Ns = percentile(99);
+      result.maxNs = latencies.isEmpty() ? 0 : latencies.last();
+      addResult(result);
+      appendText(
+          QString("%1 -> %2 %3: %4 B/s, BER %5 (%6 errors in %7 bits), %8 "
+                  "dropped, %9 slips, latency p50 %10 ms p99 %11 ms max %12 ms")
+              .arg(fromName)
+              .arg(toName)
+              .arg(result.setting)
+              .arg(result.bytesPerSecond, 0, 'f', 0)
+              .arg(berText(result.errors, result.bits))
+              .arg(result.errors)
+              .arg(result.bits)
+              .arg(result.sent - result.received)
+              .arg(result.slips)
+              .arg(result.p50Ns / 1e6, 0, 'f', 1)
+              .arg(result.p99Ns / 1e6, 0, 'f', 1)
+              .arg(result.maxNs / 1e6, 0, 'f', 1));
+    }
   } else {
     appendText("Failed to open device");
+    TestResult result = {};
+    result.from = fromName;
+    result.to = toName;
+    result.setting = "open";
+    result.pass = false;
+    addResult(result);
+  }
+  from->exec([from] {
+    if (from->isOpen()) {
+      from->close();
+    }
+  });
+  to->exec([to] {
+    if (to->isOpen()) {
+      to->close();
+    }
+  });
+}
+
+void MutualTest::report() {
+  QList<TestResult> all;
+  {
+    QMutexLocker locker(&resultsMutex);
+    all = results;
+  }
+  // one line per direction of each pair, in the order they finished
+  QStringList directions;
+  for (auto &result : all) {
+    QString direction = result.from + " -> " + result.to;
+    if (!directions.contains(direction)) {
+      directions.append(direction);
+    }
   }
-  if (from->isOpen()) {
-    from->close();
+  appendText("Report");
+  for (auto &direction : directions) {
+    int total = 0;
+    int passed = 0;
+    qint64 bits = 0;
+    qint64 errors = 0;
+    qint64 dropped = 0;
+    qint64 slips = 0;
+    qint64 worstP99 = 0;
+    bool prbs = false;
+    for (auto &result : all) {
+      if (result.from + " -> " + result.to != direction) {
+        continue;
+      }
+      total++;
+      passed += result.pass;
+      prbs |= result.sent > 0;
+      bits += result.bits;
+      errors += result.errors;
+      dropped += result.sent - result.received;
+      slips += result.slips;
+      worstP99 = qMax(worstP99, result.p99Ns);
+    }
+    QString line =
+        QString("%1: %2 of %3 passed").arg(direction).arg(passed).arg(total);
+    if (prbs) {
+      line += QString(", BER %1, %2 dropped, %3 slips, worst p99 %4 ms")
+                  .arg(berText(errors, bits))
+                  .arg(dropped)
+                  .arg(slips)
+                  .arg(worstP99 / 1e6, 0, 'f', 1);
+    }
+    appendText(line + (passed == total ? ": PASS" : ": FAIL"));
   }
-  if (to->isOpen()) {
-    to->close();
+}
+
+void MutualTest::onResultAdded() {
+  QMutexLocker locker(&resultsMutex);
+  for (int row = resultsTableWidget->rowCount(); row < results.size(); row++) {
+    resultsTableWidget->insertRow(row);
+    auto fields = resultFields(results[row]);
+    for (int column = 0; column < fields.size(); column++) {
+      resultsTableWidget->setItem(row, column,
+                                  new QTableWidgetItem(fields[column]));
+    }
   }
+  resultsTableWidget->scrollToBottom();
+}
+
+void MutualTest::onExport() {
+  QSettings settings;
+  auto fileName = QFileDialog::getSaveFileName(
+      this, "Export Results", settings.value("mutualTestFile").toString(),
+      "CSV (*.csv);;All Files (*)");
+  if (fileName.isEmpty()) {
+    return;
+  }
+  QFile file(fileName);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    doAppendText(QString("Export failed: %1").arg(file.errorString()));
+    return;
+  }
+  settings.setValue("mutualTestFile", fileName);
+  QTextStream stream(&file);
+  stream << resultColumns.join(',') << "\n";
+  QMutexLocker locker(&resultsMutex);
+  for (auto &result : results) {
+    QStringList fields;
+    for (auto &field : resultFields(result)) {
+      fields.append(csvField(field));
+    }
+    stream << fields.join(',') << "\n";
+  }
+  doAppendText(QString("Exported %1 rows to %2")
+                   .arg(results.size())
+                   .arg(fileName));
 }
 
 void MutualTest::doAppendText(QString text) {
@@ -129,61 +684,3 @@ void MutualTest::doAppendText(QString text) {
   activityTextBrowser->verticalScrollBar()->setValue(
       activityTextBrowser->verticalScrollBar()->maximum());
 }
-
-void MutualTest::receivedData(QByteArray data) {
-  buffer.append(data);
-  struct Packet *packet = (struct Packet *)buffer.data();
-  while (buffer.length() >= sizeof(Packet)) {
-
-    if (packet->len == sizeof(Packet) &&
-        packet->checksum == packet->direction + packet->baudRate +
-                                packet->dataBits + packet->parity +
-                                packet->stopBits &&
-        (packet->direction == 0 || packet->direction == 1)) {
-      // valid packet
-      auto textBrowser =
-          packet->direction ? device2TextBrowser : device1TextBrowser;
-
-      QString parityName;
-      switch (packet->parity) {
-      case QSerialPort::NoParity:
-        parityName = "N";
-        break;
-      case QSerialPort::EvenParity:
-        parityName = "E";
-        break;
-      case QSerialPort::OddParity:
-        parityName = "O";
-        break;
-      case QSerialPort::SpaceParity:
-        parityName = "S";
-        break;
-      case QSerialPort::MarkParity:
-        parityName = "M";
-        break;
-      default:
-        parityName = "U";
-        break;
-      }
-
-      auto text = QString("%1 %2 %3%4%5 OK\n")
-                      .arg(packet->direction ? "<-" : "->")
-                      .arg(packet->baudRate)
-                      .arg(packet->dataBits)
-                      .arg(parityName)
-                      .arg(packet->stopBits);
-
-      auto cursor = textBrowser->textCursor();
-      cursor.movePosition(QTextCursor::End);
-      textBrowser->setTextCursor(cursor);
-      textBrowser->insertPlainText(text);
-      textBrowser->verticalScrollBar()->setValue(
-          textBrowser->verticalScrollBar()->maximum());
-
-      buffer.remove(0, sizeof(Packet));
-    } else {
-      // bad packet
-      buffer.remove(0, 1);
-    }
-  }
-}
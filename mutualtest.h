@@ -3,30 +3,81 @@
 
 #include "drivers/serialport.h"
 #include "ui_mutualtest.h"
+#include <QAtomicInt>
 #include <QDialog>
+#include <QMutex>
 #include <QSerialPort>
 #include <QWidget>
 
+// what every pair runs, fixed while a test is going
+struct TestPlan {
+  bool prbs;
+  int order;
+  QList<qint32> baudRates;
+  int seconds;
+};
+
+// one setting in one direction of one pair, a row of the results table
+struct TestResult {
+  QString from;
+  QString to;
+  QString setting;
+  bool pass;
+  // PRBS only, sent is 0 for the settings sweep
+  qint64 sent;
+  qint64 received;
+  qint64 bits; // compared once locked
+  qint64 errors;
+  qint64 slips;
+  double bytesPerSecond;
+  // write to arrival of each written chunk's last byte
+  qint64 p50Ns;
+  qint64 p99Ns;
+  qint64 maxNs;
+};
+
 class MutualTest : public QDialog, private Ui::MutualTest {
   Q_OBJECT
 
 public:
   explicit MutualTest(QWidget *parent = nullptr);
+  ~MutualTest();
 
 signals:
   void appendText(QString text);
+  void resultAdded();
 
 private slots:
   void onBegin();
+  void onStop();
+  void onAddPair();
+  void onAddReference();
+  void onClearPairs();
+  void onExport();
   void doAppendText(QString text);
-  void receivedData(QByteArray data);
+  void onResultAdded();
 
 private:
-  void doWork(int direction);
+  void addPair(int port1, int port2);
+  // not remote, loopback or another driver's view of a listed port
+  bool isLocalPort(int index);
+  // both directions of a pair, on a thread of its own
+  void runPair(SerialPort *port1, SerialPort *port2);
+  // direction 0 is port1 to port2 of the pair
+  void doWork(int direction, SerialPort *from, SerialPort *to);
+  void doPrbs(SerialPort *from, SerialPort *to);
+  void addResult(const TestResult &result);
+  void report();
 
   QList<SerialPort *> ports;
+  QList<QPair<int, int>> pairs; // indices into ports
   QThread *thread;
-  QByteArray buffer;
+  TestPlan plan;
+  // set by Stop and on the way out, checked by every loop of the test
+  QAtomicInt shouldStop;
+
+  QMutex resultsMutex; // pair threads append, the GUI reads
+  QList<TestResult> results;
 };
 
-#endif
\ No newline at end of file
+#endif
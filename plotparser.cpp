@@ -0,0 +1,299 @@
+#include "plotparser.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// received data waiting to be parsed, beyond this new data is dropped
+#define MAX_QUEUED_BYTES (16 * 1024 * 1024)
+// longer lines are not telemetry, skip them
+#define MAX_LINE_LENGTH 4096
+
+static bool isSeparator(char ch) {
+  return ch == ',' || ch == ';' || ch == ' ' || ch == '\t';
+}
+
+static bool isDelimited(const char *begin, const char *end) {
+  for (auto p = begin; p < end; p++) {
+    if (*p == ',' || *p == ';' || *p == '\t') {
+      return true;
+    }
+  }
+  return false;
+}
+
+// The whole of [begin, end) as a decimal number. Locale independent, unlike
+// strtod() once Qt has called setlocale().
+static bool parseNumber(const char *begin, const char *end, float &result) {
+  static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                  1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                  1e18, 1e19, 1e20, 1e21, 1e22};
+  const char *p = begin;
+  bool negative = false;
+  if (p < end && (*p == '+' || *p == '-')) {
+    negative = *p++ == '-';
+  }
+
+  quint64 mantissa = 0;
+  int exponent = 0;
+  int digits = 0;
+  bool point = false;
+  for (; p < end; p++) {
+    if (*p >= '0' && *p <= '9') {
+      if (mantissa < 1000000000000000000ULL) {
+        mantissa = mantissa * 10 + (*p - '0');
+        exponent -= point;
+      } else {
+        exponent += !point;
+      }
+      digits++;
+    } else if (*p == '.' && !point) {
+      point = true;
+    } else {
+      break;
+    }
+  }
+  if (digits == 0) {
+    return false;
+  }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negativeExponent = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+      negativeExponent = *p++ == '-';
+    }
+    if (p == end) {
+      return false;
+    }
+    int value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+      value = qMin(value * 10 + (*p - '0'), 10000);
+    }
+    exponent += negativeExponent ? -value : value;
+  }
+  if (p != end) {
+    return false;
+  }
+
+  double value = mantissa;
+  if (exponent < 0) {
+    value = exponent >= -22 ? value / powers[-exponent]
+                            : value * std::pow(10.0, exponent);
+  } else if (exponent > 0) {
+    value = exponent <= 22 ? value * powers[exponent]
+                           : value * std::pow(10.0, exponent);
+  }
+  result = negative ? -value : value;
+  return true;
+}
+
+PlotParser::PlotParser(PlotStore *store, QObject *parent) : QObject(parent) {
+  this->store = store;
+  queuedBytes = 0;
+  dropped = false;
+  resetPending = false;
+  lineTooLong = false;
+  shouldStop = 0;
+  thread = QThread::create([this] { run(); });
+  thread->start();
+}
+
+PlotParser::~PlotParser() {
+  mutex.lock();
+  shouldStop = 1;
+  wake.wakeAll();
+  mutex.unlock();
+  thread->wait();
+  delete thread;
+}
+
+void PlotParser::reset() {
+  QMutexLocker locker(&mutex);
+  chunks.clear();
+  queuedBytes = 0;
+  dropped = false;
+  resetPending = true;
+  wake.wakeAll();
+}
+
+void PlotParser::feed(QByteArray data) {
+  if (data.isEmpty()) {
+    return;
+  }
+  QMutexLocker locker(&mutex);
+  if (queuedBytes + data.length() > MAX_QUEUED_BYTES) {
+    dropped = true;
+    return;
+  }
+  if (dropped) {
+    // the line the gap fell in must not be spliced with the next one
+    dropped = false;
+    chunks.append(QByteArray());
+  }
+  queuedBytes += data.length();
+  chunks.append(data);
+  wake.wakeAll();
+}
+
+void PlotParser::run() {
+  forever {
+    QList<QByteArray> pending;
+    {
+      QMutexLocker locker(&mutex);
+      while (!shouldStop && chunks.isEmpty() && !resetPending) {
+        wake.wait(&mutex);
+      }
+      if (shouldStop) {
+        return;
+      }
+      if (resetPending) {
+        resetPending = false;
+        line.clear();
+        lineTooLong = false;
+        names.clear();
+        indexes.clear();
+        header.clear();
+        rows.clear();
+        // here rather than by the caller so that no batch parsed before the
+        // reset can land after it
+        store->clear();
+      }
+      pending.swap(chunks);
+      queuedBytes = 0;
+    }
+
+    for (auto &chunk : pending) {
+      if (chunk.isEmpty()) {
+        // resync on the next newline, as for an overlong line
+        line.clear();
+        lineTooLong = true;
+        continue;
+      }
+      const char *p = chunk.constData();
+      const char *end = p + chunk.length();
+      while (p < end) {
+        auto newline = (const char *)memchr(p, '\n', end - p);
+        const char *stop = newline ? newline : end;
+        // most lines arrive whole, parse them in place
+        if (line.isEmpty() && !lineTooLong && newline) {
+          if (stop - p <= MAX_LINE_LENGTH) {
+            parseLine(p, stop);
+          }
+        } else if (!lineTooLong) {
+          line.append(p, stop - p);
+          if (line.length() > MAX_LINE_LENGTH) {
+            line.clear();
+            lineTooLong = true;
+          } else if (newline) {
+            parseLine(line.constData(), line.constData() + line.length());
+            line.clear();
+          }
+        }
+        if (newline) {
+          lineTooLong = false;
+        }
+        p = newline ? newline + 1 : end;
+      }
+    }
+
+    if (!rows.isEmpty()) {
+      store->append(names, rows);
+      rows.clear();
+    }
+  }
+}
+
+int PlotParser::seriesIndex(const QByteArray &name) {
+  auto it = indexes.constFind(name);
+  if (it != indexes.constEnd()) {
+    return it.value();
+  }
+  if (names.size() >= PLOT_MAX_SERIES) {
+    return -1;
+  }
+  int index = names.size();
+  names.append(QString::fromUtf8(name));
+  indexes.insert(name, index);
+  return index;
+}
+
+void PlotParser::parseLine(const char *begin, const char *end) {
+  if (end > begin && end[-1] == '\r') {
+    end--;
+  }
+
+  float row[PLOT_MAX_SERIES];
+  bool found = false;
+  for (auto &value : row) {
+    value = std::numeric_limits<float>::quiet_NaN();
+  }
+  QList<QByteArray> words;
+  // "key: 1.5", the value is the next field
+  QByteArray pendingKey;
+
+  int field = 0;
+  const char *p = begin;
+  while (p < end) {
+    while (p < end && isSeparator(*p)) {
+      p++;
+    }
+    const char *start = p;
+    const char *key = nullptr;
+    while (p < end && !isSeparator(*p)) {
+      if (!key && (*p == '=' || *p == ':')) {
+        key = p;
+      }
+      p++;
+    }
+    if (start == p) {
+      break;
+    }
+
+    float value;
+    if (!pendingKey.isEmpty()) {
+      QByteArray name = pendingKey;
+      pendingKey.clear();
+      if (!key && parseNumber(start, p, value)) {
+        int index = seriesIndex(name);
+        if (index >= 0) {
+          row[index] = value;
+          found = true;
+        }
+        continue;
+      }
+    }
+    if (key) {
+      if (key > start && key + 1 == p) {
+        pendingKey = QByteArray(start, key - start);
+      } else if (key > start && parseNumber(key + 1, p, value)) {
+        int index = seriesIndex(QByteArray(start, key - start));
+        if (index >= 0) {
+          row[index] = value;
+          found = true;
+        }
+      }
+    } else if (parseNumber(start, p, value)) {
+      QByteArray name = field < header.size() ? header[field]
+                                              : QByteArray::number(field + 1);
+      int index = seriesIndex(name);
+      if (index >= 0) {
+        row[index] = value;
+        found = true;
+      }
+      field++;
+    } else {
+      words.append(QByteArray(start, p - start));
+      field++;
+    }
+  }
+
+  if (found) {
+    for (auto value : row) {
+      rows.append(value);
+    }
+  } else if (!words.isEmpty() && isDelimited(begin, end)) {
+    // only delimited text is taken as a header, not any log message
+    header = words;
+  }
+}
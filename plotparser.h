@@ -0,0 +1,55 @@
+#ifndef PLOTPARSER_H
+#define PLOTPARSER_H
+
+#include "plotstore.h"
+#include <QAtomicInt>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+// Pulls numbers out of received text line by line on a worker thread and
+// appends them to a PlotStore, one sample per line. Both plain fields
+// ("1.5,2,-3" separated by commas, semicolons or blanks) and keyed fields
+// ("temp=21.5 rpm:1200") are understood, and a line without any numbers
+// names the plain fields that follow it, like a CSV header.
+class PlotParser : public QObject {
+  Q_OBJECT
+
+public:
+  explicit PlotParser(PlotStore *store, QObject *parent = nullptr);
+  ~PlotParser();
+
+  // forgets the partial line and the series names and clears the store
+  void reset();
+
+public slots:
+  // cheap and thread safe, connect it directly to SerialPort::receivedData
+  void feed(QByteArray data);
+
+private:
+  void run();
+  void parseLine(const char *begin, const char *end);
+  int seriesIndex(const QByteArray &name);
+
+  PlotStore *store;
+  QThread *thread;
+  QMutex mutex;
+  QWaitCondition wake;
+  QList<QByteArray> chunks; // an empty one marks where data was dropped
+  qint64 queuedBytes;
+  bool dropped; // since the last chunk queued
+  bool resetPending;
+  QAtomicInt shouldStop;
+
+  // only touched by the worker
+  QByteArray line;
+  bool lineTooLong;
+  QStringList names;
+  QHash<QByteArray, int> indexes;
+  QList<QByteArray> header;
+  QVector<float> rows;
+};
+
+#endif
@@ -0,0 +1,137 @@
+#include "plotstore.h"
+#include <cmath>
+#include <limits>
+
+static const float NOTHING = std::numeric_limits<float>::quiet_NaN();
+static const float INF = std::numeric_limits<float>::infinity();
+
+PlotStore::PlotStore(int capacity) {
+  this->capacity =
+      (qMax(capacity, 1) + PLOT_BLOCK_SIZE - 1) / PLOT_BLOCK_SIZE *
+      PLOT_BLOCK_SIZE;
+  total = 0;
+  changes = 0;
+}
+
+void PlotStore::clear() {
+  QMutexLocker locker(&mutex);
+  total = 0;
+  changes++;
+  names.clear();
+  values.clear();
+  blockMins.clear();
+  blockMaxs.clear();
+}
+
+void PlotStore::append(const QStringList &names, const QVector<float> &rows) {
+  QMutexLocker locker(&mutex);
+  // series are only allocated once they show up
+  while (values.size() < qMin(names.size(), PLOT_MAX_SERIES)) {
+    values.append(QVector<float>(capacity, NOTHING));
+    blockMins.append(QVector<float>(capacity / PLOT_BLOCK_SIZE, INF));
+    blockMaxs.append(QVector<float>(capacity / PLOT_BLOCK_SIZE, -INF));
+  }
+  this->names = names.mid(0, values.size());
+
+  int series = values.size();
+  for (int offset = 0; offset < rows.size(); offset += PLOT_MAX_SERIES) {
+    int index = total % capacity;
+    int block = index / PLOT_BLOCK_SIZE;
+    bool newBlock = index % PLOT_BLOCK_SIZE == 0;
+    for (int s = 0; s < series; s++) {
+      float value = rows[offset + s];
+      values[s][index] = value;
+      float &low = blockMins[s][block];
+      float &high = blockMaxs[s][block];
+      if (newBlock) {
+        // the block being overwritten is the oldest one, start it over
+        low = INF;
+        high = -INF;
+      }
+      if (!std::isnan(value)) {
+        low = qMin(low, value);
+        high = qMax(high, value);
+      }
+    }
+    total++;
+  }
+  changes++;
+}
+
+quint64 PlotStore::generation() {
+  QMutexLocker locker(&mutex);
+  return changes;
+}
+
+void PlotStore::reduce(int series, qint64 first, qint64 last, float &low,
+                       float &high) const {
+  low = INF;
+  high = -INF;
+  const float *data = values[series].constData();
+  qint64 i = first;
+  // raw samples up to a block boundary, whole blocks, then the rest
+  for (; i < last && i % PLOT_BLOCK_SIZE; i++) {
+    float value = data[i % capacity];
+    if (!std::isnan(value)) {
+      low = qMin(low, value);
+      high = qMax(high, value);
+    }
+  }
+  for (; i + PLOT_BLOCK_SIZE <= last; i += PLOT_BLOCK_SIZE) {
+    int block = (i % capacity) / PLOT_BLOCK_SIZE;
+    low = qMin(low, blockMins[series][block]);
+    high = qMax(high, blockMaxs[series][block]);
+  }
+  for (; i < last; i++) {
+    float value = data[i % capacity];
+    if (!std::isnan(value)) {
+      low = qMin(low, value);
+      high = qMax(high, value);
+    }
+  }
+  if (low > high) {
+    low = high = NOTHING;
+  }
+}
+
+PlotSnapshot PlotStore::snapshot(qint64 span, int columns) {
+  QMutexLocker locker(&mutex);
+  PlotSnapshot result;
+  result.names = names;
+  result.last = total;
+  // the block holding the oldest samples is being overwritten, skip it
+  qint64 oldest = 0;
+  if (total > capacity) {
+    oldest = (total - capacity + PLOT_BLOCK_SIZE - 1) / PLOT_BLOCK_SIZE *
+             PLOT_BLOCK_SIZE;
+  }
+  result.first = span > 0 ? qMax(oldest, total - span) : oldest;
+  qint64 count = result.last - result.first;
+  result.columns = (int)qMin<qint64>(qMax(columns, 0), count);
+  if (result.columns == 0) {
+    return result;
+  }
+
+  float low = INF;
+  float high = -INF;
+  for (int s = 0; s < values.size(); s++) {
+    QVector<float> mins(result.columns);
+    QVector<float> maxs(result.columns);
+    for (int c = 0; c < result.columns; c++) {
+      qint64 begin = result.first + count * c / result.columns;
+      qint64 end = result.first + count * (c + 1) / result.columns;
+      reduce(s, begin, end, mins[c], maxs[c]);
+      if (!std::isnan(mins[c])) {
+        low = qMin(low, mins[c]);
+        high = qMax(high, maxs[c]);
+      }
+    }
+    result.mins.append(mins);
+    result.maxs.append(maxs);
+  }
+  if (low <= high) {
+    result.low = low;
+    result.high = high;
+  }
+  return result;
+}
@@ -0,0 +1,58 @@
+#ifndef PLOTSTORE_H
+#define PLOTSTORE_H
+
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+#define PLOT_MAX_SERIES 16
+// samples summarised by one precomputed min/max pair
+#define PLOT_BLOCK_SIZE 256
+
+// What a plot needs to draw one frame: for every series the min and max of
+// each column, NaN where a column has no values.
+struct PlotSnapshot {
+  QStringList names;
+  qint64 first = 0;
+  qint64 last = 0;
+  int columns = 0;
+  QVector<QVector<float>> mins;
+  QVector<QVector<float>> maxs;
+  // over all series, low > high if there is nothing to draw
+  float low = 1;
+  float high = 0;
+};
+
+// Fixed capacity ring buffers of samples, one per series, all sharing the
+// same sample index. Every block of PLOT_BLOCK_SIZE samples keeps its min
+// and max up to date, so a snapshot costs about one step per block instead
+// of one per sample no matter how much history is shown. Thread safe.
+class PlotStore {
+public:
+  // capacity is rounded up to a whole number of blocks
+  explicit PlotStore(int capacity);
+
+  void clear();
+  // rows holds PLOT_MAX_SERIES values per sample, NaN where a series has
+  // no value, names covers every series seen so far
+  void append(const QStringList &names, const QVector<float> &rows);
+  // changes whenever the contents do
+  quint64 generation();
+  // the last span samples (all if 0) decimated into at most columns
+  PlotSnapshot snapshot(qint64 span, int columns);
+
+private:
+  void reduce(int series, qint64 first, qint64 last, float &low,
+              float &high) const;
+
+  QMutex mutex;
+  int capacity;
+  qint64 total;
+  quint64 changes;
+  QStringList names;
+  QVector<QVector<float>> values;
+  QVector<QVector<float>> blockMins;
+  QVector<QVector<float>> blockMaxs;
+};
+
+#endif
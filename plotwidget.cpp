@@ -0,0 +1,145 @@
+#include "plotwidget.h"
+#include <QPainter>
+#include <QTimer>
+#include <cmath>
+
+#define REFRESH_INTERVAL_MS 33
+#define MARGIN_LEFT 64
+#define MARGIN_RIGHT 8
+#define MARGIN_TOP 8
+#define MARGIN_BOTTOM 20
+#define GRID_LINES 4
+
+static const QColor seriesColors[] = {
+    QColor(31, 119, 180), QColor(255, 127, 14), QColor(44, 160, 44),
+    QColor(214, 39, 40),  QColor(148, 103, 189), QColor(140, 86, 75),
+    QColor(227, 119, 194), QColor(127, 127, 127)};
+
+PlotWidget::PlotWidget(QWidget *parent) : QWidget(parent) {
+  store = nullptr;
+  span = 0;
+  generation = 0;
+  setAttribute(Qt::WA_OpaquePaintEvent);
+
+  auto timer = new QTimer(this);
+  connect(timer, SIGNAL(timeout()), this, SLOT(onRefresh()));
+  timer->start(REFRESH_INTERVAL_MS);
+}
+
+void PlotWidget::setStore(PlotStore *store) {
+  this->store = store;
+  update();
+}
+
+void PlotWidget::setSpan(qint64 span) {
+  this->span = span;
+  update();
+}
+
+void PlotWidget::onRefresh() {
+  if (store && isVisible() && store->generation() != generation) {
+    update();
+  }
+}
+
+void PlotWidget::paintEvent(QPaintEvent *) {
+  QPainter painter(this);
+  painter.fillRect(rect(), palette().base());
+  QRect area = rect().adjusted(MARGIN_LEFT, MARGIN_TOP, -MARGIN_RIGHT,
+                               -MARGIN_BOTTOM);
+  if (!store || area.width() <= 0 || area.height() <= 0) {
+    return;
+  }
+
+  generation = store->generation();
+  PlotSnapshot snapshot = store->snapshot(span, area.width());
+  painter.setPen(palette().color(QPalette::Mid));
+  painter.drawRect(area);
+  if (snapshot.columns == 0 || snapshot.low > snapshot.high) {
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(area, Qt::AlignCenter, "No data");
+    return;
+  }
+
+  double low = snapshot.low;
+  double high = snapshot.high;
+  if (high - low < 1e-9) {
+    double pad = qMax(std::fabs(low) * 0.1, 1.0);
+    low -= pad;
+    high += pad;
+  }
+  double scale = area.height() / (high - low);
+  auto toY = [&](float value) {
+    return area.bottom() - (value - low) * scale;
+  };
+
+  // grid and value labels
+  for (int i = 0; i <= GRID_LINES; i++) {
+    double y = area.bottom() - (double)area.height() * i / GRID_LINES;
+    painter.setPen(palette().color(QPalette::Midlight));
+    painter.drawLine(QPointF(area.left(), y), QPointF(area.right(), y));
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(QRectF(0, y - 10, MARGIN_LEFT - 4, 20),
+                     Qt::AlignRight | Qt::AlignVCenter,
+                     QString::number(low + (high - low) * i / GRID_LINES, 'g',
+                                     5));
+  }
+  painter.drawText(QRect(area.left(), area.bottom(), area.width(),
+                         MARGIN_BOTTOM),
+                   Qt::AlignCenter,
+                   QString("samples %1 - %2")
+                       .arg(snapshot.first)
+                       .arg(snapshot.last - 1));
+
+  painter.setClipRect(area);
+  double step = (double)area.width() / snapshot.columns;
+  for (int s = 0; s < snapshot.mins.size(); s++) {
+    painter.setPen(seriesColors[s % (sizeof(seriesColors) /
+                                     sizeof(seriesColors[0]))]);
+    auto &mins = snapshot.mins[s];
+    auto &maxs = snapshot.maxs[s];
+    // both ends of every column, nearest to the previous column first so
+    // that the line does not zigzag; gaps split the line
+    QPolygonF line;
+    auto flush = [&] {
+      if (line.size() == 1) {
+        painter.drawPoint(line.first());
+      } else if (line.size() > 1) {
+        painter.drawPolyline(line);
+      }
+      line.clear();
+    };
+    for (int c = 0; c < snapshot.columns; c++) {
+      if (std::isnan(mins[c])) {
+        flush();
+        continue;
+      }
+      double x = area.left() + (c + 0.5) * step;
+      QPointF bottom(x, toY(mins[c]));
+      QPointF top(x, toY(maxs[c]));
+      if (line.isEmpty() ||
+          std::fabs(line.last().y() - bottom.y()) <=
+              std::fabs(line.last().y() - top.y())) {
+        line << bottom;
+        if (top != bottom) {
+          line << top;
+        }
+      } else {
+        line << top << bottom;
+      }
+    }
+    flush();
+  }
+
+  // legend
+  painter.setClipping(false);
+  int y = area.top() + 4;
+  for (int s = 0; s < snapshot.names.size(); s++) {
+    painter.fillRect(area.left() + 6, y + 4, 10, 10,
+                     seriesColors[s % (sizeof(seriesColors) /
+                                       sizeof(seriesColors[0]))]);
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(area.left() + 22, y + 13, snapshot.names[s]);
+    y += 18;
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef PLOTWIDGET_H
+#define PLOTWIDGET_H
+
+#include "plotstore.h"
+#include <QWidget>
+
+// Draws the series of a PlotStore, one min/max pair per pixel column, and
+// repaints at a fixed rate only when the store has changed.
+class PlotWidget : public QWidget {
+  Q_OBJECT
+
+public:
+  explicit PlotWidget(QWidget *parent = nullptr);
+
+  void setStore(PlotStore *store);
+  // samples shown, the latest ones, 0 for everything in the store
+  void setSpan(qint64 span);
+
+protected:
+  void paintEvent(QPaintEvent *event) override;
+
+private slots:
+  void onRefresh();
+
+private:
+  PlotStore *store;
+  qint64 span;
+  quint64 generation;
+};
+
+#endif
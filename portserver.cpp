@@ -0,0 +1,159 @@
+#include "portserver.h"
+
+// queued for one client beyond what its socket holds
+#define MAX_CLIENT_BACKLOG (4 * 1024 * 1024)
+// handed to a socket at a time, the rest waits in the client queue
+#define SOCKET_WINDOW (256 * 1024)
+
+PortServer::PortServer(SerialPort *port, Policy policy, QObject *parent)
+    : QObject(parent) {
+  this->port = port;
+  this->policy = policy;
+  nextId = 1;
+  writer = nullptr;
+  flushPending = false;
+  server = new QLocalServer(this);
+  connect(server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+PortServer::~PortServer() {
+  server->close();
+  QMutexLocker locker(&mutex);
+  for (auto client : clientList) {
+    client->socket->disconnect(this);
+    client->socket->abort();
+    delete client;
+  }
+  clientList.clear();
+}
+
+bool PortServer::listen(const QString &name) {
+  // a stale socket file left by a crash would make listen() fail
+  QLocalServer::removeServer(name);
+  return server->listen(name);
+}
+
+QVector<PortClientInfo> PortServer::clients() {
+  QMutexLocker locker(&mutex);
+  QVector<PortClientInfo> result;
+  for (auto client : clientList) {
+    result.append(PortClientInfo{
+        client->id, client == writer, client->lagging, client->delivered,
+        client->dropped, client->queued + client->socket->bytesToWrite()});
+  }
+  return result;
+}
+
+void PortServer::process(const QByteArray &data, qint64) {
+  QMutexLocker locker(&mutex);
+  if (clientList.isEmpty()) {
+    return;
+  }
+  for (auto client : clientList) {
+    if (client->queued + data.length() > MAX_CLIENT_BACKLOG) {
+      client->lagging = true;
+      client->dropped += data.length();
+      continue;
+    }
+    // shares the buffer, no copy
+    client->queue.append(data);
+    client->queued += data.length();
+  }
+  if (!flushPending) {
+    flushPending = true;
+    QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+  }
+}
+
+void PortServer::flush() {
+  QList<QLocalSocket *> slow;
+  QList<QPair<QLocalSocket *, QByteArray>> writes;
+  {
+    QMutexLocker locker(&mutex);
+    flushPending = false;
+    for (auto client : clientList) {
+      if (client->lagging && policy == Disconnect) {
+        slow.append(client->socket);
+        continue;
+      }
+      qint64 room = SOCKET_WINDOW - client->socket->bytesToWrite();
+      while (!client->queue.isEmpty() && room > 0) {
+        QByteArray chunk = client->queue.takeFirst();
+        client->queued -= chunk.length();
+        client->delivered += chunk.length();
+        room -= chunk.length();
+        writes.append(qMakePair(client->socket, chunk));
+      }
+      if (client->queue.isEmpty()) {
+        client->lagging = false;
+      }
+    }
+  }
+
+  // outside the lock so the reader thread is never kept waiting on a copy
+  for (auto &write : writes) {
+    write.first->write(write.second);
+  }
+  for (auto socket : slow) {
+    socket->abort();
+  }
+}
+
+void PortServer::onNewConnection() {
+  while (server->hasPendingConnections()) {
+    auto client = new Client;
+    client->id = nextId++;
+    client->socket = server->nextPendingConnection();
+    connect(client->socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(client->socket, SIGNAL(disconnected()), this,
+            SLOT(onDisconnected()));
+    connect(client->socket, SIGNAL(bytesWritten(qint64)), this,
+            SLOT(flush()));
+    QMutexLocker locker(&mutex);
+    clientList.append(client);
+  }
+}
+
+PortServer::Client *PortServer::clientFor(QObject *socket) {
+  QMutexLocker locker(&mutex);
+  for (auto client : clientList) {
+    if (client->socket == socket) {
+      return client;
+    }
+  }
+  return nullptr;
+}
+
+void PortServer::onReadyRead() {
+  auto socket = qobject_cast<QLocalSocket *>(sender());
+  QByteArray data = socket->readAll();
+  auto client = clientFor(socket);
+  if (!client || data.isEmpty()) {
+    return;
+  }
+  if (!writer) {
+    QMutexLocker locker(&mutex);
+    writer = client;
+  }
+  if (client == writer) {
+    port->write(data);
+    emit written(data);
+  }
+}
+
+void PortServer::onDisconnected() {
+  auto socket = qobject_cast<QLocalSocket *>(sender());
+  {
+    QMutexLocker locker(&mutex);
+    for (int i = 0; i < clientList.size(); i++) {
+      if (clientList[i]->socket == socket) {
+        if (writer == clientList[i]) {
+          writer = nullptr;
+        }
+        delete clientList.takeAt(i);
+        break;
+      }
+    }
+  }
+  socket->deleteLater();
+}
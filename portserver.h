@@ -0,0 +1,82 @@
+#ifndef PORTSERVER_H
+#define PORTSERVER_H
+
+#include "drivers/serialport.h"
+#include <QList>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMutex>
+#include <QObject>
+#include <QVector>
+
+struct PortClientInfo {
+  quint64 id;
+  bool writer;
+  bool lagging;
+  qint64 delivered;
+  qint64 dropped;
+  qint64 backlog;
+};
+
+// Shares an open port over a local socket (a Unix domain socket, or a named
+// pipe on Windows). Every client reads the raw received stream; the first
+// client to send becomes the writer until it disconnects, and what others
+// send is discarded.
+//
+// Received chunks are queued per client from the reader thread as shared
+// QByteArrays, so fanning out costs no copy per client. Each queue is
+// bounded; a client that falls behind is either disconnected or skips data
+// until it catches up, and the port is never held up. Sockets are serviced
+// on the thread that created the server.
+class PortServer : public QObject, public ReceiveStage {
+  Q_OBJECT
+
+public:
+  enum Policy { Disconnect, Skip };
+
+  PortServer(SerialPort *port, Policy policy, QObject *parent = nullptr);
+  ~PortServer();
+
+  bool listen(const QString &name);
+  QString fullServerName() const { return server->fullServerName(); }
+  QString errorString() const { return server->errorString(); }
+  QVector<PortClientInfo> clients();
+
+  void process(const QByteArray &data, qint64 timestamp) override;
+
+signals:
+  // data the writer sent to the port
+  void written(QByteArray data);
+
+private slots:
+  void onNewConnection();
+  void onReadyRead();
+  void onDisconnected();
+  void flush();
+
+private:
+  struct Client {
+    quint64 id;
+    QLocalSocket *socket;
+    QList<QByteArray> queue;
+    qint64 queued = 0;
+    qint64 delivered = 0;
+    qint64 dropped = 0;
+    bool lagging = false;
+  };
+
+  Client *clientFor(QObject *socket);
+
+  SerialPort *port;
+  Policy policy;
+  QLocalServer *server;
+  quint64 nextId;
+  // only changed on the server's thread, read under the mutex elsewhere
+  Client *writer;
+
+  QMutex mutex;
+  QList<Client *> clientList;
+  bool flushPending;
+};
+
+#endif
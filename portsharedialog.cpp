@@ -0,0 +1,69 @@
+#include "portsharedialog.h"
+#include <QHeaderView>
+#include <QTimer>
+
+#define COLUMN_ID 0
+#define COLUMN_ROLE 1
+#define COLUMN_DELIVERED 2
+#define COLUMN_DROPPED 3
+#define COLUMN_BACKLOG 4
+#define COLUMN_STATE 5
+
+PortShareDialog::PortShareDialog(const QString &name,
+                                 PortServer::Policy policy, QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  nameLineEdit->setText(name);
+  policyComboBox->setCurrentIndex(policy);
+  clientTableWidget->horizontalHeader()->setStretchLastSection(true);
+  setServer(nullptr);
+
+  auto timer = new QTimer(this);
+  connect(timer, SIGNAL(timeout()), this, SLOT(refreshClients()));
+  timer->start(250);
+}
+
+void PortShareDialog::setServer(PortServer *server) {
+  this->server = server;
+  nameLineEdit->setEnabled(!server);
+  policyComboBox->setEnabled(!server);
+  startStopButton->setText(server ? "Stop Sharing" : "Start Sharing");
+  statusLabel->setText(server ? QString("Listening on %1")
+                                    .arg(server->fullServerName())
+                              : QString("Not shared"));
+  refreshClients();
+}
+
+void PortShareDialog::onStartStop() {
+  if (server) {
+    emit stopRequested();
+  } else {
+    emit startRequested(nameLineEdit->text(),
+                        (PortServer::Policy)policyComboBox->currentIndex());
+  }
+}
+
+void PortShareDialog::refreshClients() {
+  QVector<PortClientInfo> clients;
+  if (server) {
+    clients = server->clients();
+  }
+  clientTableWidget->setRowCount(clients.size());
+  for (int row = 0; row < clients.size(); row++) {
+    auto &client = clients.at(row);
+    QStringList texts = {QString::number(client.id),
+                         client.writer ? "Writer" : "Reader",
+                         QString::number(client.delivered),
+                         QString::number(client.dropped),
+                         QString::number(client.backlog),
+                         client.lagging ? "Lagging" : "OK"};
+    for (int column = COLUMN_ID; column <= COLUMN_STATE; column++) {
+      auto item = clientTableWidget->item(row, column);
+      if (!item) {
+        item = new QTableWidgetItem();
+        clientTableWidget->setItem(row, column, item);
+      }
+      item->setText(texts[column]);
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#ifndef PORTSHAREDIALOG_H
+#define PORTSHAREDIALOG_H
+
+#include "portserver.h"
+#include "ui_portsharedialog.h"
+#include <QDialog>
+#include <QPointer>
+
+class PortShareDialog : public QDialog, private Ui::PortShareDialog {
+  Q_OBJECT
+
+public:
+  PortShareDialog(const QString &name, PortServer::Policy policy,
+                  QWidget *parent = nullptr);
+
+  // the running server, if any, whose clients are listed
+  void setServer(PortServer *server);
+
+signals:
+  void startRequested(QString name, PortServer::Policy policy);
+  void stopRequested();
+
+private slots:
+  void onStartStop();
+  void refreshClients();
+
+private:
+  QPointer<PortServer> server;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#include "ptygeneratordialog.h"
+#include <QFileDialog>
+
+static const int prbsOrders[] = {7, 9, 15, 23, 31};
+
+PtyGeneratorDialog::PtyGeneratorDialog(const PtyGenerator &generator,
+                                       QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  modeComboBox->setCurrentIndex(generator.mode);
+  rateSpinBox->setValue(generator.rate);
+  for (int i = 0; i < 5; i++) {
+    if (prbsOrders[i] == generator.prbsOrder) {
+      prbsComboBox->setCurrentIndex(i);
+    }
+  }
+  replayLineEdit->setText(generator.replayFile);
+  burstSizeSpinBox->setValue(generator.burstSize);
+  burstIntervalSpinBox->setValue(generator.burstIntervalMs);
+  onModeChanged();
+}
+
+PtyGenerator PtyGeneratorDialog::generator() const {
+  PtyGenerator generator;
+  generator.mode = (PtyGenerator::Mode)modeComboBox->currentIndex();
+  generator.rate = rateSpinBox->value();
+  generator.prbsOrder = prbsOrders[prbsComboBox->currentIndex()];
+  generator.replayFile = replayLineEdit->text();
+  generator.burstSize = burstSizeSpinBox->value();
+  generator.burstIntervalMs = burstIntervalSpinBox->value();
+  return generator;
+}
+
+void PtyGeneratorDialog::onModeChanged() {
+  int mode = modeComboBox->currentIndex();
+  rateSpinBox->setEnabled(mode == PtyGenerator::Prbs ||
+                          mode == PtyGenerator::Replay);
+  prbsComboBox->setEnabled(mode == PtyGenerator::Prbs);
+  replayLineEdit->setEnabled(mode == PtyGenerator::Replay);
+  browseButton->setEnabled(mode == PtyGenerator::Replay);
+  burstSizeSpinBox->setEnabled(mode == PtyGenerator::Burst);
+  burstIntervalSpinBox->setEnabled(mode == PtyGenerator::Burst);
+}
+
+void PtyGeneratorDialog::onBrowse() {
+  auto fileName = QFileDialog::getOpenFileName(this, "Replay File",
+                                               replayLineEdit->text());
+  if (!fileName.isEmpty()) {
+    replayLineEdit->setText(fileName);
+  }
+}
@@ -0,0 +1,21 @@
+#ifndef PTYGENERATORDIALOG_H
+#define PTYGENERATORDIALOG_H
+
+#include "drivers/serialportpty.h"
+#include "ui_ptygeneratordialog.h"
+#include <QDialog>
+
+class PtyGeneratorDialog : public QDialog, private Ui::PtyGeneratorDialog {
+  Q_OBJECT
+
+public:
+  PtyGeneratorDialog(const PtyGenerator &generator, QWidget *parent = nullptr);
+
+  PtyGenerator generator() const;
+
+private slots:
+  void onModeChanged();
+  void onBrowse();
+};
+
+#endif
@@ -0,0 +1,23 @@
+QT += core serialport network
+equals(QT_MAJOR_VERSION, 6){
+  QT += core5compat
+}
+QT -= gui
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+TARGET = qserial-cli
+INCLUDEPATH += .
+DEFINES += QT_DEPRECATED_WARNINGS QSERIAL_HEADLESS
+SOURCES += main.cpp headless.cpp capture.cpp sendencoder.cpp drivers/serialport.cpp drivers/chunkpool.cpp drivers/readertuning.cpp drivers/serialportqt.cpp drivers/serialportposix.cpp drivers/serialportpty.cpp drivers/serialportcp210x.cpp drivers/serialportch34x.cpp drivers/serialportpl2303.cpp drivers/serialportftdi.cpp drivers/serialportcdcacm.cpp drivers/rfc2217.cpp drivers/serialportrfc2217.cpp drivers/usbemulator.cpp drivers/usbbulkreader.cpp drivers/usbbulkwriter.cpp
+HEADERS += headless.h capture.h sendencoder.h drivers/serialport.h drivers/chunkpool.h drivers/readertuning.h drivers/serialportqt.h drivers/serialportposix.h drivers/serialportpty.h drivers/prbs.h drivers/serialportdummy.h drivers/serialportcp210x.h drivers/serialportch34x.h drivers/serialportpl2303.h drivers/serialportftdi.h drivers/serialportcdcacm.h drivers/rfc2217.h drivers/serialportrfc2217.h drivers/usbemulator.h drivers/usbbulkreader.h drivers/usbbulkwriter.h
+INCLUDEPATH += /usr/local/include
+LIBS += -L/usr/local/lib
+# qmake CONFIG+=usb_emulator runs the USB drivers against emulated chips
+usb_emulator {
+    DEFINES += QSERIAL_USB_EMULATOR
+} else {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libusb-1.0
+}
+linux: LIBS += -lutil
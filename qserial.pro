@@ -1,4 +1,4 @@
-QT += core gui widgets serialport webenginewidgets
+QT += core gui widgets serialport network webenginewidgets
 equals(QT_MAJOR_VERSION, 6){
   QT += core5compat
 }
@@ -7,14 +7,20 @@ TEMPLATE = app
 TARGET = QSerial
 INCLUDEPATH += .
 DEFINES += QT_DEPRECATED_WARNINGS
-SOURCES += main.cpp mainwindow.cpp mutualtest.cpp drivers/serialport.cpp drivers/serialportqt.cpp drivers/serialportcp210x.cpp drivers/serialportch34x.cpp drivers/serialportpl2303.cpp
-HEADERS += mainwindow.h mutualtest.h drivers/serialport.h drivers/serialportqt.h drivers/serialportdummy.h drivers/serialportcp210x.h drivers/serialportch34x.h drivers/serialportpl2303.h
+SOURCES += main.cpp mainwindow.cpp mutualtest.cpp capture.cpp replayengine.cpp replaydialog.cpp searchengine.cpp searchdialog.cpp filesender.cpp filesenddialog.cpp crc.cpp sendencoder.cpp framer.cpp framemodel.cpp modbus.cpp ahocorasick.cpp triggerengine.cpp triggerhighlighter.cpp triggerdialog.cpp autoresponder.cpp autoresponderdialog.cpp plotstore.cpp plotparser.cpp plotwidget.cpp session.cpp headless.cpp portserver.cpp portsharedialog.cpp rfc2217server.cpp ptygeneratordialog.cpp readertuningdialog.cpp filetransfer.cpp filetransferdialog.cpp sendscheduler.cpp sendschedulerdialog.cpp drivers/serialport.cpp drivers/chunkpool.cpp drivers/readertuning.cpp drivers/serialportqt.cpp drivers/serialportposix.cpp drivers/serialportpty.cpp drivers/serialportcp210x.cpp drivers/serialportch34x.cpp drivers/serialportpl2303.cpp drivers/serialportftdi.cpp drivers/serialportcdcacm.cpp drivers/rfc2217.cpp drivers/serialportrfc2217.cpp drivers/usbemulator.cpp drivers/usbbulkreader.cpp drivers/usbbulkwriter.cpp
+HEADERS += mainwindow.h mutualtest.h capture.h replayengine.h replaydialog.h searchengine.h searchdialog.h filesender.h filesenddialog.h crc.h sendencoder.h framer.h framemodel.h modbus.h ahocorasick.h triggerengine.h triggerhighlighter.h triggerdialog.h autoresponder.h autoresponderdialog.h plotstore.h plotparser.h plotwidget.h session.h headless.h portserver.h portsharedialog.h rfc2217server.h ptygeneratordialog.h readertuningdialog.h filetransfer.h filetransferdialog.h sendscheduler.h sendschedulerdialog.h drivers/serialport.h drivers/chunkpool.h drivers/readertuning.h drivers/serialportqt.h drivers/serialportposix.h drivers/serialportpty.h drivers/prbs.h drivers/serialportdummy.h drivers/serialportcp210x.h drivers/serialportch34x.h drivers/serialportpl2303.h drivers/serialportftdi.h drivers/serialportcdcacm.h drivers/rfc2217.h drivers/serialportrfc2217.h drivers/usbemulator.h drivers/usbbulkreader.h drivers/usbbulkwriter.h
 RESOURCES += resources.qrc
-FORMS += mainwindow.ui mutualtest.ui
+FORMS += mainwindow.ui mutualtest.ui replaydialog.ui searchdialog.ui filesenddialog.ui filetransferdialog.ui sendschedulerdialog.ui triggerdialog.ui autoresponderdialog.ui session.ui portsharedialog.ui ptygeneratordialog.ui readertuningdialog.ui
 INCLUDEPATH += /usr/local/include
 LIBS += -L/usr/local/lib 
 QMAKE_CXX_FLAGS += -fsanitize=address
 QMAKE_LFLAGS += -fsanitize=address
 TRANSLATIONS +=
-CONFIG += link_pkgconfig
-PKGCONFIG += libusb-1.0
+# qmake CONFIG+=usb_emulator runs the USB drivers against emulated chips
+usb_emulator {
+    DEFINES += QSERIAL_USB_EMULATOR
+} else {
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libusb-1.0
+}
+linux: LIBS += -lutil
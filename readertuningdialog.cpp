@@ -0,0 +1,30 @@
+#include "readertuningdialog.h"
+
+ReaderTuningDialog::ReaderTuningDialog(const QString &portName,
+                                       const ReaderTuning &tuning,
+                                       QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  setWindowTitle(QString("Reader Thread - %1").arg(portName));
+  cpuSpinBox->setValue(tuning.cpu);
+  policyComboBox->setCurrentIndex(tuning.policy);
+  prioritySpinBox->setValue(tuning.priority);
+  lockMemoryCheckBox->setChecked(tuning.lockMemory);
+  readModeComboBox->setCurrentIndex(tuning.readMode);
+  onPolicyChanged();
+}
+
+ReaderTuning ReaderTuningDialog::tuning() const {
+  ReaderTuning tuning;
+  tuning.cpu = cpuSpinBox->value();
+  tuning.policy = (ReaderTuning::Policy)policyComboBox->currentIndex();
+  tuning.priority = prioritySpinBox->value();
+  tuning.lockMemory = lockMemoryCheckBox->isChecked();
+  tuning.readMode = (ReaderTuning::ReadMode)readModeComboBox->currentIndex();
+  return tuning;
+}
+
+void ReaderTuningDialog::onPolicyChanged() {
+  prioritySpinBox->setEnabled(policyComboBox->currentIndex() !=
+                              ReaderTuning::Normal);
+}
@@ -0,0 +1,21 @@
+#ifndef READERTUNINGDIALOG_H
+#define READERTUNINGDIALOG_H
+
+#include "drivers/readertuning.h"
+#include "ui_readertuningdialog.h"
+#include <QDialog>
+
+class ReaderTuningDialog : public QDialog, private Ui::ReaderTuningDialog {
+  Q_OBJECT
+
+public:
+  ReaderTuningDialog(const QString &portName, const ReaderTuning &tuning,
+                     QWidget *parent = nullptr);
+
+  ReaderTuning tuning() const;
+
+private slots:
+  void onPolicyChanged();
+};
+
+#endif
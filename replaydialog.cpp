@@ -0,0 +1,78 @@
+#include "replaydialog.h"
+#include <QFileDialog>
+#include <QSettings>
+
+ReplayDialog::ReplayDialog(ReplayEngine *engine, SerialPort *port,
+                           QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->engine = engine;
+  this->port = port;
+
+  QSettings settings;
+  fileLineEdit->setText(settings.value("replay/file").toString());
+
+  connect(engine, SIGNAL(progress(ReplayStatistics)), this,
+          SLOT(onProgress(ReplayStatistics)));
+  connect(engine, SIGNAL(finished(ReplayStatistics)), this,
+          SLOT(onFinished(ReplayStatistics)));
+}
+
+void ReplayDialog::onBrowse() {
+  auto fileName = QFileDialog::getOpenFileName(this, "Open Capture",
+                                               fileLineEdit->text());
+  if (!fileName.isEmpty()) {
+    fileLineEdit->setText(fileName);
+  }
+}
+
+void ReplayDialog::onStart() {
+  bool toPort = targetComboBox->currentIndex() == 1;
+  if (toPort && !port->status().open) {
+    statisticsLabel->setText("Serial port is not open");
+    return;
+  }
+
+  auto mode = modeComboBox->currentIndex() == 0 ? ReplayEngine::OriginalTiming
+                                                : ReplayEngine::MaxSpeed;
+  if (!engine->start(fileLineEdit->text(), mode, speedDoubleSpinBox->value(),
+                     toPort ? port : nullptr)) {
+    statisticsLabel->setText(engine->errorString());
+    return;
+  }
+  QSettings().setValue("replay/file", fileLineEdit->text());
+  startButton->setEnabled(false);
+  stopButton->setEnabled(true);
+}
+
+void ReplayDialog::onStop() { engine->stop(); }
+
+void ReplayDialog::onProgress(ReplayStatistics statistics) {
+  showStatistics(statistics);
+}
+
+void ReplayDialog::onFinished(ReplayStatistics statistics) {
+  showStatistics(statistics);
+  startButton->setEnabled(true);
+  stopButton->setEnabled(false);
+}
+
+void ReplayDialog::showStatistics(const ReplayStatistics &statistics) {
+  auto text = QString("%1 / %2 bytes in %3 chunks, %4 s, %5 KiB/s")
+                  .arg(statistics.bytes)
+                  .arg(statistics.totalBytes)
+                  .arg(statistics.chunks)
+                  .arg(statistics.elapsedNs / 1e9, 0, 'f', 3)
+                  .arg(statistics.throughput() / 1024, 0, 'f', 2);
+  if (modeComboBox->currentIndex() == 0) {
+    text += QString("\nJitter: mean %1 us, max %2 us")
+                .arg(statistics.meanJitterNs / 1000.0, 0, 'f', 1)
+                .arg(statistics.maxJitterNs / 1000.0, 0, 'f', 1);
+  }
+  statisticsLabel->setText(text);
+}
+
+void ReplayDialog::done(int result) {
+  engine->stop();
+  QDialog::done(result);
+}
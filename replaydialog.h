@@ -0,0 +1,30 @@
+#ifndef REPLAYDIALOG_H
+#define REPLAYDIALOG_H
+
+#include "replayengine.h"
+#include "ui_replaydialog.h"
+#include <QDialog>
+
+class ReplayDialog : public QDialog, private Ui::ReplayDialog {
+  Q_OBJECT
+
+public:
+  ReplayDialog(ReplayEngine *engine, SerialPort *port,
+               QWidget *parent = nullptr);
+
+private slots:
+  void onBrowse();
+  void onStart();
+  void onStop();
+  void onProgress(ReplayStatistics statistics);
+  void onFinished(ReplayStatistics statistics);
+
+private:
+  void showStatistics(const ReplayStatistics &statistics);
+  void done(int result) override;
+
+  ReplayEngine *engine;
+  SerialPort *port;
+};
+
+#endif
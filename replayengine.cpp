@@ -0,0 +1,158 @@
+#include "replayengine.h"
+#include "capture.h"
+#include <QElapsedTimer>
+
+#define PROGRESS_INTERVAL_NS 100000000LL
+// sleep until this close to the deadline, then yield
+#define SPIN_THRESHOLD_NS 200000LL
+// bytes allowed in a target port's queue before waiting for it to drain
+#define REPLAY_HIGH_WATER (64 * 1024)
+// replayedData is coalesced and sent at most a batch per interval, so the
+// GUI is not flooded with queued signals at MaxSpeed
+#define REPLAY_BATCH_SIZE (64 * 1024)
+#define REPLAY_EMIT_INTERVAL_NS 20000000LL
+
+ReplayEngine::ReplayEngine(QObject *parent) : QObject(parent) {
+  qRegisterMetaType<ReplayStatistics>();
+  thread = nullptr;
+  shouldStop = 0;
+}
+
+ReplayEngine::~ReplayEngine() { stop(); }
+
+bool ReplayEngine::isRunning() { return thread && thread->isRunning(); }
+
+bool ReplayEngine::start(const QString &fileName, Mode mode, double speed,
+                         SerialPort *target) {
+  stop();
+
+  // check the file up front so errors reach the caller synchronously
+  CaptureReader reader;
+  if (!reader.open(fileName)) {
+    error = reader.errorString();
+    return false;
+  }
+  reader.close();
+
+  if (speed <= 0) {
+    speed = 1.0;
+  }
+  shouldStop = 0;
+  thread = QThread::create(
+      [this, fileName, mode, speed, target] { run(fileName, mode, speed, target); });
+  thread->start();
+  return true;
+}
+
+void ReplayEngine::stop() {
+  if (thread) {
+    shouldStop = 1;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+  }
+}
+
+void ReplayEngine::run(QString fileName, Mode mode, double speed,
+                       SerialPort *target) {
+  CaptureReader reader;
+  ReplayStatistics stats;
+  if (!reader.open(fileName)) {
+    emit finished(stats);
+    return;
+  }
+
+  CaptureReader::Record record;
+  while (reader.next(record)) {
+    if (record.direction == Capture::Received) {
+      stats.totalBytes += record.length;
+    }
+  }
+  reader.rewind();
+
+  // raw files have no timing to reproduce
+  if (!reader.hasTiming()) {
+    mode = MaxSpeed;
+  }
+
+  QElapsedTimer clock;
+  clock.start();
+  qint64 firstTimestamp = -1;
+  qint64 jitterSum = 0;
+  qint64 lastProgress = 0;
+
+  const qint64 baseline = target ? target->bytesToWrite() : 0;
+  QByteArray batch;
+  qint64 lastEmit = 0;
+  auto flush = [&] {
+    if (!batch.isEmpty()) {
+      emit replayedData(batch);
+      batch.clear();
+      lastEmit = clock.nsecsElapsed();
+    }
+  };
+
+  while (!shouldStop && reader.next(record)) {
+    if (record.direction != Capture::Received) {
+      continue;
+    }
+
+    if (mode == OriginalTiming) {
+      if (firstTimestamp < 0) {
+        firstTimestamp = record.timestamp;
+      }
+      qint64 due = (qint64)((record.timestamp - firstTimestamp) / speed);
+      if (due > clock.nsecsElapsed()) {
+        // nothing held back across a gap
+        flush();
+      }
+      qint64 remaining;
+      while ((remaining = due - clock.nsecsElapsed()) > 0 && !shouldStop) {
+        if (remaining > SPIN_THRESHOLD_NS) {
+          QThread::usleep((remaining - SPIN_THRESHOLD_NS) / 1000);
+        } else {
+          QThread::yieldCurrentThread();
+        }
+      }
+      qint64 jitter = qAbs(clock.nsecsElapsed() - due);
+      jitterSum += jitter;
+      stats.maxJitterNs = qMax(stats.maxJitterNs, jitter);
+    }
+
+    if (target) {
+      if (!target->waitForBacklog(baseline, REPLAY_HIGH_WATER, shouldStop)) {
+        break;
+      }
+      target->write(QByteArray(record.data, record.length));
+    } else {
+      if (batch.length() >= REPLAY_BATCH_SIZE) {
+        qint64 remaining;
+        while ((remaining = lastEmit + REPLAY_EMIT_INTERVAL_NS -
+                            clock.nsecsElapsed()) > 0 &&
+               !shouldStop) {
+          QThread::usleep(qMin<qint64>(remaining / 1000, 1000));
+        }
+        flush();
+      }
+      batch.append(record.data, record.length);
+      if (clock.nsecsElapsed() - lastEmit >= REPLAY_EMIT_INTERVAL_NS) {
+        flush();
+      }
+    }
+
+    stats.bytes += record.length;
+    stats.chunks++;
+    stats.elapsedNs = clock.nsecsElapsed();
+    stats.meanJitterNs = jitterSum / stats.chunks;
+    if (stats.elapsedNs - lastProgress > PROGRESS_INTERVAL_NS) {
+      lastProgress = stats.elapsedNs;
+      emit progress(stats);
+    }
+  }
+
+  if (!shouldStop) {
+    flush();
+  }
+  stats.elapsedNs = clock.nsecsElapsed();
+  emit finished(stats);
+}
@@ -0,0 +1,55 @@
+#ifndef REPLAYENGINE_H
+#define REPLAYENGINE_H
+
+#include "drivers/serialport.h"
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QObject>
+#include <QThread>
+
+struct ReplayStatistics {
+  qint64 bytes = 0;
+  qint64 chunks = 0;
+  qint64 totalBytes = 0;  // payload bytes in the capture
+  qint64 elapsedNs = 0;   // wall time since the replay started
+  qint64 meanJitterNs = 0; // |actual - scheduled| averaged over chunks
+  qint64 maxJitterNs = 0;
+
+  double throughput() const {
+    return elapsedNs > 0 ? bytes * 1e9 / elapsedNs : 0;
+  }
+};
+Q_DECLARE_METATYPE(ReplayStatistics)
+
+// Plays a capture back either as received data (replayedData) or out of a
+// serial port. Runs on its own thread so pacing does not depend on the GUI.
+class ReplayEngine : public QObject {
+  Q_OBJECT
+
+public:
+  enum Mode { OriginalTiming, MaxSpeed };
+
+  explicit ReplayEngine(QObject *parent = nullptr);
+  ~ReplayEngine();
+
+  // target == nullptr feeds replayedData instead of a port
+  bool start(const QString &fileName, Mode mode, double speed,
+             SerialPort *target);
+  void stop();
+  bool isRunning();
+  QString errorString() { return error; }
+
+signals:
+  void replayedData(QByteArray data);
+  void progress(ReplayStatistics statistics);
+  void finished(ReplayStatistics statistics);
+
+private:
+  void run(QString fileName, Mode mode, double speed, SerialPort *target);
+
+  QThread *thread;
+  QAtomicInt shouldStop;
+  QString error;
+};
+
+#endif
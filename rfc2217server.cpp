@@ -0,0 +1,245 @@
+#include "rfc2217server.h"
+
+// escaped bytes queued for the client beyond what its socket holds
+#define MAX_BACKLOG (4 * 1024 * 1024)
+// handed to the socket at a time
+#define SOCKET_WINDOW (256 * 1024)
+// a break is only sent once the client ends it, see SET-CONTROL
+#define MAX_BREAK_MS 2000
+
+Rfc2217Server::Rfc2217Server(SerialPort *port, QObject *parent)
+    : QObject(parent) {
+  this->port = port;
+  client = nullptr;
+  settings = port->status().settings;
+  flushPending = false;
+  suspended = false;
+  droppedBytes = 0;
+  server = new QTcpServer(this);
+  connect(server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+Rfc2217Server::~Rfc2217Server() {
+  server->close();
+  if (client) {
+    client->disconnect(this);
+    client->abort();
+  }
+}
+
+bool Rfc2217Server::listen(const QHostAddress &address, quint16 tcpPort) {
+  return server->listen(address, tcpPort);
+}
+
+void Rfc2217Server::process(const QByteArray &data, qint64) {
+  QMutexLocker locker(&mutex);
+  if (!client) {
+    return;
+  }
+  if (outgoing.length() + data.length() > MAX_BACKLOG) {
+    droppedBytes.fetchAndAddRelaxed(data.length());
+    return;
+  }
+  outgoing += Telnet::escape(data);
+  if (!flushPending) {
+    flushPending = true;
+    QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+  }
+}
+
+void Rfc2217Server::flush() {
+  QByteArray chunk;
+  {
+    QMutexLocker locker(&mutex);
+    flushPending = false;
+    if (!client || suspended) {
+      return;
+    }
+    qint64 room = SOCKET_WINDOW - client->bytesToWrite();
+    if (room <= 0 || outgoing.isEmpty()) {
+      return;
+    }
+    if (outgoing.length() <= room) {
+      chunk.swap(outgoing);
+    } else {
+      chunk = outgoing.left(room);
+      outgoing.remove(0, room);
+    }
+  }
+  client->write(chunk);
+}
+
+void Rfc2217Server::onNewConnection() {
+  while (server->hasPendingConnections()) {
+    auto socket = server->nextPendingConnection();
+    if (client) {
+      socket->abort();
+      socket->deleteLater();
+      continue;
+    }
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(socket, SIGNAL(disconnected()), this, SLOT(onDisconnected()));
+    connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(flush()));
+    decoder.reset();
+    localOptions = {Telnet::BINARY, Telnet::SGA};
+    remoteOptions = {Telnet::BINARY};
+    QByteArray hello;
+    hello += Telnet::negotiate(Telnet::WILL, Telnet::BINARY);
+    hello += Telnet::negotiate(Telnet::DO, Telnet::BINARY);
+    hello += Telnet::negotiate(Telnet::WILL, Telnet::SGA);
+    socket->write(hello);
+
+    QMutexLocker locker(&mutex);
+    client = socket;
+    outgoing.clear();
+    suspended = false;
+  }
+}
+
+void Rfc2217Server::onReadyRead() {
+  if (!client) {
+    return;
+  }
+  QByteArray data;
+  QVector<Telnet::Event> events;
+  decoder.feed(client->readAll(), data, events);
+  for (auto &event : events) {
+    handleEvent(event);
+  }
+  if (!data.isEmpty()) {
+    port->write(data);
+    emit written(data);
+  }
+}
+
+void Rfc2217Server::onDisconnected() {
+  auto socket = qobject_cast<QTcpSocket *>(sender());
+  {
+    QMutexLocker locker(&mutex);
+    if (socket == client) {
+      client = nullptr;
+      outgoing.clear();
+    }
+  }
+  socket->deleteLater();
+}
+
+void Rfc2217Server::handleEvent(const Telnet::Event &event) {
+  bool local = event.verb == Telnet::DO || event.verb == Telnet::DONT;
+  auto &options = local ? localOptions : remoteOptions;
+  switch (event.verb) {
+  case Telnet::DO:
+  case Telnet::WILL:
+    if (!options.contains(event.option)) {
+      bool supported = event.option == Telnet::BINARY ||
+                       event.option == Telnet::SGA ||
+                       (!local && event.option == Telnet::COM_PORT_OPTION);
+      if (supported) {
+        options.append(event.option);
+      }
+      client->write(Telnet::negotiate(
+          local ? (supported ? Telnet::WILL : Telnet::WONT)
+                : (supported ? Telnet::DO : Telnet::DONT),
+          event.option));
+    }
+    break;
+  case Telnet::DONT:
+  case Telnet::WONT:
+    if (options.removeAll(event.option) > 0) {
+      client->write(Telnet::negotiate(local ? Telnet::WONT : Telnet::DONT,
+                                      event.option));
+    }
+    break;
+  case Telnet::SB:
+    if (event.option == Telnet::COM_PORT_OPTION && !event.payload.isEmpty()) {
+      handleCommand((quint8)event.payload[0], event.payload.mid(1));
+    }
+    break;
+  }
+}
+
+void Rfc2217Server::reply(quint8 command, const QByteArray &value) {
+  client->write(Rfc2217::command(command + Rfc2217::SERVER, value));
+}
+
+void Rfc2217Server::handleCommand(quint8 command, const QByteArray &value) {
+  // a value of 0 asks for the current setting without changing it
+  quint8 byte = value.isEmpty() ? 0 : (quint8)value[0];
+  bool changed = byte != 0;
+  switch (command) {
+  case Rfc2217::SET_BAUDRATE: {
+    quint32 baudRate = Rfc2217::toValue32(value);
+    changed = baudRate != 0;
+    if (changed) {
+      settings.baudRate = baudRate;
+      port->configureAsync(settings);
+    }
+    reply(command, Rfc2217::value32(settings.baudRate));
+    break;
+  }
+  case Rfc2217::SET_DATASIZE:
+    if (byte >= 5 && byte <= 8) {
+      settings.dataBits = (QSerialPort::DataBits)byte;
+      port->configureAsync(settings);
+    }
+    reply(command, QByteArray(1, (char)settings.dataBits));
+    break;
+  case Rfc2217::SET_PARITY:
+    if (Rfc2217::parityFromWire(byte, &settings.parity)) {
+      port->configureAsync(settings);
+    }
+    reply(command,
+          QByteArray(1, (char)Rfc2217::parityToWire(settings.parity)));
+    break;
+  case Rfc2217::SET_STOPSIZE:
+    if (Rfc2217::stopBitsFromWire(byte, &settings.stopBits)) {
+      port->configureAsync(settings);
+    }
+    reply(command,
+          QByteArray(1, (char)Rfc2217::stopBitsToWire(settings.stopBits)));
+    break;
+  case Rfc2217::SET_CONTROL:
+    changed = false;
+    if (Rfc2217::flowControlFromWire(byte, &settings.flowControl)) {
+      port->configureAsync(settings);
+      changed = true;
+    } else if (byte == Rfc2217::CONTROL_BREAK_ON) {
+      breakTimer.start();
+    } else if (byte == Rfc2217::CONTROL_BREAK_OFF && breakTimer.isValid()) {
+      // drivers only take a timed break, so it goes out once its length
+      // is known
+      port->breakAsync(qBound<qint64>(1, breakTimer.elapsed(), MAX_BREAK_MS));
+      breakTimer.invalidate();
+    }
+    if (byte == Rfc2217::CONTROL_REQUEST) {
+      byte = Rfc2217::flowControlToWire(settings.flowControl);
+    }
+    // DTR/RTS and anything else unsupported is acknowledged as sent
+    reply(command, QByteArray(1, (char)byte));
+    break;
+  case Rfc2217::FLOWCONTROL_SUSPEND:
+  case Rfc2217::FLOWCONTROL_RESUME: {
+    QMutexLocker locker(&mutex);
+    suspended = command == Rfc2217::FLOWCONTROL_SUSPEND;
+    changed = false;
+    if (!suspended && !flushPending) {
+      flushPending = true;
+      QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+    break;
+  }
+  case Rfc2217::SET_LINESTATE_MASK:
+  case Rfc2217::SET_MODEMSTATE_MASK:
+  case Rfc2217::PURGE_DATA:
+    changed = false;
+    reply(command, value);
+    break;
+  default:
+    changed = false;
+    break;
+  }
+  if (changed) {
+    emit settingsChanged();
+  }
+}
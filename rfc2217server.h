@@ -0,0 +1,74 @@
+#ifndef RFC2217SERVER_H
+#define RFC2217SERVER_H
+
+#include "drivers/rfc2217.h"
+#include "drivers/serialport.h"
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+// Serves an open port over TCP with the Telnet COM port control option
+// (RFC 2217), so that ser2net clients, pyserial's rfc2217:// URLs or another
+// QSerial can use it remotely. One client at a time; further connections
+// are refused while one is active. There is no authentication, so anything
+// that can reach the bound address can drive the port; bind to loopback
+// unless the network is trusted.
+//
+// Received chunks are escaped into one buffer from the reader thread and
+// flushed to the socket once per event loop pass, with Nagle's algorithm
+// off. A client that stops reading loses data beyond the backlog limit
+// rather than holding up the port.
+class Rfc2217Server : public QObject, public ReceiveStage {
+  Q_OBJECT
+
+public:
+  Rfc2217Server(SerialPort *port, QObject *parent = nullptr);
+  ~Rfc2217Server();
+
+  bool listen(const QHostAddress &address, quint16 tcpPort);
+  quint16 serverPort() const { return server->serverPort(); }
+  QString errorString() const { return server->errorString(); }
+  qint64 dropped() const { return droppedBytes.loadAcquire(); }
+  // as last set by a client, the port's worker applies them in turn
+  PortSettings getSettings() const { return settings; }
+
+  void process(const QByteArray &data, qint64 timestamp) override;
+
+signals:
+  // data the client sent to the port
+  void written(QByteArray data);
+  // the client changed the port settings
+  void settingsChanged();
+
+private slots:
+  void onNewConnection();
+  void onReadyRead();
+  void onDisconnected();
+  void flush();
+
+private:
+  void handleEvent(const Telnet::Event &event);
+  void handleCommand(quint8 command, const QByteArray &value);
+  void reply(quint8 command, const QByteArray &value);
+
+  SerialPort *port;
+  QTcpServer *server;
+  QTcpSocket *client;
+  Telnet::Decoder decoder;
+  QList<quint8> localOptions;
+  QList<quint8> remoteOptions;
+  // replies come from here rather than waiting on the port's thread
+  PortSettings settings;
+  QElapsedTimer breakTimer;
+
+  QMutex mutex;
+  QByteArray outgoing;
+  bool flushPending;
+  // set by FLOWCONTROL-SUSPEND, received data keeps queueing meanwhile
+  bool suspended;
+  QAtomicInteger<qint64> droppedBytes;
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "searchdialog.h"
+#include <QFileDialog>
+#include <QSettings>
+
+#define SOURCE_SCROLLBACK 0
+#define SOURCE_FILE 1
+
+inline QString printable(const QByteArray &data) {
+  QString text;
+  for (auto ch : data) {
+    text += (ch >= 0x20 && ch < 0x7f) ? QLatin1Char(ch) : QLatin1Char('.');
+  }
+  return text;
+}
+
+SearchDialog::SearchDialog(const QByteArray *scrollback, QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->scrollback = scrollback;
+  searchingFile = false;
+
+  engine = new SearchEngine(this);
+  connect(engine, SIGNAL(matchesFound(QVector<SearchMatch>)), this,
+          SLOT(onMatchesFound(QVector<SearchMatch>)));
+  connect(engine, SIGNAL(progress(int)), this, SLOT(onProgress(int)));
+  connect(engine, SIGNAL(finished(bool, qint64)), this,
+          SLOT(onFinished(bool, qint64)));
+
+  QSettings settings;
+  fileLineEdit->setText(settings.value("search/file").toString());
+  kindComboBox->setCurrentIndex(settings.value("search/kind", 0).toInt());
+}
+
+void SearchDialog::resetScrollback() {
+  engine->resetMemoryIndex();
+  if (!searchingFile) {
+    matches.clear();
+    resultsTableWidget->setRowCount(0);
+    previewTextBrowser->clear();
+  }
+}
+
+void SearchDialog::onBrowse() {
+  auto fileName =
+      QFileDialog::getOpenFileName(this, "Open Capture", fileLineEdit->text());
+  if (!fileName.isEmpty()) {
+    fileLineEdit->setText(fileName);
+  }
+}
+
+void SearchDialog::onSourceChanged(int index) {
+  fileLineEdit->setEnabled(index == SOURCE_FILE);
+  browseButton->setEnabled(index == SOURCE_FILE);
+}
+
+void SearchDialog::onFind() {
+  matches.clear();
+  resultsTableWidget->setRowCount(0);
+  previewTextBrowser->clear();
+  progressBar->setValue(0);
+
+  auto kind = (SearchEngine::Kind)kindComboBox->currentIndex();
+  searchingFile = sourceComboBox->currentIndex() == SOURCE_FILE;
+  bool ok = searchingFile ? engine->start(fileLineEdit->text(),
+                                          patternLineEdit->text(), kind)
+                          : engine->start(*scrollback,
+                                          patternLineEdit->text(), kind);
+  if (!ok) {
+    statusLabel->setText(engine->errorString());
+    return;
+  }
+
+  QSettings settings;
+  settings.setValue("search/kind", kindComboBox->currentIndex());
+  if (searchingFile) {
+    settings.setValue("search/file", fileLineEdit->text());
+  }
+  statusLabel->setText("Searching...");
+  findButton->setEnabled(false);
+  cancelButton->setEnabled(true);
+}
+
+void SearchDialog::onCancel() { engine->cancel(); }
+
+void SearchDialog::onMatchesFound(QVector<SearchMatch> found) {
+  int row = resultsTableWidget->rowCount();
+  resultsTableWidget->setRowCount(row + found.size());
+  for (auto &match : found) {
+    auto time = match.timestamp < 0
+                    ? QString()
+                    : QString("+%1 s").arg(match.timestamp / 1e9, 0, 'f', 6);
+    resultsTableWidget->setItem(
+        row, 0, new QTableWidgetItem(QString::number(match.offset)));
+    resultsTableWidget->setItem(
+        row, 1, new QTableWidgetItem(QString::number(match.line + 1)));
+    resultsTableWidget->setItem(row, 2, new QTableWidgetItem(time));
+    resultsTableWidget->setItem(row, 3,
+                                new QTableWidgetItem(printable(match.context)));
+    row++;
+  }
+  matches += found;
+}
+
+void SearchDialog::onProgress(int percent) { progressBar->setValue(percent); }
+
+void SearchDialog::onFinished(bool cancelled, qint64 count) {
+  progressBar->setValue(cancelled ? progressBar->value() : 100);
+  statusLabel->setText(QString("%1 matches%2")
+                           .arg(count)
+                           .arg(cancelled ? " (cancelled)" : ""));
+  findButton->setEnabled(true);
+  cancelButton->setEnabled(false);
+}
+
+void SearchDialog::onResultActivated(int row) {
+  if (row < 0 || row >= matches.size()) {
+    return;
+  }
+  auto &match = matches[row];
+  auto before = match.context.left(match.contextStart);
+  auto hit = match.context.mid(match.contextStart, match.length);
+  auto after = match.context.mid(match.contextStart + match.length);
+  previewTextBrowser->setHtml(
+      QString("<pre>%1<b>%2</b>%3\n\n%4<b>%5</b>%6</pre>")
+          .arg(printable(before).toHtmlEscaped(),
+               printable(hit).toHtmlEscaped(),
+               printable(after).toHtmlEscaped(), QString(before.toHex(' ')),
+               QString(hit.toHex(' ')), QString(after.toHex(' '))));
+
+  if (!searchingFile) {
+    emit jumpTo(match.offset, hit);
+  }
+}
+
+void SearchDialog::reject() {
+  engine->cancel();
+  QDialog::reject();
+}
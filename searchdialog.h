@@ -0,0 +1,41 @@
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include "searchengine.h"
+#include "ui_searchdialog.h"
+#include <QDialog>
+
+class SearchDialog : public QDialog, private Ui::SearchDialog {
+  Q_OBJECT
+
+public:
+  SearchDialog(const QByteArray *scrollback, QWidget *parent = nullptr);
+  // the scrollback was cleared or trimmed, so the offsets of the results
+  // no longer hold
+  void resetScrollback();
+
+signals:
+  // a match in the received data was activated, offset is into the
+  // scrollback
+  void jumpTo(qint64 offset, QByteArray match);
+
+private slots:
+  void onBrowse();
+  void onFind();
+  void onCancel();
+  void onSourceChanged(int index);
+  void onResultActivated(int row);
+  void onMatchesFound(QVector<SearchMatch> matches);
+  void onProgress(int percent);
+  void onFinished(bool cancelled, qint64 count);
+
+private:
+  void reject() override;
+
+  const QByteArray *scrollback;
+  SearchEngine *engine;
+  QVector<SearchMatch> matches;
+  bool searchingFile;
+};
+
+#endif
@@ -0,0 +1,465 @@
+#include "searchengine.h"
+#include "capture.h"
+#include "sendencoder.h"
+#include <QRegularExpression>
+#include <algorithm>
+#include <cstring>
+
+#define SEARCH_INDEX_BLOCK (64 * 1024)
+#define SEARCH_SLICE (1024 * 1024)
+#define SEARCH_MAX_MATCHES 10000
+#define SEARCH_BATCH 1000
+#define SEARCH_CONTEXT 32
+#define REGEX_WINDOW (1024 * 1024)
+#define REGEX_OVERLAP 4096
+
+namespace {
+
+struct Segment {
+  const char *data;
+  qint64 length;
+  qint64 offset; // in the received stream
+  qint64 timestamp;
+  qint64 recordPos;
+  qint64 skip; // bytes of the record payload before data
+};
+
+// Walks the received payload of the scrollback or of a capture as
+// contiguous segments, straight out of memory or the mapped file.
+class SegmentWalker {
+public:
+  SegmentWalker(const QByteArray &memory, CaptureReader *reader)
+      : memory(memory), reader(reader) {
+    seek(nullptr);
+  }
+
+  void seek(const SearchIndex::Entry *entry) {
+    offset = entry ? entry->offset : 0;
+    skip = entry ? entry->skip : 0;
+    if (reader) {
+      if (entry) {
+        reader->seek(entry->recordPos);
+      } else {
+        reader->rewind();
+      }
+    }
+  }
+
+  bool next(Segment &segment) {
+    if (!reader) {
+      if (offset >= memory.length()) {
+        return false;
+      }
+      segment = {memory.constData() + offset, memory.length() - offset, offset,
+                 -1, 0, offset};
+      offset = memory.length();
+      return true;
+    }
+
+    CaptureReader::Record record;
+    for (;;) {
+      qint64 recordPos = reader->position();
+      if (!reader->next(record)) {
+        return false;
+      }
+      if (record.direction != Capture::Received) {
+        continue;
+      }
+      qint64 first = skip;
+      skip = 0;
+      if (first >= record.length) {
+        continue;
+      }
+      segment = {record.data + first, record.length - first, offset,
+                 record.timestamp, recordPos, first};
+      offset += segment.length;
+      return true;
+    }
+  }
+
+  // rough position for progress reporting, 0 - 1000
+  int permille(const Segment &segment) const {
+    if (reader) {
+      return reader->size() ? segment.recordPos * 1000 / reader->size() : 0;
+    }
+    return memory.length()
+               ? (segment.offset + segment.length) * 1000 / memory.length()
+               : 0;
+  }
+
+private:
+  const QByteArray &memory;
+  CaptureReader *reader;
+  qint64 offset;
+  qint64 skip;
+};
+
+qint64 countLines(const char *begin, const char *end) {
+  qint64 count = 0;
+  while (begin < end) {
+    auto p = (const char *)memchr(begin, '\n', end - begin);
+    if (!p) {
+      break;
+    }
+    count++;
+    begin = p + 1;
+  }
+  return count;
+}
+
+// Indexes everything after the last complete entry.
+void extendIndex(SearchIndex &index, SegmentWalker &walker,
+                 const QAtomicInt &shouldStop) {
+  if (index.entries.isEmpty()) {
+    walker.seek(nullptr);
+    index.length = 0;
+    index.lines = 0;
+  } else {
+    // the last entry is rebuilt identically from its own position
+    auto resume = index.entries.takeLast();
+    walker.seek(&resume);
+    index.length = resume.offset;
+    index.lines = resume.line;
+  }
+
+  Segment segment;
+  while (!shouldStop && walker.next(segment)) {
+    const char *p = segment.data;
+    const char *end = segment.data + segment.length;
+    qint64 pos = segment.offset;
+    while (p < end) {
+      if (pos % SEARCH_INDEX_BLOCK == 0) {
+        index.entries.append({pos, index.lines, segment.timestamp,
+                              segment.recordPos,
+                              segment.skip + (p - segment.data)});
+      }
+      qint64 blockEnd = (pos / SEARCH_INDEX_BLOCK + 1) * SEARCH_INDEX_BLOCK;
+      const char *stop = p + qMin<qint64>(end - p, blockEnd - pos);
+      index.lines += countLines(p, stop);
+      pos += stop - p;
+      p = stop;
+    }
+    index.length = pos;
+  }
+}
+
+// Turns stream offsets into line numbers and timestamps. Offsets should be
+// resolved in increasing order; anything else jumps through the index.
+class LineResolver {
+public:
+  LineResolver(const SearchIndex &index, SegmentWalker &walker)
+      : index(index), walker(walker) {
+    valid = false;
+    have = false;
+  }
+
+  void resolve(SearchMatch &match) {
+    if (!valid || match.offset < pos ||
+        match.offset - pos > SEARCH_INDEX_BLOCK) {
+      auto begin = index.entries.constBegin();
+      auto it = std::upper_bound(
+          begin, index.entries.constEnd(), match.offset,
+          [](qint64 value, const SearchIndex::Entry &entry) {
+            return value < entry.offset;
+          });
+      if (it == begin) {
+        walker.seek(nullptr);
+        pos = 0;
+        line = 0;
+      } else {
+        --it;
+        walker.seek(&*it);
+        pos = it->offset;
+        line = it->line;
+      }
+      valid = true;
+      have = false;
+    }
+
+    for (;;) {
+      if (!have) {
+        if (!walker.next(segment)) {
+          break;
+        }
+        have = true;
+        cur = segment.data + (pos - segment.offset);
+      }
+      qint64 segmentEnd = segment.offset + segment.length;
+      if (match.offset < segmentEnd) {
+        const char *target = segment.data + (match.offset - segment.offset);
+        line += countLines(cur, target);
+        cur = target;
+        pos = match.offset;
+        match.timestamp = segment.timestamp;
+        break;
+      }
+      line += countLines(cur, segment.data + segment.length);
+      pos = segmentEnd;
+      have = false;
+    }
+    match.line = line;
+  }
+
+private:
+  const SearchIndex &index;
+  SegmentWalker &walker;
+  Segment segment;
+  const char *cur;
+  qint64 pos;
+  qint64 line;
+  bool valid;
+  bool have;
+};
+
+SearchMatch makeMatch(const char *buffer, qint64 bufferLength, qint64 at,
+                      qint64 length, qint64 offset) {
+  SearchMatch match;
+  match.offset = offset;
+  match.length = length;
+  qint64 begin = qMax<qint64>(0, at - SEARCH_CONTEXT);
+  qint64 end = qMin(bufferLength, at + length + SEARCH_CONTEXT);
+  match.context = QByteArray(buffer + begin, end - begin);
+  match.contextStart = at - begin;
+  return match;
+}
+
+} // namespace
+
+SearchEngine::SearchEngine(QObject *parent) : QObject(parent) {
+  qRegisterMetaType<SearchMatch>();
+  qRegisterMetaType<QVector<SearchMatch>>();
+  thread = nullptr;
+  shouldStop = 0;
+  kind = Text;
+  fileIndexSize = -1;
+}
+
+SearchEngine::~SearchEngine() { cancel(); }
+
+void SearchEngine::cancel() {
+  if (thread) {
+    shouldStop = 1;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+  }
+}
+
+void SearchEngine::resetMemoryIndex() {
+  cancel();
+  memoryIndex.clear();
+}
+
+bool SearchEngine::compile(const QString &pattern, Kind kind) {
+  this->kind = kind;
+  needle.clear();
+  regex.clear();
+
+  switch (kind) {
+  case Text:
+    needle = pattern.toUtf8();
+    break;
+  case Hex: {
+    // parsed like the send box
+    qint64 offset = SendEncoder::decode(pattern, SendEncoder::Hex, &needle);
+    if (offset >= 0) {
+      error = QString("Invalid hex at offset %1").arg(offset);
+      return false;
+    }
+    break;
+  }
+  case Regex: {
+    QRegularExpression re(pattern);
+    if (!re.isValid()) {
+      error = re.errorString();
+      return false;
+    }
+    regex = pattern;
+    break;
+  }
+  }
+
+  if (kind != Regex && needle.isEmpty()) {
+    error = "Empty pattern";
+    return false;
+  }
+  return true;
+}
+
+bool SearchEngine::start(const QByteArray &data, const QString &pattern,
+                         Kind kind) {
+  cancel();
+  if (!compile(pattern, kind)) {
+    return false;
+  }
+  if (data.length() < memoryIndex.length) {
+    // scrollback was trimmed or cleared
+    memoryIndex.clear();
+  }
+  return launch(data, QString());
+}
+
+bool SearchEngine::start(const QString &fileName, const QString &pattern,
+                         Kind kind) {
+  cancel();
+  if (!compile(pattern, kind)) {
+    return false;
+  }
+  CaptureReader reader;
+  if (!reader.open(fileName)) {
+    error = reader.errorString();
+    return false;
+  }
+  if (fileName != fileIndexName || reader.size() < fileIndexSize) {
+    fileIndex.clear();
+  }
+  fileIndexName = fileName;
+  fileIndexSize = reader.size();
+  return launch(QByteArray(), fileName);
+}
+
+bool SearchEngine::launch(const QByteArray &data, const QString &fileName) {
+  shouldStop = 0;
+  thread = QThread::create([this, data, fileName] { run(data, fileName); });
+  thread->start();
+  return true;
+}
+
+void SearchEngine::run(QByteArray data, QString fileName) {
+  CaptureReader scanReader, resolveReader;
+  bool isFile = !fileName.isEmpty();
+  if (isFile &&
+      (!scanReader.open(fileName) || !resolveReader.open(fileName))) {
+    emit finished(false, 0);
+    return;
+  }
+
+  SearchIndex &index = isFile ? fileIndex : memoryIndex;
+  SegmentWalker indexWalker(data, isFile ? &resolveReader : nullptr);
+  extendIndex(index, indexWalker, shouldStop);
+
+  SegmentWalker scanWalker(data, isFile ? &scanReader : nullptr);
+  SegmentWalker resolveWalker(data, isFile ? &resolveReader : nullptr);
+  LineResolver resolver(index, resolveWalker);
+
+  QVector<SearchMatch> batch;
+  qint64 count = 0;
+  int lastPermille = -1;
+  auto report = [&](SearchMatch match) {
+    resolver.resolve(match);
+    batch.append(match);
+    count++;
+    if (batch.size() >= SEARCH_BATCH) {
+      emit matchesFound(batch);
+      batch.clear();
+    }
+    if (count >= SEARCH_MAX_MATCHES) {
+      shouldStop = 1;
+    }
+  };
+  auto reportProgress = [&](const Segment &segment) {
+    int permille = scanWalker.permille(segment);
+    if (permille / 10 != lastPermille / 10) {
+      emit progress(permille / 10);
+    }
+    lastPermille = permille;
+  };
+
+  Segment segment;
+  if (kind != Regex) {
+    const qint64 n = needle.length();
+    const char first = needle[0];
+    QByteArray tail;
+    qint64 tailOffset = 0;
+    while (!shouldStop && scanWalker.next(segment)) {
+      if (!tail.isEmpty()) {
+        // matches straddling the previous segment
+        auto joint = tail + QByteArray(segment.data,
+                                       qMin<qint64>(segment.length, n - 1));
+        for (int i = 0; i < tail.length(); i++) {
+          if (joint.length() - i >= n &&
+              memcmp(joint.constData() + i, needle.constData(), n) == 0) {
+            report(makeMatch(joint.constData(), joint.length(), i, n,
+                             tailOffset + i));
+          }
+        }
+      }
+
+      // memchr is vectorized by the C library; scan in slices so
+      // cancellation and progress stay responsive on huge segments
+      const char *end = segment.data + segment.length;
+      const char *p = segment.data;
+      while (p < end && !shouldStop) {
+        const char *sliceEnd = p + qMin<qint64>(end - p, SEARCH_SLICE);
+        while (p < sliceEnd) {
+          p = (const char *)memchr(p, first, sliceEnd - p);
+          if (!p) {
+            p = sliceEnd;
+            break;
+          }
+          if (end - p >= n && memcmp(p, needle.constData(), n) == 0) {
+            qint64 at = p - segment.data;
+            report(makeMatch(segment.data, segment.length, at, n,
+                             segment.offset + at));
+          }
+          p++;
+        }
+        reportProgress(segment);
+      }
+
+      if (n > 1) {
+        if (segment.length >= n - 1) {
+          tail = QByteArray(end - (n - 1), n - 1);
+        } else {
+          tail = (tail + QByteArray(segment.data, segment.length)).right(n - 1);
+        }
+        tailOffset = segment.offset + segment.length - tail.length();
+      }
+    }
+  } else {
+    QRegularExpression re(regex);
+    QByteArray window;
+    qint64 windowOffset = 0;
+    auto scanWindow = [&](bool final) {
+      qint64 limit = final ? window.length() : window.length() - REGEX_OVERLAP;
+      auto text = QString::fromLatin1(window);
+      auto it = re.globalMatch(text);
+      while (it.hasNext() && !shouldStop) {
+        auto m = it.next();
+        if (m.capturedStart() >= limit) {
+          break;
+        }
+        if (m.capturedLength() == 0) {
+          continue;
+        }
+        report(makeMatch(window.constData(), window.length(),
+                         m.capturedStart(), m.capturedLength(),
+                         windowOffset + m.capturedStart()));
+      }
+      window.remove(0, limit);
+      windowOffset += limit;
+    };
+    while (!shouldStop && scanWalker.next(segment)) {
+      for (qint64 i = 0; i < segment.length && !shouldStop;) {
+        qint64 size = qMin<qint64>(segment.length - i,
+                                   REGEX_WINDOW - window.length() +
+                                       REGEX_OVERLAP);
+        window.append(segment.data + i, size);
+        i += size;
+        if (window.length() >= REGEX_WINDOW + REGEX_OVERLAP) {
+          scanWindow(false);
+        }
+      }
+      reportProgress(segment);
+    }
+    if (!shouldStop) {
+      scanWindow(true);
+    }
+  }
+
+  if (!batch.isEmpty()) {
+    emit matchesFound(batch);
+  }
+  bool cancelled = shouldStop && count < SEARCH_MAX_MATCHES;
+  emit finished(cancelled, count);
+}
@@ -0,0 +1,85 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+struct SearchMatch {
+  qint64 offset = 0;     // in the received byte stream
+  qint64 length = 0;
+  qint64 line = 0;       // 0-based
+  qint64 timestamp = -1; // ns since capture start, -1 if unknown
+  QByteArray context;    // a few bytes around the match
+  int contextStart = 0;  // of the match within context
+};
+Q_DECLARE_METATYPE(SearchMatch)
+
+// Coarse index over the received stream, one entry per block of
+// SEARCH_INDEX_BLOCK bytes, so line numbers and timestamps of a match can
+// be resolved without rescanning from the beginning.
+struct SearchIndex {
+  struct Entry {
+    qint64 offset;
+    qint64 line;
+    qint64 timestamp;
+    qint64 recordPos; // capture record holding offset, 0 for memory
+    qint64 skip;      // bytes of that record's payload before offset
+  };
+  QVector<Entry> entries;
+  qint64 length = 0; // bytes covered
+  qint64 lines = 0;
+
+  void clear() {
+    entries.clear();
+    length = 0;
+    lines = 0;
+  }
+};
+
+// Searches the session scrollback or a capture file for a literal byte
+// string, a hex pattern or a regular expression on a worker thread.
+class SearchEngine : public QObject {
+  Q_OBJECT
+
+public:
+  enum Kind { Text, Hex, Regex };
+
+  explicit SearchEngine(QObject *parent = nullptr);
+  ~SearchEngine();
+
+  // data is shared, not copied; appending to the original is fine
+  bool start(const QByteArray &data, const QString &pattern, Kind kind);
+  bool start(const QString &fileName, const QString &pattern, Kind kind);
+  void cancel();
+  bool isRunning() { return thread && thread->isRunning(); }
+  QString errorString() { return error; }
+  // forget the scrollback index, e.g. after the scrollback was cleared;
+  // stops a running search first since it may be extending the index
+  void resetMemoryIndex();
+
+signals:
+  void matchesFound(QVector<SearchMatch> matches);
+  void progress(int percent);
+  void finished(bool cancelled, qint64 count);
+
+private:
+  bool compile(const QString &pattern, Kind kind);
+  bool launch(const QByteArray &data, const QString &fileName);
+  void run(QByteArray data, QString fileName);
+
+  QThread *thread;
+  QAtomicInt shouldStop;
+  QString error;
+  Kind kind;
+  QByteArray needle;
+  QString regex;
+  SearchIndex memoryIndex;
+  SearchIndex fileIndex;
+  QString fileIndexName;
+  qint64 fileIndexSize;
+};
+
+#endif
@@ -0,0 +1,447 @@
+#include "sendencoder.h"
+#include <QTextCodec>
+#include <cstring>
+
+// input consumed per step, and roughly the size of each write
+#define CHUNK_SIZE (64 * 1024)
+
+// classes of input bytes for the table driven decoders
+#define CLASS_SKIP 0x40
+#define CLASS_PREFIX 0x41
+#define CLASS_PAD 0x42
+#define CLASS_PERCENT 0x43
+#define CLASS_INVALID 0xFF
+
+namespace {
+
+struct DecodeTables {
+  quint8 hex[256];
+  quint8 base64[256];
+
+  DecodeTables() {
+    memset(hex, CLASS_INVALID, sizeof(hex));
+    memset(base64, CLASS_INVALID, sizeof(base64));
+    for (int i = 0; i < 10; i++) {
+      hex['0' + i] = i;
+    }
+    for (int i = 0; i < 6; i++) {
+      hex['a' + i] = hex['A' + i] = 10 + i;
+    }
+    // separators people paste along with hex dumps
+    for (auto ch : {' ', '\t', '\r', '\n', ','}) {
+      hex[(quint8)ch] = CLASS_SKIP;
+    }
+    hex['x'] = hex['X'] = CLASS_PREFIX;
+
+    for (int i = 0; i < 26; i++) {
+      base64['A' + i] = i;
+      base64['a' + i] = 26 + i;
+    }
+    for (int i = 0; i < 10; i++) {
+      base64['0' + i] = 52 + i;
+    }
+    // both the standard and the url safe alphabet
+    base64['+'] = base64['-'] = 62;
+    base64['/'] = base64['_'] = 63;
+    for (auto ch : {' ', '\t', '\r', '\n'}) {
+      base64[(quint8)ch] = CLASS_SKIP;
+    }
+    base64['='] = CLASS_PAD;
+  }
+};
+
+const DecodeTables tables;
+
+// A streaming decoder. feed() returns the offset of the first invalid input
+// byte or -1; out may be null to only validate. finish() flushes what is
+// left and reports input that ended in the middle of a unit.
+class Decoder {
+public:
+  virtual ~Decoder() {}
+  virtual qint64 feed(const char *data, qint64 length, QByteArray *out) = 0;
+  virtual qint64 finish(QByteArray *out) = 0;
+
+protected:
+  qint64 consumed = 0;
+};
+
+// Hex digits in pairs. Separators may appear anywhere and a pair may be
+// prefixed with 0x.
+class HexDecoder : public Decoder {
+public:
+  qint64 feed(const char *data, qint64 length, QByteArray *out) override {
+    auto in = (const quint8 *)data;
+    char *dst = nullptr;
+    if (out) {
+      out->resize(length / 2 + 1);
+      dst = out->data();
+    }
+    qint64 produced = 0;
+    for (qint64 i = 0; i < length; i++) {
+      quint8 value = tables.hex[in[i]];
+      if (value < 16) {
+        if (high >= 0) {
+          if (dst) {
+            dst[produced] = (high << 4) | value;
+          }
+          produced++;
+          high = -1;
+        } else if (i + 1 < length && tables.hex[in[i + 1]] < 16) {
+          // the common case of two adjacent digits
+          if (dst) {
+            dst[produced] = (value << 4) | tables.hex[in[i + 1]];
+          }
+          produced++;
+          i++;
+        } else {
+          high = value;
+          highOffset = consumed + i;
+        }
+      } else if (value == CLASS_PREFIX && high == 0) {
+        high = -1;
+      } else if (value != CLASS_SKIP) {
+        return consumed + i;
+      }
+    }
+    consumed += length;
+    if (out) {
+      out->resize(produced);
+    }
+    return -1;
+  }
+
+  qint64 finish(QByteArray *out) override {
+    if (out) {
+      out->clear();
+    }
+    return high >= 0 ? highOffset : -1;
+  }
+
+private:
+  int high = -1;
+  qint64 highOffset = 0;
+};
+
+// Base64 with optional padding. Anything after the padding but whitespace
+// is an error.
+class Base64Decoder : public Decoder {
+public:
+  qint64 feed(const char *data, qint64 length, QByteArray *out) override {
+    auto in = (const quint8 *)data;
+    char *dst = nullptr;
+    if (out) {
+      out->resize(length / 4 * 3 + 3);
+      dst = out->data();
+    }
+    qint64 produced = 0;
+    for (qint64 i = 0; i < length; i++) {
+      quint8 value = tables.base64[in[i]];
+      if (value < 64 && !padded) {
+        bits = (bits << 6) | value;
+        lastOffset = consumed + i;
+        if (++count == 4) {
+          if (dst) {
+            dst[produced] = bits >> 16;
+            dst[produced + 1] = bits >> 8;
+            dst[produced + 2] = bits;
+          }
+          produced += 3;
+          count = 0;
+        }
+      } else if (value == CLASS_PAD && (padded || count >= 2)) {
+        if (!padded) {
+          produced += flush(dst ? dst + produced : nullptr);
+          padded = true;
+        }
+      } else if (value != CLASS_SKIP) {
+        return consumed + i;
+      }
+    }
+    consumed += length;
+    if (out) {
+      out->resize(produced);
+    }
+    return -1;
+  }
+
+  qint64 finish(QByteArray *out) override {
+    char tail[2];
+    if (count == 1) {
+      return lastOffset;
+    }
+    int produced = flush(tail);
+    if (out) {
+      *out = QByteArray(tail, produced);
+    }
+    return -1;
+  }
+
+private:
+  // bytes held in a group cut short by padding or the end of input
+  int flush(char *dst) {
+    int produced = 0;
+    if (count == 2) {
+      if (dst) {
+        dst[0] = bits >> 4;
+      }
+      produced = 1;
+    } else if (count == 3) {
+      if (dst) {
+        dst[0] = bits >> 10;
+        dst[1] = bits >> 2;
+      }
+      produced = 2;
+    }
+    count = 0;
+    return produced;
+  }
+
+  quint32 bits = 0;
+  int count = 0;
+  bool padded = false;
+  qint64 lastOffset = 0;
+};
+
+// %XX escapes. A % not followed by two hex digits is kept as is.
+class PercentDecoder : public Decoder {
+public:
+  qint64 feed(const char *data, qint64 length, QByteArray *out) override {
+    if (!out) {
+      return -1;
+    }
+    out->resize(length + pending.length());
+    char *dst = out->data();
+    qint64 produced = 0;
+    for (qint64 i = 0; i < length; i++) {
+      char ch = data[i];
+      if (pending.isEmpty()) {
+        if (ch == '%') {
+          pending.append(ch);
+        } else {
+          dst[produced++] = ch;
+        }
+        continue;
+      }
+      if (tables.hex[(quint8)ch] < 16) {
+        pending.append(ch);
+        if (pending.length() == 3) {
+          dst[produced++] = (tables.hex[(quint8)pending[1]] << 4) |
+                            tables.hex[(quint8)pending[2]];
+          pending.clear();
+        }
+      } else {
+        memcpy(dst + produced, pending.constData(), pending.length());
+        produced += pending.length();
+        pending.clear();
+        i--; // look at this byte again without a pending escape
+      }
+    }
+    out->resize(produced);
+    return -1;
+  }
+
+  qint64 finish(QByteArray *out) override {
+    if (out) {
+      *out = pending;
+    }
+    pending.clear();
+    return -1;
+  }
+
+private:
+  QByteArray pending;
+};
+
+Decoder *makeDecoder(SendEncoder::Format format) {
+  if (format == SendEncoder::Hex) {
+    return new HexDecoder;
+  } else if (format == SendEncoder::Base64) {
+    return new Base64Decoder;
+  }
+  return new PercentDecoder;
+}
+
+// indexed by SendEncoder::Format
+const char *codecNames[] = {"UTF-8", "Big5", "GB18030", "Shift-JIS"};
+const char *decoderNames[] = {"hex", "base64", "percent encoding"};
+
+} // namespace
+
+SendEncoder::SendEncoder(QObject *parent) : QObject(parent) {
+  shouldStop = 0;
+  cancelled = 0;
+  thread = QThread::create([this] { run(); });
+  thread->start();
+}
+
+SendEncoder::~SendEncoder() {
+  {
+    QMutexLocker locker(&mutex);
+    shouldStop = 1;
+    cancelled = 1;
+    wake.wakeAll();
+  }
+  thread->wait();
+  delete thread;
+}
+
+void SendEncoder::send(SerialPort *port, const QString &text, Format format,
+                       const QByteArray &suffix, const QString &echo) {
+  QMutexLocker locker(&mutex);
+  jobs.append(Job{port, text, format, suffix, echo});
+  wake.wakeAll();
+}
+
+void SendEncoder::cancel() {
+  QMutexLocker locker(&mutex);
+  jobs.clear();
+  cancelled = 1;
+}
+
+void SendEncoder::run() {
+  while (true) {
+    Job job;
+    {
+      QMutexLocker locker(&mutex);
+      while (jobs.isEmpty() && !shouldStop) {
+        wake.wait(&mutex);
+      }
+      if (shouldStop) {
+        return;
+      }
+      job = jobs.takeFirst();
+      // anything cancelled was queued before this job
+      cancelled = 0;
+    }
+    encode(job);
+  }
+}
+
+bool SendEncoder::write(SerialPort *port, const QByteArray &data,
+                        qint64 baseline) {
+  if (data.isEmpty()) {
+    return !cancelled;
+  }
+  if (!port->waitForBacklog(baseline, CHUNK_SIZE * SEND_WINDOW_CHUNKS,
+                            cancelled)) {
+    return false;
+  }
+  port->write(data);
+  emit sent(data);
+  return true;
+}
+
+void SendEncoder::encode(const Job &job) {
+  const qint64 baseline = job.port->bytesToWrite();
+  QByteArray chunk;
+
+  if (job.format < Hex) {
+    emit accepted(job.echo);
+    if (job.format == Utf8) {
+      auto data = job.text.toUtf8();
+      for (int i = 0; i < data.length(); i += CHUNK_SIZE) {
+        if (!write(job.port, data.mid(i, CHUNK_SIZE), baseline)) {
+          return;
+        }
+      }
+    } else {
+      auto encoder =
+          QTextCodec::codecForName(codecNames[job.format])->makeEncoder();
+      for (int i = 0; i < job.text.length(); i += CHUNK_SIZE) {
+        int length = qMin(CHUNK_SIZE, job.text.length() - i);
+        // the encoder carries a surrogate pair cut at the chunk boundary
+        chunk = encoder->fromUnicode(job.text.constData() + i, length);
+        if (!write(job.port, chunk, baseline)) {
+          delete encoder;
+          return;
+        }
+      }
+      delete encoder;
+    }
+    write(job.port, job.suffix, baseline);
+    return;
+  }
+
+  // the syntax only uses ASCII, so up to the first error byte offsets in
+  // the UTF-8 input are also character offsets in the text
+  auto data = job.text.toUtf8();
+
+  // validate everything first so that nothing goes out for bad input
+  Decoder *decoder = makeDecoder(job.format);
+  qint64 error = decoder->feed(data.constData(), data.length(), nullptr);
+  if (error < 0) {
+    error = decoder->finish(nullptr);
+  }
+  delete decoder;
+  if (error >= 0) {
+    emit failed(error, QString("Invalid %1 at offset %2")
+                           .arg(decoderNames[job.format - Hex])
+                           .arg(error));
+    return;
+  }
+  emit accepted(job.echo);
+
+  decoder = makeDecoder(job.format);
+  for (int i = 0; i < data.length(); i += CHUNK_SIZE) {
+    int length = qMin(CHUNK_SIZE, data.length() - i);
+    decoder->feed(data.constData() + i, length, &chunk);
+    if (!write(job.port, chunk, baseline)) {
+      delete decoder;
+      return;
+    }
+  }
+  decoder->finish(&chunk);
+  delete decoder;
+  if (write(job.port, chunk, baseline)) {
+    write(job.port, job.suffix, baseline);
+  }
+}
+
+qint64 SendEncoder::decode(const QString &text, Format format,
+                           QByteArray *out) {
+  out->clear();
+  if (format == Utf8) {
+    *out = text.toUtf8();
+    return -1;
+  } else if (format < Hex) {
+    *out = QTextCodec::codecForName(codecNames[format])->fromUnicode(text);
+    return -1;
+  }
+
+  auto data = text.toUtf8();
+  Decoder *decoder = makeDecoder(format);
+  QByteArray tail;
+  qint64 error = decoder->feed(data.constData(), data.length(), out);
+  if (error < 0) {
+    error = decoder->finish(&tail);
+    out->append(tail);
+  }
+  delete decoder;
+  if (error >= 0) {
+    out->clear();
+  }
+  return error;
+}
+
+QByteArray MatchRule::bytes(const QString &text) const {
+  QByteArray data;
+  SendEncoder::decode(text, hex ? SendEncoder::Hex : SendEncoder::Utf8,
+                      &data);
+  return data;
+}
+
+QString MatchRule::validate() const {
+  if (!hex) {
+    return QString();
+  }
+  QByteArray data;
+  qint64 error = SendEncoder::decode(pattern, SendEncoder::Hex, &data);
+  if (error >= 0) {
+    return QString("Invalid hex in the pattern at offset %1").arg(error);
+  }
+  error = SendEncoder::decode(response, SendEncoder::Hex, &data);
+  if (error >= 0) {
+    return QString("Invalid hex in the response at offset %1").arg(error);
+  }
+  return QString();
+}
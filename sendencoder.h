@@ -0,0 +1,80 @@
+#ifndef SENDENCODER_H
+#define SENDENCODER_H
+
+#include "drivers/serialport.h"
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QWaitCondition>
+
+// Encodes text typed or pasted into the send box on a worker thread and
+// streams the result into the port's write queue chunk by chunk, so that
+// multi-megabyte hex dumps neither block the window nor need a second full
+// copy in memory. Sends are queued and go out in the order given.
+class SendEncoder : public QObject {
+  Q_OBJECT
+
+public:
+  // same order as the "parse as" combo box
+  enum Format { Utf8, Big5, GB18030, ShiftJIS, Hex, Base64, Percent };
+
+  explicit SendEncoder(QObject *parent = nullptr);
+  ~SendEncoder();
+
+  // suffix (a line ending) is sent verbatim after the encoded text, echo is
+  // handed back through accepted() once the input is known to be valid
+  void send(SerialPort *port, const QString &text, Format format,
+            const QByteArray &suffix, const QString &echo);
+  // drops queued sends and stops the current one
+  void cancel();
+  // The whole text at once, for short input. Returns the character offset
+  // of the first invalid input, or -1 with the bytes in out.
+  static qint64 decode(const QString &text, Format format, QByteArray *out);
+
+signals:
+  void accepted(QString echo);
+  // offset is in characters from the start of the text
+  void failed(qint64 offset, QString message);
+  // every chunk handed to the port, for statistics and capture
+  void sent(QByteArray data);
+
+private:
+  struct Job {
+    SerialPort *port;
+    QString text;
+    Format format;
+    QByteArray suffix;
+    QString echo;
+  };
+
+  void run();
+  void encode(const Job &job);
+  bool write(SerialPort *port, const QByteArray &data, qint64 baseline);
+
+  QThread *thread;
+  QMutex mutex;
+  QWaitCondition wake;
+  QList<Job> jobs;
+  QAtomicInt shouldStop;
+  QAtomicInt cancelled;
+};
+
+// The pattern and response of a trigger or an auto-responder rule, as text
+// or as hex parsed like the send box.
+struct MatchRule {
+  QString pattern;
+  // pattern and response are hex instead of text
+  bool hex = false;
+  QString response;
+
+  QByteArray patternBytes() const { return bytes(pattern); }
+  QByteArray responseBytes() const { return bytes(response); }
+  // empty if both decode, otherwise what is wrong
+  QString validate() const;
+
+private:
+  QByteArray bytes(const QString &text) const;
+};
+
+#endif
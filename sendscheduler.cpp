@@ -0,0 +1,187 @@
+#include "sendscheduler.h"
+#include <chrono>
+#include <thread>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/prctl.h>
+#include <time.h>
+#endif
+
+#define UPDATE_INTERVAL_NS 250000000LL
+// long waits are sliced so that stop() does not block
+#define SLEEP_SLICE_NS 20000000LL
+// sends allowed in flight before waiting for the port, as in FileSender
+#define WINDOW_SENDS 4
+
+// upper bounds of the histogram buckets in ns, the last one is open ended
+static const qint64 bucketLimits[JITTER_BUCKETS - 1] = {
+    1000,    2000,    5000,    10000,   20000,   50000,   100000,
+    200000,  500000,  1000000, 2000000, 5000000, 10000000};
+
+QString SchedulerStatistics::bucketLabel(int bucket) {
+  auto format = [](qint64 ns) {
+    return ns >= 1000000 ? QString("%1 ms").arg(ns / 1000000)
+                         : QString("%1 us").arg(ns / 1000);
+  };
+  if (bucket == 0) {
+    return QString("< %1").arg(format(bucketLimits[0]));
+  } else if (bucket == JITTER_BUCKETS - 1) {
+    return QString(">= %1").arg(format(bucketLimits[bucket - 1]));
+  }
+  return QString("%1 - %2").arg(format(bucketLimits[bucket - 1]),
+                                format(bucketLimits[bucket]));
+}
+
+SendScheduler::SendScheduler(QObject *parent) : QObject(parent) {
+  qRegisterMetaType<SchedulerStatistics>();
+  thread = nullptr;
+  shouldStop = 0;
+  jitterSum = 0;
+}
+
+SendScheduler::~SendScheduler() { stop(); }
+
+void SendScheduler::sleepUntil(qint64 deadlineNs) {
+#ifdef Q_OS_LINUX
+  // SerialPort::now() reads CLOCK_MONOTONIC here, as Qt's timers do
+  timespec ts;
+  ts.tv_sec = deadlineNs / 1000000000LL;
+  ts.tv_nsec = deadlineNs % 1000000000LL;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+         EINTR) {
+  }
+#else
+  qint64 remaining = deadlineNs - SerialPort::now();
+  if (remaining > 0) {
+    std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+  }
+#endif
+}
+
+bool SendScheduler::start(SerialPort *port, const QByteArray &data, Mode mode,
+                          qint64 intervalUs, qint64 count) {
+  stop();
+  if (!port->status().open || data.isEmpty() || intervalUs < MIN_INTERVAL_US) {
+    return false;
+  }
+
+  {
+    QMutexLocker locker(&mutex);
+    stats = SchedulerStatistics();
+    jitterSum = 0;
+  }
+  shouldStop = 0;
+  thread = QThread::create([this, port, data, mode, intervalUs, count] {
+    run(port, data, mode, intervalUs * 1000, count);
+  });
+  thread->start(QThread::TimeCriticalPriority);
+  return true;
+}
+
+void SendScheduler::stop() {
+  if (thread) {
+    shouldStop = 1;
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+  }
+}
+
+SchedulerStatistics SendScheduler::statistics() {
+  QMutexLocker locker(&mutex);
+  return stats;
+}
+
+void SendScheduler::record(qint64 lateNs, qint64 bytes) {
+  QMutexLocker locker(&mutex);
+  if (stats.sends == 0 || lateNs < stats.minJitterNs) {
+    stats.minJitterNs = lateNs;
+  }
+  stats.maxJitterNs = qMax(stats.maxJitterNs, lateNs);
+  stats.sends++;
+  stats.bytes += bytes;
+  jitterSum += lateNs;
+  stats.meanJitterNs = jitterSum / stats.sends;
+
+  int bucket = 0;
+  while (bucket < JITTER_BUCKETS - 1 && lateNs >= bucketLimits[bucket]) {
+    bucket++;
+  }
+  stats.histogram[bucket]++;
+}
+
+void SendScheduler::run(SerialPort *port, QByteArray data, Mode mode,
+                        qint64 intervalNs, qint64 count) {
+#ifdef Q_OS_LINUX
+  // the default 50 us timer slack would dominate the jitter
+  prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+
+  // what goes out at each deadline
+  QList<QByteArray> pieces;
+  if (mode == Periodic) {
+    pieces.append(data);
+  } else if (mode == PerByte) {
+    for (int i = 0; i < data.length(); i++) {
+      pieces.append(data.mid(i, 1));
+    }
+  } else {
+    int begin = 0;
+    while (begin < data.length()) {
+      int end = data.indexOf('\n', begin);
+      end = end < 0 ? data.length() : end + 1;
+      pieces.append(data.mid(begin, end - begin));
+      begin = end;
+    }
+  }
+
+  qint64 largest = 0;
+  for (auto &piece : pieces) {
+    largest = qMax<qint64>(largest, piece.length());
+  }
+  const qint64 baseline = port->bytesToWrite();
+  const qint64 window = largest * WINDOW_SENDS;
+
+  qint64 deadline = SerialPort::now();
+  qint64 lastUpdate = deadline;
+  qint64 sends = 0;
+  int index = 0;
+  while (!shouldStop) {
+    while (!shouldStop && deadline - SerialPort::now() > SLEEP_SLICE_NS) {
+      sleepUntil(SerialPort::now() + SLEEP_SLICE_NS);
+    }
+    // a port slower than the schedule shows up as lateness and overruns
+    // rather than as an ever growing queue
+    if (!port->waitForBacklog(baseline, window, shouldStop)) {
+      break;
+    }
+    sleepUntil(deadline);
+    qint64 late = SerialPort::now() - deadline;
+    port->write(pieces[index]);
+    record(late, pieces[index].length());
+    sends++;
+
+    if (mode != Periodic) {
+      if (++index >= pieces.size()) {
+        break;
+      }
+    } else if (count > 0 && sends >= count) {
+      break;
+    }
+
+    deadline += intervalNs;
+    qint64 current = SerialPort::now();
+    if (intervalNs > 0 && current - deadline > intervalNs) {
+      // fell behind by more than a period, do not burst to catch up
+      QMutexLocker locker(&mutex);
+      stats.overruns += (current - deadline) / intervalNs;
+      deadline += (current - deadline) / intervalNs * intervalNs;
+    }
+    if (current - lastUpdate > UPDATE_INTERVAL_NS) {
+      lastUpdate = current;
+      emit statisticsUpdated(statistics());
+    }
+  }
+  emit finished(statistics());
+}
@@ -0,0 +1,69 @@
+#ifndef SENDSCHEDULER_H
+#define SENDSCHEDULER_H
+
+#include "drivers/serialport.h"
+#include <QAtomicInt>
+#include <QMetaType>
+#include <QMutex>
+#include <QObject>
+#include <QThread>
+#include <QVector>
+
+#define JITTER_BUCKETS 14
+// shortest period start() accepts, below it the sends just queue up
+#define MIN_INTERVAL_US 10
+
+struct SchedulerStatistics {
+  qint64 sends = 0;
+  qint64 bytes = 0;
+  qint64 overruns = 0; // sends that missed a whole period
+  qint64 minJitterNs = 0;
+  qint64 maxJitterNs = 0;
+  qint64 meanJitterNs = 0;
+  // lateness of each send, see bucketLabel()
+  qint64 histogram[JITTER_BUCKETS] = {0};
+
+  static QString bucketLabel(int bucket);
+};
+Q_DECLARE_METATYPE(SchedulerStatistics)
+
+// Sends on a dedicated thread with absolute monotonic deadlines, either a
+// fixed sequence every N microseconds or a buffer paced byte by byte or
+// line by line. Lateness against the deadline is collected per send.
+class SendScheduler : public QObject {
+  Q_OBJECT
+
+public:
+  enum Mode { Periodic, PerByte, PerLine };
+
+  explicit SendScheduler(QObject *parent = nullptr);
+  ~SendScheduler();
+
+  // count == 0 repeats a periodic send until stopped, intervalUs is at
+  // least MIN_INTERVAL_US
+  bool start(SerialPort *port, const QByteArray &data, Mode mode,
+             qint64 intervalUs, qint64 count = 0);
+  void stop();
+  bool isRunning() { return thread && thread->isRunning(); }
+  SchedulerStatistics statistics();
+
+  // absolute sleep until a SerialPort::now() deadline
+  static void sleepUntil(qint64 deadlineNs);
+
+signals:
+  void statisticsUpdated(SchedulerStatistics statistics);
+  void finished(SchedulerStatistics statistics);
+
+private:
+  void run(SerialPort *port, QByteArray data, Mode mode, qint64 intervalNs,
+           qint64 count);
+  void record(qint64 lateNs, qint64 bytes);
+
+  QThread *thread;
+  QAtomicInt shouldStop;
+  QMutex mutex;
+  SchedulerStatistics stats;
+  qint64 jitterSum;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#include "sendschedulerdialog.h"
+#include "sendencoder.h"
+#include <QFile>
+#include <QFileDialog>
+#include <QFontDatabase>
+#include <QSettings>
+
+#define HISTOGRAM_WIDTH 40
+#define MAX_LOAD_SIZE (16 * 1024 * 1024)
+
+SendSchedulerDialog::SendSchedulerDialog(SendScheduler *scheduler,
+                                         SerialPort *port, QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->scheduler = scheduler;
+  this->port = port;
+  histogramPlainTextEdit->setFont(
+      QFontDatabase::systemFont(QFontDatabase::FixedFont));
+
+  QSettings settings;
+  dataPlainTextEdit->setPlainText(
+      settings.value("scheduler/data").toString());
+  formatComboBox->setCurrentIndex(settings.value("scheduler/format").toInt());
+  modeComboBox->setCurrentIndex(settings.value("scheduler/mode").toInt());
+  intervalSpinBox->setValue(
+      settings.value("scheduler/interval", 1000).toInt());
+  countSpinBox->setValue(settings.value("scheduler/count").toInt());
+  onModeChanged(modeComboBox->currentIndex());
+
+  connect(scheduler, SIGNAL(statisticsUpdated(SchedulerStatistics)), this,
+          SLOT(onStatistics(SchedulerStatistics)));
+  connect(scheduler, SIGNAL(finished(SchedulerStatistics)), this,
+          SLOT(onFinished(SchedulerStatistics)));
+}
+
+void SendSchedulerDialog::onLoad() {
+  auto fileName = QFileDialog::getOpenFileName(this, "Load Data");
+  if (fileName.isEmpty()) {
+    return;
+  }
+  QFile file(fileName);
+  if (!file.open(QIODevice::ReadOnly) || file.size() > MAX_LOAD_SIZE) {
+    statisticsLabel->setText("Cannot load " + fileName);
+    return;
+  }
+  auto data = file.readAll();
+  if (formatComboBox->currentIndex() == 1) {
+    dataPlainTextEdit->setPlainText(data.toHex(' '));
+  } else {
+    dataPlainTextEdit->setPlainText(QString::fromLocal8Bit(data));
+  }
+}
+
+void SendSchedulerDialog::onModeChanged(int index) {
+  // only a periodic send has a repeat count
+  countSpinBox->setEnabled(index == 0);
+}
+
+qint64 SendSchedulerDialog::parseData(QByteArray &data) {
+  auto text = dataPlainTextEdit->toPlainText();
+  if (formatComboBox->currentIndex() == 0) {
+    data = text.toLocal8Bit();
+    return -1;
+  }
+  // parsed like the send box
+  return SendEncoder::decode(text, SendEncoder::Hex, &data);
+}
+
+void SendSchedulerDialog::onStart() {
+  if (!port->status().open) {
+    statisticsLabel->setText("Serial port is not open");
+    return;
+  }
+  QByteArray data;
+  qint64 offset = parseData(data);
+  if (offset >= 0) {
+    statisticsLabel->setText(QString("Invalid hex at offset %1").arg(offset));
+    return;
+  }
+
+  auto mode = (SendScheduler::Mode)modeComboBox->currentIndex();
+  if (!scheduler->start(port, data, mode, intervalSpinBox->value(),
+                        countSpinBox->value())) {
+    statisticsLabel->setText("Nothing to send");
+    return;
+  }
+
+  QSettings settings;
+  settings.setValue("scheduler/data", dataPlainTextEdit->toPlainText());
+  settings.setValue("scheduler/format", formatComboBox->currentIndex());
+  settings.setValue("scheduler/mode", modeComboBox->currentIndex());
+  settings.setValue("scheduler/interval", intervalSpinBox->value());
+  settings.setValue("scheduler/count", countSpinBox->value());
+  startButton->setEnabled(false);
+  stopButton->setEnabled(true);
+}
+
+void SendSchedulerDialog::onStop() { scheduler->stop(); }
+
+void SendSchedulerDialog::onStatistics(SchedulerStatistics statistics) {
+  showStatistics(statistics);
+}
+
+void SendSchedulerDialog::onFinished(SchedulerStatistics statistics) {
+  showStatistics(statistics);
+  startButton->setEnabled(true);
+  stopButton->setEnabled(false);
+}
+
+void SendSchedulerDialog::showStatistics(
+    const SchedulerStatistics &statistics) {
+  statisticsLabel->setText(
+      QString("%1 sends, %2 bytes, %3 overruns\n"
+              "Jitter: min %4 us, mean %5 us, max %6 us")
+          .arg(statistics.sends)
+          .arg(statistics.bytes)
+          .arg(statistics.overruns)
+          .arg(statistics.minJitterNs / 1000.0, 0, 'f', 1)
+          .arg(statistics.meanJitterNs / 1000.0, 0, 'f', 1)
+          .arg(statistics.maxJitterNs / 1000.0, 0, 'f', 1));
+
+  qint64 peak = 1;
+  for (auto count : statistics.histogram) {
+    peak = qMax(peak, count);
+  }
+  QString text;
+  for (int i = 0; i < JITTER_BUCKETS; i++) {
+    auto count = statistics.histogram[i];
+    text += QString("%1 %2 %3\n")
+                .arg(SchedulerStatistics::bucketLabel(i), -16)
+                .arg(QString(int(count * HISTOGRAM_WIDTH / peak), '#'),
+                     -HISTOGRAM_WIDTH)
+                .arg(count);
+  }
+  histogramPlainTextEdit->setPlainText(text);
+}
+
+void SendSchedulerDialog::done(int result) {
+  scheduler->stop();
+  QDialog::done(result);
+}
@@ -0,0 +1,33 @@
+#ifndef SENDSCHEDULERDIALOG_H
+#define SENDSCHEDULERDIALOG_H
+
+#include "sendscheduler.h"
+#include "ui_sendschedulerdialog.h"
+#include <QDialog>
+
+class SendSchedulerDialog : public QDialog, private Ui::SendSchedulerDialog {
+  Q_OBJECT
+
+public:
+  SendSchedulerDialog(SendScheduler *scheduler, SerialPort *port,
+                      QWidget *parent = nullptr);
+
+private slots:
+  void onLoad();
+  void onModeChanged(int index);
+  void onStart();
+  void onStop();
+  void onStatistics(SchedulerStatistics statistics);
+  void onFinished(SchedulerStatistics statistics);
+
+private:
+  // -1, or the offset of the first invalid character in hex mode
+  qint64 parseData(QByteArray &data);
+  void showStatistics(const SchedulerStatistics &statistics);
+  void done(int result) override;
+
+  SendScheduler *scheduler;
+  SerialPort *port;
+};
+
+#endif
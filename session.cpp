@@ -0,0 +1,139 @@
+#include "session.h"
+#include <QDateTime>
+#include <QScrollBar>
+#include <QTextCodec>
+
+#define INDEX_FORMAT_HEX 4
+// received data waiting for the next tick, older data is dropped beyond it
+#define MAX_PENDING_BYTES (1024 * 1024)
+#define MAX_LINES 2000
+#define HEX_BYTES_PER_LINE 16
+
+// same order as the format combo box
+static const char *codecNames[] = {"UTF-8", "Big5", "GB18030", "Shift-JIS"};
+
+Session::Session(SerialPort *port, const QString &description,
+                 QWidget *parent)
+    : QFrame(parent) {
+  setupUi(this);
+  serialPort = port;
+  this->description = description;
+  decoder = nullptr;
+  hexColumn = 0;
+  bytesReceived = 0;
+  bytesDropped = 0;
+  shownBytes = 0;
+  shownTime = QDateTime::currentMSecsSinceEpoch();
+
+  portLabel->setText(description + " (opening)");
+  textEdit->setMaximumBlockCount(MAX_LINES);
+  onFormatChanged(formatComboBox->currentIndex());
+
+  // queued from whichever thread read the data, drawn on the next tick; a
+  // stage rather than a direct connection so that removeStage() waits out
+  // a call in progress before the session goes away
+  serialPort->addStage(this);
+  connect(serialPort, SIGNAL(opened(bool)), this, SLOT(onOpened(bool)));
+  connect(serialPort, SIGNAL(errorOccurred(QString)), this,
+          SLOT(onPortError(QString)));
+}
+
+Session::~Session() {
+  serialPort->removeStage(this);
+  disconnect(serialPort, SIGNAL(opened(bool)), this, SLOT(onOpened(bool)));
+  disconnect(serialPort, SIGNAL(errorOccurred(QString)), this,
+             SLOT(onPortError(QString)));
+  serialPort->closeAsync();
+  delete decoder;
+}
+
+void Session::process(const QByteArray &data, qint64) {
+  QMutexLocker locker(&mutex);
+  bytesReceived += data.length();
+  pending.append(data);
+  if (pending.length() > MAX_PENDING_BYTES) {
+    int excess = pending.length() - MAX_PENDING_BYTES;
+    pending.remove(0, excess);
+    bytesDropped += excess;
+  }
+}
+
+void Session::onOpened(bool ok) {
+  portLabel->setText(ok ? description : description + " (failed to open)");
+}
+
+void Session::onPortError(QString message) {
+  // nothing more will arrive, leave it to the user to close the session
+  portLabel->setText(QString("%1 (%2)").arg(description, message));
+}
+
+void Session::render() {
+  QByteArray data;
+  qint64 received;
+  qint64 dropped;
+  {
+    QMutexLocker locker(&mutex);
+    data.swap(pending);
+    received = bytesReceived;
+    dropped = bytesDropped;
+  }
+
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  if (now - shownTime >= 1000) {
+    QString text = QString("%1 B, %2 B/s")
+                       .arg(received)
+                       .arg((received - shownBytes) * 1000 / (now - shownTime));
+    if (dropped) {
+      text += QString(", %1 B not shown").arg(dropped);
+    }
+    statisticsLabel->setText(text);
+    shownBytes = received;
+    shownTime = now;
+  }
+  if (data.isEmpty()) {
+    return;
+  }
+
+  QString text;
+  if (decoder) {
+    text = decoder->toUnicode(data);
+  } else {
+    static const char digits[] = "0123456789ABCDEF";
+    text.reserve(data.length() * 3 + data.length() / HEX_BYTES_PER_LINE);
+    for (auto byte : data) {
+      text += digits[(quint8)byte >> 4];
+      text += digits[byte & 0x0F];
+      if (++hexColumn == HEX_BYTES_PER_LINE) {
+        text += '\n';
+        hexColumn = 0;
+      } else {
+        text += ' ';
+      }
+    }
+  }
+
+  auto scrollBar = textEdit->verticalScrollBar();
+  bool atBottom = scrollBar->value() == scrollBar->maximum();
+  QTextCursor cursor(textEdit->document());
+  cursor.movePosition(QTextCursor::End);
+  cursor.insertText(text);
+  if (atBottom) {
+    scrollBar->setValue(scrollBar->maximum());
+  }
+}
+
+void Session::onFormatChanged(int index) {
+  delete decoder;
+  decoder = nullptr;
+  hexColumn = 0;
+  if (index >= 0 && index < INDEX_FORMAT_HEX) {
+    decoder = QTextCodec::codecForName(codecNames[index])->makeDecoder();
+  }
+}
+
+void Session::onClear() {
+  textEdit->clear();
+  hexColumn = 0;
+}
+
+void Session::onClose() { emit closeRequested(this); }
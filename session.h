@@ -0,0 +1,57 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "drivers/serialport.h"
+#include "ui_session.h"
+#include <QFrame>
+#include <QMutex>
+#include <QTextDecoder>
+
+// A port monitored next to the main one, with its own decoder, buffer,
+// statistics and view. Received data is only queued as it arrives; the
+// owner calls render() for all sessions from one shared timer, so the GUI
+// cost follows the amount of data rather than the number of ports or the
+// number of chunks they deliver.
+class Session : public QFrame, public ReceiveStage, private Ui::Session {
+  Q_OBJECT
+
+public:
+  // port is being opened by the caller with openAsync(), the outcome
+  // shows on the label; it is closed on destruction
+  Session(SerialPort *port, const QString &description,
+          QWidget *parent = nullptr);
+  ~Session();
+
+  SerialPort *port() { return serialPort; }
+  // shows what arrived since the last call
+  void render();
+  // on the thread that read the data, only queues it
+  void process(const QByteArray &data, qint64 timestamp) override;
+
+signals:
+  void closeRequested(Session *session);
+
+private slots:
+  void onOpened(bool ok);
+  void onPortError(QString message);
+  void onFormatChanged(int index);
+  void onClear();
+  void onClose();
+
+private:
+  SerialPort *serialPort;
+  QString description;
+  QTextDecoder *decoder;
+  int hexColumn;
+
+  QMutex mutex;
+  QByteArray pending;
+  qint64 bytesReceived;
+  qint64 bytesDropped;
+
+  // statistics as last shown, only touched by render()
+  qint64 shownBytes;
+  qint64 shownTime;
+};
+
+#endif
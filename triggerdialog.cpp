@@ -0,0 +1,129 @@
+#include "triggerdialog.h"
+#include <QComboBox>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QTimer>
+
+#define COLUMN_PATTERN 0
+#define COLUMN_HEX 1
+#define COLUMN_ACTION 2
+#define COLUMN_RESPONSE 3
+#define COLUMN_COUNT 4
+
+TriggerDialog::TriggerDialog(const QVector<Trigger> &triggers, bool ignoreCase,
+                             QVector<qint64> *counts, QWidget *parent)
+    : QDialog(parent) {
+  setupUi(this);
+  this->counts = counts;
+  ignoreCaseCheckBox->setChecked(ignoreCase);
+  triggerTableWidget->horizontalHeader()->setSectionResizeMode(
+      COLUMN_PATTERN, QHeaderView::Stretch);
+  triggerTableWidget->horizontalHeader()->setSectionResizeMode(
+      COLUMN_RESPONSE, QHeaderView::Stretch);
+
+  for (int i = 0; i < triggers.size(); i++) {
+    addRow(triggers[i], i);
+  }
+  refreshCounts();
+
+  auto timer = new QTimer(this);
+  connect(timer, SIGNAL(timeout()), this, SLOT(refreshCounts()));
+  timer->start(250);
+}
+
+void TriggerDialog::addRow(const Trigger &trigger, int origin) {
+  int row = triggerTableWidget->rowCount();
+  triggerTableWidget->insertRow(row);
+
+  auto pattern = new QTableWidgetItem(trigger.pattern);
+  pattern->setData(Qt::UserRole, origin);
+  triggerTableWidget->setItem(row, COLUMN_PATTERN, pattern);
+
+  auto hex = new QTableWidgetItem();
+  hex->setFlags(Qt::ItemIsUserCheckable | Qt::ItemIsEnabled);
+  hex->setCheckState(trigger.hex ? Qt::Checked : Qt::Unchecked);
+  triggerTableWidget->setItem(row, COLUMN_HEX, hex);
+
+  auto action = new QComboBox();
+  // same order as Trigger::Action
+  action->addItems({"Highlight", "Count", "Bookmark capture", "Pause display",
+                    "Send response"});
+  action->setCurrentIndex(trigger.action);
+  triggerTableWidget->setCellWidget(row, COLUMN_ACTION, action);
+
+  triggerTableWidget->setItem(row, COLUMN_RESPONSE,
+                              new QTableWidgetItem(trigger.response));
+
+  auto count = new QTableWidgetItem();
+  count->setFlags(Qt::ItemIsEnabled);
+  triggerTableWidget->setItem(row, COLUMN_COUNT, count);
+}
+
+QVector<Trigger> TriggerDialog::triggers() const {
+  QVector<Trigger> result;
+  for (int row = 0; row < triggerTableWidget->rowCount(); row++) {
+    Trigger trigger;
+    trigger.pattern = triggerTableWidget->item(row, COLUMN_PATTERN)->text();
+    trigger.hex = triggerTableWidget->item(row, COLUMN_HEX)->checkState() ==
+                  Qt::Checked;
+    trigger.action = (Trigger::Action)((QComboBox *)triggerTableWidget
+                                           ->cellWidget(row, COLUMN_ACTION))
+                         ->currentIndex();
+    trigger.response = triggerTableWidget->item(row, COLUMN_RESPONSE)->text();
+    result.append(trigger);
+  }
+  return result;
+}
+
+QVector<int> TriggerDialog::origins() const {
+  QVector<int> result;
+  for (int row = 0; row < triggerTableWidget->rowCount(); row++) {
+    result.append(
+        triggerTableWidget->item(row, COLUMN_PATTERN)->data(Qt::UserRole).toInt());
+  }
+  return result;
+}
+
+void TriggerDialog::accept() {
+  auto all = triggers();
+  for (int row = 0; row < all.size(); row++) {
+    QString error = all[row].validate();
+    if (!error.isEmpty()) {
+      triggerTableWidget->setCurrentCell(row, COLUMN_PATTERN);
+      QMessageBox::warning(this, windowTitle(),
+                           QString("Row %1: %2").arg(row + 1).arg(error));
+      return;
+    }
+  }
+  QDialog::accept();
+}
+
+void TriggerDialog::onAdd() {
+  addRow(Trigger(), -1);
+  triggerTableWidget->editItem(
+      triggerTableWidget->item(triggerTableWidget->rowCount() - 1,
+                               COLUMN_PATTERN));
+}
+
+void TriggerDialog::onRemove() {
+  int row = triggerTableWidget->currentRow();
+  if (row >= 0) {
+    triggerTableWidget->removeRow(row);
+  }
+}
+
+void TriggerDialog::onResetCounts() {
+  counts->fill(0);
+  refreshCounts();
+}
+
+void TriggerDialog::refreshCounts() {
+  for (int row = 0; row < triggerTableWidget->rowCount(); row++) {
+    int origin =
+        triggerTableWidget->item(row, COLUMN_PATTERN)->data(Qt::UserRole).toInt();
+    triggerTableWidget->item(row, COLUMN_COUNT)
+        ->setText(origin >= 0 && origin < counts->size()
+                      ? QString::number(counts->at(origin))
+                      : QString());
+  }
+}
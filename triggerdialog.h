@@ -0,0 +1,37 @@
+#ifndef TRIGGERDIALOG_H
+#define TRIGGERDIALOG_H
+
+#include "triggerengine.h"
+#include "ui_triggerdialog.h"
+#include <QDialog>
+
+class TriggerDialog : public QDialog, private Ui::TriggerDialog {
+  Q_OBJECT
+
+public:
+  // counts is indexed like triggers and shown live while the dialog is open
+  TriggerDialog(const QVector<Trigger> &triggers, bool ignoreCase,
+                QVector<qint64> *counts, QWidget *parent = nullptr);
+
+  QVector<Trigger> triggers() const;
+  bool ignoreCase() const { return ignoreCaseCheckBox->isChecked(); }
+  // for each trigger the index it had when the dialog opened, -1 if new
+  QVector<int> origins() const;
+
+public slots:
+  // refuses rules that do not decode
+  void accept() override;
+
+private slots:
+  void onAdd();
+  void onRemove();
+  void onResetCounts();
+  void refreshCounts();
+
+private:
+  void addRow(const Trigger &trigger, int origin);
+
+  QVector<qint64> *counts;
+};
+
+#endif
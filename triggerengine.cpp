@@ -0,0 +1,57 @@
+#include "triggerengine.h"
+
+TriggerEngine::TriggerEngine(const QVector<Trigger> &triggers, bool ignoreCase,
+                             SerialPort *port, QObject *parent)
+    : QObject(parent) {
+  qRegisterMetaType<TriggerHit>();
+  qRegisterMetaType<QVector<TriggerHit>>("QVector<TriggerHit>");
+  this->port = port;
+  state = AhoCorasick::start();
+  offset = 0;
+
+  QList<QByteArray> patterns;
+  for (auto &trigger : triggers) {
+    patterns.append(trigger.patternBytes());
+    responses.append(trigger.action == Trigger::Respond
+                         ? trigger.responseBytes()
+                         : QByteArray());
+    ids.append(trigger.id);
+  }
+  automaton.build(patterns, ignoreCase);
+  hitIndex.fill(-1, triggers.size());
+}
+
+void TriggerEngine::process(const QByteArray &data, qint64 timestamp) {
+  if (automaton.isEmpty()) {
+    return;
+  }
+
+  auto p = (const quint8 *)data.constData();
+  int n = data.length();
+  for (int i = 0; i < n; i++) {
+    state = automaton.next(state, p[i]);
+    if (!automaton.hasMatches(state)) {
+      continue;
+    }
+    for (auto match = automaton.matchesBegin(state);
+         match != automaton.matchesEnd(state); match++) {
+      int trigger = *match;
+      if (hitIndex[trigger] < 0) {
+        hitIndex[trigger] = hits.size();
+        hits.append(TriggerHit{ids[trigger], 0, offset + i + 1, timestamp});
+      }
+      hits[hitIndex[trigger]].count++;
+      if (!responses[trigger].isEmpty()) {
+        port->write(responses[trigger]);
+        emit replied(responses[trigger]);
+      }
+    }
+  }
+  offset += n;
+
+  if (!hits.isEmpty()) {
+    emit triggered(hits);
+    hitIndex.fill(-1);
+    hits.clear();
+  }
+}
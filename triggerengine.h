@@ -0,0 +1,61 @@
+#ifndef TRIGGERENGINE_H
+#define TRIGGERENGINE_H
+
+#include "ahocorasick.h"
+#include "drivers/serialport.h"
+#include "sendencoder.h"
+#include <QMetaType>
+#include <QObject>
+#include <QVector>
+
+struct Trigger : public MatchRule {
+  enum Action { Highlight, Count, Bookmark, Pause, Respond };
+
+  Action action = Highlight;
+  // stays with the trigger through edits, unlike its index
+  int id = -1;
+};
+
+// what one trigger matched within one received chunk
+struct TriggerHit {
+  int trigger; // Trigger::id, not an index
+  int count;
+  // stream offset just past the first match in the chunk
+  qint64 offset;
+  qint64 timestamp;
+};
+Q_DECLARE_METATYPE(TriggerHit)
+Q_DECLARE_METATYPE(QVector<TriggerHit>)
+
+// Runs all triggers over the received stream in one pass on the port's
+// reader thread, keeping the automaton state across chunks so matches may
+// straddle them. Respond triggers reply from the reader thread, at once (see
+// AutoResponder for delayed replies); every other action is left to the
+// receiver of triggered().
+class TriggerEngine : public QObject, public ReceiveStage {
+  Q_OBJECT
+
+public:
+  TriggerEngine(const QVector<Trigger> &triggers, bool ignoreCase,
+                SerialPort *port, QObject *parent = nullptr);
+
+  void process(const QByteArray &data, qint64 timestamp) override;
+
+signals:
+  void triggered(QVector<TriggerHit> hits);
+  // every Respond reply handed to the port, for statistics and capture
+  void replied(QByteArray data);
+
+private:
+  AhoCorasick automaton;
+  QVector<QByteArray> responses; // empty unless the action is Respond
+  QVector<int> ids;
+  SerialPort *port;
+  int state;
+  qint64 offset;
+  // index into hits per trigger for the current chunk, -1 if none
+  QVector<int> hitIndex;
+  QVector<TriggerHit> hits;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "triggerhighlighter.h"
+
+TriggerHighlighter::TriggerHighlighter(QTextDocument *document)
+    : QSyntaxHighlighter(document) {
+  format.setBackground(Qt::yellow);
+  format.setForeground(Qt::black);
+}
+
+void TriggerHighlighter::setPatterns(const QList<QByteArray> &patterns,
+                                     bool ignoreCase) {
+  automaton.build(patterns, ignoreCase);
+  rehighlight();
+}
+
+void TriggerHighlighter::highlightBlock(const QString &text) {
+  if (automaton.isEmpty()) {
+    return;
+  }
+
+  // patterns are bytes, so match on UTF-8 and map back to characters
+  auto utf8 = text.toUtf8();
+  auto p = (const quint8 *)utf8.constData();
+  QVector<QPair<int, int>> matches; // first and last byte
+  int state = AhoCorasick::start();
+  for (int i = 0; i < utf8.length(); i++) {
+    state = automaton.next(state, p[i]);
+    for (auto match = automaton.matchesBegin(state);
+         match != automaton.matchesEnd(state); match++) {
+      matches.append(qMakePair(i + 1 - automaton.patternLength(*match), i));
+    }
+  }
+  if (matches.isEmpty()) {
+    return;
+  }
+
+  // characters before each byte; a four byte sequence is a surrogate pair
+  QVector<int> position(utf8.length() + 1);
+  int characters = 0;
+  for (int i = 0; i < utf8.length(); i++) {
+    position[i] = characters;
+    if ((p[i] & 0xC0) != 0x80) {
+      characters += p[i] >= 0xF0 ? 2 : 1;
+    }
+  }
+  position[utf8.length()] = characters;
+  for (auto &match : matches) {
+    // the character after the last byte starts at the next lead byte
+    int end = match.second + 1;
+    while (end < utf8.length() && (p[end] & 0xC0) == 0x80) {
+      end++;
+    }
+    int start = position[match.first];
+    setFormat(start, position[end] - start, format);
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef TRIGGERHIGHLIGHTER_H
+#define TRIGGERHIGHLIGHTER_H
+
+#include "ahocorasick.h"
+#include <QSyntaxHighlighter>
+#include <QTextCharFormat>
+
+// Marks Highlight trigger matches in the received text. Qt only calls
+// highlightBlock() for blocks that changed, so appending stays cheap, and
+// each block is matched against all patterns in one pass. Matches do not
+// span lines.
+class TriggerHighlighter : public QSyntaxHighlighter {
+  Q_OBJECT
+
+public:
+  explicit TriggerHighlighter(QTextDocument *document);
+
+  void setPatterns(const QList<QByteArray> &patterns, bool ignoreCase);
+
+protected:
+  void highlightBlock(const QString &text) override;
+
+private:
+  AhoCorasick automaton;
+  QTextCharFormat format;
+};
+
+#endif
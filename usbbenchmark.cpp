@@ -0,0 +1,158 @@
+// Drives the libusb drivers against the emulated chips and reports the
+// sustained receive rate they reach and the CPU time they spend on it.
+// Only built with QSERIAL_USB_EMULATOR.
+
+#include "drivers/chunkpool.h"
+#include "drivers/libusb.h"
+#include "drivers/serialportch34x.h"
+#include "drivers/serialportcp210x.h"
+#include "drivers/serialportpl2303.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QTimer>
+#include <cstdio>
+#include <ctime>
+
+#define WRITE_INTERVAL_MS 10
+
+libusb_context *context = nullptr;
+
+// runs on the reader thread, checks that the emulator's counting pattern
+// arrives in order
+struct Counter : public ReceiveStage {
+  QAtomicInteger<qint64> bytes;
+  QAtomicInteger<qint64> chunks;
+  QAtomicInteger<qint64> breaks;
+  quint8 expected = 0;
+  bool first = true;
+
+  void process(const QByteArray &data, qint64) override {
+    for (auto byte : data) {
+      if (!first && (quint8)byte != expected) {
+        breaks.fetchAndAddRelaxed(1);
+      }
+      first = false;
+      expected = byte + 1;
+    }
+    bytes.fetchAndAddRelaxed(data.length());
+    chunks.fetchAndAddRelaxed(1);
+  }
+};
+
+int main(int argc, char *argv[]) {
+  QCoreApplication app(argc, argv);
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Benchmarks the USB serial drivers against emulated chips.");
+  parser.addHelpOption();
+  parser.addOptions({
+      {{"t", "duration"}, "Seconds per driver, 5 by default.", "seconds", "5"},
+      {{"b", "baud"}, "Baud rate set through the driver.", "rate", "921600"},
+      {"rate",
+       "Bytes per second the chips produce regardless of the baud rate.",
+       "bytes"},
+      {"write", "Bytes per second written to the port meanwhile.", "bytes"},
+      {"cpu", "CPU to pin the reader threads to.", "cpu"},
+      {"sched", "Real-time scheduling of the reader threads, fifo:PRIORITY "
+                "or rr:PRIORITY.", "policy"},
+      {"mlock", "Lock the receive buffers in memory."},
+      {"read-mode", "low-latency (default) or bulk.", "mode"},
+  });
+  parser.process(app);
+
+  auto rc = libusb_init(&context);
+  Q_ASSERT(rc >= 0);
+  if (parser.isSet("rate")) {
+    UsbEmulator::setLineRate(parser.value("rate").toLongLong());
+  }
+  double duration = parser.value("duration").toDouble();
+  qint64 writeRate = parser.value("write").toLongLong();
+  ReaderTuning tuning;
+  if (parser.isSet("cpu")) {
+    tuning.cpu = parser.value("cpu").toInt();
+  }
+  if (parser.isSet("sched")) {
+    QStringList sched = parser.value("sched").split(':');
+    tuning.policy = sched[0] == "rr" ? ReaderTuning::RoundRobin
+                                     : ReaderTuning::Fifo;
+    tuning.priority = sched.value(1, "50").toInt();
+  }
+  tuning.lockMemory = parser.isSet("mlock");
+  if (parser.value("read-mode") == "bulk") {
+    tuning.readMode = ReaderTuning::Bulk;
+  }
+
+  QList<SerialPort *> ports;
+  ports.append(SerialPortCP210X::availablePorts());
+  ports.append(SerialPortCH34X::availablePorts());
+  ports.append(SerialPortPL2303::availablePorts());
+
+  printf("%-26s %10s %12s %12s %10s %8s %7s %9s %7s %9s %8s %8s %9s %8s\n",
+         "Driver", "Baud", "Line B/s", "Rx B/s", "Overrun", "Breaks", "CPU %",
+         "CPU ns/B", "Stalls", "Allocs/s", "p99 us", "Max us", "Chunks/s",
+         "Close ms");
+  for (auto port : ports) {
+    UsbEmulator::resetStats();
+    port->setReaderTuning(tuning);
+    if (!port->open()) {
+      printf("%-26s failed to open\n", qPrintable(port->portName()));
+      continue;
+    }
+    port->setBaudRate(parser.value("baud").toInt());
+    Counter counter;
+    port->addStage(&counter);
+
+    // writes in small slices, completions come back on the reader thread
+    QTimer writer;
+    QByteArray chunk(writeRate * WRITE_INTERVAL_MS / 1000, 'x');
+    QObject::connect(&writer, &QTimer::timeout, [&] {
+      if (!chunk.isEmpty()) {
+        port->write(chunk);
+      }
+    });
+    writer.start(WRITE_INTERVAL_MS);
+
+    qint64 allocations = ChunkPool::allocations();
+    std::clock_t cpuStart = std::clock();
+    QElapsedTimer wall;
+    wall.start();
+    QEventLoop loop;
+    QTimer::singleShot((int)(duration * 1000), &loop, SLOT(quit()));
+    loop.exec();
+    writer.stop();
+    double cpu = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    double elapsed = wall.nsecsElapsed() / 1e9;
+
+    port->removeStage(&counter);
+    // a read in flight is cancelled rather than waited out
+    QElapsedTimer closing;
+    closing.start();
+    port->close();
+    double closeMs = closing.nsecsElapsed() / 1e6;
+    // the stats were reset before open, only the device under test moved
+    UsbEmulator::DeviceStats device = {};
+    for (auto &candidate : UsbEmulator::stats()) {
+      if (candidate.controlTransfers > device.controlTransfers) {
+        device = candidate;
+      }
+    }
+    qint64 bytes = counter.bytes.loadAcquire();
+    // receive buffers taken from the heap rather than the port's pool
+    double allocationRate =
+        (ChunkPool::allocations() - allocations) / elapsed;
+    // how late the reader came back from reads that were due
+    auto latency = port->schedulingLatency();
+    printf("%-26s %10d %12lld %12.0f %10lld %8lld %7.1f %9.1f %7lld %9.1f "
+           "%8lld %8lld %9.1f %8.1f\n",
+           qPrintable(port->portName()), device.baudRate,
+           (long long)device.lineRate, bytes / elapsed,
+           (long long)device.overrun, (long long)counter.breaks.loadAcquire(),
+           cpu / elapsed * 100, bytes ? cpu * 1e9 / bytes : 0.0,
+           (long long)device.stalls, allocationRate,
+           (long long)latency.p99Ns / 1000, (long long)latency.maxNs / 1000,
+           counter.chunks.loadAcquire() / elapsed, closeMs);
+  }
+  return 0;
+}